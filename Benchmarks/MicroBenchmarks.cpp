@@ -0,0 +1,1210 @@
+#include "MicroBenchmarks.h"
+#include "Benchmark.h"
+#include "DrawList.h"
+#include "DynamicMesh.h"
+#include "SpriteBatch.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t kTargetSize = 256;
+constexpr uint32_t kDescriptorBatch = 1024;
+
+double elapsedMs( Clock::time_point start )
+{
+    return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+}
+
+std::string formatSize( VkDeviceSize size )
+{
+    if ( size >= ( 1ull << 30 ) && size % ( 1ull << 30 ) == 0 )
+    {
+        return std::to_string( size >> 30 ) + "GB";
+    }
+    if ( size >= ( 1ull << 20 ) && size % ( 1ull << 20 ) == 0 )
+    {
+        return std::to_string( size >> 20 ) + "MB";
+    }
+    if ( size >= ( 1ull << 10 ) && size % ( 1ull << 10 ) == 0 )
+    {
+        return std::to_string( size >> 10 ) + "KB";
+    }
+    return std::to_string( size ) + "B";
+}
+
+// createBuffer may throw after the buffer itself was created, so both handles are
+// checked separately.
+void destroyBuffer( VkDevice device, VkBuffer &buffer, VkDeviceMemory &memory )
+{
+    if ( buffer != VK_NULL_HANDLE )
+    {
+        vkDestroyBuffer( device, buffer, nullptr );
+        buffer = VK_NULL_HANDLE;
+    }
+    if ( memory != VK_NULL_HANDLE )
+    {
+        vkFreeMemory( device, memory, nullptr );
+        memory = VK_NULL_HANDLE;
+    }
+}
+
+void writeJsonString( std::ostream &out, const std::string &text )
+{
+    out << '"';
+    for ( char c : text )
+    {
+        if ( c == '"' || c == '\\' )
+        {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+uint32_t parseNumber( const std::string &arg, const std::string &value )
+{
+    try
+    {
+        size_t used = 0;
+        unsigned long number = std::stoul( value, &used );
+        if ( used == value.size() )
+        {
+            return static_cast<uint32_t>( number );
+        }
+    }
+    catch ( const std::exception & )
+    {
+    }
+    throw std::runtime_error( "Invalid value for " + arg + ": " + value );
+}
+} // namespace
+
+MicroBenchmarkOptions parseMicroBenchmarkOptions( int argc, char **argv )
+{
+    MicroBenchmarkOptions options;
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        std::string arg = argv[i];
+
+        auto nextValue = [&]() -> std::string {
+            if ( i + 1 >= argc )
+            {
+                throw std::runtime_error( "Missing value for " + arg );
+            }
+            return argv[++i];
+        };
+
+        if ( arg == "--out" )
+        {
+            options.outputFile = nextValue();
+        }
+        else if ( arg == "--shaders" )
+        {
+            options.shaderDir = nextValue();
+            if ( !options.shaderDir.empty() && options.shaderDir.back() != '/' && options.shaderDir.back() != '\\' )
+            {
+                options.shaderDir += '/';
+            }
+        }
+        else if ( arg == "--device" )
+        {
+            options.deviceIndex = parseNumber( arg, nextValue() );
+        }
+        else if ( arg == "--max-upload-mb" )
+        {
+            options.maxUploadSize = static_cast<VkDeviceSize>( parseNumber( arg, nextValue() ) ) << 20;
+        }
+        else
+        {
+            throw std::runtime_error( "Unknown argument: " + arg );
+        }
+    }
+
+    return options;
+}
+
+MicroBenchmarks::MicroBenchmarks( const MicroBenchmarkOptions &options )
+    : m_Options( options )
+{
+}
+
+void MicroBenchmarks::run()
+{
+    initVulkan();
+
+    std::cout << "Micro-benchmarks on " << m_Properties.deviceName << "\n";
+
+    benchmarkBufferCreation();
+    benchmarkStagedUpload();
+    benchmarkDescriptorSets();
+    benchmarkPipelineCreation();
+    benchmarkCommandBuffers();
+    benchmarkSpriteBatch();
+    benchmarkDynamicMesh();
+    benchmarkDrawSort();
+
+    writeJson();
+    cleanup();
+}
+
+void MicroBenchmarks::initVulkan()
+{
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "Micro-benchmarks";
+    appInfo.applicationVersion = VK_MAKE_VERSION( 1, 0, 0 );
+    appInfo.pEngineName = "No Engine";
+    appInfo.engineVersion = VK_MAKE_VERSION( 1, 0, 0 );
+    appInfo.apiVersion = VK_API_VERSION_1_0;
+
+    // No surface, no layers: the numbers should reflect the driver alone.
+    VkInstanceCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    createInfo.pApplicationInfo = &appInfo;
+
+    if ( vkCreateInstance( &createInfo, nullptr, &m_Instance ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create instance!" );
+    }
+
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices( m_Instance, &deviceCount, nullptr );
+    if ( m_Options.deviceIndex >= deviceCount )
+    {
+        throw std::runtime_error( "No Vulkan device with index " + std::to_string( m_Options.deviceIndex ) );
+    }
+
+    std::vector<VkPhysicalDevice> devices( deviceCount );
+    vkEnumeratePhysicalDevices( m_Instance, &deviceCount, devices.data() );
+    m_PhysicalDevice = devices[m_Options.deviceIndex];
+    vkGetPhysicalDeviceProperties( m_PhysicalDevice, &m_Properties );
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties( m_PhysicalDevice, &queueFamilyCount, nullptr );
+    std::vector<VkQueueFamilyProperties> queueFamilies( queueFamilyCount );
+    vkGetPhysicalDeviceQueueFamilyProperties( m_PhysicalDevice, &queueFamilyCount, queueFamilies.data() );
+
+    bool found = false;
+    for ( uint32_t i = 0; i < queueFamilyCount; ++i )
+    {
+        if ( queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT )
+        {
+            m_QueueFamily = i;
+            found = true;
+            break;
+        }
+    }
+    if ( !found )
+    {
+        throw std::runtime_error( "The device has no graphics queue." );
+    }
+
+    float queuePriority = 1.0f;
+    VkDeviceQueueCreateInfo queueCreateInfo{};
+    queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueCreateInfo.queueFamilyIndex = m_QueueFamily;
+    queueCreateInfo.queueCount = 1;
+    queueCreateInfo.pQueuePriorities = &queuePriority;
+
+    VkPhysicalDeviceFeatures deviceFeatures{};
+    VkDeviceCreateInfo deviceInfo{};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueCreateInfo;
+    deviceInfo.pEnabledFeatures = &deviceFeatures;
+
+    if ( vkCreateDevice( m_PhysicalDevice, &deviceInfo, nullptr, &m_Device ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create logical device!" );
+    }
+    vkGetDeviceQueue( m_Device, m_QueueFamily, 0, &m_Queue );
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = m_QueueFamily;
+    if ( vkCreateCommandPool( m_Device, &poolInfo, nullptr, &m_CommandPool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to create command pool!" );
+    }
+
+    createRenderTarget();
+    createPipelineLayout();
+
+    m_VertShader = createShaderModule( m_Device, readFile( m_Options.shaderDir + "vert.spv" ) );
+    m_FragShader = createShaderModule( m_Device, readFile( m_Options.shaderDir + "frag.spv" ) );
+}
+
+void MicroBenchmarks::cleanup()
+{
+    vkDestroyShaderModule( m_Device, m_FragShader, nullptr );
+    vkDestroyShaderModule( m_Device, m_VertShader, nullptr );
+    vkDestroyPipelineLayout( m_Device, m_PipelineLayout, nullptr );
+    vkDestroyDescriptorSetLayout( m_Device, m_DescriptorSetLayout, nullptr );
+    vkDestroyFramebuffer( m_Device, m_Framebuffer, nullptr );
+    vkDestroyImageView( m_Device, m_TargetView, nullptr );
+    vkDestroyImage( m_Device, m_TargetImage, nullptr );
+    vkFreeMemory( m_Device, m_TargetMemory, nullptr );
+    vkDestroyRenderPass( m_Device, m_RenderPass, nullptr );
+    vkDestroyCommandPool( m_Device, m_CommandPool, nullptr );
+    vkDestroyDevice( m_Device, nullptr );
+    vkDestroyInstance( m_Instance, nullptr );
+}
+
+void MicroBenchmarks::benchmarkBufferCreation()
+{
+    const VkDeviceSize sizes[] = { 256, 64 << 10, 16 << 20 };
+    const uint32_t iterations = 200;
+
+    for ( VkDeviceSize size : sizes )
+    {
+        Result result;
+        result.name = "createBuffer/" + formatSize( size );
+        result.unit = "ms";
+
+        for ( uint32_t i = 0; i < iterations; ++i )
+        {
+            VkBuffer buffer = VK_NULL_HANDLE;
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            try
+            {
+                auto start = Clock::now();
+                createBuffer( m_PhysicalDevice,
+                              m_Device,
+                              size,
+                              VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                              buffer,
+                              memory );
+                result.samples.push_back( elapsedMs( start ) );
+            }
+            catch ( const std::exception &e )
+            {
+                result.samples.clear();
+                result.skipReason = e.what();
+            }
+            destroyBuffer( m_Device, buffer, memory );
+            if ( !result.skipReason.empty() )
+            {
+                break;
+            }
+        }
+
+        printResult( result );
+        m_Results.push_back( std::move( result ) );
+    }
+}
+
+void MicroBenchmarks::benchmarkStagedUpload()
+{
+    for ( VkDeviceSize size = 1 << 10; size <= m_Options.maxUploadSize; size *= 4 )
+    {
+        Result result;
+        result.name = "stagedUpload/" + formatSize( size );
+        result.unit = "ms";
+        result.derivedName = "GB/s";
+
+        // Keep the total amount copied per size roughly bounded.
+        uint32_t iterations = static_cast<uint32_t>( std::clamp<VkDeviceSize>( ( 256ull << 20 ) / size, 3, 50 ) );
+
+        VkBuffer stagingBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+        VkBuffer deviceBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory deviceMemory = VK_NULL_HANDLE;
+        try
+        {
+            createBuffer( m_PhysicalDevice,
+                          m_Device,
+                          size,
+                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                          stagingBuffer,
+                          stagingMemory );
+            createBuffer( m_PhysicalDevice,
+                          m_Device,
+                          size,
+                          VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                          deviceBuffer,
+                          deviceMemory );
+
+            void *data;
+            vkMapMemory( m_Device, stagingMemory, 0, size, 0, &data );
+            memset( data, 0x5a, (size_t)size );
+            vkUnmapMemory( m_Device, stagingMemory );
+
+            // The first copy pays for lazy page commits in the driver.
+            copyBuffer( m_Device, m_CommandPool, m_Queue, stagingBuffer, deviceBuffer, size );
+            for ( uint32_t i = 0; i < iterations; ++i )
+            {
+                auto start = Clock::now();
+                copyBuffer( m_Device, m_CommandPool, m_Queue, stagingBuffer, deviceBuffer, size );
+                result.samples.push_back( elapsedMs( start ) );
+            }
+
+            double medianMs = summarizeSamples( result.samples ).p50;
+            result.derivedValue = medianMs > 0.0 ? size / ( medianMs / 1000.0 ) / 1e9 : 0.0;
+        }
+        catch ( const std::exception &e )
+        {
+            // Large sizes regularly exceed what software or integrated devices can allocate.
+            result.samples.clear();
+            result.skipReason = e.what();
+        }
+        destroyBuffer( m_Device, deviceBuffer, deviceMemory );
+        destroyBuffer( m_Device, stagingBuffer, stagingMemory );
+
+        printResult( result );
+        m_Results.push_back( std::move( result ) );
+    }
+}
+
+void MicroBenchmarks::benchmarkDescriptorSets()
+{
+    const uint32_t rounds = 20;
+
+    VkBuffer uniformBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory uniformMemory = VK_NULL_HANDLE;
+    createBuffer( m_PhysicalDevice,
+                  m_Device,
+                  256,
+                  VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  uniformBuffer,
+                  uniformMemory );
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSize.descriptorCount = kDescriptorBatch;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = kDescriptorBatch;
+
+    VkDescriptorPool pool;
+    if ( vkCreateDescriptorPool( m_Device, &poolInfo, nullptr, &pool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create Descriptor pool." );
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts( kDescriptorBatch, m_DescriptorSetLayout );
+    std::vector<VkDescriptorSet> sets( kDescriptorBatch );
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = kDescriptorBatch;
+    allocInfo.pSetLayouts = layouts.data();
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = uniformBuffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = 256;
+
+    std::vector<VkWriteDescriptorSet> writes( kDescriptorBatch );
+
+    Result allocation;
+    allocation.name = "descriptorAllocate/x" + std::to_string( kDescriptorBatch );
+    allocation.unit = "ms";
+    allocation.derivedName = "sets/s";
+
+    Result update;
+    update.name = "descriptorUpdate/x" + std::to_string( kDescriptorBatch );
+    update.unit = "ms";
+    update.derivedName = "sets/s";
+
+    for ( uint32_t round = 0; round < rounds; ++round )
+    {
+        auto start = Clock::now();
+        if ( vkAllocateDescriptorSets( m_Device, &allocInfo, sets.data() ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to allocae descriptor sets" );
+        }
+        allocation.samples.push_back( elapsedMs( start ) );
+
+        for ( uint32_t i = 0; i < kDescriptorBatch; ++i )
+        {
+            writes[i] = {};
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = sets[i];
+            writes[i].dstBinding = 0;
+            writes[i].dstArrayElement = 0;
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            writes[i].descriptorCount = 1;
+            writes[i].pBufferInfo = &bufferInfo;
+        }
+
+        start = Clock::now();
+        vkUpdateDescriptorSets( m_Device, kDescriptorBatch, writes.data(), 0, nullptr );
+        update.samples.push_back( elapsedMs( start ) );
+
+        vkResetDescriptorPool( m_Device, pool, 0 );
+    }
+
+    for ( Result *result : { &allocation, &update } )
+    {
+        double medianMs = summarizeSamples( result->samples ).p50;
+        result->derivedValue = medianMs > 0.0 ? kDescriptorBatch / ( medianMs / 1000.0 ) : 0.0;
+        printResult( *result );
+        m_Results.push_back( std::move( *result ) );
+    }
+
+    vkDestroyDescriptorPool( m_Device, pool, nullptr );
+    destroyBuffer( m_Device, uniformBuffer, uniformMemory );
+}
+
+void MicroBenchmarks::benchmarkPipelineCreation()
+{
+    const uint32_t iterations = 20;
+
+    // Drivers often keep a cache of their own, so the uncached figure can still be
+    // faster than a true first-time compile.
+    Result uncached;
+    uncached.name = "createGraphicsPipeline/noCache";
+    uncached.unit = "ms";
+    for ( uint32_t i = 0; i < iterations; ++i )
+    {
+        auto start = Clock::now();
+        VkPipeline pipeline = createPipeline( VK_NULL_HANDLE );
+        uncached.samples.push_back( elapsedMs( start ) );
+        vkDestroyPipeline( m_Device, pipeline, nullptr );
+    }
+    printResult( uncached );
+    m_Results.push_back( std::move( uncached ) );
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    VkPipelineCache cache;
+    if ( vkCreatePipelineCache( m_Device, &cacheInfo, nullptr, &cache ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create pipeline cache!" );
+    }
+
+    Result cold;
+    cold.name = "createGraphicsPipeline/coldCache";
+    cold.unit = "ms";
+    auto start = Clock::now();
+    vkDestroyPipeline( m_Device, createPipeline( cache ), nullptr );
+    cold.samples.push_back( elapsedMs( start ) );
+    printResult( cold );
+    m_Results.push_back( std::move( cold ) );
+
+    Result warm;
+    warm.name = "createGraphicsPipeline/warmCache";
+    warm.unit = "ms";
+    for ( uint32_t i = 0; i < iterations; ++i )
+    {
+        start = Clock::now();
+        VkPipeline pipeline = createPipeline( cache );
+        warm.samples.push_back( elapsedMs( start ) );
+        vkDestroyPipeline( m_Device, pipeline, nullptr );
+    }
+    printResult( warm );
+    m_Results.push_back( std::move( warm ) );
+
+    vkDestroyPipelineCache( m_Device, cache, nullptr );
+}
+
+void MicroBenchmarks::benchmarkCommandBuffers()
+{
+    VkPipeline pipeline = createPipeline( VK_NULL_HANDLE );
+
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+    createBuffer( m_PhysicalDevice,
+                  m_Device,
+                  sizeof( float ) * 5 * 3,
+                  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  vertexBuffer,
+                  vertexMemory );
+
+    VkBuffer uniformBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory uniformMemory = VK_NULL_HANDLE;
+    createBuffer( m_PhysicalDevice,
+                  m_Device,
+                  sizeof( float ) * 16 * 3,
+                  VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  uniformBuffer,
+                  uniformMemory );
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSize.descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 1;
+
+    VkDescriptorPool pool;
+    if ( vkCreateDescriptorPool( m_Device, &poolInfo, nullptr, &pool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create Descriptor pool." );
+    }
+
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = pool;
+    setInfo.descriptorSetCount = 1;
+    setInfo.pSetLayouts = &m_DescriptorSetLayout;
+
+    VkDescriptorSet descriptorSet;
+    if ( vkAllocateDescriptorSets( m_Device, &setInfo, &descriptorSet ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to allocae descriptor sets" );
+    }
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = uniformBuffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets( m_Device, 1, &descriptorWrite, 0, nullptr );
+
+    VkCommandBuffer commandBuffer = allocateCommandBuffer();
+    VkFence         fence = createFence();
+
+    const std::array<uint32_t, 3> drawCounts = { 0, 100, 10000 };
+    for ( uint32_t drawCount : drawCounts )
+    {
+        uint32_t iterations = drawCount >= 10000 ? 20 : 100;
+
+        Result record;
+        record.name = "recordCommandBuffer/" + std::to_string( drawCount ) + "draws";
+        record.unit = "ms";
+
+        Result submit;
+        submit.name = "submitAndWait/" + std::to_string( drawCount ) + "draws";
+        submit.unit = "ms";
+
+        for ( uint32_t i = 0; i < iterations; ++i )
+        {
+            auto start = Clock::now();
+
+            beginCommandBuffer( commandBuffer );
+            beginTargetPass( commandBuffer );
+
+            vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+
+            VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers( commandBuffer, 0, 1, &vertexBuffer, &offset );
+            vkCmdBindDescriptorSets( commandBuffer,
+                                     VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                     m_PipelineLayout,
+                                     0, 1, &descriptorSet, 0, nullptr );
+
+            for ( uint32_t draw = 0; draw < drawCount; ++draw )
+            {
+                vkCmdDraw( commandBuffer, 3, 1, 0, 0 );
+            }
+
+            vkCmdEndRenderPass( commandBuffer );
+            vkEndCommandBuffer( commandBuffer );
+            record.samples.push_back( elapsedMs( start ) );
+
+            start = Clock::now();
+            submitAndWait( commandBuffer, fence );
+            submit.samples.push_back( elapsedMs( start ) );
+        }
+
+        printResult( record );
+        printResult( submit );
+        m_Results.push_back( std::move( record ) );
+        m_Results.push_back( std::move( submit ) );
+    }
+
+    vkDestroyFence( m_Device, fence, nullptr );
+    vkFreeCommandBuffers( m_Device, m_CommandPool, 1, &commandBuffer );
+    vkDestroyDescriptorPool( m_Device, pool, nullptr );
+    destroyBuffer( m_Device, uniformBuffer, uniformMemory );
+    destroyBuffer( m_Device, vertexBuffer, vertexMemory );
+    vkDestroyPipeline( m_Device, pipeline, nullptr );
+}
+
+void MicroBenchmarks::benchmarkSpriteBatch()
+{
+    VkCommandBuffer commandBuffer = allocateCommandBuffer();
+    VkFence         fence = createFence();
+
+    const std::array<uint32_t, 4> quadCounts = { 10000, 100000, 1000000, 4000000 };
+    for ( uint32_t quadCount : quadCounts )
+    {
+        uint32_t iterations = quadCount >= 1000000 ? 10 : 50;
+
+        // Filling the mapped buffer alone, then the whole frame: fill, record, draw.
+        // The largest batches need a few hundred MB of host visible memory and may be skipped.
+        SpriteBatch batch;
+        auto measure = [&]( Result &submit, Result &frame )
+        {
+            SpriteBatchCreateInfo createInfo{};
+            createInfo.physicalDevice = m_PhysicalDevice;
+            createInfo.device = m_Device;
+            createInfo.renderPass = m_RenderPass;
+            createInfo.framesInFlight = 1;
+            createInfo.initialCapacity = quadCount;
+            createInfo.shaderDir = m_Options.shaderDir;
+            batch.create( createInfo );
+
+            const uint32_t columns = static_cast<uint32_t>( std::sqrt( static_cast<double>( quadCount ) ) ) + 1;
+            const float cell = static_cast<float>( kTargetSize ) / columns;
+
+            for ( uint32_t i = 0; i < iterations; ++i )
+            {
+                auto start = Clock::now();
+                batch.begin( 0 );
+                for ( uint32_t quad = 0; quad < quadCount; ++quad )
+                {
+                    float x = static_cast<float>( quad % columns ) * cell;
+                    float y = static_cast<float>( quad / columns ) * cell;
+                    batch.submitQuad( { x, y }, { cell, cell }, { x / kTargetSize, y / kTargetSize, 0.5f } );
+                }
+                submit.samples.push_back( elapsedMs( start ) );
+
+                beginCommandBuffer( commandBuffer );
+                beginTargetPass( commandBuffer );
+                batch.flush( commandBuffer, { kTargetSize, kTargetSize } );
+                vkCmdEndRenderPass( commandBuffer );
+                vkEndCommandBuffer( commandBuffer );
+
+                submitAndWait( commandBuffer, fence );
+                frame.samples.push_back( elapsedMs( start ) );
+            }
+        };
+        measureRates( "spriteSubmit/" + std::to_string( quadCount ) + "quads",
+                      "spriteFrame/" + std::to_string( quadCount ) + "quads",
+                      "Mquads/s",
+                      quadCount,
+                      measure );
+        batch.cleanup();
+    }
+
+    vkDestroyFence( m_Device, fence, nullptr );
+    vkFreeCommandBuffers( m_Device, m_CommandPool, 1, &commandBuffer );
+}
+
+void MicroBenchmarks::benchmarkDynamicMesh()
+{
+    VkCommandBuffer commandBuffer = allocateCommandBuffer();
+    VkFence         fence = createFence();
+
+    // Position and color, like the renderer's Vertex.
+    constexpr uint32_t kStride = 5 * sizeof( float );
+    const std::array<uint32_t, 3> vertexCounts = { 1000, 100000, 1000000 };
+    for ( uint32_t vertexCount : vertexCounts )
+    {
+        uint32_t iterations = vertexCount >= 1000000 ? 20 : 100;
+        std::vector<float> vertices( static_cast<size_t>( vertexCount ) * 5, 0.5f );
+
+        // Staging the edit alone, then the whole frame: stage, record the copy, submit, wait.
+        DeletionQueue deletionQueue;
+        deletionQueue.create( m_Device );
+        DynamicMesh mesh;
+        auto measure = [&]( Result &stage, Result &frame )
+        {
+            DynamicMeshCreateInfo createInfo{};
+            createInfo.physicalDevice = m_PhysicalDevice;
+            createInfo.device = m_Device;
+            createInfo.deletionQueue = &deletionQueue;
+            createInfo.framesInFlight = 1;
+            createInfo.vertexStride = kStride;
+            createInfo.vertexCapacity = vertexCount;
+            createInfo.stagingBytes = static_cast<VkDeviceSize>( vertexCount ) * kStride;
+            mesh.create( createInfo );
+            mesh.setVertices( vertices.data(), vertexCount );
+
+            for ( uint32_t i = 0; i < iterations; ++i )
+            {
+                deletionQueue.beginFrame( i );
+                mesh.beginFrame( 0 );
+
+                auto start = Clock::now();
+                vertices[0] = static_cast<float>( i );
+                mesh.updateVertices( 0, vertices.data(), vertexCount );
+                stage.samples.push_back( elapsedMs( start ) );
+
+                beginCommandBuffer( commandBuffer );
+                mesh.recordUploads( commandBuffer );
+                vkEndCommandBuffer( commandBuffer );
+
+                submitAndWait( commandBuffer, fence );
+                frame.samples.push_back( elapsedMs( start ) );
+                deletionQueue.collect( i );
+            }
+        };
+        measureRates( "meshUpdate/" + std::to_string( vertexCount ) + "vertices",
+                      "meshFrame/" + std::to_string( vertexCount ) + "vertices",
+                      "Mvertices/s",
+                      vertexCount,
+                      measure );
+        vkQueueWaitIdle( m_Queue );
+        mesh.cleanup();
+        deletionQueue.cleanup();
+    }
+
+    vkDestroyFence( m_Device, fence, nullptr );
+    vkFreeCommandBuffers( m_Device, m_CommandPool, 1, &commandBuffer );
+}
+
+void MicroBenchmarks::benchmarkDrawSort()
+{
+    std::vector<uint32_t> threadCounts = { 1 };
+    if ( std::thread::hardware_concurrency() > 1 )
+    {
+        threadCounts.push_back( std::thread::hardware_concurrency() );
+    }
+
+    const std::array<uint32_t, 3> keyCounts = { 16 * 1024, 256 * 1024, 1024 * 1024 };
+    for ( uint32_t keyCount : keyCounts )
+    {
+        uint32_t iterations = keyCount >= 1024 * 1024 ? 10 : 50;
+
+        // About four items per key so equal keys have an order to keep. The multiply
+        // spreads the keys over all eight digits.
+        std::vector<DrawSortItem> input( keyCount );
+        uint64_t state = 0x2545F4914F6CDD1Dull;
+        for ( uint32_t i = 0; i < keyCount; ++i )
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            input[i] = { ( state % ( keyCount / 4 ) ) * 0x9E3779B97F4A7C15ull, i };
+        }
+
+        for ( uint32_t threadCount : threadCounts )
+        {
+            Result sort;
+            sort.name = "radixSort/" + std::to_string( keyCount ) + "keys/" + std::to_string( threadCount ) + "threads";
+            sort.unit = "ms";
+            sort.derivedName = "Mkeys/s";
+
+            std::vector<DrawSortItem> items;
+            std::vector<DrawSortItem> scratch;
+            for ( uint32_t i = 0; i < iterations; ++i )
+            {
+                items = input;
+                auto start = Clock::now();
+                radixSort( items, scratch, threadCount );
+                sort.samples.push_back( elapsedMs( start ) );
+            }
+
+            // The input indices are ascending, so a stable sort leaves them ascending
+            // within every run of equal keys.
+            std::vector<bool> seen( keyCount, false );
+            for ( size_t i = 0; i < items.size(); ++i )
+            {
+                bool ordered = i == 0 || items[i - 1].key < items[i].key ||
+                               ( items[i - 1].key == items[i].key && items[i - 1].index < items[i].index );
+                if ( !ordered || items[i].index >= keyCount || seen[items[i].index] )
+                {
+                    throw std::runtime_error( sort.name + " produced an unsorted or unstable result" );
+                }
+                seen[items[i].index] = true;
+            }
+
+            double medianMs = summarizeSamples( sort.samples ).p50;
+            sort.derivedValue = medianMs > 0.0 ? keyCount / ( medianMs * 1e3 ) : 0.0;
+            printResult( sort );
+            m_Results.push_back( std::move( sort ) );
+        }
+    }
+}
+
+VkCommandBuffer MicroBenchmarks::allocateCommandBuffer()
+{
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_CommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if ( vkAllocateCommandBuffers( m_Device, &allocInfo, &commandBuffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to allocate command buffer!" );
+    }
+    return commandBuffer;
+}
+
+VkFence MicroBenchmarks::createFence()
+{
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    if ( vkCreateFence( m_Device, &fenceInfo, nullptr, &fence ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to create fence!" );
+    }
+    return fence;
+}
+
+void MicroBenchmarks::beginCommandBuffer( VkCommandBuffer commandBuffer )
+{
+    vkResetCommandBuffer( commandBuffer, 0 );
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer( commandBuffer, &beginInfo );
+}
+
+void MicroBenchmarks::beginTargetPass( VkCommandBuffer commandBuffer )
+{
+    VkClearValue clearColor = { { { 0.0f, 0.0f, 0.0f, 1.0f } } };
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = m_RenderPass;
+    renderPassInfo.framebuffer = m_Framebuffer;
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = { kTargetSize, kTargetSize };
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearColor;
+    vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+
+    VkViewport viewport{ 0.0f, 0.0f, (float)kTargetSize, (float)kTargetSize, 0.0f, 1.0f };
+    vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
+    VkRect2D scissor{ { 0, 0 }, { kTargetSize, kTargetSize } };
+    vkCmdSetScissor( commandBuffer, 0, 1, &scissor );
+}
+
+void MicroBenchmarks::submitAndWait( VkCommandBuffer commandBuffer, VkFence fence )
+{
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    if ( vkQueueSubmit( m_Queue, 1, &submitInfo, fence ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to submit command buffer!" );
+    }
+    vkWaitForFences( m_Device, 1, &fence, VK_TRUE, UINT64_MAX );
+    vkResetFences( m_Device, 1, &fence );
+}
+
+void MicroBenchmarks::measureRates( const std::string &stepName,
+                                    const std::string &frameName,
+                                    const std::string &rateName,
+                                    uint32_t itemCount,
+                                    const std::function<void( Result &step, Result &frame )> &measure )
+{
+    Result step;
+    step.name = stepName;
+    Result frame;
+    frame.name = frameName;
+    for ( Result *result : { &step, &frame } )
+    {
+        result->unit = "ms";
+        result->derivedName = rateName;
+    }
+
+    try
+    {
+        measure( step, frame );
+        for ( Result *result : { &step, &frame } )
+        {
+            double medianMs = summarizeSamples( result->samples ).p50;
+            result->derivedValue = medianMs > 0.0 ? itemCount / ( medianMs * 1e3 ) : 0.0;
+        }
+    }
+    catch ( const std::exception &e )
+    {
+        for ( Result *result : { &step, &frame } )
+        {
+            result->samples.clear();
+            result->skipReason = e.what();
+        }
+    }
+
+    printResult( step );
+    printResult( frame );
+    m_Results.push_back( std::move( step ) );
+    m_Results.push_back( std::move( frame ) );
+}
+
+void MicroBenchmarks::createRenderTarget()
+{
+    const VkFormat format = VK_FORMAT_B8G8R8A8_UNORM;
+
+    createImage( m_PhysicalDevice,
+                 m_Device,
+                 kTargetSize,
+                 kTargetSize,
+                 1,
+                 format,
+                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 m_TargetImage,
+                 m_TargetMemory );
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_TargetImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+    if ( vkCreateImageView( m_Device, &viewInfo, nullptr, &m_TargetView ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create image view!" );
+    }
+
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = format;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    if ( vkCreateRenderPass( m_Device, &renderPassInfo, nullptr, &m_RenderPass ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to create render pass!" );
+    }
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = m_RenderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &m_TargetView;
+    framebufferInfo.width = kTargetSize;
+    framebufferInfo.height = kTargetSize;
+    framebufferInfo.layers = 1;
+    if ( vkCreateFramebuffer( m_Device, &framebufferInfo, nullptr, &m_Framebuffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to create framebuffer!" );
+    }
+}
+
+void MicroBenchmarks::createPipelineLayout()
+{
+    // Same interface as VertexShader.vert.
+    VkDescriptorSetLayoutBinding uboLayoutBinding{};
+    uboLayoutBinding.binding = 0;
+    uboLayoutBinding.descriptorCount = 1;
+    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &uboLayoutBinding;
+    if ( vkCreateDescriptorSetLayout( m_Device, &layoutInfo, nullptr, &m_DescriptorSetLayout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create descriptor set layout. " );
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+    if ( vkCreatePipelineLayout( m_Device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create pipeline layout!" );
+    }
+}
+
+VkPipeline MicroBenchmarks::createPipeline( VkPipelineCache cache )
+{
+    VkPipelineShaderStageCreateInfo shaderStages[2]{};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = m_VertShader;
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = m_FragShader;
+    shaderStages[1].pName = "main";
+
+    // Matches App's Vertex: vec2 position followed by vec3 color.
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof( float ) * 5;
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+    attributeDescriptions[0].offset = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[1].offset = sizeof( float ) * 2;
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>( attributeDescriptions.size() );
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>( dynamicStates.size() );
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_PipelineLayout;
+    pipelineInfo.renderPass = m_RenderPass;
+    pipelineInfo.subpass = 0;
+
+    VkPipeline pipeline;
+    if ( vkCreateGraphicsPipelines( m_Device, cache, 1, &pipelineInfo, nullptr, &pipeline ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create graphics pipeline!" );
+    }
+
+    return pipeline;
+}
+
+void MicroBenchmarks::printResult( const Result &result ) const
+{
+    std::cout << std::left << std::setw( 36 ) << result.name << std::right;
+    if ( !result.skipReason.empty() )
+    {
+        std::cout << "skipped (" << result.skipReason << ")\n";
+        return;
+    }
+
+    SampleSummary summary = summarizeSamples( result.samples );
+    std::cout << std::fixed << std::setprecision( 4 ) << "p50 " << std::setw( 10 ) << summary.p50 << " "
+              << result.unit << "  mean " << std::setw( 10 ) << summary.mean << "  p95 " << std::setw( 10 )
+              << summary.p95;
+    if ( !result.derivedName.empty() )
+    {
+        std::cout << "  " << std::setprecision( 2 ) << result.derivedValue << " " << result.derivedName;
+    }
+    std::cout << "\n";
+}
+
+void MicroBenchmarks::writeJson() const
+{
+    std::ofstream out( m_Options.outputFile, std::ios::trunc );
+    if ( !out.is_open() )
+    {
+        throw std::runtime_error( "Failed to open " + m_Options.outputFile );
+    }
+
+    out << std::fixed << std::setprecision( 6 );
+    out << "{\n  \"device\": ";
+    writeJsonString( out, m_Properties.deviceName );
+    out << ",\n  \"vendorId\": " << m_Properties.vendorID << ",\n  \"driverVersion\": " << m_Properties.driverVersion
+        << ",\n  \"apiVersion\": \"" << VK_VERSION_MAJOR( m_Properties.apiVersion ) << "."
+        << VK_VERSION_MINOR( m_Properties.apiVersion ) << "." << VK_VERSION_PATCH( m_Properties.apiVersion )
+        << "\",\n  \"results\": [";
+
+    for ( size_t i = 0; i < m_Results.size(); ++i )
+    {
+        const Result &result = m_Results[i];
+        out << ( i == 0 ? "\n" : ",\n" ) << "    { \"name\": ";
+        writeJsonString( out, result.name );
+
+        if ( !result.skipReason.empty() )
+        {
+            out << ", \"skipped\": ";
+            writeJsonString( out, result.skipReason );
+            out << " }";
+            continue;
+        }
+
+        SampleSummary summary = summarizeSamples( result.samples );
+        out << ", \"unit\": \"" << result.unit << "\", \"count\": " << summary.count << ", \"mean\": " << summary.mean
+            << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+            << ", \"max\": " << summary.max;
+        if ( !result.derivedName.empty() )
+        {
+            out << ", ";
+            writeJsonString( out, result.derivedName );
+            out << ": " << result.derivedValue;
+        }
+        out << " }";
+    }
+
+    out << "\n  ]\n}\n";
+    std::cout << "Results written to " << m_Options.outputFile << "\n";
+}
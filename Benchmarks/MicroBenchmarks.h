@@ -0,0 +1,108 @@
+#pragma once
+// Micro-benchmarks for the Vulkan building blocks the renderer is made of.
+//
+// Runs on its own instance and device with no window or surface, so it works on
+// any ICD including software ones like lavapipe. Every measurement is written to a
+// JSON file so results can be compared between runs.
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct MicroBenchmarkOptions
+{
+    std::string outputFile = "microbenchmarks.json";
+    // Directory holding vert.spv, frag.spv and the sprite shaders.
+    std::string shaderDir = "../Vulkan/";
+    uint32_t    deviceIndex = 0;
+    // Largest staged upload size, inclusive.
+    VkDeviceSize maxUploadSize = 1ull << 30;
+};
+
+MicroBenchmarkOptions parseMicroBenchmarkOptions( int argc, char **argv );
+
+class MicroBenchmarks
+{
+public:
+    explicit MicroBenchmarks( const MicroBenchmarkOptions &options );
+
+    void run();
+
+private:
+    struct Result
+    {
+        std::string name;
+        std::string unit;
+        // Per-iteration samples; empty when the case was skipped.
+        std::vector<double> samples;
+        // Derived figure, e.g. throughput, reported next to the samples.
+        std::string derivedName;
+        double      derivedValue = 0.0;
+        std::string skipReason;
+    };
+
+    void initVulkan();
+    void cleanup();
+
+    void benchmarkBufferCreation();
+    void benchmarkStagedUpload();
+    void benchmarkDescriptorSets();
+    void benchmarkPipelineCreation();
+    void benchmarkCommandBuffers();
+    void benchmarkSpriteBatch();
+    void benchmarkDynamicMesh();
+    // Throws std::runtime_error when the sort's output is wrong.
+    void benchmarkDrawSort();
+
+    // Shared by the cases that record, submit and wait for their own work.
+    VkCommandBuffer allocateCommandBuffer();
+    VkFence         createFence();
+    // Resets and begins a one time submit.
+    void beginCommandBuffer( VkCommandBuffer commandBuffer );
+    // Begins the render pass on the shared target and sets the viewport to cover it.
+    void beginTargetPass( VkCommandBuffer commandBuffer );
+    void submitAndWait( VkCommandBuffer commandBuffer, VkFence fence );
+    // Runs measure, which samples one step alone into step and the whole frame into
+    // frame, and reports both with the rate of itemCount items at the median. Both are
+    // reported as skipped when measure throws.
+    void measureRates( const std::string &stepName,
+                       const std::string &frameName,
+                       const std::string &rateName,
+                       uint32_t itemCount,
+                       const std::function<void( Result &step, Result &frame )> &measure );
+
+    void createRenderTarget();
+    void createPipelineLayout();
+    VkPipeline createPipeline( VkPipelineCache cache );
+
+    void printResult( const Result &result ) const;
+    void writeJson() const;
+
+private:
+    MicroBenchmarkOptions m_Options;
+
+    VkInstance       m_Instance = VK_NULL_HANDLE;
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice         m_Device = VK_NULL_HANDLE;
+    VkQueue          m_Queue = VK_NULL_HANDLE;
+    uint32_t         m_QueueFamily = 0;
+    VkCommandPool    m_CommandPool = VK_NULL_HANDLE;
+
+    VkPhysicalDeviceProperties m_Properties{};
+
+    // Shared by the pipeline and command buffer cases.
+    VkRenderPass          m_RenderPass = VK_NULL_HANDLE;
+    VkImage               m_TargetImage = VK_NULL_HANDLE;
+    VkDeviceMemory        m_TargetMemory = VK_NULL_HANDLE;
+    VkImageView           m_TargetView = VK_NULL_HANDLE;
+    VkFramebuffer         m_Framebuffer = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_DescriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout      m_PipelineLayout = VK_NULL_HANDLE;
+    VkShaderModule        m_VertShader = VK_NULL_HANDLE;
+    VkShaderModule        m_FragShader = VK_NULL_HANDLE;
+
+    std::vector<Result> m_Results;
+};
@@ -0,0 +1,18 @@
+#include "MicroBenchmarks.h"
+#include <iostream>
+
+int main( int argc, char **argv )
+{
+    try
+    {
+        MicroBenchmarks benchmarks( parseMicroBenchmarkOptions( argc, argv ) );
+        benchmarks.run();
+    }
+    catch ( const std::exception &e )
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -1,47 +1,35 @@
 #include "App.h"
+#include "DeviceSelection.h"
+#include "InitGraph.h"
+#include "VulkanUtils.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <optional>
 #include <set>
 #include <stdexcept>
+#include <thread>
+#include <tuple>
 
 void App::run()
 {
-    initWindow();
     initVulkan();
     mainLoop();
     cleanup();
 }
 
-std::vector<char> App::readFile( const std::string &filename )
+void App::enableFrameReadback( FrameReadback::Callback callback )
 {
-    std::ifstream file( filename, std::ios::ate | std::ios::binary );
-    if ( !file.is_open() )
-    {
-        throw std::runtime_error( "failed to open file!" );
-    }
-
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer( fileSize );
-
-    file.seekg( 0 );
-    file.read( buffer.data(), fileSize );
-
-    file.close();
-
-    return buffer;
+    m_ReadbackEnabled = true;
+    m_FrameReadback.setCallback( std::move( callback ) );
 }
 
-VKAPI_ATTR VkBool32 VKAPI_CALL
-App::debugCallback( VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-                                         VkDebugUtilsMessageTypeFlagsEXT messageType,
-                                         const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
-                                         void *pUserData )
+std::vector<char> App::readFile( const std::string &filename )
 {
-
-    std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
-    return VK_FALSE;
+    return ::readFile( filename );
 }
 
 VkResult App::CreateDebugUtilsMessengerEXT( 
@@ -77,22 +65,28 @@ void App::populateDebugMessengerCreateInfo( VkDebugUtilsMessengerCreateInfoEXT &
 {
     createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+    // Everything is subscribed so the sink's severity filter can be lowered at runtime.
     createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
+                                 VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |
                                  VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
                                  VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
     createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
                              VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
                              VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-    createInfo.pfnUserCallback = debugCallback;
+    createInfo.pfnUserCallback = DebugMessageSink::callback;
+    createInfo.pUserData = &m_DebugLog;
 }
 
 std::vector<const char *> App::getRequiredExtensions()
 {
-    uint32_t glfwExtensionCount = 0;
-    const char **glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions( &glfwExtensionCount );
-
-    std::vector<const char *> extensions( glfwExtensions, glfwExtensions + glfwExtensionCount );
+    std::vector<const char *> extensions;
+    if ( !m_Options.headless )
+    {
+        uint32_t glfwExtensionCount = 0;
+        const char **glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions( &glfwExtensionCount );
+        extensions.assign( glfwExtensions, glfwExtensions + glfwExtensionCount );
+    }
 
     if ( enableValidationLayers )
     {
@@ -102,6 +96,17 @@ std::vector<const char *> App::getRequiredExtensions()
     return extensions;
 }
 
+std::vector<const char *> App::getRequiredDeviceExtensions() const
+{
+    std::vector<const char *> extensions;
+    if ( !m_Options.headless )
+    {
+        extensions.insert( extensions.end(), deviceExtensions.begin(), deviceExtensions.end() );
+    }
+
+    return extensions;
+}
+
 void App::framebufferResizeCallback( GLFWwindow *window, int width, int height )
 {
     auto app = reinterpret_cast<App *>( glfwGetWindowUserPointer( window ) );
@@ -110,65 +115,13 @@ void App::framebufferResizeCallback( GLFWwindow *window, int width, int height )
 
 uint32_t App::findMemoryType( uint32_t typeFilter, VkMemoryPropertyFlags properties )
 {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties( m_PhysicalDevice, &memProperties );
-    for ( uint32_t i = 0; i < memProperties.memoryTypeCount; ++i )
-    {
-        /*
-        VkMemoryRequirements::memoryTypeBits is a bitfield that sets a bit for every memoryType 
-        that is supported for the resource. Therefore we need to check if the bit at index i is
-        set while also testing the required memory property flags while iterating over the memory 
-        types. Leaving this here just in case I'm not the only one that got confused.
-        */
-        if ( typeFilter & ( 1 << i ) && 
-             ( memProperties.memoryTypes[i].propertyFlags & properties ) == properties )
-        {
-            return i;
-        }
-    }
-
-    throw std::runtime_error( "Failed to find suitable memory type!" );
-
-    return 0;
-}
-
-void App::copyBuffer( VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size )
-{
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = m_CommandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers( m_Device, &allocInfo, &commandBuffer );
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-   vkBeginCommandBuffer( commandBuffer, &beginInfo );
-
-   VkBufferCopy copyRegion{};
-   copyRegion.srcOffset = 0; // Optional
-   copyRegion.dstOffset = 0; // Optional
-   copyRegion.size = size; // can't use the VK_WOLE_SIZE
-   vkCmdCopyBuffer( commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion );
-
-   vkEndCommandBuffer( commandBuffer );
-
-   VkSubmitInfo submitInfo{};
-   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-   submitInfo.commandBufferCount = 1;
-   submitInfo.pCommandBuffers = &commandBuffer;
-   vkQueueSubmit( m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE );
-   vkQueueWaitIdle( m_GraphicsQueue );
-
-   vkFreeCommandBuffers( m_Device, m_CommandPool, 1, &commandBuffer );
+    return ::findMemoryType( m_PhysicalDevice, typeFilter, properties );
 }
 
 void App::recordCommandBuffer( VkCommandBuffer commandBuffer, uint32_t imageIndex )
 {
+    PROFILE_CPU_SCOPE( "recordCommandBuffer" );
+
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = 0;                  // Optional
@@ -179,49 +132,136 @@ void App::recordCommandBuffer( VkCommandBuffer commandBuffer, uint32_t imageInde
         throw std::runtime_error( "failed to begin recording command buffer!" );
     }
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = m_RenderPass;
-    renderPassInfo.framebuffer = m_SwapChainFramebuffers[imageIndex];
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = m_SwapChainExtent;
+    m_GpuProfiler.beginFrame( commandBuffer, m_CurrentFrame );
+    uint32_t frameScope = m_GpuProfiler.beginScope( commandBuffer, "frame" );
+    {
+        PROFILE_GPU_SCOPE( m_GpuProfiler, commandBuffer, "textureUploads" );
+        m_Textures.recordUploads( commandBuffer );
+    }
+    {
+        PROFILE_GPU_SCOPE( m_GpuProfiler, commandBuffer, "meshUploads" );
+        m_Mesh.recordUploads( commandBuffer );
+    }
+    if ( m_PointCloud.isEnabled() )
+    {
+        PROFILE_GPU_SCOPE( m_GpuProfiler, commandBuffer, "pointUploads" );
+        m_PointCloud.recordUploads( commandBuffer );
+    }
+    uint32_t passScope = m_GpuProfiler.beginScope( commandBuffer, "mainPass" );
 
-    VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
+    beginMainPass( commandBuffer, imageIndex );
+    uint32_t passStatistics = m_GpuProfiler.beginPassStatistics( commandBuffer, "mainPass" );
 
-    vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
-    vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline );
-   
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>( m_SwapChainExtent.width );
-    viewport.height = static_cast<float>( m_SwapChainExtent.height );
+    viewport.width = static_cast<float>( m_RenderExtent.width );
+    viewport.height = static_cast<float>( m_RenderExtent.height );
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
     vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
     
     VkRect2D scissor{};
     scissor.offset = { 0, 0 };
-    scissor.extent = m_SwapChainExtent;
+    scissor.extent = m_RenderExtent;
     vkCmdSetScissor( commandBuffer, 0, 1, &scissor );
 
-    VkBuffer vertexBuffers[] = { m_VertexBuffer };
-    VkDeviceSize offsets[] = { 0 };
-    vkCmdBindVertexBuffers( commandBuffer, 0, 1, vertexBuffers, offsets );
-    vkCmdBindIndexBuffer( commandBuffer, m_IndexBuffer, 0, VK_INDEX_TYPE_UINT16 );
-
     // vkCmdDraw( commandBuffer, static_cast<uint32_t>( triangle.size() ), 1, 0, 0 );
-    
-    vkCmdBindDescriptorSets( m_CommandBuffers[m_CurrentFrame], 
-                             VK_PIPELINE_BIND_POINT_GRAPHICS, 
-                             m_PipelineLayout, 0, 1,
-                             m_DescriptorSets.data(), 0, nullptr );
 
-    vkCmdDrawIndexed( commandBuffer, static_cast<uint32_t>( indices.size() ), 1, 0, 0, 0 );
+    m_DrawList.clear();
+    for ( const CaptureDraw &sceneDraw : m_SceneDraws )
+    {
+        DrawCall call{};
+        call.pipeline = m_GraphicsPipeline;
+        call.layout = m_PipelineLayout;
+        call.descriptorSet = m_DescriptorSets[m_CurrentFrame];
+        call.vertexBuffer = m_Mesh.getVertexBuffer();
+        call.indexBuffer = m_Mesh.getIndexBuffer();
+        call.indexType = m_Mesh.getIndexType();
+        call.indexCount = sceneDraw.indexCount;
+        call.instanceCount = sceneDraw.instanceCount;
+        call.firstIndex = sceneDraw.firstIndex;
+        call.vertexOffset = sceneDraw.vertexOffset;
+        call.firstInstance = sceneDraw.firstInstance;
+        m_DrawList.add( call, 0.0f );
+    }
+    m_DrawList.sort( m_SortThreadCount );
+
+    m_DrawRecorder.begin( commandBuffer );
+    m_DrawRecorder.record( m_DrawList );
+
+    if ( m_Particles.isEnabled() )
+    {
+        m_Particles.recordDraw( commandBuffer, m_DescriptorSets[m_CurrentFrame], m_Mesh.getVertexBuffer(), m_Mesh.getIndexBuffer() );
+        m_DrawRecorder.invalidate();
+    }
+
+    if ( m_PointCloud.isEnabled() )
+    {
+        m_PointCloud.recordDraw( commandBuffer, m_DescriptorSets[m_CurrentFrame] );
+        m_DrawRecorder.invalidate();
+    }
+
+    if ( m_Sprites.isEnabled() )
+    {
+        // Positioned in window pixels, whatever the scene is rendered at.
+        m_Sprites.flush( commandBuffer, m_SwapChainExtent );
+        m_SpriteDraws += m_Sprites.getDrawCount();
+        m_DrawRecorder.invalidate();
+    }
+
+    const DrawRecorder::Stats &drawStats = m_DrawRecorder.getStats();
+    m_FrameCounters.draws += drawStats.draws + ( m_Particles.isEnabled() ? 1 : 0 ) + m_Sprites.getDrawCount() +
+                             m_PointCloud.getDrawCount();
+    m_FrameCounters.uploadBytes +=
+        m_Textures.getLastUploadBytes() + m_Mesh.getLastUploadBytes() + m_PointCloud.getLastUploadBytes();
+    m_DrawTotals.draws += drawStats.draws;
+    m_DrawTotals.binds += drawStats.binds;
+    m_DrawTotals.redundantBinds += drawStats.redundantBinds;
+    ++m_RecordedFrames;
     
-    vkCmdEndRenderPass( commandBuffer );
+    m_GpuProfiler.endPassStatistics( commandBuffer, passStatistics );
+    endMainPass( commandBuffer, imageIndex );
+    m_GpuProfiler.endScope( commandBuffer, passScope );
+
+    if ( m_ResolutionController )
+    {
+        PROFILE_GPU_SCOPE( m_GpuProfiler, commandBuffer, "upscale" );
+        auto [consumerStage, consumerAccess] = getSceneConsumer();
+        m_ResolutionTargets.recordUpscale( commandBuffer,
+                                           m_CurrentFrame,
+                                           m_RenderExtent,
+                                           m_SwapChainImages[imageIndex],
+                                           getPresentLayout(),
+                                           consumerStage,
+                                           consumerAccess );
+    }
+
+    if ( m_Occlusion.isEnabled() )
+    {
+        PROFILE_GPU_SCOPE( m_GpuProfiler, commandBuffer, "occlusionScene" );
+        m_Occlusion.record( commandBuffer, m_CurrentFrame, imageIndex );
+        m_FrameCounters.draws += OcclusionScene::kDrawCount;
+    }
+
+    if ( m_Hud.isEnabled() )
+    {
+        PROFILE_GPU_SCOPE( m_GpuProfiler, commandBuffer, "hud" );
+        m_Hud.record( commandBuffer, m_CurrentFrame, imageIndex );
+    }
+
+    if ( m_ReadbackEnabled )
+    {
+        PROFILE_GPU_SCOPE( m_GpuProfiler, commandBuffer, "readback" );
+        m_FrameReadback.record( commandBuffer,
+                                m_SwapChainImages[imageIndex],
+                                getPresentLayout(),
+                                m_SwapChainImageFormat,
+                                m_SwapChainExtent,
+                                m_FrameNumber );
+    }
+
+    m_GpuProfiler.endScope( commandBuffer, frameScope );
     if ( vkEndCommandBuffer( commandBuffer ) != VK_SUCCESS )
     {
         throw std::runtime_error( "failed to record command buffer!" );
@@ -229,10 +269,112 @@ void App::recordCommandBuffer( VkCommandBuffer commandBuffer, uint32_t imageInde
 }
 
 
-void App::initWindow()
+void App::beginMainPass( VkCommandBuffer commandBuffer, uint32_t imageIndex )
+{
+    VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+    // Scaled frames go to the frame slot's offscreen image rather than the swap chain.
+    uint32_t target = m_ResolutionController ? m_CurrentFrame : imageIndex;
+
+    if ( m_DynamicRendering )
+    {
+        VkImage     image = m_ResolutionController ? m_ResolutionTargets.getImage( target ) : m_SwapChainImages[target];
+        VkImageView imageView = m_ResolutionController ? m_ResolutionTargets.getImageView( target )
+                                                       : m_SwapChainImageViews[target];
+
+        // What the render pass' initial layout and subpass dependency used to do.
+        recordImageBarrier( commandBuffer,
+                            image,
+                            VK_IMAGE_LAYOUT_UNDEFINED,
+                            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                            0,
+                            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT );
+
+        VkRenderingAttachmentInfo colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        colorAttachment.imageView = imageView;
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.clearValue = clearColor;
+
+        VkRenderingInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        renderingInfo.renderArea.offset = { 0, 0 };
+        renderingInfo.renderArea.extent = m_RenderExtent;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+        m_CmdBeginRendering( commandBuffer, &renderingInfo );
+        return;
+    }
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = m_RenderPass;
+    renderPassInfo.framebuffer = m_SwapChainFramebuffers[target];
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = m_RenderExtent;
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearColor;
+
+    vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+}
+
+void App::endMainPass( VkCommandBuffer commandBuffer, uint32_t imageIndex )
+{
+    if ( !m_DynamicRendering )
+    {
+        vkCmdEndRenderPass( commandBuffer );
+        return;
+    }
+
+    m_CmdEndRendering( commandBuffer );
+
+    if ( m_ResolutionController )
+    {
+        recordImageBarrier( commandBuffer,
+                            m_ResolutionTargets.getImage( m_CurrentFrame ),
+                            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                            VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            VK_ACCESS_TRANSFER_READ_BIT );
+        return;
+    }
+
+    auto [consumerStage, consumerAccess] = getSceneConsumer();
+    recordImageBarrier( commandBuffer,
+                        m_SwapChainImages[imageIndex],
+                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                        getPresentLayout(),
+                        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                        consumerStage,
+                        consumerAccess );
+}
+
+void App::initGlfw()
 {
+    if ( m_Options.headless )
+    {
+        return;
+    }
+
     // These built-in functions are the first step to the necessary.
     glfwInit();
+}
+
+void App::initWindow()
+{
+    if ( m_Options.headless )
+    {
+        return;
+    }
+
     // GLFW was originally desinged to create an OpenGL context.
     // we need to tell it to not create an OpenGL context with a subsequent call
     glfwWindowHint( GLFW_CLIENT_API, GLFW_NO_API );
@@ -246,39 +388,372 @@ void App::initWindow()
 
 void App::initVulkan()
 {
-    createInstance();
-    setupDebugMessenger();
-    createSurface();
-    pickphysicalDevice();
-    createLogicalDevice();
-    createSwapChain();
-    createImageView();
-    createRenderPass();
-    createDescriptorSetLayout();
-    createGraphicsPipeline();
-    createFramebuffers();
-    createCommandPool();
-    createVertexBuffer();
-    createIndexBuffer();
-    createUniformBuffers();
-    createDescriptorPool();
-    createDescriptorSets();
-    createCommandBuffers();
-    createSyncObjects();
+    using Affinity = InitGraph::Affinity;
+
+    if ( m_Options.dynamicResolutionMs > 0.0f )
+    {
+        m_ResolutionController.emplace( DynamicResolutionSettings{ m_Options.dynamicResolutionMs,
+                                                                   m_Options.minResolutionScale,
+                                                                   m_Options.maxResolutionScale } );
+    }
+
+    // Before the graph, so the capture sees the initial mesh uploads.
+    if ( !m_Options.replayFile.empty() )
+    {
+        m_Replay.open( m_Options.replayFile );
+        if ( m_Replay.getFrameCount() == 0 )
+        {
+            throw std::runtime_error( m_Options.replayFile + " holds no frames." );
+        }
+    }
+    if ( !m_Options.captureFile.empty() )
+    {
+        m_CaptureWriter.open( m_Options.captureFile );
+        m_CaptureStartUs = CpuTimeline::nowUs();
+    }
+
+    InitGraph graph;
+
+    auto assets = graph.add( "assets", [this]() {
+        if ( !m_Options.assetArchive.empty() )
+        {
+            m_Assets.open( m_Options.assetArchive );
+        }
+    } );
+    auto shaders = graph.add( "shaders", [this]() { preloadShaders(); }, { assets } );
+
+    // GLFW wants its window functions called from the main thread.
+    auto glfw = graph.add( "glfw", [this]() { initGlfw(); }, {}, Affinity::MainThread );
+    auto window = graph.add( "window", [this]() { initWindow(); }, { glfw }, Affinity::MainThread );
+    auto instance = graph.add( "instance", [this]() { createInstance(); }, { glfw } );
+    graph.add( "debugMessenger", [this]() { setupDebugMessenger(); }, { instance } );
+    auto surface = graph.add( "surface", [this]() { createSurface(); }, { instance, window }, Affinity::MainThread );
+    auto physicalDevice = graph.add( "physicalDevice", [this]() { pickphysicalDevice(); }, { surface } );
+    auto device = graph.add( "device", [this]() { createLogicalDevice(); }, { physicalDevice } );
+
+    auto swapChain = graph.add( "swapChain", [this]() {
+        createSwapChain();
+        createImageView();
+    }, { device }, Affinity::MainThread );
+    auto renderPass = graph.add( "renderPass", [this]() { createRenderPass(); }, { swapChain } );
+    auto setLayout = graph.add( "descriptorSetLayout", [this]() { createDescriptorSetLayout(); }, { device } );
+    graph.add( "pipeline", [this]() { createGraphicsPipeline(); }, { renderPass, setLayout, shaders } );
+    auto resolutionTargets = graph.add( "resolutionTargets", [this]() { createResolutionTargets(); }, { swapChain } );
+    graph.add( "framebuffers", [this]() { createFramebuffers(); }, { swapChain, renderPass, resolutionTargets } );
+
+    // Everything using m_CommandPool or submitting to m_GraphicsQueue is chained,
+    // since neither may be used from two threads at once.
+    auto commandPool = graph.add( "commandPool", [this]() { createCommandPool(); }, { device } );
+    auto commandBuffers = graph.add( "commandBuffers", [this]() { createCommandBuffers(); }, { commandPool } );
+    graph.add( "mesh", [this]() { createMesh(); }, { device } );
+
+    auto uniformBuffers = graph.add( "uniformBuffers", [this]() { createUniformBuffers(); }, { device } );
+    auto textures = graph.add( "textures", [this]() { createTextures(); }, { device } );
+    auto descriptorPool = graph.add( "descriptorPool", [this]() { createDescriptorPool(); }, { device } );
+    graph.add( "descriptorSets",
+               [this]() { createDescriptorSets(); },
+               { descriptorPool, setLayout, uniformBuffers, textures } );
+    graph.add( "syncObjects", [this]() { createSyncObjects(); }, { device } );
+
+    auto asyncCompute = graph.add( "asyncCompute", [this]() {
+        QueueFamilyIndices queueFamilies = findQueueFamilies( m_PhysicalDevice );
+        m_AsyncCompute.create( m_Device, queueFamilies.computeFamily.value(), m_ComputeQueue, MAX_FRAMES_IN_FLIGHT );
+    }, { device } );
+
+    if ( m_Options.particleCount > 0 )
+    {
+        graph.add( "particles", [this]() {
+            createParticles( findQueueFamilies( m_PhysicalDevice ) );
+        }, { assets, renderPass, setLayout, asyncCompute, commandBuffers } );
+    }
+
+    if ( m_Options.spriteCount > 0 )
+    {
+        graph.add( "sprites", [this]() { createSprites(); }, { assets, renderPass } );
+    }
+
+    if ( !m_Options.pointCloud.empty() )
+    {
+        graph.add( "pointCloud", [this]() { createPointCloud(); }, { assets, renderPass, setLayout } );
+    }
+
+    if ( m_Options.occlusionCulling )
+    {
+        graph.add( "occlusionScene", [this]() { createOcclusionScene(); }, { assets, swapChain } );
+    }
+
+    if ( m_Options.hud )
+    {
+        graph.add( "hud", [this]() { createHud(); }, { assets, swapChain } );
+    }
+
+    graph.add( "gpuProfiler", [this]() {
+        QueueFamilyIndices queueFamilies = findQueueFamilies( m_PhysicalDevice );
+        m_GpuProfiler.create( m_PhysicalDevice,
+                              m_Device,
+                              queueFamilies.graphicsFamily.value(),
+                              MAX_FRAMES_IN_FLIGHT );
+        if ( m_Options.pipelineStatistics )
+        {
+            m_GpuProfiler.enablePassStatistics( m_EnabledFeatures );
+        }
+    }, { device } );
+
+    if ( m_ReadbackEnabled )
+    {
+        graph.add( "frameReadback", [this]() {
+            // One slot more than frames in flight so a frame can be handed out while the
+            // next ones are still being written.
+            m_FrameReadback.create( m_PhysicalDevice, m_Device, MAX_FRAMES_IN_FLIGHT + 1 );
+        }, { device } );
+    }
+
+    graph.run( std::clamp( std::thread::hardware_concurrency(), 2u, 4u ) - 1 );
+    // The update thread keeps running while the render thread sorts.
+    m_SortThreadCount = std::clamp( std::thread::hardware_concurrency() / 2, 1u, 4u );
+    graph.printTimings( std::cout );
+
+    // Textures aren't part of a capture. Streaming them in while replaying would make
+    // the first frames depend on decode times, so they are complete before frame 0.
+    if ( m_Replay.isOpen() )
+    {
+        m_Textures.flush( m_CommandPool, m_GraphicsQueue );
+    }
+
+    if ( m_ResolutionController && !m_GpuProfiler.isSupported() )
+    {
+        std::cerr << "Dynamic resolution needs GPU timestamps, rendering at the maximum scale." << std::endl;
+    }
+}
+
+void App::preloadShaders()
+{
+    for ( const char *name : { "textured_vert.spv", "textured_frag.spv" } )
+    {
+        m_ShaderCode.emplace( name, m_Assets.load( name ) );
+    }
 }
 
 void App::mainLoop()
 {
-    while ( !glfwWindowShouldClose( m_Window ) )
+    if ( m_Replay.isOpen() )
+    {
+        // Every captured frame is rendered; at most half of them count as warmup.
+        uint32_t frames = static_cast<uint32_t>( std::min<uint64_t>( m_Replay.getFrameCount(), UINT32_MAX ) );
+        uint32_t warmup = std::min( m_Options.warmupFrames, frames / 2 );
+        m_Benchmark.emplace( warmup, frames - warmup );
+
+        VkExtent2D extent = m_Replay.getExtent();
+        if ( extent.width != m_SwapChainExtent.width || extent.height != m_SwapChainExtent.height )
+        {
+            std::cerr << "Capture was recorded at " << extent.width << "x" << extent.height << ", replaying at "
+                      << m_SwapChainExtent.width << "x" << m_SwapChainExtent.height << std::endl;
+        }
+    }
+    else if ( m_Options.benchmark )
     {
-        glfwPollEvents();
-        drawFrame();
+        m_Benchmark.emplace( m_Options.warmupFrames, m_Options.measuredFrames );
+    }
+
+    // GLFW events can only be polled on the main thread, so it runs the updates and
+    // hands the Vulkan work to a thread of its own.
+    std::thread renderThread( [this]() { renderLoop(); } );
+    try
+    {
+        updateLoop();
+    }
+    catch ( ... )
+    {
+        m_FramePackets.close();
+        renderThread.join();
+        throw;
+    }
+    renderThread.join();
+    if ( m_RenderError )
+    {
+        std::rethrow_exception( m_RenderError );
     }
     vkDeviceWaitIdle( m_Device );
+
+    if ( m_CaptureWriter.isOpen() )
+    {
+        m_CaptureWriter.setExtent( m_SwapChainExtent );
+        m_CaptureWriter.close();
+        std::cout << "Captured " << m_CaptureWriter.getFrameCount() << " frames to " << m_Options.captureFile
+                  << std::endl;
+    }
+
+    if ( m_Options.pipelineStatistics )
+    {
+        printPassStatistics( std::cout, m_GpuProfiler.getLastFramePassStatistics() );
+        if ( m_RecordedFrames > 0 )
+        {
+            double frames = static_cast<double>( m_RecordedFrames );
+            std::cout << "Draw state per frame: " << m_DrawTotals.draws / frames << " draws, "
+                      << m_DrawTotals.binds / frames << " binds, " << m_DrawTotals.redundantBinds / frames
+                      << " redundant binds skipped" << std::endl;
+        }
+    }
+
+    if ( m_Options.particleStress && !m_ParticleThroughput.empty() )
+    {
+        SampleSummary summary = summarizeSamples( m_ParticleThroughput );
+        std::cout << "Particle throughput (particles/ms): mean " << summary.mean << ", p50 " << summary.p50
+                  << ", p99 " << summary.p99 << " over " << m_ParticleThroughput.size() << " frames" << std::endl;
+    }
+
+    if ( !m_SpriteSubmitMs.empty() )
+    {
+        SampleSummary summary = summarizeSamples( m_SpriteSubmitMs );
+        double frames = static_cast<double>( m_SpriteSubmitMs.size() );
+        std::cout << "Sprites: " << m_Options.spriteCount << " quads per frame in " << m_SpriteDraws / frames
+                  << " draws, submission mean " << summary.mean << " ms, p99 " << summary.p99 << " ms ("
+                  << m_Options.spriteCount / ( summary.mean * 1e3 ) << " M quads/s), "
+                  << m_SpritesDropped << " dropped while growing" << std::endl;
+    }
+
+    if ( m_PointCloudFrames > 0 )
+    {
+        double frames = static_cast<double>( m_PointCloudFrames );
+        std::cout << "Point cloud: " << m_PointCloud.getPointCount() << " points in " << m_PointCloud.getNodeCount()
+                  << " nodes, " << m_PointCloudPoints / frames << " points in " << m_PointCloudDraws / frames
+                  << " draws per frame, " << m_PointCloud.getUploadCount() << " chunks uploaded, "
+                  << m_PointCloud.getEvictionCount() << " evicted, " << m_PointCloud.getResidentCount() << " of "
+                  << m_PointCloud.getSlotCount() << " slots resident" << std::endl;
+    }
+
+    if ( m_OcclusionFrames > 0 )
+    {
+        std::cout << "Occlusion culling: " << m_Occlusion.getObjectCount() << " blocks, "
+                  << m_OcclusionDrawn / static_cast<double>( m_OcclusionFrames ) << " drawn per frame" << std::endl;
+    }
+
+    if ( m_ResolutionController )
+    {
+        std::cout << "Dynamic resolution: mean scale " << m_ResolutionController->getMeanScale() << ", lowest "
+                  << m_ResolutionController->getLowestScale() << ", " << m_ResolutionController->getChangeCount()
+                  << " changes over " << m_ResolutionController->getUpdateCount() << " measured frames" << std::endl;
+    }
+
+    if ( m_Benchmark )
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties( m_PhysicalDevice, &properties );
+
+        m_Benchmark->printReport( std::cout, properties.deviceName );
+        if ( !m_Options.benchmarkOutput.empty() &&
+             !m_Benchmark->writeJson( m_Options.benchmarkOutput, properties.deviceName, m_Options.headless ) )
+        {
+            std::cerr << "Failed to write benchmark results to " << m_Options.benchmarkOutput << std::endl;
+        }
+    }
+}
+
+void App::updateLoop()
+{
+    CpuTimeline::setThreadName( "update" );
+
+    uint64_t frameIndex = 0;
+    while ( !m_FramePackets.isClosed() )
+    {
+        if ( !m_Options.headless )
+        {
+            glfwPollEvents();
+            if ( glfwWindowShouldClose( m_Window ) )
+            {
+                break;
+            }
+
+            int width = 0, height = 0;
+            glfwGetFramebufferSize( m_Window, &width, &height );
+            m_FramebufferWidth = static_cast<uint32_t>( width );
+            m_FramebufferHeight = static_cast<uint32_t>( height );
+            if ( width == 0 || height == 0 )
+            {
+                // Minimized: nothing to render until the window comes back.
+                glfwWaitEvents();
+                continue;
+            }
+        }
+
+        if ( m_Replay.isOpen() && frameIndex >= m_Replay.getFrameCount() )
+        {
+            break;
+        }
+
+        FramePacket *packet = m_FramePackets.beginWrite();
+        if ( !packet )
+        {
+            break;
+        }
+        updateScene( *packet, frameIndex++ );
+        m_FramePackets.endWrite();
+    }
+    m_FramePackets.close();
+}
+
+void App::renderLoop()
+{
+    CpuTimeline::setThreadName( "render" );
+
+    try
+    {
+        while ( const FramePacket *packet = m_FramePackets.beginRead() )
+        {
+            uint64_t frameNumber = m_FrameNumber;
+            double frameStartUs = CpuTimeline::nowUs();
+            drawFrame( *packet );
+            m_FramePackets.endRead();
+
+            if ( m_Benchmark && m_FrameNumber != frameNumber )
+            {
+                if ( m_GpuProfiler.consumeNewResults() )
+                {
+                    m_Benchmark->addGpuFrame( m_GpuProfiler.getLastFrameGpuMs() );
+                }
+                m_Benchmark->addFrame( ( CpuTimeline::nowUs() - frameStartUs ) / 1000.0, m_LastPresentIntervalMs );
+                if ( m_Benchmark->isFinished() )
+                {
+                    break;
+                }
+            }
+        }
+    }
+    catch ( ... )
+    {
+        m_RenderError = std::current_exception();
+    }
+    m_FramePackets.close();
+    if ( !m_Options.headless )
+    {
+        // The update loop may be waiting for events in a minimized window.
+        glfwPostEmptyEvent();
+    }
 }
 
 void App::cleanup()
 {
+    m_Particles.cleanup();
+    m_Sprites.cleanup();
+    m_PointCloud.cleanup();
+    m_Occlusion.cleanup();
+    m_Hud.cleanup();
+    m_Textures.cleanup();
+    m_AsyncCompute.cleanup();
+
+    // After the subsystems joined their workers, so no thread is still recording events.
+    if ( !m_Options.traceFile.empty() && !m_GpuProfiler.exportChromeTrace( m_Options.traceFile ) )
+    {
+        std::cerr << "Failed to write trace to " << m_Options.traceFile << std::endl;
+    }
+    m_GpuProfiler.cleanup();
+
+    if ( m_ReadbackEnabled )
+    {
+        m_FrameReadback.collect( m_FrameNumber );
+        m_FrameReadback.cleanup();
+    }
+
     cleanupSwapchain();
 
     for ( size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i )
@@ -296,21 +771,22 @@ void App::cleanup()
         vkDestroySemaphore( m_Device, m_RenderFinishedSemaphores[i], nullptr );
         vkDestroyFence( m_Device, m_InFlightFences[i], nullptr );
     }
-    vkDestroyBuffer( m_Device, m_IndexBuffer, nullptr );
-    vkFreeMemory( m_Device, m_IndexBufferMemory, nullptr );
-
-    vkDestroyBuffer( m_Device, m_VertexBuffer, nullptr );
-    vkFreeMemory( m_Device, m_VertexBufferMemory, nullptr );
+    m_Mesh.cleanup();
+    // The device is idle; everything released so far can go.
+    m_DeletionQueue.cleanup();
 
     vkDestroyCommandPool( m_Device, m_CommandPool, nullptr );
 
-    vkDestroyPipeline( m_Device, m_GraphicsPipeline, nullptr );
+    m_PipelineVariants.cleanup();
     vkDestroyPipelineLayout( m_Device, m_PipelineLayout, nullptr );
     vkDestroyRenderPass( m_Device, m_RenderPass, nullptr );
     
 
     vkDestroyDevice( m_Device, nullptr );
-    vkDestroySurfaceKHR( m_Instance, m_Surface, nullptr );
+    if ( m_Surface != VK_NULL_HANDLE )
+    {
+        vkDestroySurfaceKHR( m_Instance, m_Surface, nullptr );
+    }
 
     if ( enableValidationLayers )
     {
@@ -318,17 +794,75 @@ void App::cleanup()
     }
 
     vkDestroyInstance( m_Instance, nullptr );
-    glfwDestroyWindow( m_Window );
-    glfwTerminate();
+    m_DebugLog.stop();
+    if ( !m_Options.headless )
+    {
+        glfwDestroyWindow( m_Window );
+        glfwTerminate();
+    }
 }
 
-void App::drawFrame()
+void App::drawFrame( const FramePacket &packet )
 {
-    vkWaitForFences( m_Device, 1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, UINT64_MAX );
-    
+    PROFILE_CPU_SCOPE( "drawFrame" );
+
+    double startUs = CpuTimeline::nowUs();
+    double waitedUs = 0.0;
+
+    // Frames the GPU is still working on, this slot's previous one included.
+    uint32_t framesInFlight = 0;
+    if ( m_Hud.isEnabled() )
+    {
+        for ( VkFence fence : m_InFlightFences )
+        {
+            framesInFlight += vkGetFenceStatus( m_Device, fence ) == VK_NOT_READY ? 1 : 0;
+        }
+    }
+
+    {
+        PROFILE_CPU_SCOPE( "waitForFence" );
+        double waitStartUs = CpuTimeline::nowUs();
+        vkWaitForFences( m_Device, 1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, UINT64_MAX );
+        waitedUs += CpuTimeline::nowUs() - waitStartUs;
+    }
+    m_GpuProfiler.collect( m_CurrentFrame );
+    if ( m_Particles.isEnabled() )
+    {
+        m_Particles.collect( m_CurrentFrame );
+    }
+
+    m_DeletionQueue.beginFrame( m_FrameNumber );
+    m_Textures.beginFrame( m_FrameNumber );
+    m_Mesh.beginFrame( m_CurrentFrame );
+    m_Textures.markUsed( m_Texture );
+    updateTextureDescriptor( m_CurrentFrame );
+
+    // The fence we just waited on belongs to the frame submitted MAX_FRAMES_IN_FLIGHT
+    // frames ago, so that frame and everything before it has retired.
+    if ( m_FrameNumber >= MAX_FRAMES_IN_FLIGHT )
+    {
+        m_DeletionQueue.collect( m_FrameNumber - MAX_FRAMES_IN_FLIGHT );
+    }
+    if ( m_ReadbackEnabled && m_FrameNumber >= MAX_FRAMES_IN_FLIGHT )
+    {
+        m_FrameReadback.collect( m_FrameNumber - MAX_FRAMES_IN_FLIGHT + 1 );
+    }
+
     uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR( m_Device, m_SwapChain, UINT64_MAX, m_ImageAvailableSemaphores[m_CurrentFrame],
-                                             VK_NULL_HANDLE, &imageIndex );
+    VkResult result = VK_SUCCESS;
+    if ( m_Options.headless )
+    {
+        // There is one offscreen image per frame in flight, guarded by the fence above.
+        imageIndex = m_CurrentFrame;
+    }
+    else
+    {
+        PROFILE_CPU_SCOPE( "acquireImage" );
+        double waitStartUs = CpuTimeline::nowUs();
+        result = vkAcquireNextImageKHR( m_Device, m_SwapChain, UINT64_MAX, m_ImageAvailableSemaphores[m_CurrentFrame],
+                                        VK_NULL_HANDLE, &imageIndex );
+        waitedUs += CpuTimeline::nowUs() - waitStartUs;
+    }
     if ( result == VK_ERROR_OUT_OF_DATE_KHR )
     {
         recreateSwapChain();
@@ -339,33 +873,154 @@ void App::drawFrame()
         throw std::runtime_error( "failed to acquire swap chain image!" );
     }
 
-    updateUniformBuffer( m_CurrentFrame );
+    if ( m_CaptureWriter.isOpen() )
+    {
+        m_CaptureWriter.beginFrame( packet.frameIndex, CpuTimeline::nowUs() - m_CaptureStartUs );
+        m_CaptureWriter.writeUniforms( packet.particleDeltaTime, &packet.ubo, sizeof( packet.ubo ) );
+    }
+    updateUniformBuffer( m_CurrentFrame, packet.ubo );
+
+    m_SceneDraws.clear();
+    if ( m_Replay.isOpen() )
+    {
+        for ( const CaptureMeshEdit &edit : packet.capture.meshEdits )
+        {
+            editSceneMesh( edit );
+        }
+        for ( const CaptureDraw &draw : packet.capture.draws )
+        {
+            if ( uint64_t( draw.firstIndex ) + draw.indexCount > m_Mesh.getIndexCount() )
+            {
+                throw std::runtime_error( "The capture draws past the end of the mesh." );
+            }
+            m_SceneDraws.push_back( draw );
+        }
+    }
+    else
+    {
+        if ( m_Options.meshEdits )
+        {
+            editMesh();
+        }
+        CaptureDraw rectangle{};
+        rectangle.indexCount = m_Mesh.getIndexCount();
+        m_SceneDraws.push_back( rectangle );
+    }
+    if ( m_CaptureWriter.isOpen() )
+    {
+        for ( const CaptureDraw &draw : m_SceneDraws )
+        {
+            m_CaptureWriter.writeDraw( draw );
+        }
+        m_CaptureWriter.endFrame();
+    }
+    if ( m_Particles.isEnabled() )
+    {
+        updateParticles( packet.particleDeltaTime );
+    }
+    if ( m_Sprites.isEnabled() )
+    {
+        submitSprites();
+    }
+
+    m_RenderExtent = m_SwapChainExtent;
+    if ( m_ResolutionController )
+    {
+        if ( m_GpuProfiler.getResolvedFrameCount() != m_ResolvedGpuFrames )
+        {
+            m_ResolvedGpuFrames = m_GpuProfiler.getResolvedFrameCount();
+            m_ResolutionController->update( m_GpuProfiler.getLastFrameGpuMs() );
+        }
+        m_RenderExtent = m_ResolutionTargets.getRenderExtent( m_ResolutionController->getScale() );
+    }
+
+    if ( m_PointCloud.isEnabled() )
+    {
+        PROFILE_CPU_SCOPE( "updatePointCloud" );
+        const UniformBufferObject &ubo = packet.ubo;
+        m_PointCloud.update( ubo.proj * ubo.view * ubo.model, std::abs( ubo.proj[1][1] ), m_RenderExtent, m_FrameNumber );
+        ++m_PointCloudFrames;
+        m_PointCloudDraws += m_PointCloud.getDrawCount();
+        m_PointCloudPoints += m_PointCloud.getDrawnPoints();
+    }
+
+    if ( m_Occlusion.isEnabled() )
+    {
+        m_Occlusion.update( m_CurrentFrame, packet.time );
+        // Nothing is collected until the slot's first frame retired.
+        if ( m_Occlusion.getObjectCount() > 0 )
+        {
+            ++m_OcclusionFrames;
+            m_OcclusionDrawn += m_Occlusion.getDrawnCount();
+        }
+    }
+
+    if ( m_Hud.isEnabled() )
+    {
+        updateHud();
+    }
+    m_FrameCounters = {};
+    m_FrameCounters.framesInFlight = framesInFlight;
 
     vkResetFences( m_Device, 1, &m_InFlightFences[m_CurrentFrame] );
 
     vkResetCommandBuffer( m_CommandBuffers[m_CurrentFrame], /*VkCommandBufferResetFlagBits*/ 0 );
     recordCommandBuffer( m_CommandBuffers[m_CurrentFrame], imageIndex );
 
+    // Compute goes first so it can start while the previous frame is still rendering.
+    VkSemaphore computeFinished = m_AsyncCompute.submit( m_CurrentFrame );
+    if ( m_Particles.isEnabled() )
+    {
+        m_FrameCounters.dispatches += m_Particles.getDispatchCount();
+    }
+
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore waitSemaphores[] = { m_ImageAvailableSemaphores[m_CurrentFrame] };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    if ( !m_Options.headless )
+    {
+        waitSemaphores.push_back( m_ImageAvailableSemaphores[m_CurrentFrame] );
+        // A scaled frame only touches the swap chain image in the upscale, so rendering
+        // can start before the image is ready.
+        waitStages.push_back( m_ResolutionController ? VK_PIPELINE_STAGE_TRANSFER_BIT
+                                                     : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+    }
+    if ( computeFinished != VK_NULL_HANDLE )
+    {
+        waitSemaphores.push_back( computeFinished );
+        waitStages.push_back( m_AsyncCompute.getWaitStages() );
+    }
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>( waitSemaphores.size() );
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
 
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &m_CommandBuffers[m_CurrentFrame];
 
     VkSemaphore signalSemaphores[] = { m_RenderFinishedSemaphores[m_CurrentFrame] };
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = m_Options.headless ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
+    m_GpuProfiler.markSubmitted( m_CurrentFrame );
     if ( vkQueueSubmit( m_GraphicsQueue, 1, &submitInfo, m_InFlightFences[m_CurrentFrame] ) != VK_SUCCESS )
     {
         throw std::runtime_error( "Failed to submit draw command buffer!" );
     }
+    ++m_FrameNumber;
+    m_FrameCounters.cpuMs = ( CpuTimeline::nowUs() - startUs - waitedUs ) / 1000.0;
+
+    if ( m_Options.headless )
+    {
+        // Nothing is presented; the submit stands in for the present.
+        double nowUs = CpuTimeline::nowUs();
+        m_LastPresentIntervalMs = m_LastPresentUs > 0.0 ? ( nowUs - m_LastPresentUs ) / 1000.0 : 0.0;
+        m_LastPresentUs = nowUs;
+
+        m_CurrentFrame = ( m_CurrentFrame + 1 ) % MAX_FRAMES_IN_FLIGHT;
+        return;
+    }
 
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -379,7 +1034,14 @@ void App::drawFrame()
 
     presentInfo.pImageIndices = &imageIndex;
 
-    result = vkQueuePresentKHR( m_PresentQueue, &presentInfo );
+    {
+        PROFILE_CPU_SCOPE( "queuePresent" );
+        result = vkQueuePresentKHR( m_PresentQueue, &presentInfo );
+    }
+
+    double nowUs = CpuTimeline::nowUs();
+    m_LastPresentIntervalMs = m_LastPresentUs > 0.0 ? ( nowUs - m_LastPresentUs ) / 1000.0 : 0.0;
+    m_LastPresentUs = nowUs;
 
     if ( result == VK_ERROR_OUT_OF_DATE_KHR || 
          result == VK_SUBOPTIMAL_KHR || 
@@ -404,13 +1066,19 @@ void App::createInstance()
         throw std::runtime_error( "Validation layers requested, but not available." );
     }
 
+    if ( enableValidationLayers )
+    {
+        m_DebugLog.setMinimumSeverity( m_Options.validationSeverity );
+        m_DebugLog.start( m_Options.validationLog );
+    }
+
     VkApplicationInfo appInfo{};
     appInfo.sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO;
     appInfo.pApplicationName   = "Hello Triangle";
     appInfo.applicationVersion = VK_MAKE_VERSION( 1, 0, 0 );
     appInfo.pEngineName        = "No Engine";
     appInfo.engineVersion      = VK_MAKE_VERSION( 1, 0, 0 );
-    appInfo.apiVersion         = VK_API_VERSION_1_0;
+    appInfo.apiVersion         = API_VERSION;
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType            = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -445,6 +1113,11 @@ void App::createInstance()
 
 void App::createSurface()
 {
+    if ( m_Options.headless )
+    {
+        return;
+    }
+
     VkResult result = glfwCreateWindowSurface( m_Instance, m_Window, nullptr, &m_Surface );
     if ( result != VK_SUCCESS )
     {
@@ -454,6 +1127,12 @@ void App::createSurface()
 
 void App::createSwapChain()
 {
+    if ( m_Options.headless )
+    {
+        createHeadlessTargets();
+        return;
+    }
+
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport( m_PhysicalDevice );
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat( swapChainSupport.formats );
@@ -478,6 +1157,22 @@ void App::createSwapChain()
     // It is also possible that you'll render images to a separate image
     // first to perform operations like post-processing.
     // In that case you may use a value like 'VK_IMAGE_USAGE_TRANSFER_DST_BIT'
+    if ( m_ReadbackEnabled )
+    {
+        if ( !( swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT ) )
+        {
+            throw std::runtime_error( "Swap chain images can't be used as a transfer source for readback." );
+        }
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    if ( m_ResolutionController )
+    {
+        if ( !( swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT ) )
+        {
+            throw std::runtime_error( "Swap chain images can't be blitted to for dynamic resolution." );
+        }
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
 
     QueueFamilyIndices indices              = findQueueFamilies( m_PhysicalDevice );
     uint32_t           queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
@@ -513,6 +1208,44 @@ void App::createSwapChain()
     m_SwapChainExtent      = extent;
 }
 
+void App::createHeadlessTargets()
+{
+    m_SwapChainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    m_SwapChainExtent = { WIN_WIDTH, WIN_HEIGHT };
+
+    m_SwapChainImages.resize( MAX_FRAMES_IN_FLIGHT );
+    m_HeadlessImagesMemory.resize( MAX_FRAMES_IN_FLIGHT );
+    for ( size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i )
+    {
+        createImage( m_PhysicalDevice,
+                     m_Device,
+                     m_SwapChainExtent.width,
+                     m_SwapChainExtent.height,
+                     1,
+                     m_SwapChainImageFormat,
+                     VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                         VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     m_SwapChainImages[i],
+                     m_HeadlessImagesMemory[i] );
+    }
+}
+
+void App::createResolutionTargets()
+{
+    if ( !m_ResolutionController )
+    {
+        return;
+    }
+
+    m_ResolutionTargets.create( m_PhysicalDevice,
+                                m_Device,
+                                m_SwapChainImageFormat,
+                                m_SwapChainExtent,
+                                m_Options.maxResolutionScale,
+                                MAX_FRAMES_IN_FLIGHT );
+}
+
 void App::createImageView()
 {
     m_SwapChainImageViews.resize( m_SwapChainImages.size() );
@@ -545,11 +1278,31 @@ void App::createImageView()
 
 void App::createGraphicsPipeline()
 {
-    auto vertShaderCode = readFile( "vert.spv" );
-    auto fragShaderCode = readFile( "frag.spv" );
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
 
-    VkShaderModule vertShaderModule = createShaderModule( vertShaderCode );
-    VkShaderModule fragShaderModule = createShaderModule( fragShaderCode );
+    if ( vkCreatePipelineLayout( m_Device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create pipeline layout!" );
+    }
+
+    m_PipelineVariants.create( m_Device, [this]( const VkSpecializationInfo *specialization, VkPipelineCache cache ) {
+        return createGraphicsPipelineVariant( specialization, cache );
+    } );
+
+    ShaderVariant variant;
+    variant.set( ShaderConstant::UseTexture, !m_Options.texture.empty() )
+        .set( ShaderConstant::UseVertexColor, !m_Options.flatShading )
+        .set( ShaderConstant::BlurRadius, m_Options.blurRadius );
+    m_GraphicsPipeline = m_PipelineVariants.get( variant );
+}
+
+VkPipeline App::createGraphicsPipelineVariant( const VkSpecializationInfo *specialization, VkPipelineCache cache )
+{
+    VkShaderModule vertShaderModule = loadShaderModule( "textured_vert.spv" );
+    VkShaderModule fragShaderModule = loadShaderModule( "textured_frag.spv" );
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -562,6 +1315,7 @@ void App::createGraphicsPipeline()
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main";
+    fragShaderStageInfo.pSpecializationInfo = specialization;
 
     VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
     
@@ -618,19 +1372,9 @@ void App::createGraphicsPipeline()
 
     std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
     VkPipelineDynamicStateCreateInfo dynamicState{};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = static_cast<uint32_t>( dynamicStates.size() );
-    dynamicState.pDynamicStates = dynamicStates.data();
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
-
-    if ( vkCreatePipelineLayout( m_Device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout ) != VK_SUCCESS )
-    {
-        throw std::runtime_error( "Failed to create pipeline layout!" );
-    }
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>( dynamicStates.size() );
+    dynamicState.pDynamicStates = dynamicStates.data();
 
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -648,31 +1392,60 @@ void App::createGraphicsPipeline()
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if ( vkCreateGraphicsPipelines( m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_GraphicsPipeline ) !=
-         VK_SUCCESS )
+    // Without a render pass the pipeline only needs to know the attachment formats.
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &m_SwapChainImageFormat;
+    if ( m_DynamicRendering )
+    {
+        pipelineInfo.pNext = &renderingInfo;
+    }
+
+    VkPipeline pipeline;
+    if ( vkCreateGraphicsPipelines( m_Device, cache, 1, &pipelineInfo, nullptr, &pipeline ) != VK_SUCCESS )
     {
         throw std::runtime_error( "Failed to create graphics pipeline!" );
     }
 
     vkDestroyShaderModule( m_Device, fragShaderModule, nullptr );
     vkDestroyShaderModule( m_Device, vertShaderModule, nullptr );
+
+    return pipeline;
 }
 
 void App::createFramebuffers()
 {
-    m_SwapChainFramebuffers.resize( m_SwapChainImageViews.size() );
+    if ( m_DynamicRendering )
+    {
+        return;
+    }
+
+    std::vector<VkImageView> imageViews = m_SwapChainImageViews;
+    VkExtent2D               extent = m_SwapChainExtent;
+    if ( m_ResolutionController )
+    {
+        imageViews.resize( m_ResolutionTargets.getCount() );
+        for ( uint32_t i = 0; i < m_ResolutionTargets.getCount(); ++i )
+        {
+            imageViews[i] = m_ResolutionTargets.getImageView( i );
+        }
+        extent = m_ResolutionTargets.getImageExtent();
+    }
+
+    m_SwapChainFramebuffers.resize( imageViews.size() );
 
-    for ( size_t i = 0; i < m_SwapChainImageViews.size(); i++ )
+    for ( size_t i = 0; i < imageViews.size(); i++ )
     {
-        VkImageView attachments[] = { m_SwapChainImageViews[i] };
+        VkImageView attachments[] = { imageViews[i] };
 
         VkFramebufferCreateInfo framebufferInfo{};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebufferInfo.renderPass = m_RenderPass;
         framebufferInfo.attachmentCount = 1;
         framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = m_SwapChainExtent.width;
-        framebufferInfo.height = m_SwapChainExtent.height;
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
         framebufferInfo.layers = 1;
 
         if ( vkCreateFramebuffer( m_Device, &framebufferInfo, nullptr, &m_SwapChainFramebuffers[i] ) != VK_SUCCESS )
@@ -697,63 +1470,84 @@ void App::createCommandPool()
 
 }
 
-void App::createVertexBuffer()
+void App::createMesh()
 {
-    VkDeviceSize bufferSize = sizeof( rectangle[0] ) * rectangle.size();
-    
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    createBuffer( bufferSize,
-                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                  stagingBuffer,
-                  stagingBufferMemory );
-
-    void *data;
-    vkMapMemory( m_Device, stagingBufferMemory, 0, bufferSize, 0, &data );
-    memcpy( data, rectangle.data(), (size_t)bufferSize );
-    vkUnmapMemory( m_Device, stagingBufferMemory );
-
-    createBuffer( bufferSize, 
-                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | 
-                  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_VertexBuffer, m_VertexBufferMemory );
-    
-    copyBuffer( stagingBuffer, m_VertexBuffer, bufferSize );
-    vkDestroyBuffer( m_Device, stagingBuffer, nullptr );
-    vkFreeMemory( m_Device, stagingBufferMemory, nullptr );
+    DynamicMeshCreateInfo createInfo{};
+    createInfo.physicalDevice = m_PhysicalDevice;
+    createInfo.device = m_Device;
+    createInfo.deletionQueue = &m_DeletionQueue;
+    createInfo.framesInFlight = MAX_FRAMES_IN_FLIGHT;
+    createInfo.vertexStride = sizeof( Vertex );
+    createInfo.indexType = VK_INDEX_TYPE_UINT16;
+    createInfo.vertexCapacity = static_cast<uint32_t>( rectangle.size() );
+    createInfo.indexCapacity = static_cast<uint32_t>( indices.size() );
+    m_Mesh.create( createInfo );
+
+    // Copied to the GPU with the first frame's commands.
+    CaptureMeshEdit vertices{};
+    vertices.stream = CaptureMeshStream::Vertices;
+    vertices.mode = CaptureEditMode::Set;
+    vertices.count = static_cast<uint32_t>( rectangle.size() );
+    vertices.stride = sizeof( Vertex );
+    vertices.data = { reinterpret_cast<const char *>( rectangle.data() ), rectangle.size() * sizeof( Vertex ) };
+    editSceneMesh( vertices );
+
+    CaptureMeshEdit meshIndices{};
+    meshIndices.stream = CaptureMeshStream::Indices;
+    meshIndices.mode = CaptureEditMode::Set;
+    meshIndices.count = static_cast<uint32_t>( indices.size() );
+    meshIndices.stride = sizeof( uint16_t );
+    meshIndices.data = { reinterpret_cast<const char *>( indices.data() ), indices.size() * sizeof( uint16_t ) };
+    editSceneMesh( meshIndices );
 }
 
-void App::createIndexBuffer()
+void App::editMesh()
 {
-    VkDeviceSize bufferSize = sizeof( indices[0] ) * indices.size();
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer( bufferSize, 
-                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | 
-                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-                  stagingBuffer, stagingBufferMemory );
-
-    void *data;
-    vkMapMemory( m_Device, stagingBufferMemory, 0, bufferSize, 0, &data );
-    memcpy( data, indices.data(), (size_t)bufferSize );
-    vkUnmapMemory( m_Device, stagingBufferMemory );
+    PROFILE_CPU_SCOPE( "editMesh" );
 
-    createBuffer( bufferSize, 
-                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | 
-                  VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
-                  m_IndexBuffer, m_IndexBufferMemory );
+    // Corners breathing in and out, rewritten in place every frame.
+    const float phase = static_cast<float>( m_FrameNumber % 120 ) / 120.0f * 6.2831853f;
+    std::vector<Vertex> vertices = rectangle;
+    for ( size_t i = 0; i < vertices.size(); ++i )
+    {
+        vertices[i].pos *= 1.0f + 0.15f * std::sin( phase + static_cast<float>( i ) * 1.5707963f );
+    }
 
-    copyBuffer( stagingBuffer, m_IndexBuffer, bufferSize );
+    CaptureMeshEdit edit{};
+    edit.stream = CaptureMeshStream::Vertices;
+    edit.mode = CaptureEditMode::Update;
+    edit.count = static_cast<uint32_t>( vertices.size() );
+    edit.stride = sizeof( Vertex );
+    edit.data = { reinterpret_cast<const char *>( vertices.data() ), vertices.size() * sizeof( Vertex ) };
+    editSceneMesh( edit );
+}
 
-    vkDestroyBuffer( m_Device, stagingBuffer, nullptr );
-    vkFreeMemory( m_Device, stagingBufferMemory, nullptr );
+void App::editSceneMesh( const CaptureMeshEdit &edit )
+{
+    const bool vertices = edit.stream == CaptureMeshStream::Vertices;
+    if ( edit.stride != ( vertices ? sizeof( Vertex ) : sizeof( uint16_t ) ) )
+    {
+        throw std::runtime_error( "Mesh edit doesn't match the scene's vertex or index layout." );
+    }
+    if ( m_CaptureWriter.isOpen() )
+    {
+        m_CaptureWriter.writeMeshEdit( edit );
+    }
 
+    const void *data = edit.data.data();
+    switch ( edit.mode )
+    {
+    case CaptureEditMode::Set:
+        vertices ? m_Mesh.setVertices( data, edit.count ) : m_Mesh.setIndices( data, edit.count );
+        break;
+    case CaptureEditMode::Update:
+        vertices ? m_Mesh.updateVertices( edit.first, data, edit.count )
+                 : m_Mesh.updateIndices( edit.first, data, edit.count );
+        break;
+    case CaptureEditMode::Append:
+        vertices ? m_Mesh.appendVertices( data, edit.count ) : m_Mesh.appendIndices( data, edit.count );
+        break;
+    }
 }
 
 void App::createUniformBuffers()
@@ -783,14 +1577,16 @@ void App::createUniformBuffers()
 
 void App::createDescriptorPool()
 {
-    VkDescriptorPoolSize poolSize{};
-    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = static_cast<uint32_t>( MAX_FRAMES_IN_FLIGHT );
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = static_cast<uint32_t>( MAX_FRAMES_IN_FLIGHT );
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount = static_cast<uint32_t>( MAX_FRAMES_IN_FLIGHT );
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = 1;
-    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.poolSizeCount = static_cast<uint32_t>( poolSizes.size() );
+    poolInfo.pPoolSizes = poolSizes.data();
     poolInfo.maxSets = static_cast<uint32_t>( MAX_FRAMES_IN_FLIGHT );
 
     VkResult result = vkCreateDescriptorPool( m_Device, &poolInfo, nullptr, &m_DescriptorPool );
@@ -840,6 +1636,53 @@ void App::createDescriptorSets()
         vkUpdateDescriptorSets( m_Device, 1, &descriptorWrite, 0, nullptr );
     }
 
+    // Binding 1 starts out as the fallback texture; drawFrame swaps in the real one.
+    m_TextureVersions.assign( MAX_FRAMES_IN_FLIGHT, UINT64_MAX );
+    for ( uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i )
+    {
+        updateTextureDescriptor( i );
+    }
+}
+
+void App::updateTextureDescriptor( uint32_t currentFrame )
+{
+    // Only the set of the frame being recorded is rewritten; the others may still be
+    // in use by frames in flight.
+    uint64_t version = m_Textures.getVersion( m_Texture );
+    if ( m_TextureVersions[currentFrame] == version )
+    {
+        return;
+    }
+    m_TextureVersions[currentFrame] = version;
+
+    VkDescriptorImageInfo imageInfo = m_Textures.getDescriptorInfo( m_Texture );
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = m_DescriptorSets[currentFrame];
+    descriptorWrite.dstBinding = 1;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets( m_Device, 1, &descriptorWrite, 0, nullptr );
+}
+
+void App::createTextures()
+{
+    TextureStreamerCreateInfo createInfo{};
+    createInfo.physicalDevice = m_PhysicalDevice;
+    createInfo.device = m_Device;
+    createInfo.deletionQueue = &m_DeletionQueue;
+    createInfo.budgetBytes = static_cast<VkDeviceSize>( m_Options.textureBudgetMB ) << 20;
+    createInfo.enabledFeatures = m_EnabledFeatures;
+    m_Textures.create( createInfo );
+
+    if ( !m_Options.texture.empty() )
+    {
+        m_Texture = m_Textures.load( m_Options.texture );
+    }
 }
 
 void App::createCommandBuffers()
@@ -887,21 +1730,35 @@ void App::createSyncObjects()
 
 void App::recreateSwapChain()
 {
-    int width = 0, height = 0;
-    glfwGetFramebufferSize( m_Window, &width, &height );
-    while ( width == 0 || height == 0 )
+    if ( !m_Options.headless && ( m_FramebufferWidth == 0 || m_FramebufferHeight == 0 ) )
     {
-        glfwGetFramebufferSize( m_Window, &width, &height );
-        glfwWaitEvents();
+        // Minimized; the update thread stops sending packets until it is restored,
+        // and the next frame tries again.
+        m_FramebufferResized = true;
+        return;
     }
 
     vkDeviceWaitIdle( m_Device );
 
+    if ( m_ReadbackEnabled )
+    {
+        m_FrameReadback.collect( m_FrameNumber );
+    }
+
     cleanupSwapchain();
 
     createSwapChain();
     createImageView();
+    createResolutionTargets();
     createFramebuffers();
+    if ( m_Occlusion.isEnabled() )
+    {
+        m_Occlusion.createTargets( m_SwapChainImageViews, m_SwapChainExtent );
+    }
+    if ( m_Hud.isEnabled() )
+    {
+        m_Hud.createTargets( m_SwapChainImages, m_SwapChainImageViews, m_SwapChainExtent );
+    }
 }
 
 void App::cleanupSwapchain()
@@ -911,28 +1768,267 @@ void App::cleanupSwapchain()
     {
         vkDestroyFramebuffer( m_Device, m_SwapChainFramebuffers[i], nullptr );
     }
+    m_ResolutionTargets.cleanup();
+    m_Occlusion.cleanupTargets();
+    m_Hud.cleanupTargets();
     for ( i = 0; i < m_SwapChainImageViews.size(); ++i )
     {
         vkDestroyImageView( m_Device, m_SwapChainImageViews[i], nullptr );
     }
+    if ( m_Options.headless )
+    {
+        for ( i = 0; i < m_SwapChainImages.size(); ++i )
+        {
+            vkDestroyImage( m_Device, m_SwapChainImages[i], nullptr );
+            vkFreeMemory( m_Device, m_HeadlessImagesMemory[i], nullptr );
+        }
+        m_SwapChainImages.clear();
+        m_HeadlessImagesMemory.clear();
+        return;
+    }
     vkDestroySwapchainKHR( m_Device, m_SwapChain, nullptr );
 }
 
-void App::updateUniformBuffer( uint32_t currentImage )
+void App::createParticles( const QueueFamilyIndices &queueFamilies )
+{
+    ParticleSystemCreateInfo createInfo{};
+    createInfo.physicalDevice = m_PhysicalDevice;
+    createInfo.device = m_Device;
+    createInfo.renderPass = m_RenderPass;
+    createInfo.colorFormat = m_SwapChainImageFormat;
+    createInfo.sceneSetLayout = m_DescriptorSetLayout;
+    createInfo.graphicsFamily = queueFamilies.graphicsFamily.value();
+    createInfo.computeFamily = queueFamilies.computeFamily.value();
+    createInfo.quadBinding = Vertex::getBindingDescription();
+    for ( const auto &attribute : Vertex::getAttributeDescription() )
+    {
+        createInfo.quadAttributes.push_back( attribute );
+    }
+    createInfo.uploadCommandPool = m_CommandPool;
+    createInfo.uploadQueue = m_GraphicsQueue;
+    createInfo.framesInFlight = MAX_FRAMES_IN_FLIGHT;
+    createInfo.capacity = m_Options.particleCount;
+    createInfo.assets = &m_Assets;
+    m_Particles.create( createInfo );
+
+    m_AsyncCompute.addPass(
+        "particles",
+        [this]( VkCommandBuffer commandBuffer, uint32_t frameIndex ) {
+            m_Particles.recordSimulation( commandBuffer, frameIndex );
+        },
+        ParticleSystem::kConsumerStages );
+}
+
+void App::updateParticles( float deltaTime )
 {
+    double nowUs = CpuTimeline::nowUs();
+    m_Particles.update( deltaTime );
+
+    if ( !m_Options.particleStress || !m_Particles.consumeNewResults() )
+    {
+        return;
+    }
+
+    double gpuMs = m_Particles.getLastSimulationGpuMs();
+    if ( gpuMs <= 0.0 )
+    {
+        return;
+    }
+    double throughput = m_Particles.getAliveCount() / gpuMs;
+    m_ParticleThroughput.push_back( throughput );
+
+    if ( nowUs - m_LastParticleReportUs >= 1e6 )
+    {
+        std::cout << "Particles: " << m_Particles.getAliveCount() << " alive, simulation " << gpuMs << " ms, "
+                  << throughput << " particles/ms" << std::endl;
+        m_LastParticleReportUs = nowUs;
+    }
+}
+
+void App::createSprites()
+{
+    SpriteBatchCreateInfo createInfo{};
+    createInfo.physicalDevice = m_PhysicalDevice;
+    createInfo.device = m_Device;
+    createInfo.renderPass = m_RenderPass;
+    createInfo.colorFormat = m_SwapChainImageFormat;
+    createInfo.framesInFlight = MAX_FRAMES_IN_FLIGHT;
+    createInfo.initialCapacity = m_Options.spriteCount;
+    createInfo.assets = &m_Assets;
+    m_Sprites.create( createInfo );
+}
+
+void App::submitSprites()
+{
+    PROFILE_CPU_SCOPE( "submitSprites" );
+
+    double startUs = CpuTimeline::nowUs();
+    m_Sprites.begin( m_CurrentFrame );
+
+    // A grid of cells covering the window, with colors drifting over time.
+    const uint32_t count = m_Options.spriteCount;
+    const float width = static_cast<float>( m_SwapChainExtent.width );
+    const float height = static_cast<float>( m_SwapChainExtent.height );
+    const uint32_t columns = std::max( 1u, static_cast<uint32_t>( std::ceil( std::sqrt( count * width / height ) ) ) );
+    const uint32_t rows = ( count + columns - 1 ) / columns;
+    const glm::vec2 cell( width / columns, height / rows );
+    const float phase = static_cast<float>( m_FrameNumber % 256 ) / 256.0f;
+
+    for ( uint32_t i = 0; i < count; ++i )
+    {
+        uint32_t column = i % columns;
+        uint32_t row = i / columns;
+        float shade = static_cast<float>( ( column + row ) & 255 ) / 255.0f;
+        m_Sprites.submitQuad( glm::vec2( column * cell.x, row * cell.y ),
+                              cell * 0.8f,
+                              glm::vec3( shade, phase, 1.0f - shade ) );
+    }
+
+    m_SpriteSubmitMs.push_back( ( CpuTimeline::nowUs() - startUs ) / 1e3 );
+    m_SpritesDropped += m_Sprites.getDroppedCount();
+}
+
+void App::createPointCloud()
+{
+    PointCloudCreateInfo createInfo{};
+    createInfo.physicalDevice = m_PhysicalDevice;
+    createInfo.device = m_Device;
+    createInfo.renderPass = m_RenderPass;
+    createInfo.colorFormat = m_SwapChainImageFormat;
+    createInfo.sceneSetLayout = m_DescriptorSetLayout;
+    createInfo.framesInFlight = MAX_FRAMES_IN_FLIGHT;
+    createInfo.assets = &m_Assets;
+    createInfo.path = m_Options.pointCloud;
+    createInfo.budgetBytes = VkDeviceSize( m_Options.pointBudgetMB ) << 20;
+    createInfo.largePoints = m_EnabledFeatures.largePoints == VK_TRUE;
+    createInfo.pointSize = m_Options.pointSize;
+    m_PointCloud.create( createInfo );
+}
+
+void App::createOcclusionScene()
+{
+    if ( !m_OcclusionCulling )
+    {
+        return;
+    }
+
+    OcclusionSceneCreateInfo createInfo{};
+    createInfo.physicalDevice = m_PhysicalDevice;
+    createInfo.device = m_Device;
+    createInfo.colorFormat = m_SwapChainImageFormat;
+    createInfo.imageLayout = getPresentLayout();
+    createInfo.framesInFlight = MAX_FRAMES_IN_FLIGHT;
+    createInfo.gridSize = m_Options.occlusionGrid;
+    createInfo.drawIndirectCount = m_OcclusionCulling;
+    createInfo.assets = &m_Assets;
+    m_Occlusion.create( createInfo );
+    m_Occlusion.createTargets( m_SwapChainImageViews, m_SwapChainExtent );
+}
+
+void App::createHud()
+{
+    PerfHudCreateInfo createInfo{};
+    createInfo.physicalDevice = m_PhysicalDevice;
+    createInfo.device = m_Device;
+    createInfo.colorFormat = m_SwapChainImageFormat;
+    createInfo.imageLayout = getPresentLayout();
+    if ( m_DynamicRendering )
+    {
+        createInfo.beginRendering = m_CmdBeginRendering;
+        createInfo.endRendering = m_CmdEndRendering;
+    }
+    createInfo.framesInFlight = MAX_FRAMES_IN_FLIGHT;
+    createInfo.memoryBudget = m_MemoryBudget;
+    createInfo.assets = &m_Assets;
+    m_Hud.create( createInfo );
+    m_Hud.createTargets( m_SwapChainImages, m_SwapChainImageViews, m_SwapChainExtent );
+}
+
+void App::updateHud()
+{
+    HudCounters counters = m_FrameCounters;
+    counters.frameMs = m_LastPresentIntervalMs;
+    if ( m_GpuProfiler.getResolvedFrameCount() != m_HudResolvedFrames )
+    {
+        m_HudResolvedFrames = m_GpuProfiler.getResolvedFrameCount();
+        counters.gpuMs = m_GpuProfiler.getLastFrameGpuMs();
+        for ( const TraceEvent &scope : m_GpuProfiler.getLastFrameScopes() )
+        {
+            if ( std::strcmp( scope.name, "hud" ) == 0 )
+            {
+                counters.hudGpuMs = scope.durationUs / 1000.0;
+            }
+        }
+    }
+    m_Hud.update( counters );
+}
+
+void App::updateScene( FramePacket &packet, uint64_t frameIndex )
+{
+    PROFILE_CPU_SCOPE( "updateScene" );
+
+    if ( m_Replay.isOpen() )
+    {
+        m_Replay.readFrame( frameIndex, packet.capture );
+        if ( packet.capture.uniforms.size() != sizeof( UniformBufferObject ) )
+        {
+            throw std::runtime_error( "The capture's uniforms don't match this build." );
+        }
+        packet.frameIndex = frameIndex;
+        memcpy( &packet.ubo, packet.capture.uniforms.data(), sizeof( packet.ubo ) );
+        packet.particleDeltaTime = packet.capture.deltaTime;
+        packet.time = frameIndex / 60.0f;
+
+        if ( m_Options.replayTiming )
+        {
+            double nowUs = CpuTimeline::nowUs();
+            if ( frameIndex == 0 )
+            {
+                m_ReplayStartUs = nowUs - packet.capture.timeUs;
+            }
+            double waitUs = m_ReplayStartUs + packet.capture.timeUs - nowUs;
+            if ( waitUs > 0.0 )
+            {
+                std::this_thread::sleep_for( std::chrono::microseconds( static_cast<int64_t>( waitUs ) ) );
+            }
+        }
+        return;
+    }
+
     static auto startTime = std::chrono::high_resolution_clock::now();
 
     auto currentTime = std::chrono::high_resolution_clock::now();
     float time = std::chrono::duration<float, std::chrono::seconds::period>( currentTime - startTime ).count();
+    if ( m_Options.benchmark )
+    {
+        // Advance the scene by frame count so every run renders the same frames.
+        time = frameIndex / 60.0f;
+    }
 
-    UniformBufferObject ubo{};
-    ubo.model = glm::rotate( glm::mat4( 1.0f ), time * glm::radians( 90.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) );
-    ubo.view =
+    // The swap chain belongs to the render thread; the framebuffer has the same size.
+    float aspect = m_FramebufferWidth / static_cast<float>( m_FramebufferHeight );
+
+    packet.frameIndex = frameIndex;
+    packet.time = time;
+    packet.ubo.model = glm::rotate( glm::mat4( 1.0f ), time * glm::radians( 90.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) );
+    packet.ubo.view =
         glm::lookAt( glm::vec3( 2.0f, 2.0f, 2.0f ), glm::vec3( 0.0f, 0.0f, 0.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) );
-    ubo.proj =
-        glm::perspective( glm::radians( 45.0f ), m_SwapChainExtent.width / (float)m_SwapChainExtent.height, 0.1f, 10.0f );
-    ubo.proj[1][1] *= -1;
+    packet.ubo.proj = glm::perspective( glm::radians( 45.0f ), aspect, 0.1f, 10.0f );
+    packet.ubo.proj[1][1] *= -1;
+
+    double nowUs = CpuTimeline::nowUs();
+    packet.particleDeltaTime = 1.0f / 60.0f;
+    if ( !m_Options.benchmark && m_LastUpdateUs > 0.0 )
+    {
+        // Clamp so a stall (breakpoint, window drag) doesn't fling everything at once.
+        packet.particleDeltaTime = std::min( static_cast<float>( ( nowUs - m_LastUpdateUs ) / 1e6 ), 0.1f );
+    }
+    m_LastUpdateUs = nowUs;
+}
 
+void App::updateUniformBuffer( uint32_t currentImage, const UniformBufferObject &ubo )
+{
+    PROFILE_CPU_SCOPE( "updateUniformBuffer" );
     memcpy( m_UniformBuffersMapped[currentImage], &ubo, sizeof( ubo ) );
 }
 
@@ -953,6 +2049,11 @@ void App::setupDebugMessenger()
 
 void App::createRenderPass()
 {
+    if ( m_DynamicRendering )
+    {
+        return;
+    }
+
     VkAttachmentDescription colorAttachment = {};
     colorAttachment.format = m_SwapChainImageFormat;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -961,7 +2062,8 @@ void App::createRenderPass()
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // Scaled frames are blitted to the swap chain image afterwards.
+    colorAttachment.finalLayout = m_ResolutionController ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : getPresentLayout();
 
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
@@ -979,6 +2081,27 @@ void App::createRenderPass()
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
 
+    // Whatever reads the image after the pass: the upscale, or the city or HUD drawing over it.
+    VkSubpassDependency outputDependency{};
+    outputDependency.srcSubpass = 0;
+    outputDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    outputDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    outputDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    if ( m_ResolutionController )
+    {
+        outputDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        outputDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    }
+    else
+    {
+        std::tie( outputDependency.dstStageMask, outputDependency.dstAccessMask ) = getSceneConsumer();
+    }
+    if ( m_ResolutionController || m_OcclusionCulling || m_Options.hud )
+    {
+        renderPassInfo.dependencyCount = 1;
+        renderPassInfo.pDependencies = &outputDependency;
+    }
+
     if ( vkCreateRenderPass( m_Device, &renderPassInfo, nullptr, &m_RenderPass ) != VK_SUCCESS )
     {
         throw std::runtime_error( "failed to create render pass!" );
@@ -994,10 +2117,18 @@ void App::createDescriptorSetLayout()
     uboLayoutBinding.pImmutableSamplers = nullptr;
     uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
+    VkDescriptorSetLayoutBinding samplerLayoutBinding{};
+    samplerLayoutBinding.binding = 1;
+    samplerLayoutBinding.descriptorCount = 1;
+    samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    samplerLayoutBinding.pImmutableSamplers = nullptr;
+    samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = 1;
-    layoutInfo.pBindings = &uboLayoutBinding;
+    layoutInfo.bindingCount = static_cast<uint32_t>( bindings.size() );
+    layoutInfo.pBindings = bindings.data();
 
     VkResult result = vkCreateDescriptorSetLayout( m_Device, &layoutInfo, nullptr, &m_DescriptorSetLayout );
     if ( result != VK_SUCCESS )
@@ -1017,34 +2148,101 @@ void App::pickphysicalDevice()
 
     std::vector<VkPhysicalDevice> devices( deviceCount );
     vkEnumeratePhysicalDevices( m_Instance, &deviceCount, devices.data() );
-    for ( const auto &m_Device : devices )
+
+    // --gpu wins over the environment, so a single run can be pointed elsewhere.
+    std::string selector = m_Options.gpu;
+    std::string selectorSource = "--gpu";
+    if ( const char *environment = std::getenv( "VULKAN_GPU" ); selector.empty() && environment )
+    {
+        selector = environment;
+        selectorSource = "VULKAN_GPU";
+    }
+
+    int64_t bestScore = 0;
+    for ( uint32_t i = 0; i < deviceCount; ++i )
     {
-        if ( isDeviceSuitable( m_Device ) )
+        PhysicalDeviceInfo info = describePhysicalDevice( devices[i], i, API_VERSION );
+        std::string description = describeForLog( info );
+
+        std::string reason;
+        bool suitable = isDeviceSuitable( info.device, reason );
+
+        if ( !selector.empty() )
         {
-            m_PhysicalDevice = m_Device;
-            break;
+            if ( !matchesDeviceSelector( info, selector ) || m_PhysicalDevice != VK_NULL_HANDLE )
+            {
+                std::cout << description << ": skipped, not selected by " << selectorSource << std::endl;
+                continue;
+            }
+            if ( !suitable )
+            {
+                throw std::runtime_error( description + " was selected by " + selectorSource + " but " + reason + "." );
+            }
+            std::cout << description << ": selected by " << selectorSource << "=" << selector << std::endl;
+            m_PhysicalDevice = info.device;
+            continue;
+        }
+
+        if ( !suitable )
+        {
+            std::cout << description << ": rejected, " << reason << std::endl;
+            continue;
+        }
+
+        int64_t score = scorePhysicalDevice( info );
+        std::cout << description << ": score " << score << std::endl;
+        if ( m_PhysicalDevice == VK_NULL_HANDLE || score > bestScore )
+        {
+            m_PhysicalDevice = info.device;
+            bestScore = score;
         }
     }
+
     if ( m_PhysicalDevice == VK_NULL_HANDLE )
     {
+        if ( !selector.empty() )
+        {
+            throw std::runtime_error( "No GPU matches " + selectorSource + "=" + selector + "." );
+        }
         throw std::runtime_error( "Failed to find a suitable GPU." );
     }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties( m_PhysicalDevice, &properties );
+    std::cout << "Using " << properties.deviceName << std::endl;
 }
 
-bool App::isDeviceSuitable( VkPhysicalDevice device )
+bool App::isDeviceSuitable( VkPhysicalDevice device, std::string &reason )
 {
     QueueFamilyIndices indices = findQueueFamilies( device );
+    if ( !indices.graphicsFamily.has_value() )
+    {
+        reason = "it has no graphics queue";
+        return false;
+    }
+    if ( !indices.presentFamily.has_value() )
+    {
+        reason = "none of its queues can present to the window";
+        return false;
+    }
 
-    bool extensionsSupported = checkDeviceExtensionSupport( device );
+    if ( !checkDeviceExtensionSupport( device ) )
+    {
+        reason = "it lacks required device extensions";
+        return false;
+    }
 
-    bool swapChainAdequate = false;
-    if ( extensionsSupported )
+    if ( !m_Options.headless )
     {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport( device );
-        swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+        if ( swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty() )
+        {
+            reason = "it has no surface formats or present modes for the window";
+            return false;
+        }
     }
 
-    return indices.isComplete() && extensionsSupported && swapChainAdequate;
+    return true;
 }
 
 QueueFamilyIndices App::findQueueFamilies( VkPhysicalDevice device )
@@ -1066,7 +2264,15 @@ QueueFamilyIndices App::findQueueFamilies( VkPhysicalDevice device )
         }
 
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR( device, i, m_Surface, &presentSupport );
+        if ( m_Options.headless )
+        {
+            // Nothing is presented, so the graphics queue doubles as the "present" queue.
+            presentSupport = ( queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT ) != 0;
+        }
+        else
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR( device, i, m_Surface, &presentSupport );
+        }
 
         if ( presentSupport )
         {
@@ -1081,6 +2287,21 @@ QueueFamilyIndices App::findQueueFamilies( VkPhysicalDevice device )
         i++;
     }
 
+    for ( uint32_t family = 0; family < queueFamilyCount; ++family )
+    {
+        VkQueueFlags flags = queueFamilies[family].queueFlags;
+        if ( ( flags & VK_QUEUE_COMPUTE_BIT ) && !( flags & VK_QUEUE_GRAPHICS_BIT ) )
+        {
+            indices.computeFamily = family;
+            break;
+        }
+    }
+    // A graphics family always supports compute as well.
+    if ( !indices.computeFamily.has_value() )
+    {
+        indices.computeFamily = indices.graphicsFamily;
+    }
+
     return indices;
 }
 
@@ -1093,7 +2314,8 @@ bool App::checkDeviceExtensionSupport( VkPhysicalDevice device )
 
     vkEnumerateDeviceExtensionProperties( device, nullptr, &extensionCount, availableExtensions.data() );
 
-    std::set<std::string> requiredExtension( deviceExtensions.begin(), deviceExtensions.end() );
+    std::vector<const char *> extensions = getRequiredDeviceExtensions();
+    std::set<std::string> requiredExtension( extensions.begin(), extensions.end() );
 
     for ( const auto &extension : availableExtensions )
     {
@@ -1109,46 +2331,25 @@ void App::createBuffer( VkDeviceSize size,
                         VkBuffer &buffer,
                         VkDeviceMemory &bufferMemory )
 {
-    VkBufferCreateInfo bufferInfo{};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = size;
-    bufferInfo.usage = usage;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-    if ( vkCreateBuffer( m_Device, &bufferInfo, nullptr, &buffer ) != VK_SUCCESS )
-    {
-        throw std::runtime_error( "failed to create buffer!" );
-    }
-
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements( m_Device, buffer, &memRequirements );
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType( memRequirements.memoryTypeBits, properties );
-
-    if ( vkAllocateMemory( m_Device, &allocInfo, nullptr, &bufferMemory ) != VK_SUCCESS )
-    {
-        throw std::runtime_error( "failed to allocate buffer memory!" );
-    }
-
-    vkBindBufferMemory( m_Device, buffer, bufferMemory, 0 );
+    ::createBuffer( m_PhysicalDevice, m_Device, size, usage, properties, buffer, bufferMemory );
 }
 
 VkShaderModule App::createShaderModule( const std::vector<char> &code )
 {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t *>( code.data() );
-    VkShaderModule shaderModule;
-    if ( vkCreateShaderModule( m_Device, &createInfo, nullptr, &shaderModule ) != VK_SUCCESS )
+    return ::createShaderModule( m_Device, code );
+}
+
+VkShaderModule App::loadShaderModule( const std::string &name )
+{
+    auto preloaded = m_ShaderCode.find( name );
+    if ( preloaded != m_ShaderCode.end() )
     {
-        throw std::runtime_error( "failed to create shader module!" );
+        return ::createShaderModule( m_Device, preloaded->second.getData() );
     }
 
-    return shaderModule;
+    // Archived shaders are passed to the driver straight from the mapping.
+    AssetBlob code = m_Assets.load( name );
+    return ::createShaderModule( m_Device, code.getData() );
 }
 
 SwapChainSupportDetails App::querySwapChainSupport( VkPhysicalDevice device )
@@ -1213,6 +2414,29 @@ VkPresentModeKHR App::chooseSwapPresentMode(
     return bestMode;
 }
 
+VkImageLayout App::getPresentLayout() const
+{
+    return m_Options.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
+
+std::pair<VkPipelineStageFlags, VkAccessFlags> App::getSceneConsumer() const
+{
+    // The city is drawn over the frame before the HUD.
+    if ( m_OcclusionCulling )
+    {
+        return { OcclusionScene::kImageStages, OcclusionScene::kImageAccess };
+    }
+    if ( m_Options.hud )
+    {
+        return { PerfHud::kImageStages, PerfHud::kImageAccess };
+    }
+    if ( m_ReadbackEnabled || m_Options.headless )
+    {
+        return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT };
+    }
+    return { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0 };
+}
+
 VkExtent2D App::chooseSwapExtent( const VkSurfaceCapabilitiesKHR &capabilities ) const
 {
     if ( capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max() )
@@ -1238,7 +2462,9 @@ void App::createLogicalDevice()
     QueueFamilyIndices indices = findQueueFamilies( m_PhysicalDevice );
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(),
+                                               indices.presentFamily.value(),
+                                               indices.computeFamily.value() };
 
     /*VkDeviceQueueCreateInfo queueCreateInfo{};
     queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
@@ -1257,7 +2483,24 @@ void App::createLogicalDevice()
     }
     // queueCreateInfo.pQueuePriorities = &queuePriority;
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures( m_PhysicalDevice, &supportedFeatures );
+
     VkPhysicalDeviceFeatures deviceFeatures{};
+    if ( m_Options.pipelineStatistics )
+    {
+        deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+        deviceFeatures.occlusionQueryPrecise = supportedFeatures.occlusionQueryPrecise;
+    }
+    // Compressed textures are used whenever the device can sample them.
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+    deviceFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+    if ( !m_Options.pointCloud.empty() )
+    {
+        deviceFeatures.largePoints = supportedFeatures.largePoints;
+    }
+    m_EnabledFeatures = deviceFeatures;
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -1268,8 +2511,93 @@ void App::createLogicalDevice()
     createInfo.pEnabledFeatures = &deviceFeatures;
 
     // createInfo.enabledExtensionCount = 0;
-    createInfo.enabledExtensionCount   = static_cast<uint32_t>( deviceExtensions.size() );
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    std::vector<const char *> extensions = getRequiredDeviceExtensions();
+
+    VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+    bool dynamicRenderingCore = false;
+    if ( m_Options.dynamicRendering )
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties( m_PhysicalDevice, &properties );
+        dynamicRenderingCore = properties.apiVersion >= VK_API_VERSION_1_3;
+        // The extension needs 1.1 for vkGetPhysicalDeviceFeatures2 and the extensions it depends on.
+        bool dynamicRenderingExtension = !dynamicRenderingCore && properties.apiVersion >= VK_API_VERSION_1_1 &&
+                                         hasDeviceExtension( m_PhysicalDevice, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME );
+
+        if ( dynamicRenderingCore || dynamicRenderingExtension )
+        {
+            VkPhysicalDeviceFeatures2 features2{};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features2.pNext = &dynamicRenderingFeatures;
+            vkGetPhysicalDeviceFeatures2( m_PhysicalDevice, &features2 );
+            m_DynamicRendering = dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+        }
+
+        if ( m_DynamicRendering )
+        {
+            dynamicRenderingFeatures.pNext = nullptr;
+            createInfo.pNext = &dynamicRenderingFeatures;
+            if ( dynamicRenderingExtension )
+            {
+                extensions.push_back( VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME );
+                // Core in 1.2.
+                if ( properties.apiVersion < VK_API_VERSION_1_2 )
+                {
+                    extensions.push_back( VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME );
+                    extensions.push_back( VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME );
+                }
+            }
+        }
+        else
+        {
+            std::cout << "Dynamic rendering isn't supported by this device, using a render pass." << std::endl;
+        }
+    }
+
+    // Occlusion culling draws with a count written on the GPU. Core in 1.2, but even
+    // there the feature has to be enabled.
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    if ( m_Options.occlusionCulling )
+    {
+        m_OcclusionCulling = HiZCuller::isSupported( m_PhysicalDevice );
+        if ( m_OcclusionCulling )
+        {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties( m_PhysicalDevice, &properties );
+            if ( properties.apiVersion >= VK_API_VERSION_1_2 )
+            {
+                vulkan12Features.drawIndirectCount = VK_TRUE;
+                vulkan12Features.pNext = const_cast<void *>( createInfo.pNext );
+                createInfo.pNext = &vulkan12Features;
+            }
+            else
+            {
+                extensions.push_back( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME );
+            }
+        }
+        else
+        {
+            std::cout << "Draw indirect count isn't supported by this device, ignoring --hiz." << std::endl;
+        }
+    }
+
+    // Lets the HUD show how much of each heap is used; reading it needs 1.1.
+    if ( m_Options.hud )
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties( m_PhysicalDevice, &properties );
+        m_MemoryBudget = properties.apiVersion >= VK_API_VERSION_1_1 &&
+                         hasDeviceExtension( m_PhysicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME );
+        if ( m_MemoryBudget )
+        {
+            extensions.push_back( VK_EXT_MEMORY_BUDGET_EXTENSION_NAME );
+        }
+    }
+
+    createInfo.enabledExtensionCount   = static_cast<uint32_t>( extensions.size() );
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     if ( enableValidationLayers )
     {
@@ -1289,6 +2617,20 @@ void App::createLogicalDevice()
 
     vkGetDeviceQueue( m_Device, indices.graphicsFamily.value(), 0, &m_GraphicsQueue );
     vkGetDeviceQueue( m_Device, indices.presentFamily.value(), 0, &m_PresentQueue );
+    vkGetDeviceQueue( m_Device, indices.computeFamily.value(), 0, &m_ComputeQueue );
+    m_DeletionQueue.create( m_Device );
+
+    if ( m_DynamicRendering )
+    {
+        m_CmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(
+            vkGetDeviceProcAddr( m_Device, dynamicRenderingCore ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR" ) );
+        m_CmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(
+            vkGetDeviceProcAddr( m_Device, dynamicRenderingCore ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR" ) );
+        if ( !m_CmdBeginRendering || !m_CmdEndRendering )
+        {
+            throw std::runtime_error( "Failed to load the dynamic rendering commands." );
+        }
+    }
 }
 
 bool App::checkValidationLayerSupport() const
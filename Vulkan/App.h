@@ -8,6 +8,7 @@
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
 #include <GLFW/glfw3.h>
 
+#include <map>
 #include <optional>
 #include <vector>
 #include <fstream>
@@ -16,11 +17,38 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <array>
 
+#include <atomic>
 #include <chrono>
+#include <exception>
+#include <utility>
+
+#include "AssetArchive.h"
+#include "AsyncCompute.h"
+#include "Benchmark.h"
+#include "DebugMessageSink.h"
+#include "DeletionQueue.h"
+#include "DynamicMesh.h"
+#include "DrawList.h"
+#include "DynamicResolution.h"
+#include "FrameCapture.h"
+#include "FramePipeline.h"
+#include "FrameReadback.h"
+#include "OcclusionScene.h"
+#include "Options.h"
+#include "ParticleSystem.h"
+#include "PerfHud.h"
+#include "PointCloud.h"
+#include "Profiler.h"
+#include "ShaderVariant.h"
+#include "SpriteBatch.h"
+#include "TextureStreamer.h"
 
 const uint32_t WIN_WIDTH = 800;
 const uint32_t WIN_HEIGHT = 600;
 const int MAX_FRAMES_IN_FLIGHT = 2;
+// Highest version used: 1.1 for the device UUIDs --gpu can select by, 1.3 for core
+// dynamic rendering. Older devices keep working at the version they support.
+const uint32_t API_VERSION = VK_API_VERSION_1_3;
 
 const std::vector<const char *> validationLayers = { "VK_LAYER_KHRONOS_validation" };
 const std::vector<const char *> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
@@ -29,6 +57,9 @@ struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // A compute-only family when the device has one, so compute work can overlap
+    // with graphics; the graphics family otherwise.
+    std::optional<uint32_t> computeFamily;
 
     bool isComplete() const
     {
@@ -50,6 +81,19 @@ struct UniformBufferObject
     alignas( 16 ) glm::mat4 proj;
 };
 
+// Everything the update thread prepares for one frame of the render thread.
+struct FramePacket
+{
+    uint64_t            frameIndex = 0;
+    UniformBufferObject ubo{};
+    float               particleDeltaTime = 0.0f;
+    // Seconds, for what the capture doesn't record; counted in frames when benchmarking
+    // or replaying.
+    float               time = 0.0f;
+    // The frame being replayed; empty otherwise.
+    CaptureFrame        capture;
+};
+
 struct Vertex
 {
     glm::vec2 pos;
@@ -92,6 +136,17 @@ const std::vector<Vertex> rectangle = { { { -0.5f, -0.5f }, { 1.0f, 0.0f, 0.0f }
 
 const std::vector<uint16_t> indices = { 0, 1, 2, 2, 3, 0 };
 
+// constant_id values of TexturedShader.frag.
+namespace ShaderConstant
+{
+enum : uint32_t
+{
+    UseTexture = 0,
+    UseVertexColor = 1,
+    BlurRadius = 2,
+};
+}
+
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
 #else
@@ -101,19 +156,22 @@ const bool enableValidationLayers = true;
 class App
 {
 public:
+    App() = default;
+    explicit App( const AppOptions &options ) : m_Options( options ) {}
+
     void run();
 
+    // Copies every presented frame back to host memory. Call before run().
+    // Without a callback the frames are queued on getFrameReadback(). The callback runs
+    // on the render thread.
+    void enableFrameReadback( FrameReadback::Callback callback = nullptr );
+    FrameReadback &getFrameReadback() { return m_FrameReadback; }
+
 private:
     static std::vector<char> readFile( const std::string &filename );
     
     void setupDebugMessenger();
 
-    static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback( 
-        VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-        VkDebugUtilsMessageTypeFlagsEXT messageType,
-        const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
-        void *pUserData );
-
      VkResult CreateDebugUtilsMessengerEXT( 
          VkInstance m_Instance,
          const VkDebugUtilsMessengerCreateInfoEXT *pCreateInfo,
@@ -129,21 +187,25 @@ private:
          VkDebugUtilsMessengerCreateInfoEXT &createInfo );
     
      std::vector<const char *> getRequiredExtensions();
+     std::vector<const char *> getRequiredDeviceExtensions() const;
 
      static void framebufferResizeCallback( GLFWwindow *window, int width, int height );
 
      uint32_t findMemoryType( uint32_t typeFilter, VkMemoryPropertyFlags properties );
-     
-     void copyBuffer( VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size );
 
 
 private:
+    void initGlfw();
     void initWindow();
     void initVulkan();
+    void preloadShaders();
     void mainLoop();
+    void updateLoop();
+    void renderLoop();
     void cleanup();
  
-    void drawFrame();
+    void updateScene( FramePacket &packet, uint64_t frameIndex );
+    void drawFrame( const FramePacket &packet );
 
 private:
     bool checkValidationLayerSupport() const;
@@ -153,14 +215,19 @@ private:
     void createSurface();
     void createLogicalDevice();
     void createSwapChain();
+    void createHeadlessTargets();
     void createImageView();
+    void createResolutionTargets();
     void createRenderPass();
     void createDescriptorSetLayout(); 
     void createGraphicsPipeline();
+    VkPipeline createGraphicsPipelineVariant( const VkSpecializationInfo *specialization, VkPipelineCache cache );
     void createFramebuffers();
     void createCommandPool();
-    void createVertexBuffer();
-    void createIndexBuffer();
+    void createMesh();
+    void editMesh();
+    // Applies an edit to m_Mesh and captures it.
+    void editSceneMesh( const CaptureMeshEdit &edit );
     void createUniformBuffers();
     void createDescriptorPool();
     void createDescriptorSets();
@@ -170,18 +237,39 @@ private:
 
     void cleanupSwapchain();
 
-    void updateUniformBuffer( uint32_t currentImage );
+    void updateUniformBuffer( uint32_t currentImage, const UniformBufferObject &ubo );
+    void createParticles( const QueueFamilyIndices &queueFamilies );
+    void createTextures();
+    void updateTextureDescriptor( uint32_t currentFrame );
+    void updateParticles( float deltaTime );
+    void createSprites();
+    void submitSprites();
+    void createPointCloud();
+    void createOcclusionScene();
+    void createHud();
+    void updateHud();
 
     VkShaderModule createShaderModule( const std::vector<char> &code );
+    VkShaderModule loadShaderModule( const std::string &name );
     SwapChainSupportDetails querySwapChainSupport( VkPhysicalDevice device );
     VkSurfaceFormatKHR chooseSwapSurfaceFormat( const std::vector<VkSurfaceFormatKHR> &availableFormats ) const;
     VkPresentModeKHR chooseSwapPresentMode( const std::vector<VkPresentModeKHR> &availablePresentModes ) const;
     VkExtent2D chooseSwapExtent( const VkSurfaceCapabilitiesKHR &capabilities ) const;
+    // Layout the frame's color image ends up in: ready to present, or ready to be
+    // copied from when running headless.
+    VkImageLayout getPresentLayout() const;
+    // Stage and access of what uses the swap chain image once the scene is on it: the
+    // occlusion city or the HUD, a copy for readback or headless frames, or nothing but
+    // the present.
+    std::pair<VkPipelineStageFlags, VkAccessFlags> getSceneConsumer() const;
     
     void recordCommandBuffer( VkCommandBuffer commandBuffer, uint32_t imageIndex );
+    void beginMainPass( VkCommandBuffer commandBuffer, uint32_t imageIndex );
+    void endMainPass( VkCommandBuffer commandBuffer, uint32_t imageIndex );
 
     void pickphysicalDevice();
-    bool isDeviceSuitable( VkPhysicalDevice m_Device );
+    // Fills reason when the device can't be used.
+    bool isDeviceSuitable( VkPhysicalDevice device, std::string &reason );
     QueueFamilyIndices findQueueFamilies( VkPhysicalDevice device );
     bool checkDeviceExtensionSupport( VkPhysicalDevice device );
 
@@ -193,30 +281,55 @@ private:
 
   private: // Window Application
     GLFWwindow *m_Window = nullptr;
+    AppOptions  m_Options;
 
 private: // Vulkan API
-    VkInstance m_Instance;
+    VkInstance m_Instance = VK_NULL_HANDLE;
     VkDebugUtilsMessengerEXT debugMessenger;
+    // Validation messages are written from here, off the threads that trigger them.
+    DebugMessageSink         m_DebugLog;
 
     VkDevice         m_Device;
-    VkPhysicalDevice m_PhysicalDevice;
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
     VkQueue          m_GraphicsQueue;
-    VkSurfaceKHR     m_Surface;
+    VkSurfaceKHR     m_Surface = VK_NULL_HANDLE;
     VkQueue          m_PresentQueue;
-    VkSwapchainKHR   m_SwapChain;
+    VkQueue          m_ComputeQueue;
+    VkSwapchainKHR   m_SwapChain = VK_NULL_HANDLE;
     VkCommandPool    m_CommandPool;
+    // Resources replaced while frames are in flight are released here; declared ahead
+    // of anything holding a UniqueHandle so it outlives them.
+    DeletionQueue    m_DeletionQueue;
 
     uint32_t m_CurrentFrame = 0;
+    uint64_t m_FrameNumber = 0;
     std::vector<VkSemaphore>  m_ImageAvailableSemaphores;
     std::vector<VkSemaphore>  m_RenderFinishedSemaphores;
     std::vector<VkFence>      m_InFlightFences;
 
-    bool m_FramebufferResized = false;
-
-    VkBuffer m_VertexBuffer;
-    VkDeviceMemory m_VertexBufferMemory;
-    VkBuffer m_IndexBuffer;
-    VkDeviceMemory m_IndexBufferMemory;
+    // Written on the update thread (GLFW callbacks), read on the render thread.
+    std::atomic<bool>     m_FramebufferResized = false;
+    std::atomic<uint32_t> m_FramebufferWidth = WIN_WIDTH;
+    std::atomic<uint32_t> m_FramebufferHeight = WIN_HEIGHT;
+
+    // The main thread polls events and updates the scene one packet ahead of the
+    // render thread, which records, submits and presents.
+    FramePipeline<FramePacket>    m_FramePackets;
+    std::exception_ptr            m_RenderError;
+    std::optional<FrameBenchmark> m_Benchmark;
+    // Update thread only.
+    double m_LastUpdateUs = 0.0;
+
+    // The rectangle; editable while frames are in flight.
+    DynamicMesh m_Mesh;
+    // Drawn from m_Mesh this frame, with the scene pipeline.
+    std::vector<CaptureDraw> m_SceneDraws;
+
+    CaptureWriter m_CaptureWriter;
+    double        m_CaptureStartUs = 0.0;
+    CaptureReader m_Replay;
+    // Update thread only: where frame 0 of the replay sits on the CPU timeline.
+    double        m_ReplayStartUs = 0.0;
 
     std::vector<VkBuffer> m_UniformBuffers;
     std::vector<VkDeviceMemory> m_UniformBuffersMemory;
@@ -232,10 +345,82 @@ private: // Vulkan API
     std::vector<VkImageView>   m_SwapChainImageViews;
     VkFormat                   m_SwapChainImageFormat;
     VkExtent2D                 m_SwapChainExtent;
-
-    VkRenderPass     m_RenderPass;
+    // Headless mode renders into these instead of swap chain images.
+    std::vector<VkDeviceMemory> m_HeadlessImagesMemory;
+
+    // With dynamic resolution the main pass renders into m_ResolutionTargets, and the
+    // framebuffers are theirs, one per frame in flight. m_RenderExtent is the part
+    // drawn this frame; the swap chain extent otherwise. Render thread only.
+    std::optional<ResolutionController> m_ResolutionController;
+    ResolutionTargets                   m_ResolutionTargets;
+    VkExtent2D                          m_RenderExtent{};
+    uint64_t                            m_ResolvedGpuFrames = 0;
+
+    double m_LastPresentUs = 0.0;
+    double m_LastPresentIntervalMs = 0.0;
+
+    // VK_NULL_HANDLE with dynamic rendering, which begins rendering on the image views.
+    VkRenderPass     m_RenderPass = VK_NULL_HANDLE;
+    bool                       m_DynamicRendering = false;
+    PFN_vkCmdBeginRenderingKHR m_CmdBeginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR   m_CmdEndRendering = nullptr;
     VkDescriptorSetLayout m_DescriptorSetLayout;
     VkPipelineLayout m_PipelineLayout;
 
     VkPipeline m_GraphicsPipeline;
+    // Render thread only. The totals are reported with --pipeline-stats.
+    DrawList             m_DrawList;
+    // Only lists long enough to pay for the threads are sorted in parallel.
+    uint32_t             m_SortThreadCount = 1;
+    DrawRecorder         m_DrawRecorder;
+    DrawRecorder::Stats  m_DrawTotals;
+    uint64_t             m_RecordedFrames = 0;
+    // Owns m_GraphicsPipeline and every other variant created so far.
+    PipelineVariants m_PipelineVariants;
+
+    bool          m_ReadbackEnabled = false;
+    FrameReadback m_FrameReadback;
+
+    AsyncCompute m_AsyncCompute;
+
+    // Shaders come from here when --assets is given; load() falls back to loose files.
+    AssetArchive               m_Assets;
+    // Filled by the startup graph so pipeline compilation doesn't wait on file reads.
+    std::map<std::string, AssetBlob> m_ShaderCode;
+    TextureStreamer            m_Textures;
+    TextureStreamer::TextureId m_Texture = TextureStreamer::kFallbackTexture;
+    // Texture version each frame's descriptor set was last written with.
+    std::vector<uint64_t>      m_TextureVersions;
+
+    ParticleSystem      m_Particles;
+    double              m_LastParticleReportUs = 0.0;
+    // Particles simulated per GPU millisecond, one sample per resolved frame.
+    std::vector<double> m_ParticleThroughput;
+
+    SpriteBatch         m_Sprites;
+    // CPU time spent submitting the --sprites quads, one sample per frame.
+    std::vector<double> m_SpriteSubmitMs;
+    uint64_t            m_SpriteDraws = 0;
+    uint64_t            m_SpritesDropped = 0;
+
+    PointCloud m_PointCloud;
+    uint64_t   m_PointCloudFrames = 0;
+    uint64_t   m_PointCloudDraws = 0;
+    uint64_t   m_PointCloudPoints = 0;
+
+    OcclusionScene m_Occlusion;
+    // --hiz was given and drawIndirectCount could be enabled.
+    bool           m_OcclusionCulling = false;
+    uint64_t       m_OcclusionFrames = 0;
+    uint64_t       m_OcclusionDrawn = 0;
+
+    PerfHud     m_Hud;
+    // Collected while the current frame is built and shown by the next one.
+    HudCounters m_FrameCounters;
+    uint64_t    m_HudResolvedFrames = 0;
+    // VK_EXT_memory_budget was enabled for the HUD.
+    bool        m_MemoryBudget = false;
+
+    GpuProfiler m_GpuProfiler;
+    VkPhysicalDeviceFeatures m_EnabledFeatures{};
 };
@@ -0,0 +1,356 @@
+#include "AssetArchive.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef VULKAN_WITH_LZ4
+#include <lz4.h>
+#endif
+#ifdef VULKAN_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace
+{
+const char     kMagic[8] = { 'V', 'K', 'P', 'A', 'K', 0, 0, 0 };
+const uint32_t kVersion = 1;
+
+struct ArchiveHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+    uint64_t indexOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+uint64_t alignUp( uint64_t value, uint64_t alignment )
+{
+    return ( value + alignment - 1 ) / alignment * alignment;
+}
+
+std::vector<char> compress( [[maybe_unused]] const std::vector<char> &data, AssetCompression compression )
+{
+    std::vector<char> compressed;
+    switch ( compression )
+    {
+    case AssetCompression::None:
+        break;
+    case AssetCompression::LZ4:
+#ifdef VULKAN_WITH_LZ4
+    {
+        compressed.resize( LZ4_compressBound( static_cast<int>( data.size() ) ) );
+        int size = LZ4_compress_default( data.data(),
+                                         compressed.data(),
+                                         static_cast<int>( data.size() ),
+                                         static_cast<int>( compressed.size() ) );
+        compressed.resize( size > 0 ? size : 0 );
+        break;
+    }
+#else
+        throw std::runtime_error( "LZ4 needs a build with VULKAN_WITH_LZ4" );
+#endif
+    case AssetCompression::Zstd:
+#ifdef VULKAN_WITH_ZSTD
+    {
+        compressed.resize( ZSTD_compressBound( data.size() ) );
+        size_t size = ZSTD_compress( compressed.data(), compressed.size(), data.data(), data.size(), 19 );
+        compressed.resize( ZSTD_isError( size ) ? 0 : size );
+        break;
+    }
+#else
+        throw std::runtime_error( "zstd needs a build with VULKAN_WITH_ZSTD" );
+#endif
+    }
+    return compressed;
+}
+
+std::vector<char> decompress( [[maybe_unused]] std::span<const char> data, uint64_t size, AssetCompression compression )
+{
+    std::vector<char> decompressed( size );
+    bool ok = false;
+    switch ( compression )
+    {
+    case AssetCompression::None:
+        break;
+    case AssetCompression::LZ4:
+#ifdef VULKAN_WITH_LZ4
+        ok = LZ4_decompress_safe( data.data(),
+                                  decompressed.data(),
+                                  static_cast<int>( data.size() ),
+                                  static_cast<int>( size ) ) == static_cast<int>( size );
+#endif
+        break;
+    case AssetCompression::Zstd:
+#ifdef VULKAN_WITH_ZSTD
+        ok = ZSTD_decompress( decompressed.data(), size, data.data(), data.size() ) == size;
+#endif
+        break;
+    }
+    if ( !ok )
+    {
+        throw std::runtime_error( "failed to decompress asset" );
+    }
+    return decompressed;
+}
+} // namespace
+
+struct AssetArchive::Entry
+{
+    uint64_t nameOffset;
+    uint32_t nameLength;
+    uint32_t compression;
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t size;
+};
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+void MappedFile::open( const std::string &path )
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA( path.c_str(),
+                               GENERIC_READ,
+                               FILE_SHARE_READ,
+                               nullptr,
+                               OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                               nullptr );
+    if ( file == INVALID_HANDLE_VALUE )
+    {
+        throw std::runtime_error( "failed to open file " + path );
+    }
+    LARGE_INTEGER size;
+    if ( !GetFileSizeEx( file, &size ) || size.QuadPart == 0 )
+    {
+        CloseHandle( file );
+        // An empty file can't be mapped.
+        throw std::runtime_error( "failed to map file " + path + ", it is empty" );
+    }
+    HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    const void *view = mapping ? MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) : nullptr;
+    if ( !view )
+    {
+        if ( mapping )
+        {
+            CloseHandle( mapping );
+        }
+        CloseHandle( file );
+        throw std::runtime_error( "failed to map file " + path );
+    }
+    m_File = file;
+    m_Mapping = mapping;
+    m_Data = static_cast<const char *>( view );
+    m_Size = static_cast<size_t>( size.QuadPart );
+#else
+    int file = ::open( path.c_str(), O_RDONLY );
+    if ( file < 0 )
+    {
+        throw std::runtime_error( "failed to open file " + path );
+    }
+    struct stat status;
+    if ( fstat( file, &status ) != 0 || status.st_size == 0 )
+    {
+        ::close( file );
+        // An empty file can't be mapped.
+        throw std::runtime_error( "failed to map file " + path + ", it is empty" );
+    }
+    void *view = mmap( nullptr, static_cast<size_t>( status.st_size ), PROT_READ, MAP_PRIVATE, file, 0 );
+    ::close( file );
+    if ( view == MAP_FAILED )
+    {
+        throw std::runtime_error( "failed to map file " + path );
+    }
+    m_Data = static_cast<const char *>( view );
+    m_Size = static_cast<size_t>( status.st_size );
+#endif
+}
+
+void MappedFile::close()
+{
+    if ( !m_Data )
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile( m_Data );
+    CloseHandle( m_Mapping );
+    CloseHandle( m_File );
+    m_File = nullptr;
+    m_Mapping = nullptr;
+#else
+    munmap( const_cast<char *>( m_Data ), m_Size );
+#endif
+    m_Data = nullptr;
+    m_Size = 0;
+}
+
+void AssetArchive::open( const std::string &path )
+{
+    close();
+    m_File.open( path );
+
+    std::span<const char> data = m_File.getData();
+    ArchiveHeader header;
+    if ( data.size() < sizeof( header ) )
+    {
+        close();
+        throw std::runtime_error( path + " is not an asset archive" );
+    }
+    memcpy( &header, data.data(), sizeof( header ) );
+    if ( memcmp( header.magic, kMagic, sizeof( kMagic ) ) != 0 || header.version != kVersion )
+    {
+        close();
+        throw std::runtime_error( path + " is not an asset archive" );
+    }
+    if ( header.indexOffset % alignof( Entry ) != 0 || header.indexOffset > data.size() ||
+         header.entryCount > ( data.size() - header.indexOffset ) / sizeof( Entry ) ||
+         header.namesOffset > data.size() || header.namesSize > data.size() - header.namesOffset )
+    {
+        close();
+        throw std::runtime_error( path + " is truncated" );
+    }
+
+    m_Entries = reinterpret_cast<const Entry *>( data.data() + header.indexOffset );
+    m_EntryCount = header.entryCount;
+    m_Names = data.data() + header.namesOffset;
+    m_NamesSize = static_cast<size_t>( header.namesSize );
+
+    for ( size_t i = 0; i < m_EntryCount; ++i )
+    {
+        const Entry &entry = m_Entries[i];
+        if ( entry.nameOffset > m_NamesSize || entry.nameLength > m_NamesSize - entry.nameOffset ||
+             entry.offset > data.size() || entry.storedSize > data.size() - entry.offset )
+        {
+            close();
+            throw std::runtime_error( path + " has an invalid index" );
+        }
+    }
+}
+
+void AssetArchive::close()
+{
+    m_File.close();
+    m_Entries = nullptr;
+    m_EntryCount = 0;
+    m_Names = nullptr;
+    m_NamesSize = 0;
+}
+
+AssetBlob AssetArchive::load( const std::string &name ) const
+{
+    const Entry *entry = find( name );
+    if ( !entry )
+    {
+        return AssetBlob( readFile( name ) );
+    }
+
+    std::span<const char> stored = m_File.getData().subspan( entry->offset, entry->storedSize );
+    AssetCompression compression = static_cast<AssetCompression>( entry->compression );
+    if ( compression == AssetCompression::None )
+    {
+        return AssetBlob( stored );
+    }
+    return AssetBlob( decompress( stored, entry->size, compression ) );
+}
+
+const AssetArchive::Entry *AssetArchive::find( std::string_view name ) const
+{
+    const Entry *end = m_Entries + m_EntryCount;
+    const Entry *found = std::lower_bound( m_Entries, end, name, [this]( const Entry &entry, std::string_view key ) {
+        return getName( entry ) < key;
+    } );
+    return found != end && getName( *found ) == name ? found : nullptr;
+}
+
+std::string_view AssetArchive::getName( const Entry &entry ) const
+{
+    return std::string_view( m_Names + entry.nameOffset, entry.nameLength );
+}
+
+void AssetArchive::write( const std::string &archivePath,
+                          const std::vector<std::string> &files,
+                          AssetCompression compression )
+{
+    std::vector<std::string> names = files;
+    std::sort( names.begin(), names.end() );
+    names.erase( std::unique( names.begin(), names.end() ), names.end() );
+
+    std::ofstream out( archivePath, std::ios::binary | std::ios::trunc );
+    if ( !out )
+    {
+        throw std::runtime_error( "failed to create " + archivePath );
+    }
+
+    ArchiveHeader header{};
+    memcpy( header.magic, kMagic, sizeof( kMagic ) );
+    header.version = kVersion;
+    header.entryCount = static_cast<uint32_t>( names.size() );
+    out.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+
+    auto padTo = [&out]( uint64_t alignment ) {
+        uint64_t position = static_cast<uint64_t>( out.tellp() );
+        static const char zeros[kPayloadAlignment] = {};
+        out.write( zeros, static_cast<std::streamsize>( alignUp( position, alignment ) - position ) );
+        return alignUp( position, alignment );
+    };
+
+    std::vector<Entry> entries;
+    std::string nameBlob;
+    for ( const std::string &name : names )
+    {
+        std::vector<char> data = readFile( name );
+
+        Entry entry{};
+        entry.nameOffset = nameBlob.size();
+        entry.nameLength = static_cast<uint32_t>( name.size() );
+        entry.size = data.size();
+        nameBlob += name;
+
+        std::vector<char> compressed = compress( data, compression );
+        bool keepCompressed = !compressed.empty() && compressed.size() <= data.size() - data.size() / 8;
+        const std::vector<char> &payload = keepCompressed ? compressed : data;
+        entry.compression = static_cast<uint32_t>( keepCompressed ? compression : AssetCompression::None );
+        entry.storedSize = payload.size();
+        entry.offset = padTo( kPayloadAlignment );
+        out.write( payload.data(), static_cast<std::streamsize>( payload.size() ) );
+
+        entries.push_back( entry );
+    }
+
+    header.indexOffset = padTo( alignof( Entry ) );
+    out.write( reinterpret_cast<const char *>( entries.data() ),
+               static_cast<std::streamsize>( entries.size() * sizeof( Entry ) ) );
+    header.namesOffset = static_cast<uint64_t>( out.tellp() );
+    header.namesSize = nameBlob.size();
+    out.write( nameBlob.data(), static_cast<std::streamsize>( nameBlob.size() ) );
+
+    out.seekp( 0 );
+    out.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+    if ( !out )
+    {
+        throw std::runtime_error( "failed to write " + archivePath );
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+// Packed asset archive, memory-mapped for loading.
+//
+// Layout, all little endian:
+//   ArchiveHeader
+//   payloads, each starting on a kPayloadAlignment boundary
+//   Entry[entryCount], sorted by name
+//   names, back to back without terminators
+//
+// Opening an archive maps the file once. Stored payloads are handed out as spans
+// straight into the mapping; only compressed ones (LZ4 or zstd, when the build has
+// VULKAN_WITH_LZ4 / VULKAN_WITH_ZSTD) are decoded into memory of their own.
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+enum class AssetCompression : uint32_t
+{
+    None = 0,
+    LZ4 = 1,
+    Zstd = 2,
+};
+
+// Read-only view of a whole file.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile( const MappedFile & ) = delete;
+    MappedFile &operator=( const MappedFile & ) = delete;
+
+    // Throws std::runtime_error when the file can't be opened or mapped, which includes empty files.
+    void open( const std::string &path );
+    void close();
+
+    bool                  isOpen() const { return m_Data != nullptr; }
+    std::span<const char> getData() const { return { m_Data, m_Size }; }
+
+private:
+    const char *m_Data = nullptr;
+    size_t      m_Size = 0;
+#ifdef _WIN32
+    void *m_File = nullptr;
+    void *m_Mapping = nullptr;
+#endif
+};
+
+// An asset's bytes: either a span into the mapping or a buffer it owns.
+class AssetBlob
+{
+public:
+    AssetBlob() = default;
+    explicit AssetBlob( std::span<const char> mapped ) : m_Data( mapped ) {}
+    explicit AssetBlob( std::vector<char> &&storage ) : m_Storage( std::move( storage ) ), m_Data( m_Storage ) {}
+    AssetBlob( AssetBlob && ) = default;
+    AssetBlob &operator=( AssetBlob && ) = default;
+    AssetBlob( const AssetBlob & ) = delete;
+    AssetBlob &operator=( const AssetBlob & ) = delete;
+
+    std::span<const char> getData() const { return m_Data; }
+    bool                  isMapped() const { return m_Storage.empty() && !m_Data.empty(); }
+
+private:
+    std::vector<char>     m_Storage;
+    std::span<const char> m_Data;
+};
+
+class AssetArchive
+{
+public:
+    static constexpr uint64_t kPayloadAlignment = 64;
+
+    // Throws std::runtime_error when the file isn't a valid archive.
+    void open( const std::string &path );
+    void close();
+
+    bool   isOpen() const { return m_File.isOpen(); }
+    bool   contains( std::string_view name ) const { return find( name ) != nullptr; }
+    size_t getAssetCount() const { return m_EntryCount; }
+
+    // Returns the asset from the archive, or reads it from the file system when the
+    // archive isn't open or doesn't have it, so callers work either way.
+    AssetBlob load( const std::string &name ) const;
+
+    // Packs the files into an archive, each stored under its path as given. Entries
+    // only keep the compressed form when it saves at least an eighth. Throws
+    // std::runtime_error on I/O errors or when the compression isn't built in.
+    static void write( const std::string &archivePath,
+                       const std::vector<std::string> &files,
+                       AssetCompression compression );
+
+private:
+    struct Entry;
+
+    const Entry     *find( std::string_view name ) const;
+    std::string_view getName( const Entry &entry ) const;
+
+private:
+    MappedFile   m_File;
+    const Entry *m_Entries = nullptr;
+    size_t       m_EntryCount = 0;
+    const char  *m_Names = nullptr;
+    size_t       m_NamesSize = 0;
+};
@@ -0,0 +1,110 @@
+#include "AsyncCompute.h"
+#include "Profiler.h"
+
+#include <stdexcept>
+
+void AsyncCompute::create( VkDevice device, uint32_t queueFamilyIndex, VkQueue queue, uint32_t framesInFlight )
+{
+    m_Device = device;
+    m_Queue = queue;
+    m_QueueFamilyIndex = queueFamilyIndex;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    if ( vkCreateCommandPool( m_Device, &poolInfo, nullptr, &m_CommandPool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to create compute command pool!" );
+    }
+
+    m_CommandBuffers.resize( framesInFlight );
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_CommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = framesInFlight;
+    if ( vkAllocateCommandBuffers( m_Device, &allocInfo, m_CommandBuffers.data() ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to allocate compute command buffers!" );
+    }
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    m_FinishedSemaphores.resize( framesInFlight );
+    for ( auto &semaphore : m_FinishedSemaphores )
+    {
+        if ( vkCreateSemaphore( m_Device, &semaphoreInfo, nullptr, &semaphore ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create compute semaphore!" );
+        }
+    }
+}
+
+void AsyncCompute::cleanup()
+{
+    for ( auto semaphore : m_FinishedSemaphores )
+    {
+        vkDestroySemaphore( m_Device, semaphore, nullptr );
+    }
+    m_FinishedSemaphores.clear();
+    m_CommandBuffers.clear();
+    m_Passes.clear();
+
+    vkDestroyCommandPool( m_Device, m_CommandPool, nullptr );
+    m_CommandPool = VK_NULL_HANDLE;
+}
+
+void AsyncCompute::addPass( const char *name, RecordFunction record, VkPipelineStageFlags consumerStages )
+{
+    m_Passes.push_back( { name, std::move( record ) } );
+    m_WaitStages |= consumerStages;
+}
+
+VkSemaphore AsyncCompute::submit( uint32_t frameIndex )
+{
+    if ( m_Passes.empty() )
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    PROFILE_CPU_SCOPE( "computeSubmit" );
+
+    VkCommandBuffer commandBuffer = m_CommandBuffers[frameIndex];
+    vkResetCommandBuffer( commandBuffer, 0 );
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if ( vkBeginCommandBuffer( commandBuffer, &beginInfo ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to begin recording compute command buffer!" );
+    }
+
+    for ( const auto &pass : m_Passes )
+    {
+        PROFILE_CPU_SCOPE( pass.name );
+        pass.record( commandBuffer, frameIndex );
+    }
+
+    if ( vkEndCommandBuffer( commandBuffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to record compute command buffer!" );
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_FinishedSemaphores[frameIndex];
+
+    if ( vkQueueSubmit( m_Queue, 1, &submitInfo, VK_NULL_HANDLE ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to submit compute command buffer!" );
+    }
+
+    return m_FinishedSemaphores[frameIndex];
+}
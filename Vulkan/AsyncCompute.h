@@ -0,0 +1,56 @@
+#pragma once
+// Compute work submitted on its own queue ahead of the frame's graphics submit.
+//
+// Every frame in flight owns a command buffer and a semaphore. Registered passes are
+// recorded into the frame's command buffer, submitted on the compute queue, and the
+// graphics submit waits on the semaphore only at the stages that consume the results.
+// The graphics work of the previous frame keeps running meanwhile, so passes must
+// write per-frame resources (indexed by frameIndex) rather than anything still read
+// by a frame in flight.
+//
+// The graphics fence of a frame also covers its compute work, since the graphics
+// submit can't start before the compute semaphore was signalled.
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class AsyncCompute
+{
+public:
+    using RecordFunction = std::function<void( VkCommandBuffer commandBuffer, uint32_t frameIndex )>;
+
+    void create( VkDevice device, uint32_t queueFamilyIndex, VkQueue queue, uint32_t framesInFlight );
+    void cleanup();
+
+    // consumerStages are the graphics stages that read what the pass writes.
+    void addPass( const char *name, RecordFunction record, VkPipelineStageFlags consumerStages );
+
+    // Records and submits the frame's passes. Returns the semaphore the graphics submit
+    // has to wait on, or VK_NULL_HANDLE when there was nothing to do.
+    VkSemaphore submit( uint32_t frameIndex );
+    VkPipelineStageFlags getWaitStages() const { return m_WaitStages; }
+
+    uint32_t getQueueFamilyIndex() const { return m_QueueFamilyIndex; }
+
+private:
+    struct Pass
+    {
+        const char    *name;
+        RecordFunction record;
+    };
+
+private:
+    VkDevice      m_Device = VK_NULL_HANDLE;
+    VkQueue       m_Queue = VK_NULL_HANDLE;
+    uint32_t      m_QueueFamilyIndex = 0;
+    VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+
+    std::vector<VkCommandBuffer> m_CommandBuffers;
+    std::vector<VkSemaphore>     m_FinishedSemaphores;
+
+    std::vector<Pass>    m_Passes;
+    VkPipelineStageFlags m_WaitStages = 0;
+};
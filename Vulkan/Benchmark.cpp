@@ -0,0 +1,119 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+
+SampleSummary summarizeSamples( std::vector<double> samples )
+{
+    SampleSummary summary;
+    summary.count = samples.size();
+    if ( samples.empty() )
+    {
+        return summary;
+    }
+
+    std::sort( samples.begin(), samples.end() );
+
+    // Nearest-rank percentile.
+    auto percentile = [&samples]( double p ) {
+        size_t rank = static_cast<size_t>( std::ceil( p / 100.0 * samples.size() ) );
+        return samples[std::clamp<size_t>( rank, 1, samples.size() ) - 1];
+    };
+
+    summary.mean = std::accumulate( samples.begin(), samples.end(), 0.0 ) / samples.size();
+    summary.p50 = percentile( 50.0 );
+    summary.p95 = percentile( 95.0 );
+    summary.p99 = percentile( 99.0 );
+    summary.max = samples.back();
+    return summary;
+}
+
+FrameBenchmark::FrameBenchmark( uint32_t warmupFrames, uint32_t measuredFrames )
+    : m_WarmupFrames( warmupFrames ), m_MeasuredFrames( measuredFrames )
+{
+    m_CpuMs.reserve( measuredFrames );
+    m_GpuMs.reserve( measuredFrames );
+    m_PresentIntervalMs.reserve( measuredFrames );
+}
+
+void FrameBenchmark::addFrame( double cpuMs, double presentIntervalMs )
+{
+    if ( isMeasuring() && !isFinished() )
+    {
+        m_CpuMs.push_back( cpuMs );
+        if ( presentIntervalMs > 0.0 )
+        {
+            m_PresentIntervalMs.push_back( presentIntervalMs );
+        }
+    }
+    ++m_Frame;
+}
+
+void FrameBenchmark::addGpuFrame( double gpuMs )
+{
+    if ( isMeasuring() && !isFinished() )
+    {
+        m_GpuMs.push_back( gpuMs );
+    }
+}
+
+void FrameBenchmark::printReport( std::ostream &out, const std::string &deviceName ) const
+{
+    auto printRow = [&out]( const char *label, const SampleSummary &summary ) {
+        out << std::left << std::setw( 18 ) << label << std::right << std::fixed << std::setprecision( 3 )
+            << std::setw( 10 ) << summary.mean << std::setw( 10 ) << summary.p50 << std::setw( 10 ) << summary.p95
+            << std::setw( 10 ) << summary.p99 << std::setw( 10 ) << summary.max << std::setw( 8 ) << summary.count
+            << "\n";
+    };
+
+    out << "Benchmark on " << deviceName << " (" << m_WarmupFrames << " warm-up, " << m_MeasuredFrames
+        << " measured frames)\n";
+    out << std::left << std::setw( 18 ) << "[ms]" << std::right << std::setw( 10 ) << "mean" << std::setw( 10 )
+        << "p50" << std::setw( 10 ) << "p95" << std::setw( 10 ) << "p99" << std::setw( 10 ) << "max"
+        << std::setw( 8 ) << "n" << "\n";
+    printRow( "cpu frame", summarizeSamples( m_CpuMs ) );
+    printRow( "gpu frame", summarizeSamples( m_GpuMs ) );
+    printRow( "present interval", summarizeSamples( m_PresentIntervalMs ) );
+}
+
+bool FrameBenchmark::writeJson( const std::string &path, const std::string &deviceName, bool headless ) const
+{
+    std::ofstream out( path, std::ios::trunc );
+    if ( !out.is_open() )
+    {
+        return false;
+    }
+
+    auto writeSummary = [&out]( const char *name, const SampleSummary &summary ) {
+        out << "  \"" << name << "\": { \"count\": " << summary.count << ", \"mean\": " << summary.mean
+            << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+            << ", \"max\": " << summary.max << " }";
+    };
+
+    std::string device;
+    for ( char c : deviceName )
+    {
+        if ( c == '"' || c == '\\' )
+        {
+            device += '\\';
+        }
+        device += c;
+    }
+
+    out << std::fixed << std::setprecision( 4 );
+    out << "{\n";
+    out << "  \"device\": \"" << device << "\",\n";
+    out << "  \"headless\": " << ( headless ? "true" : "false" ) << ",\n";
+    out << "  \"warmupFrames\": " << m_WarmupFrames << ",\n";
+    out << "  \"measuredFrames\": " << m_MeasuredFrames << ",\n";
+    writeSummary( "cpuFrameMs", summarizeSamples( m_CpuMs ) );
+    out << ",\n";
+    writeSummary( "gpuFrameMs", summarizeSamples( m_GpuMs ) );
+    out << ",\n";
+    writeSummary( "presentIntervalMs", summarizeSamples( m_PresentIntervalMs ) );
+    out << "\n}\n";
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+// Frame time benchmark: skips a number of warm-up frames, then records a fixed number
+// of frames and reports mean and percentile statistics.
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct SampleSummary
+{
+    size_t count = 0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+SampleSummary summarizeSamples( std::vector<double> samples );
+
+class FrameBenchmark
+{
+public:
+    FrameBenchmark( uint32_t warmupFrames, uint32_t measuredFrames );
+
+    // Called once per submitted frame. GPU times arrive a few frames late, so they are
+    // passed separately whenever the profiler resolved a new frame.
+    void addFrame( double cpuMs, double presentIntervalMs );
+    void addGpuFrame( double gpuMs );
+
+    bool isMeasuring() const { return m_Frame >= m_WarmupFrames; }
+    bool isFinished() const { return m_Frame >= m_WarmupFrames + m_MeasuredFrames; }
+
+    void printReport( std::ostream &out, const std::string &deviceName ) const;
+    bool writeJson( const std::string &path, const std::string &deviceName, bool headless ) const;
+
+private:
+    uint32_t m_WarmupFrames;
+    uint32_t m_MeasuredFrames;
+    uint32_t m_Frame = 0;
+
+    std::vector<double> m_CpuMs;
+    std::vector<double> m_GpuMs;
+    std::vector<double> m_PresentIntervalMs;
+};
@@ -1,3 +1,16 @@
 C:/VulkanSDK/1.3.250.0/Bin/glslc.exe VertexShader.vert -o vert.spv
 C:/VulkanSDK/1.3.250.0/Bin/glslc.exe FragmentShader.frag -o frag.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe TexturedShader.vert -o textured_vert.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe TexturedShader.frag -o textured_frag.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe ParticleShader.vert -o particle_vert.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe ParticleShader.frag -o particle_frag.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe ParticleSimulate.comp -o particle_simulate.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe ParticleEmit.comp -o particle_emit.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe ParticleFinalize.comp -o particle_finalize.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe HiZDownsample.comp -o hiz_downsample.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe HiZCull.comp -o hiz_cull.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe SpriteShader.vert -o sprite_vert.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe SpriteShader.frag -o sprite_frag.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe PointShader.vert -o point_vert.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe OcclusionScene.vert -o occlusion_vert.spv
 pause
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "DebugMessageSink.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+namespace
+{
+const char *getSeverityName( VkDebugUtilsMessageSeverityFlagBitsEXT severity )
+{
+    switch ( severity )
+    {
+    case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT:
+        return "verbose";
+    case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:
+        return "info";
+    case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT:
+        return "warning";
+    default:
+        return "error";
+    }
+}
+
+void copyTruncated( char *destination, size_t capacity, const char *source )
+{
+    size_t length = source ? std::min( strlen( source ), capacity - 1 ) : 0;
+    memcpy( destination, source ? source : "", length );
+    destination[length] = '\0';
+}
+} // namespace
+
+DebugMessageSink::~DebugMessageSink()
+{
+    stop();
+}
+
+void DebugMessageSink::start( const std::string &path )
+{
+    stop();
+
+    if ( !path.empty() )
+    {
+        m_File.open( path, std::ios::trunc );
+        if ( !m_File )
+        {
+            throw std::runtime_error( "Failed to create " + path );
+        }
+    }
+    m_Out = path.empty() ? &std::cerr : &m_File;
+
+    m_Slots = std::make_unique<Slot[]>( kSlotCount );
+    for ( uint32_t i = 0; i < kSlotCount; ++i )
+    {
+        m_Slots[i].sequence.store( i, std::memory_order_relaxed );
+    }
+    m_EnqueuePosition.store( 0, std::memory_order_relaxed );
+    m_DequeuePosition = 0;
+    m_Dropped = 0;
+    m_ReportedDrops = 0;
+    m_Repeats.clear();
+
+    m_Running = true;
+    m_Thread = std::thread( [this]() { run(); } );
+}
+
+void DebugMessageSink::stop()
+{
+    if ( !m_Thread.joinable() )
+    {
+        return;
+    }
+
+    m_Running = false;
+    m_Wake.notify_one();
+    m_Thread.join();
+
+    if ( m_File.is_open() )
+    {
+        m_File.close();
+    }
+}
+
+void DebugMessageSink::setMinimumSeverity( VkDebugUtilsMessageSeverityFlagBitsEXT severity )
+{
+    m_MinimumSeverity.store( severity, std::memory_order_relaxed );
+}
+
+void DebugMessageSink::push( VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+                             VkDebugUtilsMessageTypeFlagsEXT type,
+                             const VkDebugUtilsMessengerCallbackDataEXT &data )
+{
+    // The severity bits are ordered, so the filter is a plain comparison.
+    if ( static_cast<uint32_t>( severity ) < m_MinimumSeverity.load( std::memory_order_relaxed ) ||
+         !m_Running.load( std::memory_order_relaxed ) )
+    {
+        return;
+    }
+
+    uint64_t position = m_EnqueuePosition.load( std::memory_order_relaxed );
+    Slot    *slot = nullptr;
+    for ( ;; )
+    {
+        slot = &m_Slots[position & ( kSlotCount - 1 )];
+        uint64_t sequence = slot->sequence.load( std::memory_order_acquire );
+        int64_t  difference = static_cast<int64_t>( sequence - position );
+        if ( difference == 0 )
+        {
+            if ( m_EnqueuePosition.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+            {
+                break;
+            }
+        }
+        else if ( difference < 0 )
+        {
+            // Full: the logger is a whole ring behind.
+            m_Dropped.fetch_add( 1, std::memory_order_relaxed );
+            return;
+        }
+        else
+        {
+            position = m_EnqueuePosition.load( std::memory_order_relaxed );
+        }
+    }
+
+    slot->severity = severity;
+    slot->type = type;
+    copyTruncated( slot->idName, kMaxIdNameLength, data.pMessageIdName );
+    copyTruncated( slot->message, kMaxMessageLength, data.pMessage );
+    slot->key = data.messageIdNumber != 0
+                    ? static_cast<uint32_t>( data.messageIdNumber )
+                    : std::hash<std::string_view>()( slot->message ) | ( 1ull << 63 );
+    slot->sequence.store( position + 1, std::memory_order_release );
+
+    // Errors should show up right away, and a burst shouldn't wait for the next poll
+    // to be drained.
+    if ( severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT || ( position & ( kSlotCount / 4 - 1 ) ) == 0 )
+    {
+        m_Wake.notify_one();
+    }
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL DebugMessageSink::callback( VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+                                                           VkDebugUtilsMessageTypeFlagsEXT type,
+                                                           const VkDebugUtilsMessengerCallbackDataEXT *data,
+                                                           void *userData )
+{
+    static_cast<DebugMessageSink *>( userData )->push( severity, type, *data );
+    return VK_FALSE;
+}
+
+void DebugMessageSink::run()
+{
+    auto lastSummary = std::chrono::steady_clock::now();
+    while ( m_Running )
+    {
+        {
+            std::unique_lock<std::mutex> lock( m_WakeMutex );
+            m_Wake.wait_for( lock, std::chrono::milliseconds( 20 ) );
+        }
+        drain();
+
+        auto now = std::chrono::steady_clock::now();
+        if ( now - lastSummary >= std::chrono::seconds( 1 ) )
+        {
+            writeRepeats( false );
+            lastSummary = now;
+        }
+    }
+
+    drain();
+    writeRepeats( true );
+}
+
+void DebugMessageSink::drain()
+{
+    bool wrote = false;
+    for ( ;; )
+    {
+        Slot &slot = m_Slots[m_DequeuePosition & ( kSlotCount - 1 )];
+        if ( slot.sequence.load( std::memory_order_acquire ) != m_DequeuePosition + 1 )
+        {
+            break;
+        }
+
+        Repeats &repeats = m_Repeats[slot.key];
+        if ( repeats.total++ == 0 )
+        {
+            repeats.idName = slot.idName;
+            write( slot );
+            wrote = true;
+        }
+        else
+        {
+            ++repeats.pending;
+        }
+
+        slot.sequence.store( m_DequeuePosition + kSlotCount, std::memory_order_release );
+        ++m_DequeuePosition;
+    }
+
+    // One flush per batch instead of one per line.
+    if ( wrote )
+    {
+        m_Out->flush();
+    }
+}
+
+void DebugMessageSink::write( const Slot &slot )
+{
+    *m_Out << "validation layer [" << getSeverityName( slot.severity ) << "]";
+    if ( slot.type & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT )
+    {
+        *m_Out << "[performance]";
+    }
+    if ( slot.idName[0] != '\0' )
+    {
+        *m_Out << "[" << slot.idName << "]";
+    }
+    *m_Out << ": " << slot.message << '\n';
+}
+
+void DebugMessageSink::writeRepeats( bool final )
+{
+    bool wrote = false;
+    for ( auto &[key, repeats] : m_Repeats )
+    {
+        if ( final ? repeats.total > 1 : repeats.pending > 0 )
+        {
+            *m_Out << "validation layer: " << ( repeats.idName.empty() ? "message" : repeats.idName ) << " repeated "
+                   << ( final ? repeats.total - 1 : repeats.pending ) << ( final ? " times in total" : " more times" )
+                   << '\n';
+            repeats.pending = 0;
+            wrote = true;
+        }
+    }
+
+    uint64_t dropped = m_Dropped.load( std::memory_order_relaxed );
+    if ( dropped != m_ReportedDrops )
+    {
+        *m_Out << "validation layer: " << dropped - m_ReportedDrops << " messages dropped, queue full" << '\n';
+        m_ReportedDrops = dropped;
+        wrote = true;
+    }
+
+    if ( wrote )
+    {
+        m_Out->flush();
+    }
+}
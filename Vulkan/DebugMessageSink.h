@@ -0,0 +1,99 @@
+#pragma once
+// Asynchronous sink for VK_EXT_debug_utils messages.
+//
+// The messenger callback runs on whatever thread made the Vulkan call, often in the
+// middle of recording a frame. push() only checks the severity filter and copies the
+// message into a slot of a fixed ring - a bounded multi-producer queue synchronized by
+// per-slot sequence numbers, so no producer ever waits on another or on the writer.
+// A logger thread drains the ring, writes each message ID in full the first time it
+// is seen (messages without an ID are told apart by their text) and only counts the
+// repeats, which it summarizes once a second and on shutdown. Messages arriving while
+// the ring is full are dropped and counted.
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+class DebugMessageSink
+{
+public:
+    DebugMessageSink() = default;
+    ~DebugMessageSink();
+    DebugMessageSink( const DebugMessageSink & ) = delete;
+    DebugMessageSink &operator=( const DebugMessageSink & ) = delete;
+
+    // Writes to path, or to std::cerr when it is empty. Throws std::runtime_error when
+    // the file can't be created.
+    void start( const std::string &path );
+    // Drains what is left, writes the repeat counts and joins the logger thread.
+    void stop();
+
+    // Messages below this severity are discarded in push(). Can be changed at any time.
+    void setMinimumSeverity( VkDebugUtilsMessageSeverityFlagBitsEXT severity );
+
+    void push( VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+               VkDebugUtilsMessageTypeFlagsEXT type,
+               const VkDebugUtilsMessengerCallbackDataEXT &data );
+
+    // Passes every message to the sink given as pUserData.
+    static VKAPI_ATTR VkBool32 VKAPI_CALL callback( VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+                                                    VkDebugUtilsMessageTypeFlagsEXT type,
+                                                    const VkDebugUtilsMessengerCallbackDataEXT *data,
+                                                    void *userData );
+
+private:
+    static constexpr uint32_t kSlotCount = 1024; // power of two
+    static constexpr size_t   kMaxMessageLength = 1024;
+    static constexpr size_t   kMaxIdNameLength = 64;
+
+    struct Slot
+    {
+        std::atomic<uint64_t>                  sequence;
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+        VkDebugUtilsMessageTypeFlagsEXT        type;
+        uint64_t                               key;
+        char                                   idName[kMaxIdNameLength];
+        char                                   message[kMaxMessageLength];
+    };
+
+    struct Repeats
+    {
+        std::string idName;
+        uint64_t    total = 0;
+        // Repeats since the last summary.
+        uint64_t    pending = 0;
+    };
+
+private:
+    void run();
+    void drain();
+    void write( const Slot &slot );
+    void writeRepeats( bool final );
+
+private:
+    std::unique_ptr<Slot[]> m_Slots;
+    alignas( 64 ) std::atomic<uint64_t> m_EnqueuePosition{ 0 };
+    alignas( 64 ) uint64_t              m_DequeuePosition = 0;
+    std::atomic<uint32_t>               m_MinimumSeverity{ VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT };
+    std::atomic<uint64_t>               m_Dropped{ 0 };
+
+    // Only wakes the logger early; producers never take it.
+    std::mutex              m_WakeMutex;
+    std::condition_variable m_Wake;
+    std::atomic<bool>       m_Running{ false };
+    std::thread             m_Thread;
+
+    // Logger thread only.
+    std::ofstream                         m_File;
+    std::ostream                         *m_Out = nullptr;
+    std::unordered_map<uint64_t, Repeats> m_Repeats;
+    uint64_t                              m_ReportedDrops = 0;
+};
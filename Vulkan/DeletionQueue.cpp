@@ -0,0 +1,39 @@
+#include "DeletionQueue.h"
+
+void DeletionQueue::create( VkDevice device )
+{
+    m_Device = device;
+    m_FrameNumber = 0;
+    m_Destroyed = 0;
+}
+
+void DeletionQueue::cleanup()
+{
+    if ( m_Device == VK_NULL_HANDLE )
+    {
+        return;
+    }
+    flush();
+    m_Device = VK_NULL_HANDLE;
+}
+
+void DeletionQueue::collect( uint64_t completedFrame )
+{
+    while ( !m_Entries.empty() && m_Entries.front().frameNumber <= completedFrame )
+    {
+        const Entry &entry = m_Entries.front();
+        entry.destroy( m_Device, entry.handle );
+        m_Entries.pop_front();
+        ++m_Destroyed;
+    }
+}
+
+void DeletionQueue::flush()
+{
+    for ( const Entry &entry : m_Entries )
+    {
+        entry.destroy( m_Device, entry.handle );
+    }
+    m_Destroyed += m_Entries.size();
+    m_Entries.clear();
+}
@@ -0,0 +1,161 @@
+#pragma once
+// Deferred destruction of Vulkan objects.
+//
+// A resource that is replaced while frames are in flight can't be destroyed on the
+// spot: command buffers still executing may reference it. Instead it is released to a
+// DeletionQueue, which tags it with the frame being recorded and destroys it once that
+// frame's fence has been waited on - no vkDeviceWaitIdle, no stall. The queue only
+// needs to know which frame numbers have completed, so the same works with the value
+// of a timeline semaphore in place of the frame number.
+//
+// UniqueHandle owns one handle and is move-only. When it goes away or is assigned over
+// it hands its handle to the queue it was created with, or destroys it right away
+// without one.
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <utility>
+
+class DeletionQueue
+{
+public:
+    template <typename Handle>
+    using DestroyFunction = void( VKAPI_PTR * )( VkDevice, Handle, const VkAllocationCallbacks * );
+
+    void create( VkDevice device );
+    // Destroys everything still queued; the device must be idle.
+    void cleanup();
+
+    bool isEnabled() const { return m_Device != VK_NULL_HANDLE; }
+    VkDevice getDevice() const { return m_Device; }
+
+    // Handles released from here on belong to frameNumber, which must not decrease.
+    void beginFrame( uint64_t frameNumber ) { m_FrameNumber = frameNumber; }
+    // Destroys what was released up to and including completedFrame.
+    void collect( uint64_t completedFrame );
+    // Destroys everything queued; the device must be idle.
+    void flush();
+
+    template <typename Handle, DestroyFunction<Handle> Destroy>
+    void release( Handle handle )
+    {
+        static_assert( sizeof( Handle ) <= sizeof( uint64_t ) );
+        if ( handle == VK_NULL_HANDLE )
+        {
+            return;
+        }
+        Entry entry{ m_FrameNumber, &destroyEntry<Handle, Destroy>, 0 };
+        std::memcpy( &entry.handle, &handle, sizeof( handle ) );
+        m_Entries.push_back( entry );
+    }
+
+    size_t   getPendingCount() const { return m_Entries.size(); }
+    uint64_t getDestroyedCount() const { return m_Destroyed; }
+
+private:
+    // Non-dispatchable handles are pointers on 64-bit builds and uint64_t on 32-bit
+    // ones; either way they fit the entry's 64 bits.
+    struct Entry
+    {
+        uint64_t frameNumber;
+        void ( *destroy )( VkDevice device, uint64_t handle );
+        uint64_t handle;
+    };
+
+    template <typename Handle, DestroyFunction<Handle> Destroy>
+    static void destroyEntry( VkDevice device, uint64_t stored )
+    {
+        Handle handle;
+        std::memcpy( &handle, &stored, sizeof( handle ) );
+        Destroy( device, handle, nullptr );
+    }
+
+private:
+    VkDevice          m_Device = VK_NULL_HANDLE;
+    uint64_t          m_FrameNumber = 0;
+    // In release order, which is also frame order.
+    std::deque<Entry> m_Entries;
+    uint64_t          m_Destroyed = 0;
+};
+
+template <typename Handle, DeletionQueue::DestroyFunction<Handle> Destroy>
+class UniqueHandle
+{
+public:
+    UniqueHandle() = default;
+    UniqueHandle( VkDevice device, Handle handle, DeletionQueue *queue = nullptr )
+        : m_Device( device ), m_Handle( handle ), m_Queue( queue )
+    {
+    }
+    ~UniqueHandle() { reset(); }
+
+    UniqueHandle( const UniqueHandle & ) = delete;
+    UniqueHandle &operator=( const UniqueHandle & ) = delete;
+
+    UniqueHandle( UniqueHandle &&other ) noexcept
+        : m_Device( other.m_Device ), m_Handle( std::exchange( other.m_Handle, Handle( VK_NULL_HANDLE ) ) ),
+          m_Queue( other.m_Queue )
+    {
+    }
+
+    UniqueHandle &operator=( UniqueHandle &&other ) noexcept
+    {
+        if ( this != &other )
+        {
+            reset();
+            m_Device = other.m_Device;
+            m_Handle = std::exchange( other.m_Handle, Handle( VK_NULL_HANDLE ) );
+            m_Queue = other.m_Queue;
+        }
+        return *this;
+    }
+
+    Handle get() const { return m_Handle; }
+    explicit operator bool() const { return m_Handle != VK_NULL_HANDLE; }
+
+    void reset()
+    {
+        if ( m_Handle == VK_NULL_HANDLE )
+        {
+            return;
+        }
+        if ( m_Queue != nullptr )
+        {
+            m_Queue->release<Handle, Destroy>( m_Handle );
+        }
+        else
+        {
+            Destroy( m_Device, m_Handle, nullptr );
+        }
+        m_Handle = VK_NULL_HANDLE;
+    }
+
+    // Gives up ownership without destroying anything.
+    Handle detach() { return std::exchange( m_Handle, Handle( VK_NULL_HANDLE ) ); }
+
+private:
+    VkDevice       m_Device = VK_NULL_HANDLE;
+    Handle         m_Handle = VK_NULL_HANDLE;
+    DeletionQueue *m_Queue = nullptr;
+};
+
+using UniqueBuffer              = UniqueHandle<VkBuffer, vkDestroyBuffer>;
+using UniqueDeviceMemory        = UniqueHandle<VkDeviceMemory, vkFreeMemory>;
+using UniqueImage               = UniqueHandle<VkImage, vkDestroyImage>;
+using UniqueImageView           = UniqueHandle<VkImageView, vkDestroyImageView>;
+using UniqueSampler             = UniqueHandle<VkSampler, vkDestroySampler>;
+using UniqueFramebuffer         = UniqueHandle<VkFramebuffer, vkDestroyFramebuffer>;
+using UniqueRenderPass          = UniqueHandle<VkRenderPass, vkDestroyRenderPass>;
+using UniquePipeline            = UniqueHandle<VkPipeline, vkDestroyPipeline>;
+using UniquePipelineLayout      = UniqueHandle<VkPipelineLayout, vkDestroyPipelineLayout>;
+using UniquePipelineCache       = UniqueHandle<VkPipelineCache, vkDestroyPipelineCache>;
+using UniqueShaderModule        = UniqueHandle<VkShaderModule, vkDestroyShaderModule>;
+using UniqueDescriptorSetLayout = UniqueHandle<VkDescriptorSetLayout, vkDestroyDescriptorSetLayout>;
+using UniqueDescriptorPool      = UniqueHandle<VkDescriptorPool, vkDestroyDescriptorPool>;
+using UniqueQueryPool           = UniqueHandle<VkQueryPool, vkDestroyQueryPool>;
+using UniqueCommandPool         = UniqueHandle<VkCommandPool, vkDestroyCommandPool>;
+using UniqueSemaphore           = UniqueHandle<VkSemaphore, vkDestroySemaphore>;
+using UniqueFence               = UniqueHandle<VkFence, vkDestroyFence>;
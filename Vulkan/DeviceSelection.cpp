@@ -0,0 +1,189 @@
+#include "DeviceSelection.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+const char *getTypeName( VkPhysicalDeviceType type )
+{
+    switch ( type )
+    {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        return "discrete";
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        return "integrated";
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        return "virtual";
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        return "cpu";
+    default:
+        return "other";
+    }
+}
+
+int64_t getTypeRank( VkPhysicalDeviceType type )
+{
+    switch ( type )
+    {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        return 4;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        return 3;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        return 2;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+std::string formatUuid( const std::array<uint8_t, VK_UUID_SIZE> &uuid )
+{
+    std::string text;
+    for ( size_t i = 0; i < uuid.size(); ++i )
+    {
+        char hex[3];
+        snprintf( hex, sizeof( hex ), "%02x", uuid[i] );
+        text += hex;
+        if ( i == 3 || i == 5 || i == 7 || i == 9 )
+        {
+            text += '-';
+        }
+    }
+    return text;
+}
+
+std::string toLower( std::string text )
+{
+    std::transform( text.begin(), text.end(), text.begin(), []( unsigned char c ) {
+        return static_cast<char>( std::tolower( c ) );
+    } );
+    return text;
+}
+} // namespace
+
+PhysicalDeviceInfo describePhysicalDevice( VkPhysicalDevice device, uint32_t index, uint32_t instanceVersion )
+{
+    PhysicalDeviceInfo info;
+    info.device = device;
+    info.index = index;
+    vkGetPhysicalDeviceProperties( device, &info.properties );
+    vkGetPhysicalDeviceFeatures( device, &info.features );
+
+    if ( instanceVersion >= VK_API_VERSION_1_1 && info.properties.apiVersion >= VK_API_VERSION_1_1 )
+    {
+        VkPhysicalDeviceIDProperties idProperties{};
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &idProperties;
+        vkGetPhysicalDeviceProperties2( device, &properties2 );
+
+        info.hasUuid = true;
+        std::copy( std::begin( idProperties.deviceUUID ), std::end( idProperties.deviceUUID ), info.uuid.begin() );
+    }
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties( device, &memoryProperties );
+    for ( uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i )
+    {
+        if ( memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT )
+        {
+            info.deviceLocalBytes += memoryProperties.memoryHeaps[i].size;
+        }
+    }
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties( device, &queueFamilyCount, nullptr );
+    std::vector<VkQueueFamilyProperties> queueFamilies( queueFamilyCount );
+    vkGetPhysicalDeviceQueueFamilyProperties( device, &queueFamilyCount, queueFamilies.data() );
+    for ( const auto &queueFamily : queueFamilies )
+    {
+        VkQueueFlags flags = queueFamily.queueFlags;
+        if ( ( flags & VK_QUEUE_COMPUTE_BIT ) && !( flags & VK_QUEUE_GRAPHICS_BIT ) )
+        {
+            info.hasComputeOnlyQueue = true;
+        }
+        if ( ( flags & VK_QUEUE_TRANSFER_BIT ) && !( flags & ( VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT ) ) )
+        {
+            info.hasTransferOnlyQueue = true;
+        }
+    }
+
+    return info;
+}
+
+int64_t scorePhysicalDevice( const PhysicalDeviceInfo &info )
+{
+    // The type outweighs everything else; a small discrete GPU still beats an
+    // integrated one that shares a large heap with the CPU.
+    int64_t score = getTypeRank( info.properties.deviceType ) * 1'000'000;
+
+    // Capped at 64 GiB so memory never reaches into the type rank.
+    score += static_cast<int64_t>( std::min<VkDeviceSize>( info.deviceLocalBytes >> 20, 64 * 1024 ) );
+
+    // Features the renderer uses when present.
+    const VkBool32 features[] = {
+        info.features.samplerAnisotropy,
+        info.features.textureCompressionBC,
+        info.features.textureCompressionASTC_LDR,
+        info.features.textureCompressionETC2,
+        info.features.pipelineStatisticsQuery,
+        info.features.occlusionQueryPrecise,
+    };
+    for ( VkBool32 feature : features )
+    {
+        score += feature ? 1000 : 0;
+    }
+
+    // Async compute and copy queues let particle simulation and uploads overlap rendering.
+    score += info.hasComputeOnlyQueue ? 20'000 : 0;
+    score += info.hasTransferOnlyQueue ? 10'000 : 0;
+    return score;
+}
+
+bool matchesDeviceSelector( const PhysicalDeviceInfo &info, const std::string &selector )
+{
+    if ( selector.empty() )
+    {
+        return false;
+    }
+
+    std::string hex = toLower( selector );
+    hex.erase( std::remove( hex.begin(), hex.end(), '-' ), hex.end() );
+    if ( hex.size() == VK_UUID_SIZE * 2 && std::all_of( hex.begin(), hex.end(), []( unsigned char c ) {
+             return std::isxdigit( c );
+         } ) )
+    {
+        std::string uuid = formatUuid( info.uuid );
+        uuid.erase( std::remove( uuid.begin(), uuid.end(), '-' ), uuid.end() );
+        return info.hasUuid && uuid == hex;
+    }
+
+    if ( selector.size() < 10 &&
+         std::all_of( selector.begin(), selector.end(), []( unsigned char c ) { return std::isdigit( c ); } ) )
+    {
+        return std::stoul( selector ) == info.index;
+    }
+
+    return toLower( info.properties.deviceName ).find( toLower( selector ) ) != std::string::npos;
+}
+
+std::string describeForLog( const PhysicalDeviceInfo &info )
+{
+    std::ostringstream out;
+    out << "GPU " << info.index << ": " << info.properties.deviceName << " ("
+        << getTypeName( info.properties.deviceType ) << ", " << ( info.deviceLocalBytes >> 20 )
+        << " MB device-local";
+    if ( info.hasUuid )
+    {
+        out << ", " << formatUuid( info.uuid );
+    }
+    out << ")";
+    return out.str();
+}
@@ -0,0 +1,39 @@
+#pragma once
+// Physical device ranking.
+//
+// Devices are ordered by type first (discrete > integrated > virtual > CPU), then by
+// device-local memory, optional features and queue topology. The ranking can be
+// bypassed with a selector naming one device by index, UUID or part of its name.
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+struct PhysicalDeviceInfo
+{
+    VkPhysicalDevice                  device = VK_NULL_HANDLE;
+    uint32_t                          index = 0;
+    VkPhysicalDeviceProperties        properties{};
+    VkPhysicalDeviceFeatures          features{};
+    // Only known when the device supports Vulkan 1.1.
+    bool                              hasUuid = false;
+    std::array<uint8_t, VK_UUID_SIZE> uuid{};
+    VkDeviceSize                      deviceLocalBytes = 0;
+    bool                              hasComputeOnlyQueue = false;
+    bool                              hasTransferOnlyQueue = false;
+};
+
+// instanceVersion is the apiVersion the instance was created with.
+PhysicalDeviceInfo describePhysicalDevice( VkPhysicalDevice device, uint32_t index, uint32_t instanceVersion );
+
+// Higher is better; only meaningful for comparing devices with each other.
+int64_t scorePhysicalDevice( const PhysicalDeviceInfo &info );
+
+// selector is a device index ("1"), a UUID with or without dashes, or a case-insensitive
+// part of the device name.
+bool matchesDeviceSelector( const PhysicalDeviceInfo &info, const std::string &selector );
+
+// One line: index, name, type, device-local memory and UUID.
+std::string describeForLog( const PhysicalDeviceInfo &info );
@@ -0,0 +1,249 @@
+#include "DrawList.h"
+
+#include <algorithm>
+#include <array>
+#include <barrier>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace
+{
+constexpr uint32_t kRadixBits = 8;
+constexpr uint32_t kBuckets = 1u << kRadixBits;
+constexpr uint32_t kPasses = 64 / kRadixBits;
+// Below this, starting threads costs more than the sort.
+constexpr size_t kParallelThreshold = 16 * 1024;
+
+uint32_t digitOf( uint64_t key, uint32_t pass )
+{
+    return static_cast<uint32_t>( key >> ( pass * kRadixBits ) ) & ( kBuckets - 1 );
+}
+} // namespace
+
+void radixSort( std::vector<DrawSortItem> &items, std::vector<DrawSortItem> &scratch, uint32_t threadCount )
+{
+    const size_t count = items.size();
+    if ( count < 2 )
+    {
+        return;
+    }
+    scratch.resize( count );
+
+    const uint32_t threads = count < kParallelThreshold ? 1 : std::max( threadCount, 1u );
+    // Per thread: the digit counts of its chunk, turned into its scatter offsets.
+    std::vector<std::array<size_t, kBuckets>> offsets( threads );
+    DrawSortItem *src = items.data();
+    DrawSortItem *dst = scratch.data();
+    bool          skipPass = false;
+    bool          counted = false;
+
+    // Runs on one thread between the counting and the scattering of a pass, and again
+    // after the scattering.
+    auto onPhaseDone = [&]() noexcept {
+        if ( counted )
+        {
+            if ( !skipPass )
+            {
+                std::swap( src, dst );
+            }
+            counted = false;
+            return;
+        }
+
+        // Offsets run over digits first, then threads, so each thread's items land
+        // behind the same digit's items from earlier chunks and the sort stays stable.
+        size_t offset = 0;
+        skipPass = false;
+        for ( uint32_t digit = 0; digit < kBuckets; ++digit )
+        {
+            size_t total = 0;
+            for ( uint32_t thread = 0; thread < threads; ++thread )
+            {
+                size_t digitCount = offsets[thread][digit];
+                offsets[thread][digit] = offset;
+                offset += digitCount;
+                total += digitCount;
+            }
+            // All keys share this digit; the pass wouldn't move anything.
+            skipPass = skipPass || total == count;
+        }
+        counted = true;
+    };
+    std::barrier sync( threads, onPhaseDone );
+
+    auto work = [&]( uint32_t thread ) {
+        const size_t begin = count * thread / threads;
+        const size_t end = count * ( thread + 1 ) / threads;
+        for ( uint32_t pass = 0; pass < kPasses; ++pass )
+        {
+            std::array<size_t, kBuckets> &threadOffsets = offsets[thread];
+            threadOffsets.fill( 0 );
+            for ( size_t i = begin; i < end; ++i )
+            {
+                ++threadOffsets[digitOf( src[i].key, pass )];
+            }
+            sync.arrive_and_wait();
+
+            if ( !skipPass )
+            {
+                for ( size_t i = begin; i < end; ++i )
+                {
+                    dst[threadOffsets[digitOf( src[i].key, pass )]++] = src[i];
+                }
+            }
+            sync.arrive_and_wait();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for ( uint32_t thread = 1; thread < threads; ++thread )
+    {
+        workers.emplace_back( work, thread );
+    }
+    work( 0 );
+    for ( std::thread &worker : workers )
+    {
+        worker.join();
+    }
+
+    if ( src != items.data() )
+    {
+        items.swap( scratch );
+    }
+}
+
+uint64_t DrawList::makeKey( uint32_t pipeline, uint32_t material, uint32_t mesh, float depth )
+{
+    constexpr float kDepthScale = static_cast<float>( ( 1u << kDepthBits ) - 1 );
+    // Also catches NaN.
+    float clamped = depth > 0.0f ? std::min( depth, 1.0f ) : 0.0f;
+
+    return ( static_cast<uint64_t>( pipeline ) << ( kMaterialBits + kMeshBits + kDepthBits ) ) |
+           ( static_cast<uint64_t>( material ) << ( kMeshBits + kDepthBits ) ) |
+           ( static_cast<uint64_t>( mesh ) << kDepthBits ) | static_cast<uint64_t>( clamped * kDepthScale );
+}
+
+void DrawList::clear()
+{
+    m_Calls.clear();
+    m_Items.clear();
+}
+
+void DrawList::add( const DrawCall &call, float depth )
+{
+    uint64_t key = makeKey( idOf( m_PipelineIds, call.pipeline, kPipelineBits, "pipelines" ),
+                            idOf( m_MaterialIds, call.descriptorSet, kMaterialBits, "materials" ),
+                            idOf( m_MeshIds, call.vertexBuffer, kMeshBits, "meshes" ),
+                            depth );
+    m_Items.push_back( { key, static_cast<uint32_t>( m_Calls.size() ) } );
+    m_Calls.push_back( call );
+}
+
+void DrawList::sort( uint32_t threadCount )
+{
+    radixSort( m_Items, m_Scratch, threadCount );
+}
+
+template <typename Handle>
+uint32_t DrawList::idOf( std::unordered_map<Handle, uint32_t> &ids, Handle handle, uint32_t bits, const char *what )
+{
+    auto [it, inserted] = ids.try_emplace( handle, static_cast<uint32_t>( ids.size() ) );
+    if ( inserted && it->second >= ( 1u << bits ) )
+    {
+        ids.erase( it );
+        throw std::runtime_error( std::string( "Draw list ran out of ids for " ) + what + "." );
+    }
+    return it->second;
+}
+
+void DrawRecorder::begin( VkCommandBuffer commandBuffer )
+{
+    m_CommandBuffer = commandBuffer;
+    m_Stats = {};
+    invalidate();
+}
+
+void DrawRecorder::invalidate()
+{
+    m_Pipeline = VK_NULL_HANDLE;
+    m_Layout = VK_NULL_HANDLE;
+    m_DescriptorSet = VK_NULL_HANDLE;
+    m_VertexBuffer = VK_NULL_HANDLE;
+    m_IndexBuffer = VK_NULL_HANDLE;
+    m_IndexType = VK_INDEX_TYPE_MAX_ENUM;
+}
+
+void DrawRecorder::record( const DrawCall &call )
+{
+    if ( call.pipeline != m_Pipeline )
+    {
+        vkCmdBindPipeline( m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, call.pipeline );
+        m_Pipeline = call.pipeline;
+        ++m_Stats.binds;
+    }
+    else
+    {
+        ++m_Stats.redundantBinds;
+    }
+
+    if ( call.descriptorSet != VK_NULL_HANDLE )
+    {
+        // A set only survives a layout change if the layouts are compatible, which
+        // isn't checked here.
+        if ( call.descriptorSet != m_DescriptorSet || call.layout != m_Layout )
+        {
+            vkCmdBindDescriptorSets( m_CommandBuffer,
+                                     VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                     call.layout,
+                                     0, 1, &call.descriptorSet, 0, nullptr );
+            m_DescriptorSet = call.descriptorSet;
+            m_Layout = call.layout;
+            ++m_Stats.binds;
+        }
+        else
+        {
+            ++m_Stats.redundantBinds;
+        }
+    }
+
+    if ( call.vertexBuffer != m_VertexBuffer )
+    {
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers( m_CommandBuffer, 0, 1, &call.vertexBuffer, &offset );
+        m_VertexBuffer = call.vertexBuffer;
+        ++m_Stats.binds;
+    }
+    else
+    {
+        ++m_Stats.redundantBinds;
+    }
+
+    if ( call.indexBuffer != m_IndexBuffer || call.indexType != m_IndexType )
+    {
+        vkCmdBindIndexBuffer( m_CommandBuffer, call.indexBuffer, 0, call.indexType );
+        m_IndexBuffer = call.indexBuffer;
+        m_IndexType = call.indexType;
+        ++m_Stats.binds;
+    }
+    else
+    {
+        ++m_Stats.redundantBinds;
+    }
+
+    vkCmdDrawIndexed( m_CommandBuffer,
+                      call.indexCount,
+                      call.instanceCount,
+                      call.firstIndex,
+                      call.vertexOffset,
+                      call.firstInstance );
+    ++m_Stats.draws;
+}
+
+void DrawRecorder::record( const DrawList &list )
+{
+    for ( size_t i = 0; i < list.size(); ++i )
+    {
+        record( list[i] );
+    }
+}
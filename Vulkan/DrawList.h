@@ -0,0 +1,114 @@
+#pragma once
+// Sorted draw submission.
+//
+// Draws are collected for a frame with the state they need, each under a 64-bit key
+// ordering them by what is most expensive to change:
+//
+//   63 .. 54  pipeline  (10 bits)
+//   53 .. 40  material  (14 bits, the descriptor set)
+//   39 .. 24  mesh      (16 bits, the vertex and index buffers)
+//   23 ..  0  depth     (24 bits, front to back)
+//
+// Pipelines, sets and buffers get small ids in the order they are first seen, which
+// stay the same from frame to frame. After an LSD radix sort draws sharing state sit
+// next to each other, and DrawRecorder only binds what differs from the draw before.
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct DrawCall
+{
+    VkPipeline       pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    // Bound at set 0; VK_NULL_HANDLE binds nothing.
+    VkDescriptorSet  descriptorSet = VK_NULL_HANDLE;
+    VkBuffer         vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer         indexBuffer = VK_NULL_HANDLE;
+    VkIndexType      indexType = VK_INDEX_TYPE_UINT16;
+    uint32_t         indexCount = 0;
+    uint32_t         instanceCount = 1;
+    uint32_t         firstIndex = 0;
+    int32_t          vertexOffset = 0;
+    uint32_t         firstInstance = 0;
+};
+
+struct DrawSortItem
+{
+    uint64_t key;
+    uint32_t index;
+};
+
+// Sorts by key, stable. Uses up to threadCount threads for large inputs; scratch is
+// resized as needed and can be kept around between calls.
+void radixSort( std::vector<DrawSortItem> &items, std::vector<DrawSortItem> &scratch, uint32_t threadCount );
+
+class DrawList
+{
+public:
+    static constexpr uint32_t kPipelineBits = 10;
+    static constexpr uint32_t kMaterialBits = 14;
+    static constexpr uint32_t kMeshBits = 16;
+    static constexpr uint32_t kDepthBits = 24;
+
+    static uint64_t makeKey( uint32_t pipeline, uint32_t material, uint32_t mesh, float depth );
+
+    // Forgets the draws, keeps the ids.
+    void clear();
+
+    // depth is the distance to the camera mapped to [0, 1]; values outside are clamped.
+    // Throws std::runtime_error when an id range is exhausted.
+    void add( const DrawCall &call, float depth );
+
+    void sort( uint32_t threadCount = 1 );
+
+    size_t          size() const { return m_Items.size(); }
+    const DrawCall &operator[]( size_t i ) const { return m_Calls[m_Items[i].index]; }
+
+private:
+    template <typename Handle>
+    static uint32_t idOf( std::unordered_map<Handle, uint32_t> &ids, Handle handle, uint32_t bits, const char *what );
+
+private:
+    std::vector<DrawCall>     m_Calls;
+    std::vector<DrawSortItem> m_Items;
+    std::vector<DrawSortItem> m_Scratch;
+
+    std::unordered_map<VkPipeline, uint32_t>      m_PipelineIds;
+    std::unordered_map<VkDescriptorSet, uint32_t> m_MaterialIds;
+    // Keyed by the vertex buffer; meshes sharing one differ in their index ranges.
+    std::unordered_map<VkBuffer, uint32_t>        m_MeshIds;
+};
+
+// Records draws, skipping every bind that would set what is already bound.
+class DrawRecorder
+{
+public:
+    struct Stats
+    {
+        uint32_t draws = 0;
+        uint32_t binds = 0;
+        // Binds skipped because the state was already set.
+        uint32_t redundantBinds = 0;
+    };
+
+    void begin( VkCommandBuffer commandBuffer );
+    void record( const DrawCall &call );
+    void record( const DrawList &list );
+    // Anything recorded outside the recorder may have changed the bound state.
+    void invalidate();
+
+    const Stats &getStats() const { return m_Stats; }
+
+private:
+    VkCommandBuffer  m_CommandBuffer = VK_NULL_HANDLE;
+    VkPipeline       m_Pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout m_Layout = VK_NULL_HANDLE;
+    VkDescriptorSet  m_DescriptorSet = VK_NULL_HANDLE;
+    VkBuffer         m_VertexBuffer = VK_NULL_HANDLE;
+    VkBuffer         m_IndexBuffer = VK_NULL_HANDLE;
+    VkIndexType      m_IndexType = VK_INDEX_TYPE_MAX_ENUM;
+    Stats            m_Stats;
+};
@@ -0,0 +1,355 @@
+#include "DynamicMesh.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+void recordMemoryBarrier( VkCommandBuffer commandBuffer,
+                          VkPipelineStageFlags srcStage,
+                          VkAccessFlags srcAccess,
+                          VkPipelineStageFlags dstStage,
+                          VkAccessFlags dstAccess )
+{
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier( commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr );
+}
+} // namespace
+
+void DynamicMesh::create( const DynamicMeshCreateInfo &createInfo )
+{
+    if ( createInfo.deletionQueue == nullptr || createInfo.vertexStride == 0 || createInfo.framesInFlight == 0 )
+    {
+        throw std::runtime_error( "dynamic mesh needs a deletion queue, a vertex stride and frames in flight!" );
+    }
+
+    m_PhysicalDevice = createInfo.physicalDevice;
+    m_Device = createInfo.device;
+    m_DeletionQueue = createInfo.deletionQueue;
+    m_IndexType = createInfo.indexType;
+
+    m_Vertices.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    m_Vertices.stride = createInfo.vertexStride;
+    m_Indices.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    m_Indices.stride = m_IndexType == VK_INDEX_TYPE_UINT32 ? 4 : 2;
+    createStream( m_Vertices, static_cast<VkDeviceSize>( std::max( createInfo.vertexCapacity, 1u ) ) * m_Vertices.stride );
+    createStream( m_Indices, static_cast<VkDeviceSize>( std::max( createInfo.indexCapacity, 1u ) ) * m_Indices.stride );
+
+    m_Staging.resize( createInfo.framesInFlight );
+    for ( Staging &staging : m_Staging )
+    {
+        createStaging( staging, std::max<VkDeviceSize>( createInfo.stagingBytes, 1 ) );
+    }
+    m_Frame = 0;
+    m_StagingUsed = 0;
+    m_StagingRecorded = 0;
+    m_Version = 0;
+}
+
+void DynamicMesh::cleanup()
+{
+    if ( m_Device == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    // Released like any replaced buffer; the caller flushes the queue.
+    m_Vertices = {};
+    m_Indices = {};
+    m_Staging.clear();
+    m_Device = VK_NULL_HANDLE;
+}
+
+void DynamicMesh::beginFrame( uint32_t frameIndex )
+{
+    Staging &to = m_Staging[frameIndex];
+    VkDeviceSize unrecorded = m_StagingUsed - m_StagingRecorded;
+    if ( unrecorded > to.capacity )
+    {
+        // Can't be the current buffer, which holds them already.
+        createStaging( to, std::bit_ceil( unrecorded ) );
+    }
+    moveUnrecorded( m_Staging[m_Frame], to );
+    m_Frame = frameIndex;
+}
+
+void DynamicMesh::setVertices( const void *vertices, uint32_t count )
+{
+    set( m_Vertices, vertices, count );
+}
+
+uint32_t DynamicMesh::appendVertices( const void *vertices, uint32_t count )
+{
+    return append( m_Vertices, vertices, count );
+}
+
+void DynamicMesh::updateVertices( uint32_t first, const void *vertices, uint32_t count )
+{
+    update( m_Vertices, first, vertices, count );
+}
+
+void DynamicMesh::setIndices( const void *indices, uint32_t count )
+{
+    set( m_Indices, indices, count );
+}
+
+uint32_t DynamicMesh::appendIndices( const void *indices, uint32_t count )
+{
+    return append( m_Indices, indices, count );
+}
+
+void DynamicMesh::updateIndices( uint32_t first, const void *indices, uint32_t count )
+{
+    update( m_Indices, first, indices, count );
+}
+
+void DynamicMesh::recordUploads( VkCommandBuffer commandBuffer )
+{
+    m_LastUploadBytes = 0;
+    if ( !m_Vertices.previous && !m_Indices.previous && m_Vertices.regions.empty() && m_Indices.regions.empty() )
+    {
+        return;
+    }
+
+    // Earlier frames may still be reading what is about to be overwritten, and earlier
+    // copies into the buffers may still be in progress.
+    recordMemoryBarrier( commandBuffer,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_ACCESS_TRANSFER_WRITE_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT );
+
+    VkBuffer staging = m_Staging[m_Frame].buffer.get();
+    for ( Stream *stream : { &m_Vertices, &m_Indices } )
+    {
+        // The range written by copies since the last barrier.
+        VkDeviceSize writtenBegin = 0;
+        VkDeviceSize writtenEnd = 0;
+
+        if ( stream->previous )
+        {
+            VkBufferCopy copy{ 0, 0, stream->previousBytes };
+            vkCmdCopyBuffer( commandBuffer, stream->previous.get(), stream->buffer.get(), 1, &copy );
+            m_LastUploadBytes += stream->previousBytes;
+            writtenEnd = stream->previousBytes;
+            // Destroyed once this frame has retired.
+            stream->previous.reset();
+            stream->previousMemory.reset();
+            stream->previousBytes = 0;
+        }
+
+        // Writes within a single copy command are unordered, so a region overlapping
+        // one before it starts a new command behind a barrier; the later edit wins.
+        const std::vector<VkBufferCopy> &regions = stream->regions;
+        size_t first = 0;
+        for ( size_t i = 0; i < regions.size(); ++i )
+        {
+            const VkBufferCopy &region = regions[i];
+            if ( region.dstOffset < writtenEnd && region.dstOffset + region.size > writtenBegin )
+            {
+                if ( i > first )
+                {
+                    vkCmdCopyBuffer( commandBuffer,
+                                     staging,
+                                     stream->buffer.get(),
+                                     static_cast<uint32_t>( i - first ),
+                                     &regions[first] );
+                }
+                recordMemoryBarrier( commandBuffer,
+                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                     VK_ACCESS_TRANSFER_WRITE_BIT,
+                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                     VK_ACCESS_TRANSFER_WRITE_BIT );
+                first = i;
+                writtenBegin = region.dstOffset;
+                writtenEnd = region.dstOffset + region.size;
+            }
+            else if ( writtenBegin == writtenEnd )
+            {
+                writtenBegin = region.dstOffset;
+                writtenEnd = region.dstOffset + region.size;
+            }
+            else
+            {
+                writtenBegin = std::min( writtenBegin, region.dstOffset );
+                writtenEnd = std::max( writtenEnd, region.dstOffset + region.size );
+            }
+            m_LastUploadBytes += region.size;
+        }
+        if ( regions.size() > first )
+        {
+            vkCmdCopyBuffer( commandBuffer,
+                             staging,
+                             stream->buffer.get(),
+                             static_cast<uint32_t>( regions.size() - first ),
+                             &regions[first] );
+        }
+        stream->regions.clear();
+    }
+
+    recordMemoryBarrier( commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_ACCESS_TRANSFER_WRITE_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT );
+
+    m_StagingRecorded = m_StagingUsed;
+}
+
+void DynamicMesh::set( Stream &stream, const void *data, uint32_t count )
+{
+    // Everything is overwritten, so neither the old contents nor earlier edits matter.
+    stream.previous.reset();
+    stream.previousMemory.reset();
+    stream.previousBytes = 0;
+    stream.regions.clear();
+
+    reserve( stream, count, false );
+    stream.count = count;
+    stage( stream, 0, data, static_cast<VkDeviceSize>( count ) * stream.stride );
+}
+
+uint32_t DynamicMesh::append( Stream &stream, const void *data, uint32_t count )
+{
+    uint32_t first = stream.count;
+    if ( count > UINT32_MAX - first )
+    {
+        throw std::runtime_error( "dynamic mesh is full!" );
+    }
+
+    reserve( stream, first + count, true );
+    stream.count = first + count;
+    stage( stream, static_cast<VkDeviceSize>( first ) * stream.stride, data, static_cast<VkDeviceSize>( count ) * stream.stride );
+    return first;
+}
+
+void DynamicMesh::update( Stream &stream, uint32_t first, const void *data, uint32_t count )
+{
+    if ( static_cast<uint64_t>( first ) + count > stream.count )
+    {
+        throw std::runtime_error( "dynamic mesh update is out of range!" );
+    }
+    stage( stream, static_cast<VkDeviceSize>( first ) * stream.stride, data, static_cast<VkDeviceSize>( count ) * stream.stride );
+}
+
+void DynamicMesh::reserve( Stream &stream, uint32_t count, bool keepContents )
+{
+    VkDeviceSize required = static_cast<VkDeviceSize>( count ) * stream.stride;
+    if ( required <= stream.capacity )
+    {
+        return;
+    }
+
+    UniqueDeviceMemory oldMemory = std::move( stream.memory );
+    UniqueBuffer       old = std::move( stream.buffer );
+    createStream( stream, std::bit_ceil( required ) );
+    ++m_Version;
+
+    // After a second growth within a frame, the buffer from before the first one still
+    // holds everything; the one in between was never written.
+    if ( keepContents && !stream.previous && stream.count > 0 )
+    {
+        stream.previousMemory = std::move( oldMemory );
+        stream.previous = std::move( old );
+        stream.previousBytes = static_cast<VkDeviceSize>( stream.count ) * stream.stride;
+    }
+}
+
+void DynamicMesh::createStream( Stream &stream, VkDeviceSize capacity )
+{
+    VkBuffer       buffer;
+    VkDeviceMemory memory;
+    createBuffer( m_PhysicalDevice,
+                  m_Device,
+                  capacity,
+                  stream.usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                  buffer,
+                  memory );
+    stream.memory = UniqueDeviceMemory( m_Device, memory, m_DeletionQueue );
+    stream.buffer = UniqueBuffer( m_Device, buffer, m_DeletionQueue );
+    stream.capacity = capacity;
+}
+
+void DynamicMesh::stage( Stream &stream, VkDeviceSize dstOffset, const void *data, VkDeviceSize size )
+{
+    if ( size == 0 )
+    {
+        return;
+    }
+
+    if ( m_StagingUsed + size > m_Staging[m_Frame].capacity )
+    {
+        // The old buffer goes to the deletion queue, as copies already recorded may
+        // still read from it.
+        Staging grown;
+        createStaging( grown, std::bit_ceil( m_StagingUsed - m_StagingRecorded + size ) );
+        moveUnrecorded( m_Staging[m_Frame], grown );
+        m_Staging[m_Frame] = std::move( grown );
+    }
+
+    std::memcpy( m_Staging[m_Frame].mapped + m_StagingUsed, data, static_cast<size_t>( size ) );
+
+    // Consecutive edits, the common case for appends and sweeps, share one region.
+    if ( !stream.regions.empty() )
+    {
+        VkBufferCopy &last = stream.regions.back();
+        if ( last.srcOffset + last.size == m_StagingUsed && last.dstOffset + last.size == dstOffset )
+        {
+            last.size += size;
+            m_StagingUsed += size;
+            return;
+        }
+    }
+    stream.regions.push_back( { m_StagingUsed, dstOffset, size } );
+    m_StagingUsed += size;
+}
+
+void DynamicMesh::createStaging( Staging &staging, VkDeviceSize capacity )
+{
+    VkBuffer       buffer;
+    VkDeviceMemory memory;
+    createBuffer( m_PhysicalDevice,
+                  m_Device,
+                  capacity,
+                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  buffer,
+                  memory );
+    staging.memory = UniqueDeviceMemory( m_Device, memory, m_DeletionQueue );
+    staging.buffer = UniqueBuffer( m_Device, buffer, m_DeletionQueue );
+
+    void *mapped = nullptr;
+    if ( vkMapMemory( m_Device, memory, 0, capacity, 0, &mapped ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to map dynamic mesh staging buffer!" );
+    }
+    staging.mapped = static_cast<uint8_t *>( mapped );
+    staging.capacity = capacity;
+}
+
+void DynamicMesh::moveUnrecorded( Staging &from, Staging &to )
+{
+    VkDeviceSize bytes = m_StagingUsed - m_StagingRecorded;
+    if ( bytes > 0 )
+    {
+        // Rare: edits made between recordUploads and the next beginFrame, or past the
+        // staging capacity. Reads back from mapped memory, which may be uncached.
+        std::memmove( to.mapped, from.mapped + m_StagingRecorded, static_cast<size_t>( bytes ) );
+        for ( Stream *stream : { &m_Vertices, &m_Indices } )
+        {
+            for ( VkBufferCopy &region : stream->regions )
+            {
+                region.srcOffset -= m_StagingRecorded;
+            }
+        }
+    }
+    m_StagingUsed = bytes;
+    m_StagingRecorded = 0;
+}
@@ -0,0 +1,129 @@
+#pragma once
+// Vertex and index buffers that can be edited while frames are in flight.
+//
+// The buffers themselves stay device local. Edits are written into a persistently
+// mapped staging buffer owned by the current frame and become one vkCmdCopyBuffer
+// region each, recorded by recordUploads ahead of the frame's draws. A barrier in
+// front of the copies waits for earlier frames to finish reading vertices, so nothing
+// on the CPU ever waits on the GPU.
+//
+// Growing past the capacity creates a larger buffer and bumps the version; the old
+// contents are copied over on the GPU and the old buffer goes to the deletion queue,
+// where it stays alive for the frames still drawing from it.
+
+#include "DeletionQueue.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+struct DynamicMeshCreateInfo
+{
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice         device = VK_NULL_HANDLE;
+    // Replaced buffers go here. Required.
+    DeletionQueue   *deletionQueue = nullptr;
+    uint32_t         framesInFlight = 0;
+    uint32_t         vertexStride = 0;
+    VkIndexType      indexType = VK_INDEX_TYPE_UINT16;
+    // Initial sizes; both grow on demand.
+    uint32_t         vertexCapacity = 1024;
+    uint32_t         indexCapacity = 1024;
+    VkDeviceSize     stagingBytes = 256 * 1024;
+};
+
+class DynamicMesh
+{
+public:
+    void create( const DynamicMeshCreateInfo &createInfo );
+    void cleanup();
+
+    bool isEnabled() const { return m_Device != VK_NULL_HANDLE; }
+
+    // Call after the frame's fence was waited on. Edits made since the last
+    // recordUploads carry over to the new frame.
+    void beginFrame( uint32_t frameIndex );
+
+    // Edits are seen by draws recorded after the next recordUploads; frames recorded
+    // earlier keep the old contents. Ranges outside the current count throw
+    // std::runtime_error.
+    void     setVertices( const void *vertices, uint32_t count );
+    // Returns the index of the first appended vertex.
+    uint32_t appendVertices( const void *vertices, uint32_t count );
+    void     updateVertices( uint32_t first, const void *vertices, uint32_t count );
+
+    void     setIndices( const void *indices, uint32_t count );
+    uint32_t appendIndices( const void *indices, uint32_t count );
+    void     updateIndices( uint32_t first, const void *indices, uint32_t count );
+
+    // Records the pending copies. Must be outside of a render pass, before anything
+    // drawing the mesh.
+    void recordUploads( VkCommandBuffer commandBuffer );
+
+    VkBuffer    getVertexBuffer() const { return m_Vertices.buffer.get(); }
+    VkBuffer    getIndexBuffer() const { return m_Indices.buffer.get(); }
+    VkIndexType getIndexType() const { return m_IndexType; }
+    uint32_t    getVertexCount() const { return m_Vertices.count; }
+    uint32_t    getIndexCount() const { return m_Indices.count; }
+    // Changes whenever a buffer is replaced by a larger one.
+    uint64_t    getVersion() const { return m_Version; }
+    // Bytes copied by the last recordUploads, growth copies included.
+    VkDeviceSize getLastUploadBytes() const { return m_LastUploadBytes; }
+
+private:
+    struct Stream
+    {
+        VkBufferUsageFlags usage = 0;
+        uint32_t           stride = 0;
+        UniqueDeviceMemory memory;
+        UniqueBuffer       buffer;
+        VkDeviceSize       capacity = 0;
+        uint32_t           count = 0;
+        // The buffer before this frame's first growth, copied into the new one by
+        // recordUploads ahead of the edits.
+        UniqueDeviceMemory previousMemory;
+        UniqueBuffer       previous;
+        VkDeviceSize       previousBytes = 0;
+        // Source offsets are into the current staging buffer.
+        std::vector<VkBufferCopy> regions;
+    };
+
+    struct Staging
+    {
+        UniqueDeviceMemory memory;
+        UniqueBuffer       buffer;
+        uint8_t           *mapped = nullptr;
+        VkDeviceSize       capacity = 0;
+    };
+
+    void set( Stream &stream, const void *data, uint32_t count );
+    uint32_t append( Stream &stream, const void *data, uint32_t count );
+    void update( Stream &stream, uint32_t first, const void *data, uint32_t count );
+
+    void reserve( Stream &stream, uint32_t count, bool keepContents );
+    void createStream( Stream &stream, VkDeviceSize capacity );
+    void stage( Stream &stream, VkDeviceSize dstOffset, const void *data, VkDeviceSize size );
+    void createStaging( Staging &staging, VkDeviceSize capacity );
+    // Moves the bytes not yet recorded to the front of another (or the same) buffer.
+    void moveUnrecorded( Staging &from, Staging &to );
+
+private:
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice         m_Device = VK_NULL_HANDLE;
+    DeletionQueue   *m_DeletionQueue = nullptr;
+    VkIndexType      m_IndexType = VK_INDEX_TYPE_UINT16;
+
+    Stream m_Vertices;
+    Stream m_Indices;
+
+    // One per frame in flight; m_Frame's is being written.
+    std::vector<Staging> m_Staging;
+    uint32_t             m_Frame = 0;
+    VkDeviceSize         m_StagingUsed = 0;
+    // Staged bytes before this offset are read by copies already recorded.
+    VkDeviceSize         m_StagingRecorded = 0;
+
+    uint64_t     m_Version = 0;
+    VkDeviceSize m_LastUploadBytes = 0;
+};
@@ -0,0 +1,181 @@
+#include "DynamicResolution.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+// Weight of a new sample in the smoothed GPU time.
+constexpr double kSmoothing = 0.25;
+// Within this fraction of the target the scale is left alone.
+constexpr double kDeadBand = 0.05;
+// Largest relative change of the scale per update, down and up.
+constexpr float kMaxDrop = 0.15f;
+constexpr float kMaxRise = 0.03f;
+// Frames in flight still measured at the old scale after a change.
+constexpr uint32_t kSettleUpdates = 3;
+}
+
+ResolutionController::ResolutionController( const DynamicResolutionSettings &settings )
+    : m_Settings( settings ), m_Scale( settings.maxScale ), m_LowestScale( settings.maxScale )
+{
+}
+
+float ResolutionController::update( double gpuMs )
+{
+    ++m_Updates;
+    m_ScaleSum += m_Scale;
+
+    m_SmoothedMs = m_SmoothedMs == 0.0 ? gpuMs : m_SmoothedMs + kSmoothing * ( gpuMs - m_SmoothedMs );
+    if ( m_Updates <= m_SettleUntil || m_SmoothedMs <= 0.0 )
+    {
+        return m_Scale;
+    }
+
+    double ratio = m_Settings.targetGpuMs / m_SmoothedMs;
+    if ( std::abs( ratio - 1.0 ) < kDeadBand )
+    {
+        return m_Scale;
+    }
+
+    float scale = m_Scale * static_cast<float>( std::sqrt( ratio ) );
+    scale = std::clamp( scale, m_Scale * ( 1.0f - kMaxDrop ), m_Scale * ( 1.0f + kMaxRise ) );
+    scale = std::clamp( scale, m_Settings.minScale, m_Settings.maxScale );
+    if ( scale != m_Scale )
+    {
+        m_Scale = scale;
+        m_LowestScale = std::min( m_LowestScale, scale );
+        m_SettleUntil = m_Updates + kSettleUpdates;
+        ++m_Changes;
+    }
+    return m_Scale;
+}
+
+float ResolutionController::getMeanScale() const
+{
+    return m_Updates == 0 ? m_Scale : static_cast<float>( m_ScaleSum / m_Updates );
+}
+
+void ResolutionTargets::create( VkPhysicalDevice physicalDevice,
+                                VkDevice device,
+                                VkFormat format,
+                                VkExtent2D outputExtent,
+                                float maxScale,
+                                uint32_t count )
+{
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties( physicalDevice, format, &properties );
+    // The upscale blits from these images into swap chain images of the same format.
+    const VkFormatFeatureFlags required =
+        VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    if ( ( properties.optimalTilingFeatures & required ) != required )
+    {
+        throw std::runtime_error( "The swap chain format can't be used for dynamic resolution targets." );
+    }
+    m_Filter = ( properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT )
+                   ? VK_FILTER_LINEAR
+                   : VK_FILTER_NEAREST;
+
+    m_Device = device;
+    m_OutputExtent = outputExtent;
+    m_ImageExtent.width = std::max( 1u, static_cast<uint32_t>( std::ceil( outputExtent.width * maxScale ) ) );
+    m_ImageExtent.height = std::max( 1u, static_cast<uint32_t>( std::ceil( outputExtent.height * maxScale ) ) );
+
+    m_Images.resize( count );
+    m_ImagesMemory.resize( count );
+    m_ImageViews.resize( count );
+    for ( uint32_t i = 0; i < count; ++i )
+    {
+        createImage( physicalDevice,
+                     device,
+                     m_ImageExtent.width,
+                     m_ImageExtent.height,
+                     1,
+                     format,
+                     VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     m_Images[i],
+                     m_ImagesMemory[i] );
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = m_Images[i];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 1;
+        if ( vkCreateImageView( device, &viewInfo, nullptr, &m_ImageViews[i] ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create a dynamic resolution image view." );
+        }
+    }
+}
+
+void ResolutionTargets::cleanup()
+{
+    for ( size_t i = 0; i < m_Images.size(); ++i )
+    {
+        vkDestroyImageView( m_Device, m_ImageViews[i], nullptr );
+        vkDestroyImage( m_Device, m_Images[i], nullptr );
+        vkFreeMemory( m_Device, m_ImagesMemory[i], nullptr );
+    }
+    m_Images.clear();
+    m_ImagesMemory.clear();
+    m_ImageViews.clear();
+}
+
+VkExtent2D ResolutionTargets::getRenderExtent( float scale ) const
+{
+    VkExtent2D extent;
+    extent.width = static_cast<uint32_t>( std::lround( m_OutputExtent.width * scale ) );
+    extent.height = static_cast<uint32_t>( std::lround( m_OutputExtent.height * scale ) );
+    extent.width = std::clamp( extent.width, 1u, m_ImageExtent.width );
+    extent.height = std::clamp( extent.height, 1u, m_ImageExtent.height );
+    return extent;
+}
+
+void ResolutionTargets::recordUpscale( VkCommandBuffer commandBuffer,
+                                       uint32_t index,
+                                       VkExtent2D renderExtent,
+                                       VkImage outputImage,
+                                       VkImageLayout outputLayout,
+                                       VkPipelineStageFlags dstStage,
+                                       VkAccessFlags dstAccess ) const
+{
+    // Every output pixel is written, the old contents can be dropped.
+    recordImageBarrier( commandBuffer,
+                        outputImage,
+                        VK_IMAGE_LAYOUT_UNDEFINED,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        0,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        VK_ACCESS_TRANSFER_WRITE_BIT );
+
+    VkImageBlit blit{};
+    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.layerCount = 1;
+    blit.srcOffsets[1] = { static_cast<int32_t>( renderExtent.width ), static_cast<int32_t>( renderExtent.height ), 1 };
+    blit.dstSubresource = blit.srcSubresource;
+    blit.dstOffsets[1] = { static_cast<int32_t>( m_OutputExtent.width ), static_cast<int32_t>( m_OutputExtent.height ), 1 };
+    vkCmdBlitImage( commandBuffer,
+                    m_Images[index],
+                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    outputImage,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    1,
+                    &blit,
+                    m_Filter );
+
+    recordImageBarrier( commandBuffer,
+                        outputImage,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        outputLayout,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        VK_ACCESS_TRANSFER_WRITE_BIT,
+                        dstStage,
+                        dstAccess );
+}
@@ -0,0 +1,95 @@
+#pragma once
+// Dynamic resolution.
+//
+// The scene is rendered into an offscreen image at a fraction of the output size and
+// blitted up to the output with a linear filter. ResolutionController picks that
+// fraction from the measured GPU frame time: the cost of a frame grows with its pixel
+// count, so the scale expected to hit the target is the current one times
+// sqrt( target / measured ). GPU times arrive a couple of frames late, so the
+// controller smooths them, ignores small deviations and limits every step - dropping
+// quickly when over budget, climbing back slowly - instead of chasing each sample.
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+struct DynamicResolutionSettings
+{
+    double targetGpuMs = 0.0;
+    // Fractions of the output width and height.
+    float  minScale = 0.5f;
+    float  maxScale = 1.0f;
+};
+
+class ResolutionController
+{
+public:
+    explicit ResolutionController( const DynamicResolutionSettings &settings );
+
+    // Feeds the GPU time of one resolved frame and returns the scale to render at.
+    float update( double gpuMs );
+    float getScale() const { return m_Scale; }
+
+    // Over every update so far.
+    float    getMeanScale() const;
+    float    getLowestScale() const { return m_LowestScale; }
+    uint32_t getChangeCount() const { return m_Changes; }
+    uint64_t getUpdateCount() const { return m_Updates; }
+
+private:
+    DynamicResolutionSettings m_Settings;
+    float                     m_Scale;
+    double                    m_SmoothedMs = 0.0;
+    // Updates up to this one are still measuring the previous scale.
+    uint64_t                  m_SettleUntil = 0;
+
+    double   m_ScaleSum = 0.0;
+    float    m_LowestScale;
+    uint32_t m_Changes = 0;
+    uint64_t m_Updates = 0;
+};
+
+// The offscreen images the scene is rendered into, one per frame in flight.
+class ResolutionTargets
+{
+public:
+    // Sized for maxScale * outputExtent, in the output's format. Throws
+    // std::runtime_error when the format can't be rendered to and blitted from.
+    void create( VkPhysicalDevice physicalDevice,
+                 VkDevice device,
+                 VkFormat format,
+                 VkExtent2D outputExtent,
+                 float maxScale,
+                 uint32_t count );
+    void cleanup();
+
+    // The part of the images used at this scale, starting at the origin.
+    VkExtent2D getRenderExtent( float scale ) const;
+    VkExtent2D getImageExtent() const { return m_ImageExtent; }
+
+    VkImage     getImage( uint32_t index ) const { return m_Images[index]; }
+    VkImageView getImageView( uint32_t index ) const { return m_ImageViews[index]; }
+    uint32_t    getCount() const { return static_cast<uint32_t>( m_Images.size() ); }
+
+    // Blits renderExtent of image index over the whole output image and leaves that in
+    // outputLayout for the given stage and access. The source must already be in
+    // TRANSFER_SRC_OPTIMAL with its writes visible to transfers.
+    void recordUpscale( VkCommandBuffer commandBuffer,
+                        uint32_t index,
+                        VkExtent2D renderExtent,
+                        VkImage outputImage,
+                        VkImageLayout outputLayout,
+                        VkPipelineStageFlags dstStage,
+                        VkAccessFlags dstAccess ) const;
+
+private:
+    VkDevice   m_Device = VK_NULL_HANDLE;
+    VkExtent2D m_OutputExtent{};
+    VkExtent2D m_ImageExtent{};
+    VkFilter   m_Filter = VK_FILTER_LINEAR;
+
+    std::vector<VkImage>        m_Images;
+    std::vector<VkDeviceMemory> m_ImagesMemory;
+    std::vector<VkImageView>    m_ImageViews;
+};
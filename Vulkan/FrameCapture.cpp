@@ -0,0 +1,315 @@
+#include "FrameCapture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+const char     kMagic[8] = { 'V', 'K', 'C', 'A', 'P', 'T', 'U', 'R' };
+const uint32_t kVersion = 1;
+
+struct CaptureHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved;
+    uint64_t frameCount;
+    uint64_t indexOffset;
+};
+
+struct FrameHeader
+{
+    uint64_t frameIndex;
+    double   timeUs;
+    uint32_t commandCount;
+    // Of the commands that follow.
+    uint32_t size;
+};
+
+struct CommandHeader
+{
+    uint32_t type;
+    // Of the payload that follows.
+    uint32_t size;
+};
+
+enum CommandType : uint32_t
+{
+    kUniforms = 1,
+    kMeshEdit = 2,
+    kDraw = 3,
+};
+
+struct UniformsPayload
+{
+    float    deltaTime;
+    uint32_t size;
+};
+
+struct MeshEditPayload
+{
+    uint32_t stream;
+    uint32_t mode;
+    uint32_t first;
+    uint32_t count;
+    uint32_t stride;
+};
+} // namespace
+
+void CaptureWriter::open( const std::string &path )
+{
+    close();
+    m_File.open( path, std::ios::binary | std::ios::trunc );
+    if ( !m_File )
+    {
+        throw std::runtime_error( "failed to create " + path );
+    }
+    m_Path = path;
+
+    // Rewritten by close once the frames are known.
+    CaptureHeader header{};
+    m_File.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+    m_Offset = sizeof( header );
+    m_FrameOffsets.clear();
+    m_Commands.clear();
+    m_CommandCount = 0;
+    m_InFrame = false;
+}
+
+void CaptureWriter::close()
+{
+    if ( !m_File.is_open() )
+    {
+        return;
+    }
+    if ( m_InFrame )
+    {
+        endFrame();
+    }
+
+    CaptureHeader header{};
+    memcpy( header.magic, kMagic, sizeof( kMagic ) );
+    header.version = kVersion;
+    header.width = m_Extent.width;
+    header.height = m_Extent.height;
+    header.frameCount = m_FrameOffsets.size();
+    header.indexOffset = m_Offset;
+    m_File.write( reinterpret_cast<const char *>( m_FrameOffsets.data() ), m_FrameOffsets.size() * sizeof( uint64_t ) );
+    m_File.seekp( 0 );
+    m_File.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+
+    bool failed = !m_File;
+    m_File.close();
+    if ( failed )
+    {
+        throw std::runtime_error( "failed to write " + m_Path );
+    }
+}
+
+void CaptureWriter::beginFrame( uint64_t frameIndex, double timeUs )
+{
+    if ( m_InFrame )
+    {
+        endFrame();
+    }
+    m_InFrame = true;
+    m_FrameIndex = frameIndex;
+    m_FrameTimeUs = timeUs;
+}
+
+void CaptureWriter::endFrame()
+{
+    if ( !m_InFrame )
+    {
+        return;
+    }
+    m_InFrame = false;
+
+    FrameHeader header{ m_FrameIndex, m_FrameTimeUs, m_CommandCount, static_cast<uint32_t>( m_Commands.size() ) };
+    m_File.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+    m_File.write( m_Commands.data(), m_Commands.size() );
+    m_FrameOffsets.push_back( m_Offset );
+    m_Offset += sizeof( header ) + m_Commands.size();
+
+    m_Commands.clear();
+    m_CommandCount = 0;
+}
+
+void CaptureWriter::writeUniforms( float deltaTime, const void *data, uint32_t size )
+{
+    UniformsPayload payload{ deltaTime, size };
+    writeCommand( kUniforms, &payload, sizeof( payload ), data, size );
+}
+
+void CaptureWriter::writeMeshEdit( const CaptureMeshEdit &edit )
+{
+    MeshEditPayload payload{ static_cast<uint32_t>( edit.stream ),
+                             static_cast<uint32_t>( edit.mode ),
+                             edit.first,
+                             edit.count,
+                             edit.stride };
+    writeCommand( kMeshEdit, &payload, sizeof( payload ), edit.data.data(), static_cast<uint32_t>( edit.data.size() ) );
+}
+
+void CaptureWriter::writeDraw( const CaptureDraw &draw )
+{
+    writeCommand( kDraw, &draw, sizeof( draw ), nullptr, 0 );
+}
+
+void CaptureWriter::writeCommand( uint32_t type,
+                                  const void *header,
+                                  uint32_t headerSize,
+                                  const void *data,
+                                  uint32_t dataSize )
+{
+    if ( !m_File.is_open() )
+    {
+        return;
+    }
+
+    // Payloads are padded to 8 bytes so every header that follows stays aligned.
+    uint32_t size = ( headerSize + dataSize + 7 ) & ~7u;
+    CommandHeader command{ type, size };
+    size_t offset = m_Commands.size();
+    m_Commands.resize( offset + sizeof( command ) + size, 0 );
+    memcpy( m_Commands.data() + offset, &command, sizeof( command ) );
+    memcpy( m_Commands.data() + offset + sizeof( command ), header, headerSize );
+    if ( dataSize > 0 )
+    {
+        memcpy( m_Commands.data() + offset + sizeof( command ) + headerSize, data, dataSize );
+    }
+    ++m_CommandCount;
+}
+
+void CaptureReader::open( const std::string &path )
+{
+    close();
+    m_File.open( path );
+
+    std::span<const char> data = m_File.getData();
+    CaptureHeader header;
+    if ( data.size() < sizeof( header ) )
+    {
+        close();
+        throw std::runtime_error( path + " is not a frame capture" );
+    }
+    memcpy( &header, data.data(), sizeof( header ) );
+    if ( memcmp( header.magic, kMagic, sizeof( kMagic ) ) != 0 || header.version != kVersion )
+    {
+        close();
+        throw std::runtime_error( path + " is not a frame capture" );
+    }
+    if ( header.indexOffset % alignof( uint64_t ) != 0 || header.indexOffset > data.size() ||
+         header.frameCount > ( data.size() - header.indexOffset ) / sizeof( uint64_t ) )
+    {
+        close();
+        throw std::runtime_error( path + " is truncated" );
+    }
+
+    m_FrameOffsets = reinterpret_cast<const uint64_t *>( data.data() + header.indexOffset );
+    m_FrameCount = header.frameCount;
+    m_FramesEnd = header.indexOffset;
+    m_Extent = { header.width, header.height };
+}
+
+void CaptureReader::close()
+{
+    m_File.close();
+    m_FrameOffsets = nullptr;
+    m_FrameCount = 0;
+    m_FramesEnd = 0;
+    m_Extent = {};
+}
+
+void CaptureReader::readFrame( uint64_t index, CaptureFrame &frame ) const
+{
+    const char *data = m_File.getData().data();
+    uint64_t offset = m_FrameOffsets[index];
+    FrameHeader header;
+    if ( offset % alignof( uint64_t ) != 0 || offset + sizeof( header ) > m_FramesEnd )
+    {
+        throw std::runtime_error( "frame capture has an invalid frame index" );
+    }
+    memcpy( &header, data + offset, sizeof( header ) );
+    offset += sizeof( header );
+    const uint64_t end = offset + header.size;
+    if ( end > m_FramesEnd )
+    {
+        throw std::runtime_error( "frame capture has a truncated frame" );
+    }
+
+    frame.frameIndex = header.frameIndex;
+    frame.timeUs = header.timeUs;
+    frame.deltaTime = 0.0f;
+    frame.uniforms = {};
+    frame.meshEdits.clear();
+    frame.draws.clear();
+
+    for ( uint32_t i = 0; i < header.commandCount; ++i )
+    {
+        CommandHeader command;
+        if ( offset + sizeof( command ) > end )
+        {
+            throw std::runtime_error( "frame capture has a truncated frame" );
+        }
+        memcpy( &command, data + offset, sizeof( command ) );
+        offset += sizeof( command );
+        if ( command.size > end - offset )
+        {
+            throw std::runtime_error( "frame capture has a truncated frame" );
+        }
+        const char *payload = data + offset;
+        offset += command.size;
+
+        switch ( command.type )
+        {
+        case kUniforms:
+        {
+            UniformsPayload uniforms;
+            memcpy( &uniforms, payload, std::min<size_t>( sizeof( uniforms ), command.size ) );
+            if ( command.size < sizeof( uniforms ) || uniforms.size > command.size - sizeof( uniforms ) )
+            {
+                throw std::runtime_error( "frame capture has invalid uniforms" );
+            }
+            frame.deltaTime = uniforms.deltaTime;
+            frame.uniforms = { payload + sizeof( uniforms ), uniforms.size };
+            break;
+        }
+        case kMeshEdit:
+        {
+            MeshEditPayload edit;
+            memcpy( &edit, payload, std::min<size_t>( sizeof( edit ), command.size ) );
+            uint64_t dataSize = uint64_t( edit.count ) * edit.stride;
+            if ( command.size < sizeof( edit ) || dataSize > command.size - sizeof( edit ) ||
+                 edit.stream > static_cast<uint32_t>( CaptureMeshStream::Indices ) ||
+                 edit.mode > static_cast<uint32_t>( CaptureEditMode::Append ) )
+            {
+                throw std::runtime_error( "frame capture has an invalid mesh edit" );
+            }
+            frame.meshEdits.push_back( CaptureMeshEdit{ static_cast<CaptureMeshStream>( edit.stream ),
+                                                        static_cast<CaptureEditMode>( edit.mode ),
+                                                        edit.first,
+                                                        edit.count,
+                                                        edit.stride,
+                                                        { payload + sizeof( edit ), static_cast<size_t>( dataSize ) } } );
+            break;
+        }
+        case kDraw:
+        {
+            if ( command.size < sizeof( CaptureDraw ) )
+            {
+                throw std::runtime_error( "frame capture has an invalid draw" );
+            }
+            CaptureDraw draw;
+            memcpy( &draw, payload, sizeof( draw ) );
+            frame.draws.push_back( draw );
+            break;
+        }
+        default:
+            throw std::runtime_error( "frame capture has an unknown command" );
+        }
+    }
+}
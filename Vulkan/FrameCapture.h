@@ -0,0 +1,141 @@
+#pragma once
+// Capture and replay of the scene's per-frame command stream.
+//
+// A capture records what the application hands the GPU every frame: the uniform
+// buffer contents, edits of the scene mesh and the scene's draw calls. Nothing in it
+// refers to Vulkan handles or to the clock, so replaying it renders exactly the same
+// frames on any device, driver or build - which is what makes runs comparable.
+//
+// Textures aren't captured. A replay uses the ones given on its command line and loads
+// them completely before its first frame (TextureStreamer::flush), so it never draws
+// the fallback or a coarse copy that the captured run happened to show.
+//
+// Layout, all little endian:
+//   Header
+//   per frame: FrameHeader, then its commands, each a CommandHeader and a payload
+//   uint64_t frameOffsets[frameCount]
+//
+// CaptureReader maps the file and decodes frames in place; the spans it hands out
+// point into the mapping.
+
+#include "AssetArchive.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+enum class CaptureMeshStream : uint32_t
+{
+    Vertices,
+    Indices,
+};
+
+// The DynamicMesh call the edit was made with.
+enum class CaptureEditMode : uint32_t
+{
+    Set,
+    Update,
+    Append,
+};
+
+struct CaptureMeshEdit
+{
+    CaptureMeshStream     stream = CaptureMeshStream::Vertices;
+    CaptureEditMode       mode = CaptureEditMode::Set;
+    // Ignored for Set and Append.
+    uint32_t              first = 0;
+    uint32_t              count = 0;
+    uint32_t              stride = 0;
+    std::span<const char> data;
+};
+
+struct CaptureDraw
+{
+    uint32_t indexCount = 0;
+    uint32_t instanceCount = 1;
+    uint32_t firstIndex = 0;
+    int32_t  vertexOffset = 0;
+    uint32_t firstInstance = 0;
+};
+
+struct CaptureFrame
+{
+    uint64_t frameIndex = 0;
+    // Since the first captured frame.
+    double   timeUs = 0.0;
+    float    deltaTime = 0.0f;
+    // What updateUniformBuffer wrote.
+    std::span<const char>        uniforms;
+    std::vector<CaptureMeshEdit> meshEdits;
+    std::vector<CaptureDraw>     draws;
+};
+
+class CaptureWriter
+{
+public:
+    // Throws std::runtime_error when the file can't be created.
+    void open( const std::string &path );
+    // Writes the frame index; throws std::runtime_error when anything failed to write.
+    void close();
+
+    bool isOpen() const { return m_File.is_open(); }
+
+    void setExtent( VkExtent2D extent ) { m_Extent = extent; }
+
+    // Commands go to the frame begun last. Those written before the first beginFrame,
+    // like the initial mesh contents, go to the first frame.
+    void beginFrame( uint64_t frameIndex, double timeUs );
+    void endFrame();
+
+    void writeUniforms( float deltaTime, const void *data, uint32_t size );
+    void writeMeshEdit( const CaptureMeshEdit &edit );
+    void writeDraw( const CaptureDraw &draw );
+
+    uint64_t getFrameCount() const { return m_FrameOffsets.size(); }
+
+private:
+    void writeCommand( uint32_t type, const void *header, uint32_t headerSize, const void *data, uint32_t dataSize );
+
+private:
+    std::string   m_Path;
+    std::ofstream m_File;
+    VkExtent2D    m_Extent{};
+
+    std::vector<uint64_t> m_FrameOffsets;
+    uint64_t              m_Offset = 0;
+
+    bool              m_InFrame = false;
+    uint64_t          m_FrameIndex = 0;
+    double            m_FrameTimeUs = 0.0;
+    // The current frame's commands, written out by endFrame.
+    std::vector<char> m_Commands;
+    uint32_t          m_CommandCount = 0;
+};
+
+class CaptureReader
+{
+public:
+    // Throws std::runtime_error when the file isn't a capture or is truncated.
+    void open( const std::string &path );
+    void close();
+
+    bool isOpen() const { return m_File.isOpen(); }
+
+    uint64_t   getFrameCount() const { return m_FrameCount; }
+    VkExtent2D getExtent() const { return m_Extent; }
+
+    // Decodes into frame, reusing its vectors. Throws std::runtime_error on a corrupt frame.
+    void readFrame( uint64_t index, CaptureFrame &frame ) const;
+
+private:
+    MappedFile      m_File;
+    const uint64_t *m_FrameOffsets = nullptr;
+    uint64_t        m_FrameCount = 0;
+    // Where the frames end and the index begins.
+    uint64_t        m_FramesEnd = 0;
+    VkExtent2D      m_Extent{};
+};
@@ -0,0 +1,102 @@
+#pragma once
+// Single producer, single consumer queue of frame packets.
+//
+// The update thread fills a packet with everything a frame needs from the simulation
+// while the render thread records and submits an earlier one. Packets live in a fixed
+// ring of SlotCount slots, so nothing is allocated or copied between the threads: the
+// producer writes in place, the consumer reads in place, and two counters tell them
+// which slots are theirs. With three slots one packet can be rendered, one sit ready
+// and one be written at the same time, which lets both threads absorb uneven frames.
+//
+// Neither side takes a lock. A side that runs ahead blocks in std::atomic::wait, which
+// only sleeps while there is nothing it could do anyway.
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+template <typename T, uint32_t SlotCount = 3>
+class FramePipeline
+{
+    static_assert( SlotCount >= 2, "the threads can't overlap with a single slot" );
+
+public:
+    // Producer side. Blocks while every slot holds an unread packet; returns nullptr
+    // once the pipeline was closed.
+    T *beginWrite()
+    {
+        for ( ;; )
+        {
+            uint32_t signal = m_Signal.load( std::memory_order_acquire );
+            if ( m_Closed.load( std::memory_order_acquire ) )
+            {
+                return nullptr;
+            }
+            uint64_t written = m_Written.load( std::memory_order_relaxed );
+            if ( written - m_Read.load( std::memory_order_acquire ) < SlotCount )
+            {
+                return &m_Slots[written % SlotCount];
+            }
+            m_Signal.wait( signal, std::memory_order_acquire );
+        }
+    }
+
+    void endWrite()
+    {
+        m_Written.fetch_add( 1, std::memory_order_release );
+        notify();
+    }
+
+    // Consumer side. Blocks until a packet is ready; returns nullptr once the pipeline
+    // was closed and every packet written before that has been read.
+    const T *beginRead()
+    {
+        for ( ;; )
+        {
+            uint32_t signal = m_Signal.load( std::memory_order_acquire );
+            uint64_t read = m_Read.load( std::memory_order_relaxed );
+            if ( m_Written.load( std::memory_order_acquire ) != read )
+            {
+                return &m_Slots[read % SlotCount];
+            }
+            if ( m_Closed.load( std::memory_order_acquire ) )
+            {
+                return nullptr;
+            }
+            m_Signal.wait( signal, std::memory_order_acquire );
+        }
+    }
+
+    void endRead()
+    {
+        m_Read.fetch_add( 1, std::memory_order_release );
+        notify();
+    }
+
+    // Either side may close; the other one returns from its wait.
+    void close()
+    {
+        m_Closed.store( true, std::memory_order_release );
+        notify();
+    }
+
+    bool isClosed() const { return m_Closed.load( std::memory_order_acquire ); }
+
+private:
+    // Every state change bumps the signal after it is published, so a waiter that read
+    // the signal before checking the counters can't miss the change.
+    void notify()
+    {
+        m_Signal.fetch_add( 1, std::memory_order_release );
+        m_Signal.notify_all();
+    }
+
+private:
+    std::array<T, SlotCount> m_Slots{};
+
+    // Each counter has a single writer; keep them on separate cache lines.
+    alignas( 64 ) std::atomic<uint64_t> m_Written{ 0 };
+    alignas( 64 ) std::atomic<uint64_t> m_Read{ 0 };
+    alignas( 64 ) std::atomic<uint32_t> m_Signal{ 0 };
+    std::atomic<bool>                   m_Closed{ false };
+};
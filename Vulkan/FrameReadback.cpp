@@ -0,0 +1,276 @@
+#include "FrameReadback.h"
+#include "VulkanUtils.h"
+
+#include <stdexcept>
+
+static uint32_t bytesPerPixel( VkFormat format )
+{
+    switch ( format )
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return 4;
+    default:
+        throw std::runtime_error( "Frame readback doesn't support the swap chain format." );
+    }
+}
+
+void FrameReadback::create( VkPhysicalDevice physicalDevice, VkDevice device, uint32_t slotCount )
+{
+    m_PhysicalDevice = physicalDevice;
+    m_Device = device;
+    // Slots are allocated lazily on first use so they always match the current extent.
+    m_Slots.resize( slotCount );
+}
+
+void FrameReadback::cleanup()
+{
+    for ( auto &slot : m_Slots )
+    {
+        destroySlot( slot );
+    }
+    m_Slots.clear();
+    m_Pending.clear();
+    m_Ready.clear();
+}
+
+void FrameReadback::setCallback( Callback callback )
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    m_Callback = std::move( callback );
+}
+
+bool FrameReadback::record( VkCommandBuffer commandBuffer,
+                            VkImage image,
+                            VkImageLayout imageLayout,
+                            VkFormat format,
+                            VkExtent2D extent,
+                            uint64_t frameNumber )
+{
+    uint32_t rowPitch = extent.width * bytesPerPixel( format );
+    VkDeviceSize size = static_cast<VkDeviceSize>( rowPitch ) * extent.height;
+
+    Slot *slot = nullptr;
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        for ( size_t i = 0; i < m_Slots.size(); ++i )
+        {
+            uint32_t index = static_cast<uint32_t>( ( m_NextSlot + i ) % m_Slots.size() );
+            if ( m_Slots[index].state == SlotState::Free )
+            {
+                slot = &m_Slots[index];
+                slot->frame.slot = index;
+                m_NextSlot = index + 1;
+                break;
+            }
+        }
+
+        if ( slot == nullptr )
+        {
+            ++m_DroppedFrames;
+            return false;
+        }
+
+        // The slot is free, so no frame in flight can still be writing into it.
+        if ( slot->size < size )
+        {
+            destroySlot( *slot );
+            allocateSlot( *slot, size );
+        }
+
+        slot->state = SlotState::Pending;
+        slot->frame.frameNumber = frameNumber;
+        slot->frame.extent = extent;
+        slot->frame.format = format;
+        slot->frame.rowPitch = rowPitch;
+        slot->frame.data = slot->mapped;
+        m_Pending.push_back( slot->frame.slot );
+    }
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    barrier.oldLayout = imageLayout;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          0, 0, nullptr, 0, nullptr, 1, &barrier );
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;   // tightly packed
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { extent.width, extent.height, 1 };
+    vkCmdCopyImageToBuffer( commandBuffer,
+                            image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                            slot->buffer, 1, &region );
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = imageLayout;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = 0;
+
+    VkBufferMemoryBarrier hostBarrier{};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.buffer = slot->buffer;
+    hostBarrier.offset = 0;
+    hostBarrier.size = size;
+
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                          0, 0, nullptr, 1, &hostBarrier, 1, &barrier );
+
+    return true;
+}
+
+void FrameReadback::collect( uint64_t completedFrames )
+{
+    std::vector<uint32_t> completed;
+    Callback callback;
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        while ( !m_Pending.empty() && m_Slots[m_Pending.front()].frame.frameNumber < completedFrames )
+        {
+            completed.push_back( m_Pending.front() );
+            m_Pending.pop_front();
+        }
+        callback = m_Callback;
+    }
+
+    for ( uint32_t index : completed )
+    {
+        Slot &slot = m_Slots[index];
+        if ( !slot.coherent )
+        {
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = slot.memory;
+            range.offset = 0;
+            range.size = VK_WHOLE_SIZE;
+            vkInvalidateMappedMemoryRanges( m_Device, 1, &range );
+        }
+
+        if ( callback )
+        {
+            callback( slot.frame );
+
+            std::lock_guard<std::mutex> lock( m_Mutex );
+            slot.state = SlotState::Free;
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock( m_Mutex );
+            slot.state = SlotState::Ready;
+            m_Ready.push_back( index );
+        }
+    }
+}
+
+bool FrameReadback::acquire( ReadbackFrame &frame )
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    if ( m_Ready.empty() )
+    {
+        return false;
+    }
+
+    Slot &slot = m_Slots[m_Ready.front()];
+    m_Ready.pop_front();
+    slot.state = SlotState::Acquired;
+    frame = slot.frame;
+    return true;
+}
+
+void FrameReadback::release( const ReadbackFrame &frame )
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    if ( frame.slot < m_Slots.size() && m_Slots[frame.slot].state == SlotState::Acquired )
+    {
+        m_Slots[frame.slot].state = SlotState::Free;
+    }
+}
+
+void FrameReadback::allocateSlot( Slot &slot, VkDeviceSize size )
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if ( vkCreateBuffer( m_Device, &bufferInfo, nullptr, &slot.buffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create readback buffer!" );
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements( m_Device, slot.buffer, &memRequirements );
+
+    // CPU reads from uncached memory are painfully slow, so prefer a cached type
+    // and invalidate by hand when it isn't coherent.
+    std::optional<uint32_t> memoryType =
+        findMemoryTypeIndex( m_PhysicalDevice,
+                             memRequirements.memoryTypeBits,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT );
+    slot.coherent = false;
+    if ( !memoryType.has_value() )
+    {
+        memoryType = findMemoryType( m_PhysicalDevice,
+                                     memRequirements.memoryTypeBits,
+                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+        slot.coherent = true;
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = memoryType.value();
+
+    if ( vkAllocateMemory( m_Device, &allocInfo, nullptr, &slot.memory ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to allocate readback buffer memory!" );
+    }
+
+    vkBindBufferMemory( m_Device, slot.buffer, slot.memory, 0 );
+    vkMapMemory( m_Device, slot.memory, 0, VK_WHOLE_SIZE, 0, &slot.mapped );
+    slot.size = size;
+}
+
+void FrameReadback::destroySlot( Slot &slot )
+{
+    if ( slot.buffer == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    vkUnmapMemory( m_Device, slot.memory );
+    vkDestroyBuffer( m_Device, slot.buffer, nullptr );
+    vkFreeMemory( m_Device, slot.memory, nullptr );
+    slot.buffer = VK_NULL_HANDLE;
+    slot.memory = VK_NULL_HANDLE;
+    slot.mapped = nullptr;
+    slot.size = 0;
+}
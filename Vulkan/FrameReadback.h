@@ -0,0 +1,96 @@
+#pragma once
+// Pipelined copy of finished frames back into host memory.
+//
+// Every captured frame is copied into one slot of a ring of host-visible, persistently
+// mapped buffers inside the frame's own command buffer. Nothing ever waits on the copy:
+// a slot is handed to the consumer once the frame that wrote it has retired, which is
+// MAX_FRAMES_IN_FLIGHT frames later. If the consumer still holds every slot the frame
+// is dropped instead of stalling the queue.
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+struct ReadbackFrame
+{
+    uint64_t    frameNumber = 0;
+    VkExtent2D  extent{};
+    VkFormat    format = VK_FORMAT_UNDEFINED;
+    uint32_t    rowPitch = 0;
+    // Points straight into the mapped slot, no copy is made. It stays valid until the
+    // callback returns or, in queue mode, until the frame is released.
+    const void *data = nullptr;
+    uint32_t    slot = 0;
+};
+
+class FrameReadback
+{
+public:
+    // When a callback is set, frames are delivered from collect() and the slot is
+    // recycled as soon as the callback returns. Without one, frames are queued and
+    // must be fetched with acquire() and given back with release().
+    using Callback = std::function<void( const ReadbackFrame & )>;
+
+    void create( VkPhysicalDevice physicalDevice, VkDevice device, uint32_t slotCount );
+    void cleanup();
+
+    void setCallback( Callback callback );
+
+    // Records the copy of image into the next free slot. The image is expected in
+    // imageLayout and is left in that layout. Returns false when every slot is busy
+    // and the frame was dropped.
+    bool record( VkCommandBuffer commandBuffer,
+                 VkImage image,
+                 VkImageLayout imageLayout,
+                 VkFormat format,
+                 VkExtent2D extent,
+                 uint64_t frameNumber );
+
+    // Hands over every slot written by a frame numbered below completedFrames.
+    void collect( uint64_t completedFrames );
+
+    bool acquire( ReadbackFrame &frame );
+    void release( const ReadbackFrame &frame );
+
+    uint64_t getDroppedFrameCount() const { return m_DroppedFrames; }
+
+private:
+    enum class SlotState
+    {
+        Free,
+        Pending,
+        Ready,
+        Acquired
+    };
+
+    struct Slot
+    {
+        VkBuffer       buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize   size = 0;
+        void          *mapped = nullptr;
+        bool           coherent = true;
+        SlotState      state = SlotState::Free;
+        ReadbackFrame  frame;
+    };
+
+    void allocateSlot( Slot &slot, VkDeviceSize size );
+    void destroySlot( Slot &slot );
+
+private:
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice         m_Device = VK_NULL_HANDLE;
+
+    std::mutex            m_Mutex;
+    std::vector<Slot>     m_Slots;
+    std::deque<uint32_t>  m_Pending;
+    std::deque<uint32_t>  m_Ready;
+    uint32_t              m_NextSlot = 0;
+    uint64_t              m_DroppedFrames = 0;
+
+    Callback m_Callback;
+};
@@ -0,0 +1,641 @@
+#include "HiZCuller.h"
+#include "AssetArchive.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+constexpr uint32_t kCullWorkgroupSize = 64;
+constexpr uint32_t kDownsampleWorkgroupSize = 8;
+
+void bufferBarrier( VkCommandBuffer commandBuffer,
+                    VkPipelineStageFlags srcStage,
+                    VkAccessFlags srcAccess,
+                    VkPipelineStageFlags dstStage,
+                    VkAccessFlags dstAccess )
+{
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier( commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr );
+}
+
+uint32_t previousPowerOfTwo( uint32_t value )
+{
+    return std::bit_floor( std::max( value, 1u ) );
+}
+} // namespace
+
+bool HiZCuller::isSupported( VkPhysicalDevice physicalDevice )
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties( physicalDevice, &properties );
+    if ( properties.apiVersion >= VK_API_VERSION_1_2 )
+    {
+        VkPhysicalDeviceVulkan12Features features12{};
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &features12;
+        vkGetPhysicalDeviceFeatures2( physicalDevice, &features2 );
+        return features12.drawIndirectCount == VK_TRUE;
+    }
+    return hasDeviceExtension( physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME );
+}
+
+void HiZCuller::create( const HiZCullerCreateInfo &createInfo )
+{
+    // A 1.2 device hands out vkCmdDrawIndexedIndirectCount whether or not the feature
+    // was enabled, so the pointer alone proves nothing.
+    if ( !createInfo.drawIndirectCount )
+    {
+        throw std::runtime_error( "Occlusion culling needs a device created with drawIndirectCount." );
+    }
+
+    m_PhysicalDevice = createInfo.physicalDevice;
+    m_Device = createInfo.device;
+    m_MaxObjects = createInfo.maxObjects;
+    m_Frames.resize( createInfo.framesInFlight );
+
+    m_CmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(
+        vkGetDeviceProcAddr( m_Device, "vkCmdDrawIndexedIndirectCount" ) );
+    if ( !m_CmdDrawIndexedIndirectCount )
+    {
+        m_CmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(
+            vkGetDeviceProcAddr( m_Device, "vkCmdDrawIndexedIndirectCountKHR" ) );
+    }
+    if ( !m_CmdDrawIndexedIndirectCount )
+    {
+        throw std::runtime_error( "Occlusion culling needs vkCmdDrawIndexedIndirectCount." );
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if ( vkCreateSampler( m_Device, &samplerInfo, nullptr, &m_Sampler ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create the depth pyramid sampler." );
+    }
+
+    createBuffers();
+    createDescriptors();
+    createPipelines( createInfo );
+    createPyramid( createInfo.depthExtent );
+}
+
+void HiZCuller::cleanup()
+{
+    if ( m_Device == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    cleanupPyramid();
+
+    vkDestroyPipeline( m_Device, m_CullPipeline, nullptr );
+    vkDestroyPipeline( m_Device, m_DownsamplePipeline, nullptr );
+    vkDestroyPipelineLayout( m_Device, m_CullLayout, nullptr );
+    vkDestroyPipelineLayout( m_Device, m_DownsampleLayout, nullptr );
+    vkDestroyDescriptorPool( m_Device, m_DescriptorPool, nullptr );
+    vkDestroyDescriptorSetLayout( m_Device, m_CullSetLayout, nullptr );
+    vkDestroyDescriptorSetLayout( m_Device, m_DownsampleSetLayout, nullptr );
+    vkDestroySampler( m_Device, m_Sampler, nullptr );
+
+    for ( FrameResources &frame : m_Frames )
+    {
+        vkDestroyBuffer( m_Device, frame.objectBuffer, nullptr );
+        vkFreeMemory( m_Device, frame.objectMemory, nullptr );
+        vkDestroyBuffer( m_Device, frame.statsBuffer, nullptr );
+        vkFreeMemory( m_Device, frame.statsMemory, nullptr );
+    }
+    m_Frames.clear();
+
+    vkDestroyBuffer( m_Device, m_VisibilityBuffer, nullptr );
+    vkFreeMemory( m_Device, m_VisibilityMemory, nullptr );
+    vkDestroyBuffer( m_Device, m_DrawBuffer, nullptr );
+    vkFreeMemory( m_Device, m_DrawMemory, nullptr );
+    vkDestroyBuffer( m_Device, m_CountBuffer, nullptr );
+    vkFreeMemory( m_Device, m_CountMemory, nullptr );
+
+    m_Device = VK_NULL_HANDLE;
+}
+
+void HiZCuller::resize( VkExtent2D depthExtent )
+{
+    cleanupPyramid();
+    createPyramid( depthExtent );
+    // The history was judged against the old depth buffer.
+    m_ResetVisibility = true;
+}
+
+void HiZCuller::setObjects( uint32_t frameIndex, std::span<const CullObject> objects )
+{
+    FrameResources &frame = m_Frames[frameIndex];
+    frame.objectCount = static_cast<uint32_t>( std::min<size_t>( objects.size(), m_MaxObjects ) );
+    memcpy( frame.objectsMapped, objects.data(), frame.objectCount * sizeof( CullObject ) );
+}
+
+void HiZCuller::collect( uint32_t frameIndex )
+{
+    FrameResources &frame = m_Frames[frameIndex];
+    if ( frame.statsPending )
+    {
+        uint32_t counts[2];
+        memcpy( counts, frame.statsMapped, sizeof( counts ) );
+        m_CollectedObjects = frame.objectCount;
+        m_CollectedDraws = counts[0] + counts[1];
+        frame.statsPending = false;
+    }
+}
+
+void HiZCuller::recordCull( VkCommandBuffer commandBuffer,
+                            uint32_t frameIndex,
+                            Phase phase,
+                            const float viewProjection[16] )
+{
+    FrameResources &frame = m_Frames[frameIndex];
+
+    if ( phase == Phase::Early )
+    {
+        // Last frame's draws, late phase and stats copy are done with the buffers reset
+        // here.
+        bufferBarrier( commandBuffer,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                           VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_SHADER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT );
+        if ( m_ResetVisibility )
+        {
+            // Without a history everything counts as visible, which draws the whole
+            // frustum in phase one once.
+            vkCmdFillBuffer( commandBuffer, m_VisibilityBuffer, 0, VK_WHOLE_SIZE, 1 );
+            m_ResetVisibility = false;
+        }
+        vkCmdFillBuffer( commandBuffer, m_CountBuffer, 0, VK_WHOLE_SIZE, 0 );
+        bufferBarrier( commandBuffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_TRANSFER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT );
+    }
+    else
+    {
+        // The early phase read the visibility flags this one overwrites.
+        bufferBarrier( commandBuffer,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT );
+    }
+
+    CullPushConstants push{};
+    memcpy( push.viewProjection, viewProjection, sizeof( push.viewProjection ) );
+    push.pyramidWidth = m_PyramidExtent.width;
+    push.pyramidHeight = m_PyramidExtent.height;
+    push.pyramidLevels = m_PyramidLevels;
+    push.objectCount = frame.objectCount;
+    push.maxObjects = m_MaxObjects;
+    push.phase = static_cast<uint32_t>( phase );
+
+    vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipeline );
+    vkCmdBindDescriptorSets( commandBuffer,
+                             VK_PIPELINE_BIND_POINT_COMPUTE,
+                             m_CullLayout,
+                             0, 1, &frame.cullSet, 0, nullptr );
+    vkCmdPushConstants( commandBuffer, m_CullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( push ), &push );
+    vkCmdDispatch( commandBuffer, ( frame.objectCount + kCullWorkgroupSize - 1 ) / kCullWorkgroupSize, 1, 1 );
+
+    bufferBarrier( commandBuffer,
+                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                   VK_ACCESS_SHADER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                   VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT );
+
+    if ( phase == Phase::Late )
+    {
+        VkBufferCopy copyRegion{};
+        copyRegion.size = 2 * sizeof( uint32_t );
+        vkCmdCopyBuffer( commandBuffer, m_CountBuffer, frame.statsBuffer, 1, &copyRegion );
+        bufferBarrier( commandBuffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_TRANSFER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT,
+                       VK_ACCESS_HOST_READ_BIT );
+        frame.statsPending = true;
+    }
+}
+
+void HiZCuller::recordBuildPyramid( VkCommandBuffer commandBuffer,
+                                    uint32_t frameIndex,
+                                    VkImageView depthView,
+                                    VkImageLayout depthLayout )
+{
+    FrameResources &frame = m_Frames[frameIndex];
+    if ( frame.depthView != depthView )
+    {
+        // The slot's last use has retired, so its set can be rewritten.
+        VkDescriptorImageInfo imageInfo{ m_Sampler, depthView, depthLayout };
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = frame.depthSet;
+        write.dstBinding = 0;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.descriptorCount = 1;
+        write.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets( m_Device, 1, &write, 0, nullptr );
+        frame.depthView = depthView;
+    }
+
+    // Every level is rewritten; last frame's late phase is the only earlier reader.
+    recordImageBarrier( commandBuffer,
+                        m_Pyramid,
+                        VK_IMAGE_LAYOUT_UNDEFINED,
+                        VK_IMAGE_LAYOUT_GENERAL,
+                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                        0,
+                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                        VK_ACCESS_SHADER_WRITE_BIT,
+                        0,
+                        m_PyramidLevels );
+
+    vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_DownsamplePipeline );
+    VkExtent2D srcExtent = m_DepthExtent;
+    for ( uint32_t level = 0; level < m_PyramidLevels; ++level )
+    {
+        VkExtent2D dstExtent = { std::max( m_PyramidExtent.width >> level, 1u ),
+                                 std::max( m_PyramidExtent.height >> level, 1u ) };
+        VkDescriptorSet set = level == 0 ? frame.depthSet : m_LevelSets[level];
+        DownsamplePushConstants push{ srcExtent.width, srcExtent.height, dstExtent.width, dstExtent.height };
+
+        vkCmdBindDescriptorSets( commandBuffer,
+                                 VK_PIPELINE_BIND_POINT_COMPUTE,
+                                 m_DownsampleLayout,
+                                 0, 1, &set, 0, nullptr );
+        vkCmdPushConstants( commandBuffer, m_DownsampleLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( push ), &push );
+        vkCmdDispatch( commandBuffer,
+                       ( dstExtent.width + kDownsampleWorkgroupSize - 1 ) / kDownsampleWorkgroupSize,
+                       ( dstExtent.height + kDownsampleWorkgroupSize - 1 ) / kDownsampleWorkgroupSize,
+                       1 );
+
+        recordImageBarrier( commandBuffer,
+                            m_Pyramid,
+                            VK_IMAGE_LAYOUT_GENERAL,
+                            VK_IMAGE_LAYOUT_GENERAL,
+                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                            VK_ACCESS_SHADER_WRITE_BIT,
+                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                            VK_ACCESS_SHADER_READ_BIT,
+                            level );
+        srcExtent = dstExtent;
+    }
+}
+
+void HiZCuller::recordDraw( VkCommandBuffer commandBuffer, Phase phase ) const
+{
+    uint32_t index = static_cast<uint32_t>( phase );
+    m_CmdDrawIndexedIndirectCount( commandBuffer,
+                                   m_DrawBuffer,
+                                   index * m_MaxObjects * sizeof( VkDrawIndexedIndirectCommand ),
+                                   m_CountBuffer,
+                                   index * sizeof( uint32_t ),
+                                   m_MaxObjects,
+                                   sizeof( VkDrawIndexedIndirectCommand ) );
+}
+
+void HiZCuller::createBuffers()
+{
+    for ( FrameResources &frame : m_Frames )
+    {
+        createBuffer( m_PhysicalDevice,
+                      m_Device,
+                      sizeof( CullObject ) * static_cast<VkDeviceSize>( m_MaxObjects ),
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      frame.objectBuffer,
+                      frame.objectMemory );
+        vkMapMemory( m_Device, frame.objectMemory, 0, VK_WHOLE_SIZE, 0, &frame.objectsMapped );
+
+        createBuffer( m_PhysicalDevice,
+                      m_Device,
+                      2 * sizeof( uint32_t ),
+                      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      frame.statsBuffer,
+                      frame.statsMemory );
+        vkMapMemory( m_Device, frame.statsMemory, 0, VK_WHOLE_SIZE, 0, &frame.statsMapped );
+    }
+
+    createBuffer( m_PhysicalDevice,
+                  m_Device,
+                  sizeof( uint32_t ) * static_cast<VkDeviceSize>( m_MaxObjects ),
+                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                  m_VisibilityBuffer,
+                  m_VisibilityMemory );
+    createBuffer( m_PhysicalDevice,
+                  m_Device,
+                  2 * sizeof( VkDrawIndexedIndirectCommand ) * static_cast<VkDeviceSize>( m_MaxObjects ),
+                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                  m_DrawBuffer,
+                  m_DrawMemory );
+    createBuffer( m_PhysicalDevice,
+                  m_Device,
+                  2 * sizeof( uint32_t ),
+                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                  m_CountBuffer,
+                  m_CountMemory );
+}
+
+void HiZCuller::createDescriptors()
+{
+    // Objects, visibility, draws, counts and the pyramid.
+    std::array<VkDescriptorSetLayoutBinding, 5> cullBindings{};
+    for ( uint32_t i = 0; i < cullBindings.size(); ++i )
+    {
+        cullBindings[i].binding = i;
+        cullBindings[i].descriptorType = i == 4 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+                                                : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        cullBindings[i].descriptorCount = 1;
+        cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>( cullBindings.size() );
+    layoutInfo.pBindings = cullBindings.data();
+    if ( vkCreateDescriptorSetLayout( m_Device, &layoutInfo, nullptr, &m_CullSetLayout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create the culling descriptor set layout." );
+    }
+
+    // The level read from and the level written.
+    std::array<VkDescriptorSetLayoutBinding, 2> downsampleBindings{};
+    for ( uint32_t i = 0; i < downsampleBindings.size(); ++i )
+    {
+        downsampleBindings[i].binding = i;
+        downsampleBindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+                                                      : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        downsampleBindings[i].descriptorCount = 1;
+        downsampleBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    layoutInfo.bindingCount = static_cast<uint32_t>( downsampleBindings.size() );
+    layoutInfo.pBindings = downsampleBindings.data();
+    if ( vkCreateDescriptorSetLayout( m_Device, &layoutInfo, nullptr, &m_DownsampleSetLayout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create the depth pyramid descriptor set layout." );
+    }
+
+    uint32_t frameCount = static_cast<uint32_t>( m_Frames.size() );
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = 4 * frameCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount = frameCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>( poolSizes.size() );
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = frameCount;
+    if ( vkCreateDescriptorPool( m_Device, &poolInfo, nullptr, &m_DescriptorPool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create the culling descriptor pool." );
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts( frameCount, m_CullSetLayout );
+    std::vector<VkDescriptorSet>       sets( frameCount );
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = frameCount;
+    allocInfo.pSetLayouts = layouts.data();
+    if ( vkAllocateDescriptorSets( m_Device, &allocInfo, sets.data() ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to allocate the culling descriptor sets." );
+    }
+
+    for ( uint32_t i = 0; i < frameCount; ++i )
+    {
+        m_Frames[i].cullSet = sets[i];
+
+        VkDescriptorBufferInfo bufferInfos[4] = {
+            { m_Frames[i].objectBuffer, 0, VK_WHOLE_SIZE },
+            { m_VisibilityBuffer, 0, VK_WHOLE_SIZE },
+            { m_DrawBuffer, 0, VK_WHOLE_SIZE },
+            { m_CountBuffer, 0, VK_WHOLE_SIZE },
+        };
+
+        // The pyramid is written with it, in writePyramidDescriptors().
+        std::array<VkWriteDescriptorSet, 4> writes{};
+        for ( uint32_t binding = 0; binding < writes.size(); ++binding )
+        {
+            writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[binding].dstSet = sets[i];
+            writes[binding].dstBinding = binding;
+            writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[binding].descriptorCount = 1;
+            writes[binding].pBufferInfo = &bufferInfos[binding];
+        }
+        vkUpdateDescriptorSets( m_Device, static_cast<uint32_t>( writes.size() ), writes.data(), 0, nullptr );
+    }
+}
+
+void HiZCuller::createPipelines( const HiZCullerCreateInfo &createInfo )
+{
+    auto createLayout = [this]( VkDescriptorSetLayout setLayout, uint32_t pushConstantSize ) {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = pushConstantSize;
+
+        VkPipelineLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.setLayoutCount = 1;
+        layoutInfo.pSetLayouts = &setLayout;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        VkPipelineLayout layout;
+        if ( vkCreatePipelineLayout( m_Device, &layoutInfo, nullptr, &layout ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create an occlusion culling pipeline layout." );
+        }
+        return layout;
+    };
+    m_CullLayout = createLayout( m_CullSetLayout, sizeof( CullPushConstants ) );
+    m_DownsampleLayout = createLayout( m_DownsampleSetLayout, sizeof( DownsamplePushConstants ) );
+
+    auto createPipeline = [this, &createInfo]( const char *path, VkPipelineLayout layout ) {
+        VkShaderModule shaderModule = loadShaderModule( createInfo, path );
+        VkPipeline pipeline = createComputePipeline( m_Device, shaderModule, layout );
+        vkDestroyShaderModule( m_Device, shaderModule, nullptr );
+        return pipeline;
+    };
+    m_CullPipeline = createPipeline( "hiz_cull.spv", m_CullLayout );
+    m_DownsamplePipeline = createPipeline( "hiz_downsample.spv", m_DownsampleLayout );
+}
+
+void HiZCuller::createPyramid( VkExtent2D depthExtent )
+{
+    // Rounding down keeps every pyramid texel covering at most 3x3 depth texels, and
+    // each level after the first exactly 2x2 of the one before.
+    m_DepthExtent = depthExtent;
+    m_PyramidExtent = { previousPowerOfTwo( depthExtent.width ), previousPowerOfTwo( depthExtent.height ) };
+    m_PyramidLevels = std::bit_width( std::max( m_PyramidExtent.width, m_PyramidExtent.height ) );
+
+    createImage( m_PhysicalDevice,
+                 m_Device,
+                 m_PyramidExtent.width,
+                 m_PyramidExtent.height,
+                 m_PyramidLevels,
+                 VK_FORMAT_R32_SFLOAT,
+                 VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 m_Pyramid,
+                 m_PyramidMemory );
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_Pyramid;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.levelCount = m_PyramidLevels;
+    viewInfo.subresourceRange.layerCount = 1;
+    if ( vkCreateImageView( m_Device, &viewInfo, nullptr, &m_PyramidView ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create the depth pyramid view." );
+    }
+
+    m_LevelViews.resize( m_PyramidLevels );
+    viewInfo.subresourceRange.levelCount = 1;
+    for ( uint32_t level = 0; level < m_PyramidLevels; ++level )
+    {
+        viewInfo.subresourceRange.baseMipLevel = level;
+        if ( vkCreateImageView( m_Device, &viewInfo, nullptr, &m_LevelViews[level] ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create a depth pyramid level view." );
+        }
+    }
+
+    // One set per level after the first, plus one per frame reading the depth buffer.
+    uint32_t setCount = m_PyramidLevels - 1 + static_cast<uint32_t>( m_Frames.size() );
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = setCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = setCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>( poolSizes.size() );
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = setCount;
+    if ( vkCreateDescriptorPool( m_Device, &poolInfo, nullptr, &m_PyramidPool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create the depth pyramid descriptor pool." );
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts( setCount, m_DownsampleSetLayout );
+    std::vector<VkDescriptorSet>       sets( setCount );
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_PyramidPool;
+    allocInfo.descriptorSetCount = setCount;
+    allocInfo.pSetLayouts = layouts.data();
+    if ( vkAllocateDescriptorSets( m_Device, &allocInfo, sets.data() ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to allocate the depth pyramid descriptor sets." );
+    }
+
+    m_LevelSets.assign( m_PyramidLevels, VK_NULL_HANDLE );
+    for ( uint32_t level = 1; level < m_PyramidLevels; ++level )
+    {
+        m_LevelSets[level] = sets[level - 1];
+    }
+    for ( size_t i = 0; i < m_Frames.size(); ++i )
+    {
+        m_Frames[i].depthSet = sets[m_PyramidLevels - 1 + i];
+        m_Frames[i].depthView = VK_NULL_HANDLE;
+    }
+
+    writePyramidDescriptors();
+}
+
+void HiZCuller::writePyramidDescriptors()
+{
+    std::vector<VkDescriptorImageInfo> imageInfos;
+    std::vector<VkWriteDescriptorSet>  writes;
+    imageInfos.reserve( 2 * m_PyramidLevels + m_Frames.size() );
+
+    auto addWrite = [&]( VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkImageView view ) {
+        imageInfos.push_back( { m_Sampler, view, VK_IMAGE_LAYOUT_GENERAL } );
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = binding;
+        write.descriptorType = type;
+        write.descriptorCount = 1;
+        write.pImageInfo = &imageInfos.back();
+        writes.push_back( write );
+    };
+
+    for ( uint32_t level = 1; level < m_PyramidLevels; ++level )
+    {
+        addWrite( m_LevelSets[level], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_LevelViews[level - 1] );
+        addWrite( m_LevelSets[level], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_LevelViews[level] );
+    }
+    for ( FrameResources &frame : m_Frames )
+    {
+        // Binding 0 is the depth buffer, written once it is known.
+        addWrite( frame.depthSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_LevelViews[0] );
+        addWrite( frame.cullSet, 4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_PyramidView );
+    }
+
+    vkUpdateDescriptorSets( m_Device, static_cast<uint32_t>( writes.size() ), writes.data(), 0, nullptr );
+}
+
+void HiZCuller::cleanupPyramid()
+{
+    vkDestroyDescriptorPool( m_Device, m_PyramidPool, nullptr );
+    for ( VkImageView view : m_LevelViews )
+    {
+        vkDestroyImageView( m_Device, view, nullptr );
+    }
+    m_LevelViews.clear();
+    m_LevelSets.clear();
+    vkDestroyImageView( m_Device, m_PyramidView, nullptr );
+    vkDestroyImage( m_Device, m_Pyramid, nullptr );
+    vkFreeMemory( m_Device, m_PyramidMemory, nullptr );
+
+    m_PyramidPool = VK_NULL_HANDLE;
+    m_PyramidView = VK_NULL_HANDLE;
+    m_Pyramid = VK_NULL_HANDLE;
+    m_PyramidMemory = VK_NULL_HANDLE;
+}
+
+VkShaderModule HiZCuller::loadShaderModule( const HiZCullerCreateInfo &createInfo, const std::string &name ) const
+{
+    if ( createInfo.assets )
+    {
+        return createShaderModule( m_Device, createInfo.assets->load( name ).getData() );
+    }
+    return createShaderModule( m_Device, readFile( name ) );
+}
@@ -0,0 +1,188 @@
+#pragma once
+// Hierarchical-Z occlusion culling on the GPU.
+//
+// Every object has a world space bounding box and one indexed draw. Culling runs in
+// two phases per frame, both in compute, both appending the surviving draws to an
+// indirect buffer drawn with vkCmdDrawIndexedIndirectCount:
+//
+//   1. recordCull( Phase::Early ) keeps the objects that were visible last frame and
+//      are inside the frustum; draw them.
+//   2. recordBuildPyramid() reduces the depth those draws produced into a pyramid of
+//      the farthest depth per texel, halving the size each level.
+//   3. recordCull( Phase::Late ) tests every object against the frustum and the
+//      pyramid, remembers the result for the next frame and keeps the objects that
+//      are visible now but weren't drawn in phase one - the ones that just came out
+//      from behind something; draw them on top.
+//
+// So the occluders are the previous frame's visible set, drawn at this frame's camera,
+// and nothing visible is ever missing for a frame. An object's box is projected to the
+// screen and compared with the pyramid level where it covers at most 2x2 texels, which
+// costs four fetches per object whatever its size.
+//
+// Depth is expected in the usual 0 (near) to 1 (far) range. The device must have been
+// created with drawIndirectCount (Vulkan 1.2 or VK_KHR_draw_indirect_count).
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+class AssetArchive;
+
+// Layout must match HiZCull.comp.
+struct CullObject
+{
+    float    center[3];
+    uint32_t indexCount;
+    float    extents[3]; // half size of the box along each axis
+    uint32_t firstIndex;
+    int32_t  vertexOffset;
+    uint32_t padding[3];
+};
+
+struct HiZCullerCreateInfo
+{
+    VkPhysicalDevice    physicalDevice = VK_NULL_HANDLE;
+    VkDevice            device = VK_NULL_HANDLE;
+    uint32_t            framesInFlight = 0;
+    uint32_t            maxObjects = 0;
+    // Size of the depth buffer the pyramid is built from.
+    VkExtent2D          depthExtent{};
+    // The device was created with VkPhysicalDeviceVulkan12Features::drawIndirectCount
+    // or with VK_KHR_draw_indirect_count. Being supported isn't enough.
+    bool                drawIndirectCount = false;
+    // Shaders are loaded from here when set, otherwise from the working directory.
+    const AssetArchive *assets = nullptr;
+};
+
+class HiZCuller
+{
+public:
+    enum class Phase : uint32_t
+    {
+        Early = 0,
+        Late = 1,
+    };
+
+    // Whether the device can draw from a GPU written count, i.e. whether
+    // drawIndirectCount can be enabled when creating it.
+    static bool isSupported( VkPhysicalDevice physicalDevice );
+
+    // Throws std::runtime_error unless createInfo.drawIndirectCount is set.
+    void create( const HiZCullerCreateInfo &createInfo );
+    void cleanup();
+    // With the swap chain: the device must be idle. Every object counts as visible
+    // again for the next frame.
+    void resize( VkExtent2D depthExtent );
+
+    bool isEnabled() const { return m_Device != VK_NULL_HANDLE; }
+
+    // Replaces the frame slot's object list; call after its fence was waited on. The
+    // draw of object i gets firstInstance i, for looking up per object data.
+    void setObjects( uint32_t frameIndex, std::span<const CullObject> objects );
+    // Reads back how many draws the slot's last culling kept.
+    void collect( uint32_t frameIndex );
+
+    // Both phases are recorded outside of a render pass.
+    void recordCull( VkCommandBuffer commandBuffer, uint32_t frameIndex, Phase phase, const float viewProjection[16] );
+    // depthView must be sampleable and in depthLayout; its writes must be visible to
+    // compute shader reads.
+    void recordBuildPyramid( VkCommandBuffer commandBuffer,
+                             uint32_t frameIndex,
+                             VkImageView depthView,
+                             VkImageLayout depthLayout );
+    // Recorded inside the render pass, with the pipeline and index buffer bound.
+    void recordDraw( VkCommandBuffer commandBuffer, Phase phase ) const;
+
+    // Of the last collected frame.
+    uint32_t getObjectCount() const { return m_CollectedObjects; }
+    uint32_t getDrawnCount() const { return m_CollectedDraws; }
+
+private:
+    struct CullPushConstants
+    {
+        float    viewProjection[16];
+        uint32_t pyramidWidth;
+        uint32_t pyramidHeight;
+        uint32_t pyramidLevels;
+        uint32_t objectCount;
+        uint32_t maxObjects;
+        uint32_t phase;
+    };
+
+    struct DownsamplePushConstants
+    {
+        uint32_t srcWidth;
+        uint32_t srcHeight;
+        uint32_t dstWidth;
+        uint32_t dstHeight;
+    };
+
+    struct FrameResources
+    {
+        VkBuffer        objectBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory  objectMemory = VK_NULL_HANDLE;
+        void           *objectsMapped = nullptr;
+        uint32_t        objectCount = 0;
+        VkBuffer        statsBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory  statsMemory = VK_NULL_HANDLE;
+        void           *statsMapped = nullptr;
+        bool            statsPending = false;
+        VkDescriptorSet cullSet = VK_NULL_HANDLE;
+        // Reads the depth buffer into pyramid level 0.
+        VkDescriptorSet depthSet = VK_NULL_HANDLE;
+        VkImageView     depthView = VK_NULL_HANDLE;
+    };
+
+    void createBuffers();
+    void createDescriptors();
+    void createPipelines( const HiZCullerCreateInfo &createInfo );
+    void createPyramid( VkExtent2D depthExtent );
+    void cleanupPyramid();
+    void writePyramidDescriptors();
+    VkShaderModule loadShaderModule( const HiZCullerCreateInfo &createInfo, const std::string &name ) const;
+
+private:
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice         m_Device = VK_NULL_HANDLE;
+    uint32_t         m_MaxObjects = 0;
+    PFN_vkCmdDrawIndexedIndirectCount m_CmdDrawIndexedIndirectCount = nullptr;
+
+    std::vector<FrameResources> m_Frames;
+
+    // Whether each object was visible last frame, written by the late phase.
+    VkBuffer       m_VisibilityBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_VisibilityMemory = VK_NULL_HANDLE;
+    bool           m_ResetVisibility = true;
+    // maxObjects draw commands per phase, and one count per phase.
+    VkBuffer       m_DrawBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_DrawMemory = VK_NULL_HANDLE;
+    VkBuffer       m_CountBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_CountMemory = VK_NULL_HANDLE;
+
+    VkExtent2D               m_DepthExtent{};
+    // R32_SFLOAT, power of two sized, levels down to 1x1. Always in GENERAL.
+    VkImage                  m_Pyramid = VK_NULL_HANDLE;
+    VkDeviceMemory           m_PyramidMemory = VK_NULL_HANDLE;
+    VkExtent2D               m_PyramidExtent{};
+    uint32_t                 m_PyramidLevels = 0;
+    VkImageView              m_PyramidView = VK_NULL_HANDLE;
+    std::vector<VkImageView> m_LevelViews;
+    // m_LevelSets[i] reads level i - 1 into level i; entry 0 is unused.
+    std::vector<VkDescriptorSet> m_LevelSets;
+    VkSampler                m_Sampler = VK_NULL_HANDLE;
+
+    VkDescriptorSetLayout m_CullSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_DownsampleSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool      m_DescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorPool      m_PyramidPool = VK_NULL_HANDLE;
+    VkPipelineLayout      m_CullLayout = VK_NULL_HANDLE;
+    VkPipelineLayout      m_DownsampleLayout = VK_NULL_HANDLE;
+    VkPipeline            m_CullPipeline = VK_NULL_HANDLE;
+    VkPipeline            m_DownsamplePipeline = VK_NULL_HANDLE;
+
+    uint32_t m_CollectedObjects = 0;
+    uint32_t m_CollectedDraws = 0;
+};
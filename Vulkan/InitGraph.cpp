@@ -0,0 +1,184 @@
+#include "InitGraph.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+InitGraph::Stage InitGraph::add( const char *name,
+                                 std::function<void()> work,
+                                 std::initializer_list<Stage> dependencies,
+                                 Affinity affinity )
+{
+    Stage stage = static_cast<Stage>( m_Nodes.size() );
+    for ( Stage dependency : dependencies )
+    {
+        if ( dependency >= stage )
+        {
+            throw std::runtime_error( std::string( "Init stage " ) + name + " depends on a stage added after it." );
+        }
+        m_Nodes[dependency].dependents.push_back( stage );
+    }
+
+    m_Nodes.push_back( { name, std::move( work ), {}, static_cast<uint32_t>( dependencies.size() ), affinity } );
+    return stage;
+}
+
+void InitGraph::run( uint32_t workerCount )
+{
+    std::mutex              mutex;
+    std::condition_variable wake;
+    std::deque<Stage>       ready;
+    std::deque<Stage>       readyOnMain;
+    std::vector<uint32_t>   remaining( m_Nodes.size() );
+    size_t                  running = 0;
+    size_t                  finished = 0;
+    std::exception_ptr      failure;
+
+    m_Timings.assign( m_Nodes.size(), {} );
+    auto enqueue = [&]( Stage stage ) {
+        ( m_Nodes[stage].affinity == Affinity::MainThread ? readyOnMain : ready ).push_back( stage );
+    };
+    for ( Stage stage = 0; stage < m_Nodes.size(); ++stage )
+    {
+        remaining[stage] = m_Nodes[stage].dependencyCount;
+        if ( remaining[stage] == 0 )
+        {
+            enqueue( stage );
+        }
+    }
+
+    const double startUs = CpuTimeline::nowUs();
+
+    auto isDone = [&]() {
+        return failure ? running == 0 : finished == m_Nodes.size();
+    };
+
+    // Called and returns with the lock held.
+    auto execute = [&]( Stage stage, std::unique_lock<std::mutex> &lock ) {
+        Node &node = m_Nodes[stage];
+        ++running;
+        lock.unlock();
+
+        std::exception_ptr error;
+        double beginUs = CpuTimeline::nowUs();
+        try
+        {
+            node.work();
+        }
+        catch ( ... )
+        {
+            error = std::current_exception();
+        }
+        double endUs = CpuTimeline::nowUs();
+        CpuTimeline::record( node.name, beginUs, endUs );
+
+        lock.lock();
+        --running;
+        ++finished;
+        m_Timings[stage] = { node.name,
+                             ( beginUs - startUs ) / 1000.0,
+                             ( endUs - beginUs ) / 1000.0,
+                             node.affinity == Affinity::MainThread };
+        if ( error )
+        {
+            if ( !failure )
+            {
+                failure = error;
+            }
+        }
+        else
+        {
+            for ( Stage dependent : node.dependents )
+            {
+                if ( --remaining[dependent] == 0 )
+                {
+                    enqueue( dependent );
+                }
+            }
+        }
+        wake.notify_all();
+    };
+
+    std::vector<std::thread> workers;
+    for ( uint32_t i = 0; i < workerCount; ++i )
+    {
+        workers.emplace_back( [&]() {
+            CpuTimeline::setThreadName( "init worker" );
+
+            std::unique_lock<std::mutex> lock( mutex );
+            for ( ;; )
+            {
+                wake.wait( lock, [&]() { return isDone() || ( !failure && !ready.empty() ); } );
+                if ( isDone() )
+                {
+                    return;
+                }
+                Stage stage = ready.front();
+                ready.pop_front();
+                execute( stage, lock );
+            }
+        } );
+    }
+
+    {
+        // The calling thread prefers the stages only it may run, but helps out with
+        // the others rather than sitting idle.
+        std::unique_lock<std::mutex> lock( mutex );
+        for ( ;; )
+        {
+            wake.wait( lock, [&]() {
+                return isDone() || ( !failure && ( !readyOnMain.empty() || !ready.empty() ) );
+            } );
+            if ( isDone() )
+            {
+                break;
+            }
+            std::deque<Stage> &queue = readyOnMain.empty() ? ready : readyOnMain;
+            Stage stage = queue.front();
+            queue.pop_front();
+            execute( stage, lock );
+        }
+    }
+
+    for ( std::thread &worker : workers )
+    {
+        worker.join();
+    }
+    m_TotalMs = ( CpuTimeline::nowUs() - startUs ) / 1000.0;
+
+    if ( failure )
+    {
+        std::rethrow_exception( failure );
+    }
+}
+
+void InitGraph::printTimings( std::ostream &out ) const
+{
+    std::vector<StageTiming> timings = m_Timings;
+    std::sort( timings.begin(), timings.end(), []( const StageTiming &a, const StageTiming &b ) {
+        return a.startMs < b.startMs;
+    } );
+
+    double sequentialMs = 0.0;
+    out << "Startup stages:" << std::endl;
+    for ( const StageTiming &timing : timings )
+    {
+        if ( !timing.name )
+        {
+            continue;
+        }
+        sequentialMs += timing.durationMs;
+        out << "  " << std::left << std::setw( 20 ) << timing.name << std::right << std::fixed
+            << std::setprecision( 2 ) << " at " << std::setw( 8 ) << timing.startMs << " ms, took "
+            << std::setw( 8 ) << timing.durationMs << " ms" << ( timing.mainThread ? " (main thread)" : "" )
+            << std::endl;
+    }
+    out << "Ready after " << std::fixed << std::setprecision( 2 ) << m_TotalMs << " ms ("
+        << sequentialMs << " ms of stage time)" << std::endl;
+}
@@ -0,0 +1,67 @@
+#pragma once
+// Startup expressed as a dependency graph.
+//
+// Every stage names the stages it needs. run() starts a stage as soon as all of them
+// have finished, so independent work - file loading, pipeline compilation, buffer
+// uploads - overlaps instead of queueing behind each other. Stages touching GLFW
+// windows are marked as main thread stages and only ever run on the calling thread.
+//
+// Each stage is recorded on the CPU timeline and its timing is printed once the graph
+// is done, ending with the time to ready.
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <ostream>
+#include <vector>
+
+class InitGraph
+{
+public:
+    using Stage = uint32_t;
+
+    enum class Affinity
+    {
+        AnyThread,
+        MainThread,
+    };
+
+    struct StageTiming
+    {
+        const char *name = nullptr;
+        double      startMs = 0.0; // relative to run()
+        double      durationMs = 0.0;
+        bool        mainThread = false;
+    };
+
+    // name must be a string literal, as with CPU scopes. Dependencies have to be
+    // added before the stages depending on them, which also rules out cycles.
+    Stage add( const char *name,
+               std::function<void()> work,
+               std::initializer_list<Stage> dependencies = {},
+               Affinity affinity = Affinity::AnyThread );
+
+    // Runs every stage with up to workerCount threads besides the calling one. When a
+    // stage throws, nothing new is started; the first exception is rethrown once the
+    // stages already running have returned.
+    void run( uint32_t workerCount );
+
+    const std::vector<StageTiming> &getTimings() const { return m_Timings; }
+    double                          getTotalMs() const { return m_TotalMs; }
+    void                            printTimings( std::ostream &out ) const;
+
+private:
+    struct Node
+    {
+        const char           *name;
+        std::function<void()> work;
+        std::vector<Stage>    dependents;
+        uint32_t              dependencyCount;
+        Affinity              affinity;
+    };
+
+private:
+    std::vector<Node>        m_Nodes;
+    std::vector<StageTiming> m_Timings;
+    double                   m_TotalMs = 0.0;
+};
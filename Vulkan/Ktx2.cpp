@@ -0,0 +1,296 @@
+#include "Ktx2.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef VULKAN_WITH_BASISU
+#include <basisu_transcoder.h>
+
+#include <mutex>
+#endif
+
+namespace
+{
+const unsigned char kIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+enum SupercompressionScheme : uint32_t
+{
+    SupercompressionNone = 0,
+    SupercompressionBasisLZ = 1,
+};
+
+struct Header
+{
+    unsigned char identifier[12];
+    uint32_t      vkFormat;
+    uint32_t      typeSize;
+    uint32_t      pixelWidth;
+    uint32_t      pixelHeight;
+    uint32_t      pixelDepth;
+    uint32_t      layerCount;
+    uint32_t      faceCount;
+    uint32_t      levelCount;
+    uint32_t      supercompressionScheme;
+    uint32_t      dfdByteOffset;
+    uint32_t      dfdByteLength;
+    uint32_t      kvdByteOffset;
+    uint32_t      kvdByteLength;
+    uint64_t      sgdByteOffset;
+    uint64_t      sgdByteLength;
+};
+static_assert( sizeof( Header ) == 80, "KTX2 header layout" );
+
+struct LevelIndex
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+uint32_t getFullChainLength( uint32_t width, uint32_t height )
+{
+    uint32_t levels = 1;
+    while ( levels < 32 && ( std::max( width, height ) >> levels ) > 0 )
+    {
+        ++levels;
+    }
+    return levels;
+}
+
+// Texel block size and bytes of the formats a level's size can be checked for; false
+// for any other.
+bool getBlockLayout( VkFormat format, uint32_t &blockWidth, uint32_t &blockHeight, uint32_t &blockBytes )
+{
+    blockWidth = 1;
+    blockHeight = 1;
+    if ( isBlockCompressed( format ) )
+    {
+        blockWidth = 4;
+        blockHeight = 4;
+        if ( format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK )
+        {
+            // ASTC comes in UNORM and SRGB pairs, in this order.
+            static const uint32_t kAstcBlocks[][2] = { { 4, 4 },  { 5, 4 },  { 5, 5 },   { 6, 5 },   { 6, 6 },
+                                                       { 8, 5 },  { 8, 6 },  { 8, 8 },   { 10, 5 },  { 10, 6 },
+                                                       { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 } };
+            const uint32_t *block = kAstcBlocks[( format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK ) / 2];
+            blockWidth = block[0];
+            blockHeight = block[1];
+            blockBytes = 16;
+            return true;
+        }
+
+        bool halfBlock = ( format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC1_RGBA_SRGB_BLOCK ) ||
+                         format == VK_FORMAT_BC4_UNORM_BLOCK || format == VK_FORMAT_BC4_SNORM_BLOCK ||
+                         ( format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK ) ||
+                         format == VK_FORMAT_EAC_R11_UNORM_BLOCK || format == VK_FORMAT_EAC_R11_SNORM_BLOCK;
+        blockBytes = halfBlock ? 8 : 16;
+        return true;
+    }
+
+    switch ( format )
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SRGB:
+        blockBytes = 1;
+        return true;
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8_SRGB:
+    case VK_FORMAT_R16_UNORM:
+    case VK_FORMAT_R16_SFLOAT:
+    case VK_FORMAT_R5G6B5_UNORM_PACK16:
+        blockBytes = 2;
+        return true;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_R16G16_UNORM:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+    case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+        blockBytes = 4;
+        return true;
+    case VK_FORMAT_R16G16B16A16_UNORM:
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R32G32_SFLOAT:
+        blockBytes = 8;
+        return true;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        blockBytes = 16;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Every level must hold at least the texel blocks of its extent, since it's copied to
+// the image whole.
+void checkLevelSizes( const Ktx2Image &image )
+{
+    uint32_t blockWidth, blockHeight, blockBytes;
+    if ( !getBlockLayout( image.format, blockWidth, blockHeight, blockBytes ) )
+    {
+        throw std::runtime_error( "unsupported KTX2 format" );
+    }
+    if ( image.levels.size() > getFullChainLength( image.width, image.height ) )
+    {
+        throw std::runtime_error( "KTX2 file has more levels than its size allows" );
+    }
+
+    for ( uint32_t level = 0; level < image.levels.size(); ++level )
+    {
+        uint64_t width = std::max( image.width >> level, 1u );
+        uint64_t height = std::max( image.height >> level, 1u );
+        uint64_t blocks = ( ( width + blockWidth - 1 ) / blockWidth ) * ( ( height + blockHeight - 1 ) / blockHeight );
+        if ( blocks > image.levels[level].size() / blockBytes )
+        {
+            throw std::runtime_error( "truncated KTX2 level data" );
+        }
+    }
+}
+
+#ifdef VULKAN_WITH_BASISU
+basist::transcoder_texture_format toBasisFormat( VkFormat format )
+{
+    switch ( format )
+    {
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return basist::transcoder_texture_format::cTFBC7_RGBA;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        return basist::transcoder_texture_format::cTFBC3_RGBA;
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+        return basist::transcoder_texture_format::cTFASTC_4x4_RGBA;
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+        return basist::transcoder_texture_format::cTFETC2_RGBA;
+    default:
+        return basist::transcoder_texture_format::cTFRGBA32;
+    }
+}
+
+void transcodeBasis( const std::vector<char> &file, VkFormat transcodeFormat, Ktx2Image &image )
+{
+    static std::once_flag initialized;
+    std::call_once( initialized, []() { basist::basisu_transcoder_init(); } );
+
+    basist::ktx2_transcoder transcoder;
+    if ( !transcoder.init( file.data(), static_cast<uint32_t>( file.size() ) ) || !transcoder.start_transcoding() )
+    {
+        throw std::runtime_error( "invalid Basis Universal payload" );
+    }
+
+    basist::transcoder_texture_format basisFormat = toBasisFormat( transcodeFormat );
+    bool uncompressed = basist::basis_transcoder_format_is_uncompressed( basisFormat );
+    uint32_t bytesPerUnit = basist::basis_get_bytes_per_block_or_pixel( basisFormat );
+
+    image.format = uncompressed ? VK_FORMAT_R8G8B8A8_SRGB : transcodeFormat;
+    image.levels.resize( transcoder.get_levels() );
+    for ( uint32_t level = 0; level < image.levels.size(); ++level )
+    {
+        basist::ktx2_image_level_info info;
+        if ( !transcoder.get_image_level_info( info, level, 0, 0 ) )
+        {
+            throw std::runtime_error( "invalid Basis Universal level" );
+        }
+
+        uint32_t units = uncompressed ? info.m_orig_width * info.m_orig_height : info.m_total_blocks;
+        image.levels[level].resize( static_cast<size_t>( units ) * bytesPerUnit );
+        if ( !transcoder.transcode_image_level( level, 0, 0, image.levels[level].data(), units, basisFormat ) )
+        {
+            throw std::runtime_error( "failed to transcode Basis Universal level" );
+        }
+    }
+}
+#endif
+} // namespace
+
+Ktx2Image loadKtx2( const std::string &path, VkFormat transcodeFormat )
+{
+    std::vector<char> file = readFile( path );
+
+    Header header;
+    if ( file.size() < sizeof( Header ) )
+    {
+        throw std::runtime_error( "not a KTX2 file" );
+    }
+    memcpy( &header, file.data(), sizeof( Header ) );
+    if ( memcmp( header.identifier, kIdentifier, sizeof( kIdentifier ) ) != 0 )
+    {
+        throw std::runtime_error( "not a KTX2 file" );
+    }
+    if ( header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || header.pixelWidth == 0 ||
+         header.pixelHeight == 0 )
+    {
+        throw std::runtime_error( "only single 2D KTX2 images are supported" );
+    }
+
+    if ( header.levelCount > getFullChainLength( header.pixelWidth, header.pixelHeight ) )
+    {
+        throw std::runtime_error( "KTX2 file has more levels than its size allows" );
+    }
+
+    Ktx2Image image;
+    image.format = static_cast<VkFormat>( header.vkFormat );
+    image.width = header.pixelWidth;
+    image.height = header.pixelHeight;
+
+    if ( image.format == VK_FORMAT_UNDEFINED )
+    {
+#ifdef VULKAN_WITH_BASISU
+        transcodeBasis( file, transcodeFormat, image );
+        checkLevelSizes( image );
+        return image;
+#else
+        (void)transcodeFormat;
+        throw std::runtime_error( "Basis Universal textures need a build with VULKAN_WITH_BASISU" );
+#endif
+    }
+    if ( header.supercompressionScheme != SupercompressionNone )
+    {
+        throw std::runtime_error( "supercompressed KTX2 files are not supported" );
+    }
+
+    uint32_t levelCount = std::max( header.levelCount, 1u );
+    if ( file.size() < sizeof( Header ) + levelCount * sizeof( LevelIndex ) )
+    {
+        throw std::runtime_error( "truncated KTX2 level index" );
+    }
+
+    image.levels.resize( levelCount );
+    for ( uint32_t level = 0; level < levelCount; ++level )
+    {
+        LevelIndex index;
+        memcpy( &index, file.data() + sizeof( Header ) + level * sizeof( LevelIndex ), sizeof( LevelIndex ) );
+        if ( index.byteLength > file.size() || index.byteOffset > file.size() - index.byteLength )
+        {
+            throw std::runtime_error( "truncated KTX2 level data" );
+        }
+
+        const unsigned char *data = reinterpret_cast<const unsigned char *>( file.data() ) + index.byteOffset;
+        image.levels[level].assign( data, data + index.byteLength );
+    }
+    checkLevelSizes( image );
+
+    return image;
+}
+
+bool isKtx2File( const std::string &path )
+{
+    const std::string extension = ".ktx2";
+    return path.size() >= extension.size() &&
+           path.compare( path.size() - extension.size(), extension.size(), extension ) == 0;
+}
+
+bool isBlockCompressed( VkFormat format )
+{
+    // BC, ETC2/EAC and ASTC LDR are contiguous in the core format enum.
+    return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK;
+}
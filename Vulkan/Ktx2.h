@@ -0,0 +1,30 @@
+#pragma once
+// Minimal KTX2 reader for 2D textures: one layer, one face, any number of mip levels.
+//
+// Block-compressed payloads (BC1-7, ASTC, ETC2) and plain formats are returned as
+// stored. Basis Universal payloads (ETC1S and UASTC, stored with VK_FORMAT_UNDEFINED)
+// are transcoded to the format the caller asks for; that needs the Basis Universal
+// transcoder and VULKAN_WITH_BASISU defined, otherwise loading them throws.
+// Zstandard and zlib supercompression aren't supported.
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Ktx2Image
+{
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Largest level first.
+    std::vector<std::vector<unsigned char>> levels;
+};
+
+// Throws std::runtime_error when the file can't be read or isn't supported.
+// transcodeFormat is only used for Basis Universal files.
+Ktx2Image loadKtx2( const std::string &path, VkFormat transcodeFormat );
+
+bool isKtx2File( const std::string &path );
+bool isBlockCompressed( VkFormat format );
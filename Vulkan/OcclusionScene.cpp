@@ -0,0 +1,595 @@
+#include "OcclusionScene.h"
+#include "AssetArchive.h"
+#include "VulkanUtils.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+constexpr VkFormat kDepthFormat = VK_FORMAT_D32_SFLOAT;
+
+// The cube's corners are numbered by the bits of their coordinates, x lowest; the
+// vertex shader derives them from the index.
+const std::array<uint16_t, 36> kCubeIndices = {
+    0, 2, 6, 0, 6, 4, // -x
+    1, 5, 7, 1, 7, 3, // +x
+    0, 4, 5, 0, 5, 1, // -y
+    2, 3, 7, 2, 7, 6, // +y
+    0, 1, 3, 0, 3, 2, // -z
+    4, 6, 7, 4, 7, 5, // +z
+};
+
+// A fixed sequence, so every run builds the same city.
+float nextRandom( uint32_t &state )
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return ( state >> 8 ) / 16777216.0f;
+}
+} // namespace
+
+void OcclusionScene::create( const OcclusionSceneCreateInfo &createInfo )
+{
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties( createInfo.physicalDevice, kDepthFormat, &formatProperties );
+    const VkFormatFeatureFlags depthFeatures =
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    if ( ( formatProperties.optimalTilingFeatures & depthFeatures ) != depthFeatures )
+    {
+        throw std::runtime_error( "Occlusion culling needs a sampleable D32_SFLOAT depth buffer." );
+    }
+
+    m_PhysicalDevice = createInfo.physicalDevice;
+    m_Device = createInfo.device;
+    createCity( createInfo.gridSize );
+
+    m_CullerInfo.physicalDevice = m_PhysicalDevice;
+    m_CullerInfo.device = m_Device;
+    m_CullerInfo.framesInFlight = createInfo.framesInFlight;
+    m_CullerInfo.maxObjects = static_cast<uint32_t>( m_Objects.size() );
+    m_CullerInfo.drawIndirectCount = createInfo.drawIndirectCount;
+    m_CullerInfo.assets = createInfo.assets;
+
+    createRenderPasses( createInfo );
+    createDescriptors();
+    createPipeline( createInfo );
+}
+
+void OcclusionScene::cleanup()
+{
+    if ( m_Device == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    cleanupTargets();
+    m_Culler.cleanup();
+
+    vkDestroyPipeline( m_Device, m_Pipeline, nullptr );
+    vkDestroyPipelineLayout( m_Device, m_PipelineLayout, nullptr );
+    vkDestroyDescriptorPool( m_Device, m_DescriptorPool, nullptr );
+    vkDestroyDescriptorSetLayout( m_Device, m_SetLayout, nullptr );
+    vkDestroyRenderPass( m_Device, m_EarlyPass, nullptr );
+    vkDestroyRenderPass( m_Device, m_LatePass, nullptr );
+
+    vkDestroyBuffer( m_Device, m_ObjectBuffer, nullptr );
+    vkFreeMemory( m_Device, m_ObjectMemory, nullptr );
+    vkDestroyBuffer( m_Device, m_IndexBuffer, nullptr );
+    vkFreeMemory( m_Device, m_IndexMemory, nullptr );
+
+    m_Objects.clear();
+    m_Device = VK_NULL_HANDLE;
+}
+
+void OcclusionScene::createTargets( const std::vector<VkImageView> &imageViews, VkExtent2D extent )
+{
+    m_Extent = extent;
+
+    createImage( m_PhysicalDevice,
+                 m_Device,
+                 extent.width,
+                 extent.height,
+                 1,
+                 kDepthFormat,
+                 VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 m_DepthImage,
+                 m_DepthMemory );
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_DepthImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = kDepthFormat;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = 1;
+    if ( vkCreateImageView( m_Device, &viewInfo, nullptr, &m_DepthView ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create the occlusion scene's depth view!" );
+    }
+
+    // Both passes have the same attachments, so one framebuffer serves them.
+    m_Framebuffers.resize( imageViews.size(), VK_NULL_HANDLE );
+    for ( size_t i = 0; i < imageViews.size(); ++i )
+    {
+        std::array<VkImageView, 2> attachments = { imageViews[i], m_DepthView };
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = m_EarlyPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>( attachments.size() );
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
+        framebufferInfo.layers = 1;
+
+        if ( vkCreateFramebuffer( m_Device, &framebufferInfo, nullptr, &m_Framebuffers[i] ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create the occlusion scene's framebuffer!" );
+        }
+    }
+
+    if ( m_Culler.isEnabled() )
+    {
+        // Also drops the culler's descriptors of the old depth view.
+        m_Culler.resize( extent );
+        return;
+    }
+    m_CullerInfo.depthExtent = extent;
+    m_Culler.create( m_CullerInfo );
+    // The city never changes, so every frame slot keeps its first list.
+    for ( uint32_t i = 0; i < m_CullerInfo.framesInFlight; ++i )
+    {
+        m_Culler.setObjects( i, m_Objects );
+    }
+}
+
+void OcclusionScene::cleanupTargets()
+{
+    for ( VkFramebuffer framebuffer : m_Framebuffers )
+    {
+        vkDestroyFramebuffer( m_Device, framebuffer, nullptr );
+    }
+    m_Framebuffers.clear();
+
+    vkDestroyImageView( m_Device, m_DepthView, nullptr );
+    vkDestroyImage( m_Device, m_DepthImage, nullptr );
+    vkFreeMemory( m_Device, m_DepthMemory, nullptr );
+    m_DepthView = VK_NULL_HANDLE;
+    m_DepthImage = VK_NULL_HANDLE;
+    m_DepthMemory = VK_NULL_HANDLE;
+}
+
+void OcclusionScene::update( uint32_t frameIndex, float time )
+{
+    m_Culler.collect( frameIndex );
+
+    // Circles the plaza at eye height, looking out into the blocks ahead.
+    float angle = time * 0.2f;
+    float orbit = m_PlazaRadius * 0.5f;
+    glm::vec3 eye( std::cos( angle ) * orbit, std::sin( angle ) * orbit, 0.6f );
+    glm::vec3 direction( std::cos( angle + 1.0f ), std::sin( angle + 1.0f ), 0.0f );
+    glm::mat4 view = glm::lookAt( eye, eye + direction, glm::vec3( 0.0f, 0.0f, 1.0f ) );
+
+    // The culler expects depth from 0 to 1.
+    float aspect = m_Extent.width / static_cast<float>( m_Extent.height );
+    glm::mat4 proj = glm::perspectiveRH_ZO( glm::radians( 60.0f ), aspect, 0.1f, 2.0f * m_CityRadius );
+    proj[1][1] *= -1;
+    m_ViewProjection = proj * view;
+}
+
+void OcclusionScene::record( VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t imageIndex )
+{
+    const float *viewProjection = &m_ViewProjection[0][0];
+
+    m_Culler.recordCull( commandBuffer, frameIndex, HiZCuller::Phase::Early, viewProjection );
+    recordPass( commandBuffer, m_EarlyPass, imageIndex, HiZCuller::Phase::Early );
+
+    // The early pass left the depth buffer read only, its writes visible to compute.
+    m_Culler.recordBuildPyramid( commandBuffer, frameIndex, m_DepthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL );
+
+    m_Culler.recordCull( commandBuffer, frameIndex, HiZCuller::Phase::Late, viewProjection );
+    recordPass( commandBuffer, m_LatePass, imageIndex, HiZCuller::Phase::Late );
+}
+
+void OcclusionScene::recordPass( VkCommandBuffer commandBuffer,
+                                 VkRenderPass renderPass,
+                                 uint32_t imageIndex,
+                                 HiZCuller::Phase phase )
+{
+    // Only the early pass clears, and only depth.
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[1].depthStencil = { 1.0f, 0 };
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = m_Framebuffers[imageIndex];
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = m_Extent;
+    renderPassInfo.clearValueCount = static_cast<uint32_t>( clearValues.size() );
+    renderPassInfo.pClearValues = clearValues.data();
+    vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+
+    VkViewport viewport{};
+    viewport.width = static_cast<float>( m_Extent.width );
+    viewport.height = static_cast<float>( m_Extent.height );
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
+
+    VkRect2D scissor{};
+    scissor.extent = m_Extent;
+    vkCmdSetScissor( commandBuffer, 0, 1, &scissor );
+
+    vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline );
+    vkCmdBindDescriptorSets( commandBuffer,
+                             VK_PIPELINE_BIND_POINT_GRAPHICS,
+                             m_PipelineLayout,
+                             0, 1, &m_DescriptorSet, 0, nullptr );
+    vkCmdPushConstants( commandBuffer,
+                        m_PipelineLayout,
+                        VK_SHADER_STAGE_VERTEX_BIT,
+                        0,
+                        sizeof( m_ViewProjection ),
+                        &m_ViewProjection );
+    vkCmdBindIndexBuffer( commandBuffer, m_IndexBuffer, 0, VK_INDEX_TYPE_UINT16 );
+    m_Culler.recordDraw( commandBuffer, phase );
+
+    vkCmdEndRenderPass( commandBuffer );
+}
+
+void OcclusionScene::createCity( uint32_t gridSize )
+{
+    // Blocks on a grid of unit cells, around a plaza the camera circles in.
+    float half = gridSize * 0.5f;
+    m_CityRadius = half * std::sqrt( 2.0f );
+    m_PlazaRadius = std::max( half * 0.15f, 2.0f );
+
+    uint32_t state = 0x9E3779B9u;
+    m_Objects.clear();
+    m_Objects.reserve( size_t( gridSize ) * gridSize );
+    for ( uint32_t y = 0; y < gridSize; ++y )
+    {
+        for ( uint32_t x = 0; x < gridSize; ++x )
+        {
+            float centerX = x + 0.5f - half;
+            float centerY = y + 0.5f - half;
+            float width = 0.3f + 0.15f * nextRandom( state );
+            float depth = 0.3f + 0.15f * nextRandom( state );
+            // Mostly low blocks and a few towers.
+            float random = nextRandom( state );
+            float height = 0.3f + 4.0f * random * random * random;
+            if ( std::sqrt( centerX * centerX + centerY * centerY ) < m_PlazaRadius )
+            {
+                continue;
+            }
+
+            CullObject object{};
+            object.center[0] = centerX;
+            object.center[1] = centerY;
+            object.center[2] = height * 0.5f;
+            object.extents[0] = width;
+            object.extents[1] = depth;
+            object.extents[2] = height * 0.5f;
+            object.indexCount = static_cast<uint32_t>( kCubeIndices.size() );
+            m_Objects.push_back( object );
+        }
+    }
+    if ( m_Objects.empty() )
+    {
+        throw std::runtime_error( "The occlusion scene's grid is too small to hold any blocks." );
+    }
+
+    auto createFilledBuffer = [this]( const void *data, VkDeviceSize size, VkBufferUsageFlags usage,
+                                      VkBuffer &buffer, VkDeviceMemory &memory ) {
+        // Written once and small, so host visible memory is fine.
+        createBuffer( m_PhysicalDevice,
+                      m_Device,
+                      size,
+                      usage,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      buffer,
+                      memory );
+        void *mapped;
+        vkMapMemory( m_Device, memory, 0, size, 0, &mapped );
+        memcpy( mapped, data, static_cast<size_t>( size ) );
+        vkUnmapMemory( m_Device, memory );
+    };
+    createFilledBuffer( m_Objects.data(),
+                        sizeof( CullObject ) * m_Objects.size(),
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        m_ObjectBuffer,
+                        m_ObjectMemory );
+    createFilledBuffer( kCubeIndices.data(),
+                        sizeof( kCubeIndices ),
+                        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                        m_IndexBuffer,
+                        m_IndexMemory );
+}
+
+void OcclusionScene::createRenderPasses( const OcclusionSceneCreateInfo &createInfo )
+{
+    auto createPass = [&]( VkAttachmentLoadOp depthLoadOp,
+                           VkAttachmentStoreOp depthStoreOp,
+                           VkImageLayout depthInitialLayout,
+                           VkImageLayout depthFinalLayout,
+                           const std::array<VkSubpassDependency, 2> &dependencies ) {
+        std::array<VkAttachmentDescription, 2> attachments{};
+        attachments[0].format = createInfo.colorFormat;
+        attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[0].initialLayout = createInfo.imageLayout;
+        attachments[0].finalLayout = createInfo.imageLayout;
+
+        attachments[1].format = kDepthFormat;
+        attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[1].loadOp = depthLoadOp;
+        attachments[1].storeOp = depthStoreOp;
+        attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[1].initialLayout = depthInitialLayout;
+        attachments[1].finalLayout = depthFinalLayout;
+
+        VkAttachmentReference colorAttachmentRef{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        VkAttachmentReference depthAttachmentRef{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorAttachmentRef;
+        subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>( attachments.size() );
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = static_cast<uint32_t>( dependencies.size() );
+        renderPassInfo.pDependencies = dependencies.data();
+
+        VkRenderPass renderPass;
+        if ( vkCreateRenderPass( m_Device, &renderPassInfo, nullptr, &renderPass ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create an occlusion scene render pass!" );
+        }
+        return renderPass;
+    };
+
+    const VkPipelineStageFlags depthStages =
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    const VkAccessFlags depthAccess =
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // The scene's writes were already made visible to the color stage by whoever wrote
+    // them last; the depth buffer was last written by the previous frame's late pass.
+    std::array<VkSubpassDependency, 2> earlyDependencies{};
+    earlyDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    earlyDependencies[0].dstSubpass = 0;
+    earlyDependencies[0].srcStageMask = kImageStages | depthStages;
+    earlyDependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    earlyDependencies[0].dstStageMask = kImageStages | depthStages;
+    earlyDependencies[0].dstAccessMask = kImageAccess | depthAccess;
+
+    // The pyramid is built from the depth.
+    earlyDependencies[1].srcSubpass = 0;
+    earlyDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    earlyDependencies[1].srcStageMask = depthStages;
+    earlyDependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    earlyDependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    earlyDependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    // Waits for the pyramid to be done reading before the depth goes back to being an
+    // attachment, and for the early pass' color.
+    std::array<VkSubpassDependency, 2> lateDependencies{};
+    lateDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    lateDependencies[0].dstSubpass = 0;
+    lateDependencies[0].srcStageMask = kImageStages | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    lateDependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    lateDependencies[0].dstStageMask = kImageStages | depthStages;
+    lateDependencies[0].dstAccessMask = kImageAccess | depthAccess;
+
+    // For the HUD drawing over the city, or readback.
+    lateDependencies[1].srcSubpass = 0;
+    lateDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    lateDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    lateDependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    lateDependencies[1].dstStageMask = kImageStages | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    lateDependencies[1].dstAccessMask = kImageAccess | VK_ACCESS_TRANSFER_READ_BIT;
+
+    m_EarlyPass = createPass( VK_ATTACHMENT_LOAD_OP_CLEAR,
+                              VK_ATTACHMENT_STORE_OP_STORE,
+                              VK_IMAGE_LAYOUT_UNDEFINED,
+                              VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                              earlyDependencies );
+    m_LatePass = createPass( VK_ATTACHMENT_LOAD_OP_LOAD,
+                             VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                             VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                             VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                             lateDependencies );
+}
+
+void OcclusionScene::createDescriptors()
+{
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+    if ( vkCreateDescriptorSetLayout( m_Device, &layoutInfo, nullptr, &m_SetLayout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create the occlusion scene's descriptor set layout!" );
+    }
+
+    VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 1;
+    if ( vkCreateDescriptorPool( m_Device, &poolInfo, nullptr, &m_DescriptorPool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create the occlusion scene's descriptor pool!" );
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_SetLayout;
+    if ( vkAllocateDescriptorSets( m_Device, &allocInfo, &m_DescriptorSet ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to allocate the occlusion scene's descriptor set!" );
+    }
+
+    VkDescriptorBufferInfo bufferInfo{ m_ObjectBuffer, 0, VK_WHOLE_SIZE };
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_DescriptorSet;
+    write.dstBinding = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.descriptorCount = 1;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets( m_Device, 1, &write, 0, nullptr );
+}
+
+void OcclusionScene::createPipeline( const OcclusionSceneCreateInfo &createInfo )
+{
+    VkShaderModule vertShaderModule = loadShaderModule( createInfo, "occlusion_vert.spv" );
+    VkShaderModule fragShaderModule = loadShaderModule( createInfo, "frag.spv" );
+
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module = fragShaderModule;
+    fragShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+
+    // The corners come from the vertex index and the blocks from the storage buffer.
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>( dynamicStates.size() );
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof( m_ViewProjection );
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_SetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if ( vkCreatePipelineLayout( m_Device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create occlusion scene pipeline layout!" );
+    }
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_PipelineLayout;
+    // The late pass is compatible.
+    pipelineInfo.renderPass = m_EarlyPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    if ( vkCreateGraphicsPipelines( m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create occlusion scene pipeline!" );
+    }
+
+    vkDestroyShaderModule( m_Device, fragShaderModule, nullptr );
+    vkDestroyShaderModule( m_Device, vertShaderModule, nullptr );
+}
+
+VkShaderModule OcclusionScene::loadShaderModule( const OcclusionSceneCreateInfo &createInfo,
+                                                 const std::string &name ) const
+{
+    if ( createInfo.assets )
+    {
+        return createShaderModule( m_Device, createInfo.assets->load( name ).getData() );
+    }
+    return createShaderModule( m_Device, readFile( name ) );
+}
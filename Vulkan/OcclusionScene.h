@@ -0,0 +1,116 @@
+#pragma once
+// The --hiz scene: a city of boxes drawn through HiZCuller.
+//
+// A square grid of blocks of random height around an empty plaza, seen from a camera
+// circling low inside it, so the nearest blocks hide most of the city. Every block is
+// a draw of the same cube, placed and sized in the vertex shader from its CullObject.
+//
+// The city is drawn over the finished frame, after any upscale and before the HUD,
+// into a depth buffer of its own, in two render passes around the culler:
+//
+//   recordCull( Early ), early pass: clear depth, draw last frame's visible blocks
+//   recordBuildPyramid from the early pass' depth
+//   recordCull( Late ), late pass: draw the blocks that just came into view
+//
+// Both stay render passes under --dynamic-rendering, and share one framebuffer per image.
+
+#include "HiZCuller.h"
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct OcclusionSceneCreateInfo
+{
+    VkPhysicalDevice    physicalDevice = VK_NULL_HANDLE;
+    VkDevice            device = VK_NULL_HANDLE;
+    VkFormat            colorFormat = VK_FORMAT_UNDEFINED;
+    // Layout the images are in before the city is drawn, and are left in.
+    VkImageLayout       imageLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    uint32_t            framesInFlight = 0;
+    // Blocks per side.
+    uint32_t            gridSize = 64;
+    // Passed on to HiZCullerCreateInfo.
+    bool                drawIndirectCount = false;
+    const AssetArchive *assets = nullptr;
+};
+
+class OcclusionScene
+{
+public:
+    void create( const OcclusionSceneCreateInfo &createInfo );
+    void cleanup();
+
+    bool isEnabled() const { return m_Device != VK_NULL_HANDLE; }
+
+    // The images drawn to, indexed like the swap chain's, and a depth buffer of their
+    // size. Call again after the swap chain was recreated, with the device idle.
+    void createTargets( const std::vector<VkImageView> &imageViews, VkExtent2D extent );
+    void cleanupTargets();
+
+    // Call once per frame after the frame's fence was waited on; time in seconds moves
+    // the camera.
+    void update( uint32_t frameIndex, float time );
+
+    // Recorded outside of any render pass. The scene's writes to the image must be made
+    // visible to the color attachment stage beforehand; the city's are made visible to
+    // the HUD and to transfers.
+    void record( VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t imageIndex );
+
+    // Of the last collected frame.
+    uint32_t getObjectCount() const { return m_Culler.getObjectCount(); }
+    uint32_t getDrawnCount() const { return m_Culler.getDrawnCount(); }
+
+    static constexpr VkPipelineStageFlags kImageStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    static constexpr VkAccessFlags        kImageAccess =
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    // One indirect draw per phase.
+    static constexpr uint32_t kDrawCount = 2;
+
+private:
+    void createCity( uint32_t gridSize );
+    void createRenderPasses( const OcclusionSceneCreateInfo &createInfo );
+    void createDescriptors();
+    void createPipeline( const OcclusionSceneCreateInfo &createInfo );
+    void recordPass( VkCommandBuffer commandBuffer, VkRenderPass renderPass, uint32_t imageIndex, HiZCuller::Phase phase );
+    VkShaderModule loadShaderModule( const OcclusionSceneCreateInfo &createInfo, const std::string &name ) const;
+
+private:
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice         m_Device = VK_NULL_HANDLE;
+
+    // Created with the first targets, since its pyramid follows the depth buffer's size.
+    HiZCuller               m_Culler;
+    HiZCullerCreateInfo     m_CullerInfo{};
+    std::vector<CullObject> m_Objects;
+    float                   m_CityRadius = 0.0f;
+    float                   m_PlazaRadius = 0.0f;
+    glm::mat4               m_ViewProjection{ 1.0f };
+
+    // The blocks for the vertex shader, and the cube's 36 indices.
+    VkBuffer       m_ObjectBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_ObjectMemory = VK_NULL_HANDLE;
+    VkBuffer       m_IndexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_IndexMemory = VK_NULL_HANDLE;
+
+    VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool      m_DescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet       m_DescriptorSet = VK_NULL_HANDLE;
+    VkPipelineLayout      m_PipelineLayout = VK_NULL_HANDLE;
+    VkPipeline            m_Pipeline = VK_NULL_HANDLE;
+
+    // The early pass clears depth and leaves it read only for the pyramid; the late
+    // pass loads it again.
+    VkRenderPass m_EarlyPass = VK_NULL_HANDLE;
+    VkRenderPass m_LatePass = VK_NULL_HANDLE;
+
+    VkImage                    m_DepthImage = VK_NULL_HANDLE;
+    VkDeviceMemory             m_DepthMemory = VK_NULL_HANDLE;
+    VkImageView                m_DepthView = VK_NULL_HANDLE;
+    std::vector<VkFramebuffer> m_Framebuffers;
+    VkExtent2D                 m_Extent{};
+};
@@ -0,0 +1,33 @@
+#version 450
+
+// Layout must match CullObject in HiZCuller.h.
+struct CullObject
+{
+    vec3 center;
+    uint indexCount;
+    vec3 extents;
+    uint firstIndex;
+    int  vertexOffset;
+};
+
+layout(std430, binding = 0) readonly buffer Objects { CullObject objects[]; };
+
+layout(push_constant) uniform PushConstants {
+    mat4 viewProjection;
+} push;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    // The culled draws pass the block's index as firstInstance; the corner's
+    // coordinates are the bits of the vertex index, x lowest.
+    CullObject object = objects[gl_InstanceIndex];
+    vec3 corner = vec3(gl_VertexIndex & 1, (gl_VertexIndex >> 1) & 1, (gl_VertexIndex >> 2) & 1) * 2.0 - 1.0;
+    gl_Position = push.viewProjection * vec4(object.center + object.extents * corner, 1.0);
+
+    // A grey tinted per block, darker towards the ground.
+    uint hash = uint(gl_InstanceIndex) * 2654435761u;
+    vec3 tint = vec3((hash >> 8) & 255u, (hash >> 16) & 255u, (hash >> 24) & 255u) / 255.0;
+    float shade = 0.3 + 0.7 * (corner.z * 0.5 + 0.5);
+    fragColor = mix(vec3(0.6), tint, 0.35) * shade;
+}
@@ -0,0 +1,291 @@
+#include "Options.h"
+
+#include <stdexcept>
+
+static uint32_t parseCount( const std::string &arg, const std::string &value )
+{
+    try
+    {
+        size_t used = 0;
+        unsigned long count = std::stoul( value, &used );
+        if ( used == value.size() )
+        {
+            return static_cast<uint32_t>( count );
+        }
+    }
+    catch ( const std::exception & )
+    {
+    }
+    throw std::runtime_error( "Invalid value for " + arg + ": " + value );
+}
+
+static float parseNumber( const std::string &arg, const std::string &value )
+{
+    try
+    {
+        size_t used = 0;
+        float number = std::stof( value, &used );
+        if ( used == value.size() && number >= 0.0f )
+        {
+            return number;
+        }
+    }
+    catch ( const std::exception & )
+    {
+    }
+    throw std::runtime_error( "Invalid value for " + arg + ": " + value );
+}
+
+static VkDebugUtilsMessageSeverityFlagBitsEXT parseSeverity( const std::string &arg, const std::string &value )
+{
+    if ( value == "verbose" )
+    {
+        return VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+    }
+    if ( value == "info" )
+    {
+        return VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+    }
+    if ( value == "warning" )
+    {
+        return VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+    }
+    if ( value == "error" )
+    {
+        return VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    }
+    throw std::runtime_error( "Invalid value for " + arg + ": " + value );
+}
+
+static AssetCompression parseCompression( const std::string &arg, const std::string &value )
+{
+    if ( value == "none" )
+    {
+        return AssetCompression::None;
+    }
+    if ( value == "lz4" )
+    {
+        return AssetCompression::LZ4;
+    }
+    if ( value == "zstd" )
+    {
+        return AssetCompression::Zstd;
+    }
+    throw std::runtime_error( "Invalid value for " + arg + ": " + value );
+}
+
+AppOptions parseCommandLine( int argc, char **argv )
+{
+    AppOptions options;
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        std::string arg = argv[i];
+
+        auto nextValue = [&]() -> std::string {
+            if ( i + 1 >= argc )
+            {
+                throw std::runtime_error( "Missing value for " + arg );
+            }
+            return argv[++i];
+        };
+
+        if ( arg == "--trace" )
+        {
+            options.traceFile = nextValue();
+        }
+        else if ( arg == "--benchmark" )
+        {
+            options.benchmark = true;
+        }
+        else if ( arg == "--warmup" )
+        {
+            options.warmupFrames = parseCount( arg, nextValue() );
+        }
+        else if ( arg == "--frames" )
+        {
+            options.measuredFrames = parseCount( arg, nextValue() );
+        }
+        else if ( arg == "--benchmark-out" )
+        {
+            options.benchmarkOutput = nextValue();
+        }
+        else if ( arg == "--headless" )
+        {
+            options.headless = true;
+        }
+        else if ( arg == "--capture" )
+        {
+            options.captureFile = nextValue();
+        }
+        else if ( arg == "--replay" )
+        {
+            options.replayFile = nextValue();
+        }
+        else if ( arg == "--replay-timing" )
+        {
+            options.replayTiming = true;
+        }
+        else if ( arg == "--pipeline-stats" )
+        {
+            options.pipelineStatistics = true;
+        }
+        else if ( arg == "--texture" )
+        {
+            options.texture = nextValue();
+        }
+        else if ( arg == "--texture-budget" )
+        {
+            options.textureBudgetMB = parseCount( arg, nextValue() );
+        }
+        else if ( arg == "--flat" )
+        {
+            options.flatShading = true;
+        }
+        else if ( arg == "--blur" )
+        {
+            uint32_t radius = parseCount( arg, nextValue() );
+            if ( radius > static_cast<uint32_t>( AppOptions::kMaxBlurRadius ) )
+            {
+                throw std::runtime_error( "--blur needs a radius of at most " +
+                                          std::to_string( AppOptions::kMaxBlurRadius ) + "." );
+            }
+            options.blurRadius = static_cast<int32_t>( radius );
+        }
+        else if ( arg == "--particles" )
+        {
+            options.particleCount = parseCount( arg, nextValue() );
+        }
+        else if ( arg == "--particle-stress" )
+        {
+            options.particleStress = true;
+        }
+        else if ( arg == "--sprites" )
+        {
+            options.spriteCount = parseCount( arg, nextValue() );
+        }
+        else if ( arg == "--mesh-edits" )
+        {
+            options.meshEdits = true;
+        }
+        else if ( arg == "--point-cloud" )
+        {
+            options.pointCloud = nextValue();
+        }
+        else if ( arg == "--point-budget" )
+        {
+            options.pointBudgetMB = parseCount( arg, nextValue() );
+        }
+        else if ( arg == "--point-size" )
+        {
+            options.pointSize = parseNumber( arg, nextValue() );
+        }
+        else if ( arg == "--build-point-cloud" )
+        {
+            options.pointCloudInput = nextValue();
+            options.pointCloudOutput = nextValue();
+        }
+        else if ( arg == "--gpu" )
+        {
+            options.gpu = nextValue();
+        }
+        else if ( arg == "--validation-log" )
+        {
+            options.validationLog = nextValue();
+        }
+        else if ( arg == "--validation-severity" )
+        {
+            options.validationSeverity = parseSeverity( arg, nextValue() );
+        }
+        else if ( arg == "--hud" )
+        {
+            options.hud = true;
+        }
+        else if ( arg == "--hiz" )
+        {
+            options.occlusionCulling = true;
+        }
+        else if ( arg == "--hiz-grid" )
+        {
+            options.occlusionGrid = parseCount( arg, nextValue() );
+        }
+        else if ( arg == "--dynamic-rendering" )
+        {
+            options.dynamicRendering = true;
+        }
+        else if ( arg == "--dynamic-resolution" )
+        {
+            options.dynamicResolutionMs = parseNumber( arg, nextValue() );
+        }
+        else if ( arg == "--min-resolution-scale" )
+        {
+            options.minResolutionScale = parseNumber( arg, nextValue() );
+        }
+        else if ( arg == "--max-resolution-scale" )
+        {
+            options.maxResolutionScale = parseNumber( arg, nextValue() );
+        }
+        else if ( arg == "--assets" )
+        {
+            options.assetArchive = nextValue();
+        }
+        else if ( arg == "--pack-compression" )
+        {
+            options.packCompression = parseCompression( arg, nextValue() );
+        }
+        else if ( arg == "--pack" )
+        {
+            options.packArchive = nextValue();
+            // The files run up to the next option.
+            while ( i + 1 < argc && std::string( argv[i + 1] ).rfind( "--", 0 ) != 0 )
+            {
+                options.packFiles.push_back( argv[++i] );
+            }
+        }
+        else
+        {
+            throw std::runtime_error( "Unknown argument: " + arg );
+        }
+    }
+
+    if ( !options.replayFile.empty() )
+    {
+        // The capture decides how many frames there are.
+        options.headless = true;
+        options.benchmark = true;
+    }
+    else if ( options.replayTiming )
+    {
+        throw std::runtime_error( "--replay-timing needs --replay." );
+    }
+
+    // Without a window nothing would ever end a headless run.
+    if ( options.headless && !options.benchmark )
+    {
+        throw std::runtime_error( "--headless needs --benchmark." );
+    }
+
+    if ( !options.packArchive.empty() && options.packFiles.empty() )
+    {
+        throw std::runtime_error( "--pack needs at least one file." );
+    }
+
+    if ( !options.pointCloud.empty() && options.pointBudgetMB == 0 )
+    {
+        throw std::runtime_error( "--point-budget needs at least 1 MB." );
+    }
+
+    // Above 2 the linear upscale turns into a downscale that skips most samples.
+    if ( options.minResolutionScale <= 0.0f || options.minResolutionScale > options.maxResolutionScale ||
+         options.maxResolutionScale > 2.0f )
+    {
+        throw std::runtime_error( "Resolution scales need 0 < min <= max <= 2." );
+    }
+
+    if ( options.particleStress && options.particleCount == 0 )
+    {
+        options.particleCount = 4 * 1024 * 1024;
+    }
+
+    return options;
+}
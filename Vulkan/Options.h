@@ -0,0 +1,112 @@
+#pragma once
+// Command line options understood by the application.
+
+#include "AssetArchive.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct AppOptions
+{
+    // Where to write the Chrome trace of the run on exit. Empty disables the export.
+    std::string traceFile;
+
+    // --benchmark: render a fixed scene for warmupFrames + measuredFrames frames,
+    // report the frame time statistics and exit.
+    bool        benchmark = false;
+    uint32_t    warmupFrames = 120;
+    uint32_t    measuredFrames = 1000;
+    std::string benchmarkOutput;
+
+    // Render into offscreen images instead of a window and swap chain.
+    bool headless = false;
+
+    // Write the uniforms, mesh edits and scene draws of every frame to this file.
+    std::string captureFile;
+    // Render a capture instead of the live scene, headless and as a benchmark over all
+    // of its frames; with replayTiming each frame waits until its recorded time.
+    std::string replayFile;
+    bool        replayTiming = false;
+
+    // Wrap passes in pipeline statistics and occlusion queries, and report the draw
+    // state changes per frame.
+    bool pipelineStatistics = false;
+
+    // Image drawn on the rectangle, streamed in the background.
+    std::string texture;
+    uint32_t    textureBudgetMB = 256;
+
+    // Shader variant of the rectangle: ignore the vertex colors, and blur the texture
+    // with a box filter of this radius. Each fragment takes (2r+1)^2 samples, so the
+    // radius stays small.
+    bool    flatShading = false;
+    int32_t blurRadius = 0;
+    static constexpr int32_t kMaxBlurRadius = 16;
+
+    // GPU particles simulated on the compute queue; 0 disables them.
+    uint32_t particleCount = 0;
+    // Print the particle simulation throughput while running and summarize it on exit.
+    bool particleStress = false;
+
+    // Colored quads pushed through the sprite batch every frame, to stress it; 0 disables
+    // them. The submission rate is summarized on exit.
+    uint32_t spriteCount = 0;
+
+    // Rewrites the rectangle's vertices every frame, while earlier frames are still
+    // drawing the old ones.
+    bool meshEdits = false;
+
+    // Octree point cloud streamed from disk into a device memory pool of this size.
+    std::string pointCloud;
+    uint32_t    pointBudgetMB = 512;
+    float       pointSize = 1.0f;
+
+    // --build-point-cloud <points> <octree>: sort a file of point records into the
+    // octree format read by --point-cloud and exit.
+    std::string pointCloudInput;
+    std::string pointCloudOutput;
+
+    // Overlay with frame time graphs, frames in flight, memory heap usage, draw and
+    // dispatch counts and upload sizes, drawn over the finished frame.
+    bool hud = false;
+
+    // --hiz: a city of occlusionGrid x occlusionGrid blocks drawn over the frame, culled on
+    // the GPU against last frame's depth. Needs drawIndirectCount; ignored without it.
+    bool     occlusionCulling = false;
+    uint32_t occlusionGrid = 64;
+
+    // Picks the GPU by index, UUID or part of its name instead of by score. Falls back
+    // to the VULKAN_GPU environment variable.
+    std::string gpu;
+
+    // Debug builds: where validation messages go (stderr when empty) and the least
+    // severe one that is still written.
+    std::string                            validationLog;
+    VkDebugUtilsMessageSeverityFlagBitsEXT validationSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+
+    // Render with VK_KHR_dynamic_rendering (core in 1.3) instead of a render pass and
+    // framebuffers, when the device supports it.
+    bool dynamicRendering = false;
+
+    // --dynamic-resolution <ms>: render the scene at whatever fraction of the window
+    // size keeps the GPU frame time near this target, within the two scales, and
+    // upscale it. 0 renders at full size.
+    float dynamicResolutionMs = 0.0f;
+    float minResolutionScale = 0.5f;
+    float maxResolutionScale = 1.0f;
+
+    // Packed archive the shaders are loaded from; missing entries fall back to loose files.
+    std::string assetArchive;
+
+    // --pack <archive> <files...>: write the files into an archive and exit. The files
+    // end at the next argument starting with --.
+    std::string              packArchive;
+    std::vector<std::string> packFiles;
+    AssetCompression         packCompression = AssetCompression::None;
+};
+
+// Throws std::runtime_error on unknown or incomplete arguments.
+AppOptions parseCommandLine( int argc, char **argv );
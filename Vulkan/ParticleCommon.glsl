@@ -0,0 +1,36 @@
+// Shared by the particle compute shaders. Layouts must match ParticleSystem.h.
+
+struct Particle
+{
+    vec4 position; // xyz, age in seconds
+    vec4 velocity; // xyz, lifetime in seconds
+    vec4 color;
+};
+
+// VkDrawIndexedIndirectCommand followed by VkDispatchIndirectCommand. instanceCount
+// doubles as the number of live particles.
+struct Control
+{
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int  vertexOffset;
+    uint firstInstance;
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+};
+
+layout(std430, binding = 0) readonly buffer SrcParticles { Particle particles[]; } src;
+layout(std430, binding = 1) writeonly buffer DstParticles { Particle particles[]; } dst;
+layout(std430, binding = 2) readonly buffer SrcControl { Control control; } srcControl;
+layout(std430, binding = 3) buffer DstControl { Control control; } dstControl;
+
+layout(push_constant) uniform PushConstants
+{
+    float deltaTime;
+    float lifetime;
+    uint  emitCount;
+    uint  capacity;
+    uint  seed;
+} push;
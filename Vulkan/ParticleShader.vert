@@ -0,0 +1,30 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+layout(push_constant) uniform PushConstants {
+    float size;
+} push;
+
+// Per vertex: the corners of the shared rectangle.
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+// Per instance: one particle.
+layout(location = 2) in vec4 inParticlePosition;
+layout(location = 3) in vec4 inParticleColor;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragCorner;
+
+void main() {
+    // Billboard: expand the quad in view space so it always faces the camera.
+    vec4 viewPosition = ubo.view * vec4(inParticlePosition.xyz, 1.0);
+    viewPosition.xy += inPosition * push.size;
+    gl_Position = ubo.proj * viewPosition;
+    fragColor = inParticleColor;
+    fragCorner = inPosition * 2.0;
+}
@@ -0,0 +1,559 @@
+#include "ParticleSystem.h"
+#include "AssetArchive.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+constexpr uint32_t kWorkgroupSize = 256;
+// The simulation is sized by an indirect dispatch, bounded by maxComputeWorkGroupCount.
+constexpr uint32_t kMaxCapacity = 65535 * kWorkgroupSize;
+
+void bufferBarrier( VkCommandBuffer commandBuffer,
+                    VkPipelineStageFlags srcStage,
+                    VkAccessFlags srcAccess,
+                    VkPipelineStageFlags dstStage,
+                    VkAccessFlags dstAccess )
+{
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier( commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr );
+}
+} // namespace
+
+VkVertexInputBindingDescription Particle::getBindingDescription()
+{
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 1;
+    bindingDescription.stride = sizeof( Particle );
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    return bindingDescription;
+}
+
+std::array<VkVertexInputAttributeDescription, 2> Particle::getAttributeDescription()
+{
+    std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+    attributeDescriptions[0].binding = 1;
+    attributeDescriptions[0].location = 2;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    attributeDescriptions[0].offset = offsetof( Particle, position );
+
+    attributeDescriptions[1].binding = 1;
+    attributeDescriptions[1].location = 3;
+    attributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    attributeDescriptions[1].offset = offsetof( Particle, color );
+
+    return attributeDescriptions;
+}
+
+void ParticleSystem::create( const ParticleSystemCreateInfo &createInfo )
+{
+    m_PhysicalDevice = createInfo.physicalDevice;
+    m_Device = createInfo.device;
+    m_Capacity = std::min( createInfo.capacity, kMaxCapacity );
+    m_Lifetime = createInfo.lifetime;
+    m_ParticleSize = createInfo.particleSize;
+
+    createBuffers( createInfo );
+    createDescriptors();
+    createComputePipelines( createInfo );
+    createGraphicsPipeline( createInfo );
+
+    m_Profiler.create( m_PhysicalDevice, m_Device, createInfo.computeFamily, createInfo.framesInFlight, 4 );
+}
+
+void ParticleSystem::cleanup()
+{
+    if ( m_Device == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    m_Profiler.cleanup();
+
+    vkDestroyPipeline( m_Device, m_GraphicsPipeline, nullptr );
+    vkDestroyPipelineLayout( m_Device, m_GraphicsLayout, nullptr );
+
+    vkDestroyPipeline( m_Device, m_SimulatePipeline, nullptr );
+    vkDestroyPipeline( m_Device, m_EmitPipeline, nullptr );
+    vkDestroyPipeline( m_Device, m_FinalizePipeline, nullptr );
+    vkDestroyPipelineLayout( m_Device, m_ComputeLayout, nullptr );
+    vkDestroyDescriptorPool( m_Device, m_DescriptorPool, nullptr );
+    vkDestroyDescriptorSetLayout( m_Device, m_ComputeSetLayout, nullptr );
+
+    for ( size_t i = 0; i < m_StatsBuffers.size(); ++i )
+    {
+        vkDestroyBuffer( m_Device, m_StatsBuffers[i], nullptr );
+        vkFreeMemory( m_Device, m_StatsMemory[i], nullptr );
+    }
+    m_StatsBuffers.clear();
+    m_StatsMemory.clear();
+    m_StatsMapped.clear();
+    m_StatsPending.clear();
+
+    for ( int i = 0; i < 2; ++i )
+    {
+        vkDestroyBuffer( m_Device, m_ParticleBuffers[i], nullptr );
+        vkFreeMemory( m_Device, m_ParticleMemory[i], nullptr );
+        vkDestroyBuffer( m_Device, m_ControlBuffers[i], nullptr );
+        vkFreeMemory( m_Device, m_ControlMemory[i], nullptr );
+    }
+
+    m_Device = VK_NULL_HANDLE;
+}
+
+void ParticleSystem::update( float deltaTime )
+{
+    m_Target = 1 - m_Target;
+    m_DeltaTime = deltaTime;
+    ++m_Seed;
+
+    // Emit a bit faster than particles die so the pool stays saturated; whatever
+    // doesn't fit is dropped on the GPU.
+    float rate = 1.5f * m_Capacity / m_Lifetime;
+    m_EmitAccumulator = std::min( m_EmitAccumulator + rate * deltaTime, static_cast<float>( m_Capacity ) );
+    m_EmitCount = static_cast<uint32_t>( m_EmitAccumulator );
+    m_EmitAccumulator -= static_cast<float>( m_EmitCount );
+}
+
+void ParticleSystem::collect( uint32_t frameIndex )
+{
+    m_Profiler.collect( frameIndex );
+
+    if ( m_StatsPending[frameIndex] )
+    {
+        memcpy( &m_AliveCount, m_StatsMapped[frameIndex], sizeof( uint32_t ) );
+        m_StatsPending[frameIndex] = false;
+    }
+}
+
+void ParticleSystem::recordSimulation( VkCommandBuffer commandBuffer, uint32_t frameIndex )
+{
+    uint32_t source = 1 - m_Target;
+
+    m_Profiler.beginFrame( commandBuffer, frameIndex );
+    uint32_t scope = m_Profiler.beginScope( commandBuffer, "particles" );
+
+    // The source control block was written by last frame's finalize pass, and the
+    // target is reset below while last frame's dispatch may still read it.
+    bufferBarrier( commandBuffer,
+                   VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                   VK_ACCESS_SHADER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                   VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT );
+
+    Control reset{};
+    reset.draw.indexCount = 6;
+    reset.dispatch = { 0, 1, 1 };
+    vkCmdUpdateBuffer( commandBuffer, m_ControlBuffers[m_Target], 0, sizeof( reset ), &reset );
+    bufferBarrier( commandBuffer,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT,
+                   VK_ACCESS_TRANSFER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                   VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT );
+
+    PushConstants push{ m_DeltaTime, m_Lifetime, m_EmitCount, m_Capacity, m_Seed };
+    vkCmdBindDescriptorSets( commandBuffer,
+                             VK_PIPELINE_BIND_POINT_COMPUTE,
+                             m_ComputeLayout,
+                             0, 1, &m_ComputeSets[source], 0, nullptr );
+    vkCmdPushConstants( commandBuffer, m_ComputeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( push ), &push );
+
+    vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_SimulatePipeline );
+    vkCmdDispatchIndirect( commandBuffer, m_ControlBuffers[source], offsetof( Control, dispatch ) );
+    bufferBarrier( commandBuffer,
+                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                   VK_ACCESS_SHADER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                   VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT );
+
+    if ( m_EmitCount > 0 )
+    {
+        vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_EmitPipeline );
+        vkCmdDispatch( commandBuffer, ( m_EmitCount + kWorkgroupSize - 1 ) / kWorkgroupSize, 1, 1 );
+        bufferBarrier( commandBuffer,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT );
+    }
+
+    vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_FinalizePipeline );
+    vkCmdDispatch( commandBuffer, 1, 1, 1 );
+
+    // Hand the live count to the host; it is read once the frame's fence has signalled.
+    bufferBarrier( commandBuffer,
+                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                   VK_ACCESS_SHADER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT,
+                   VK_ACCESS_TRANSFER_READ_BIT );
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = offsetof( Control, draw ) + offsetof( VkDrawIndexedIndirectCommand, instanceCount );
+    copyRegion.dstOffset = 0;
+    copyRegion.size = sizeof( uint32_t );
+    vkCmdCopyBuffer( commandBuffer, m_ControlBuffers[m_Target], m_StatsBuffers[frameIndex], 1, &copyRegion );
+    bufferBarrier( commandBuffer,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT,
+                   VK_ACCESS_TRANSFER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_HOST_BIT,
+                   VK_ACCESS_HOST_READ_BIT );
+    m_StatsPending[frameIndex] = true;
+
+    m_Profiler.endScope( commandBuffer, scope );
+    m_Profiler.markSubmitted( frameIndex );
+}
+
+void ParticleSystem::recordDraw( VkCommandBuffer commandBuffer,
+                                 VkDescriptorSet sceneSet,
+                                 VkBuffer quadVertexBuffer,
+                                 VkBuffer quadIndexBuffer )
+{
+    vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline );
+
+    VkBuffer vertexBuffers[] = { quadVertexBuffer, m_ParticleBuffers[m_Target] };
+    VkDeviceSize offsets[] = { 0, 0 };
+    vkCmdBindVertexBuffers( commandBuffer, 0, 2, vertexBuffers, offsets );
+    vkCmdBindIndexBuffer( commandBuffer, quadIndexBuffer, 0, VK_INDEX_TYPE_UINT16 );
+
+    vkCmdBindDescriptorSets( commandBuffer,
+                             VK_PIPELINE_BIND_POINT_GRAPHICS,
+                             m_GraphicsLayout,
+                             0, 1, &sceneSet, 0, nullptr );
+    vkCmdPushConstants( commandBuffer,
+                        m_GraphicsLayout,
+                        VK_SHADER_STAGE_VERTEX_BIT,
+                        0, sizeof( m_ParticleSize ), &m_ParticleSize );
+
+    vkCmdDrawIndexedIndirect( commandBuffer,
+                              m_ControlBuffers[m_Target],
+                              offsetof( Control, draw ),
+                              1,
+                              sizeof( VkDrawIndexedIndirectCommand ) );
+}
+
+void ParticleSystem::createBuffers( const ParticleSystemCreateInfo &createInfo )
+{
+    std::vector<uint32_t> queueFamilies = { createInfo.graphicsFamily, createInfo.computeFamily };
+
+    for ( int i = 0; i < 2; ++i )
+    {
+        createSharedBuffer( m_PhysicalDevice,
+                            m_Device,
+                            sizeof( Particle ) * static_cast<VkDeviceSize>( m_Capacity ),
+                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                            queueFamilies,
+                            m_ParticleBuffers[i],
+                            m_ParticleMemory[i] );
+
+        createSharedBuffer( m_PhysicalDevice,
+                            m_Device,
+                            sizeof( Control ),
+                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                            queueFamilies,
+                            m_ControlBuffers[i],
+                            m_ControlMemory[i] );
+    }
+
+    // Both control blocks start out empty, so the first simulation dispatch is a no-op.
+    Control initial{};
+    initial.draw.indexCount = 6;
+    initial.dispatch = { 0, 1, 1 };
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer( m_PhysicalDevice,
+                  m_Device,
+                  sizeof( Control ),
+                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  stagingBuffer,
+                  stagingBufferMemory );
+
+    void *data;
+    vkMapMemory( m_Device, stagingBufferMemory, 0, sizeof( Control ), 0, &data );
+    memcpy( data, &initial, sizeof( Control ) );
+    vkUnmapMemory( m_Device, stagingBufferMemory );
+
+    for ( int i = 0; i < 2; ++i )
+    {
+        copyBuffer( m_Device,
+                    createInfo.uploadCommandPool,
+                    createInfo.uploadQueue,
+                    stagingBuffer,
+                    m_ControlBuffers[i],
+                    sizeof( Control ) );
+    }
+
+    vkDestroyBuffer( m_Device, stagingBuffer, nullptr );
+    vkFreeMemory( m_Device, stagingBufferMemory, nullptr );
+
+    m_StatsBuffers.resize( createInfo.framesInFlight );
+    m_StatsMemory.resize( createInfo.framesInFlight );
+    m_StatsMapped.resize( createInfo.framesInFlight );
+    m_StatsPending.assign( createInfo.framesInFlight, false );
+    for ( uint32_t i = 0; i < createInfo.framesInFlight; ++i )
+    {
+        createBuffer( m_PhysicalDevice,
+                      m_Device,
+                      sizeof( uint32_t ),
+                      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      m_StatsBuffers[i],
+                      m_StatsMemory[i] );
+        vkMapMemory( m_Device, m_StatsMemory[i], 0, sizeof( uint32_t ), 0, &m_StatsMapped[i] );
+    }
+}
+
+void ParticleSystem::createDescriptors()
+{
+    std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+    for ( uint32_t i = 0; i < bindings.size(); ++i )
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>( bindings.size() );
+    layoutInfo.pBindings = bindings.data();
+    if ( vkCreateDescriptorSetLayout( m_Device, &layoutInfo, nullptr, &m_ComputeSetLayout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create particle descriptor set layout." );
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 2 * static_cast<uint32_t>( bindings.size() );
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 2;
+    if ( vkCreateDescriptorPool( m_Device, &poolInfo, nullptr, &m_DescriptorPool ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create particle descriptor pool." );
+    }
+
+    VkDescriptorSetLayout layouts[] = { m_ComputeSetLayout, m_ComputeSetLayout };
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 2;
+    allocInfo.pSetLayouts = layouts;
+    if ( vkAllocateDescriptorSets( m_Device, &allocInfo, m_ComputeSets ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to allocate particle descriptor sets." );
+    }
+
+    for ( uint32_t source = 0; source < 2; ++source )
+    {
+        uint32_t target = 1 - source;
+        VkDescriptorBufferInfo bufferInfos[4] = {
+            { m_ParticleBuffers[source], 0, VK_WHOLE_SIZE },
+            { m_ParticleBuffers[target], 0, VK_WHOLE_SIZE },
+            { m_ControlBuffers[source], 0, VK_WHOLE_SIZE },
+            { m_ControlBuffers[target], 0, VK_WHOLE_SIZE },
+        };
+
+        std::array<VkWriteDescriptorSet, 4> writes{};
+        for ( uint32_t i = 0; i < writes.size(); ++i )
+        {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = m_ComputeSets[source];
+            writes[i].dstBinding = i;
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[i].descriptorCount = 1;
+            writes[i].pBufferInfo = &bufferInfos[i];
+        }
+        vkUpdateDescriptorSets( m_Device, static_cast<uint32_t>( writes.size() ), writes.data(), 0, nullptr );
+    }
+}
+
+void ParticleSystem::createComputePipelines( const ParticleSystemCreateInfo &createInfo )
+{
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof( PushConstants );
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &m_ComputeSetLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushConstantRange;
+    if ( vkCreatePipelineLayout( m_Device, &layoutInfo, nullptr, &m_ComputeLayout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create particle compute pipeline layout!" );
+    }
+
+    auto createPipeline = [this, &createInfo]( const char *path ) {
+        VkShaderModule shaderModule = loadShaderModule( createInfo, path );
+        VkPipeline pipeline = createComputePipeline( m_Device, shaderModule, m_ComputeLayout );
+        vkDestroyShaderModule( m_Device, shaderModule, nullptr );
+        return pipeline;
+    };
+
+    m_SimulatePipeline = createPipeline( "particle_simulate.spv" );
+    m_EmitPipeline = createPipeline( "particle_emit.spv" );
+    m_FinalizePipeline = createPipeline( "particle_finalize.spv" );
+}
+
+VkShaderModule ParticleSystem::loadShaderModule( const ParticleSystemCreateInfo &createInfo,
+                                                 const std::string &name ) const
+{
+    if ( createInfo.assets )
+    {
+        return createShaderModule( m_Device, createInfo.assets->load( name ).getData() );
+    }
+    return createShaderModule( m_Device, readFile( name ) );
+}
+
+void ParticleSystem::createGraphicsPipeline( const ParticleSystemCreateInfo &createInfo )
+{
+    VkShaderModule vertShaderModule = loadShaderModule( createInfo, "particle_vert.spv" );
+    VkShaderModule fragShaderModule = loadShaderModule( createInfo, "particle_frag.spv" );
+
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module = fragShaderModule;
+    fragShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+
+    // Binding 0 is the shared quad, binding 1 steps once per particle.
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions = { createInfo.quadBinding,
+                                                                         Particle::getBindingDescription() };
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions = createInfo.quadAttributes;
+    for ( const auto &attribute : Particle::getAttributeDescription() )
+    {
+        attributeDescriptions.push_back( attribute );
+    }
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>( bindingDescriptions.size() );
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>( attributeDescriptions.size() );
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    // Additive, so the particles don't need sorting.
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>( dynamicStates.size() );
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof( float );
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &createInfo.sceneSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if ( vkCreatePipelineLayout( m_Device, &pipelineLayoutInfo, nullptr, &m_GraphicsLayout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create particle pipeline layout!" );
+    }
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_GraphicsLayout;
+    pipelineInfo.renderPass = createInfo.renderPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &createInfo.colorFormat;
+    if ( createInfo.renderPass == VK_NULL_HANDLE )
+    {
+        pipelineInfo.pNext = &renderingInfo;
+    }
+
+    if ( vkCreateGraphicsPipelines( m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_GraphicsPipeline ) !=
+         VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create particle pipeline!" );
+    }
+
+    vkDestroyShaderModule( m_Device, fragShaderModule, nullptr );
+    vkDestroyShaderModule( m_Device, vertShaderModule, nullptr );
+}
@@ -0,0 +1,158 @@
+#pragma once
+// GPU particle system. The CPU only records a handful of commands per frame; how many
+// particles are alive is never known on the CPU side except through the delayed stats.
+//
+// Particle state lives in two storage buffers used in turns. Every frame the compute
+// queue integrates the particles of the previous frame's buffer and appends the
+// survivors to the other one, which compacts dead particles away, then emits new
+// particles behind them. Each buffer has a control block holding the indexed indirect
+// draw command - whose instanceCount is the live count - and the indirect dispatch
+// size for the next frame's simulation. The graphics pass draws one rectangle
+// instance per particle straight from those buffers.
+//
+// With two frames in flight, the buffer written by frame N is only ever read by
+// frame N's graphics and frame N+1's compute, so no frame writes what another is
+// still reading.
+
+#include <vulkan/vulkan.h>
+
+#include "Profiler.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class AssetArchive;
+
+struct Particle
+{
+    float position[4]; // xyz, age
+    float velocity[4]; // xyz, lifetime
+    float color[4];
+
+    static VkVertexInputBindingDescription getBindingDescription();
+    static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescription();
+};
+
+struct ParticleSystemCreateInfo
+{
+    VkPhysicalDevice      physicalDevice = VK_NULL_HANDLE;
+    VkDevice              device = VK_NULL_HANDLE;
+    // VK_NULL_HANDLE with dynamic rendering; the pipeline is then built for colorFormat.
+    VkRenderPass          renderPass = VK_NULL_HANDLE;
+    VkFormat              colorFormat = VK_FORMAT_UNDEFINED;
+    // Layout of the set holding the scene's UniformBufferObject at binding 0.
+    VkDescriptorSetLayout sceneSetLayout = VK_NULL_HANDLE;
+    uint32_t              graphicsFamily = 0;
+    uint32_t              computeFamily = 0;
+    // Vertex layout of the rectangle each particle is drawn as; bound at binding 0.
+    VkVertexInputBindingDescription                quadBinding{};
+    std::vector<VkVertexInputAttributeDescription> quadAttributes;
+    // Used once to initialize the control blocks.
+    VkCommandPool         uploadCommandPool = VK_NULL_HANDLE;
+    VkQueue               uploadQueue = VK_NULL_HANDLE;
+    uint32_t              framesInFlight = 0;
+    uint32_t              capacity = 0;
+    // Shaders are loaded from here when set, otherwise from the working directory.
+    const AssetArchive   *assets = nullptr;
+    float                 lifetime = 4.0f;
+    float                 particleSize = 0.02f;
+};
+
+class ParticleSystem
+{
+public:
+    void create( const ParticleSystemCreateInfo &createInfo );
+    void cleanup();
+
+    bool isEnabled() const { return m_Device != VK_NULL_HANDLE; }
+
+    // Call once per frame before recording either queue's commands. Emission keeps the
+    // pool full at a steady state of capacity particles.
+    void update( float deltaTime );
+
+    // Call after the frame's fence was waited on.
+    void collect( uint32_t frameIndex );
+
+    // Recorded on the compute queue.
+    void recordSimulation( VkCommandBuffer commandBuffer, uint32_t frameIndex );
+    // Recorded inside the render pass; expects the scene's set for the frame.
+    void recordDraw( VkCommandBuffer commandBuffer,
+                     VkDescriptorSet sceneSet,
+                     VkBuffer quadVertexBuffer,
+                     VkBuffer quadIndexBuffer );
+
+    // Live particles and GPU simulation time of the last resolved frame.
+    uint32_t getAliveCount() const { return m_AliveCount; }
+    double   getLastSimulationGpuMs() const { return m_Profiler.getLastFrameGpuMs(); }
+    bool     consumeNewResults() { return m_Profiler.consumeNewResults(); }
+    // Dispatches the last recordSimulation recorded.
+    uint32_t getDispatchCount() const { return m_EmitCount > 0 ? 3 : 2; }
+
+    static constexpr VkPipelineStageFlags kConsumerStages =
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+
+private:
+    struct PushConstants
+    {
+        float    deltaTime;
+        float    lifetime;
+        uint32_t emitCount;
+        uint32_t capacity;
+        uint32_t seed;
+    };
+
+    // Same layout as VkDrawIndexedIndirectCommand followed by VkDispatchIndirectCommand.
+    struct Control
+    {
+        VkDrawIndexedIndirectCommand draw;
+        VkDispatchIndirectCommand    dispatch;
+    };
+
+    void createBuffers( const ParticleSystemCreateInfo &createInfo );
+    void createDescriptors();
+    void createComputePipelines( const ParticleSystemCreateInfo &createInfo );
+    void createGraphicsPipeline( const ParticleSystemCreateInfo &createInfo );
+    VkShaderModule loadShaderModule( const ParticleSystemCreateInfo &createInfo, const std::string &name ) const;
+
+private:
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice         m_Device = VK_NULL_HANDLE;
+    uint32_t         m_Capacity = 0;
+    float            m_Lifetime = 0.0f;
+    float            m_ParticleSize = 0.0f;
+
+    VkBuffer       m_ParticleBuffers[2] = {};
+    VkDeviceMemory m_ParticleMemory[2] = {};
+    VkBuffer       m_ControlBuffers[2] = {};
+    VkDeviceMemory m_ControlMemory[2] = {};
+
+    // Live count copied out each frame, one per frame in flight.
+    std::vector<VkBuffer>       m_StatsBuffers;
+    std::vector<VkDeviceMemory> m_StatsMemory;
+    std::vector<void *>         m_StatsMapped;
+    std::vector<bool>           m_StatsPending;
+
+    VkDescriptorSetLayout m_ComputeSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool      m_DescriptorPool = VK_NULL_HANDLE;
+    // m_ComputeSets[i] reads buffer i and writes buffer 1 - i.
+    VkDescriptorSet       m_ComputeSets[2] = {};
+    VkPipelineLayout      m_ComputeLayout = VK_NULL_HANDLE;
+    VkPipeline            m_SimulatePipeline = VK_NULL_HANDLE;
+    VkPipeline            m_EmitPipeline = VK_NULL_HANDLE;
+    VkPipeline            m_FinalizePipeline = VK_NULL_HANDLE;
+
+    VkPipelineLayout m_GraphicsLayout = VK_NULL_HANDLE;
+    VkPipeline       m_GraphicsPipeline = VK_NULL_HANDLE;
+
+    // Index of the buffer written this frame.
+    uint32_t m_Target = 0;
+    float    m_DeltaTime = 0.0f;
+    float    m_EmitAccumulator = 0.0f;
+    uint32_t m_EmitCount = 0;
+    uint32_t m_Seed = 0;
+    uint32_t m_AliveCount = 0;
+
+    GpuProfiler m_Profiler;
+};
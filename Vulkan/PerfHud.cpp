@@ -0,0 +1,448 @@
+#include "PerfHud.h"
+#include "Profiler.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace
+{
+// Pixels per font pixel.
+constexpr float kTextScale = 2.0f;
+constexpr float kLineHeight = 6.0f * kTextScale + 2.0f;
+constexpr float kMargin = 8.0f;
+constexpr float kPanelWidth = 4.0f * kTextScale * 32.0f + 2.0f * kMargin;
+constexpr float kGraphHeight = 40.0f;
+// Heap sizes and usage are refreshed this often, in frames.
+constexpr uint32_t kHeapQueryInterval = 30;
+
+const glm::vec3 kPanelColor( 0.05f, 0.05f, 0.07f );
+const glm::vec3 kTextColor( 0.9f, 0.9f, 0.9f );
+const glm::vec3 kCpuColor( 0.3f, 0.8f, 0.4f );
+const glm::vec3 kGpuColor( 1.0f, 0.6f, 0.2f );
+const glm::vec3 kGuideColor( 0.3f, 0.3f, 0.35f );
+
+struct Glyph
+{
+    char    character;
+    uint8_t rows[5];
+};
+
+const Glyph kGlyphs[] = {
+    { '0', { 7, 5, 5, 5, 7 } }, { '1', { 2, 6, 2, 2, 7 } }, { '2', { 7, 1, 7, 4, 7 } },
+    { '3', { 7, 1, 7, 1, 7 } }, { '4', { 5, 5, 7, 1, 1 } }, { '5', { 7, 4, 7, 1, 7 } },
+    { '6', { 7, 4, 7, 5, 7 } }, { '7', { 7, 1, 1, 1, 1 } }, { '8', { 7, 5, 7, 5, 7 } },
+    { '9', { 7, 5, 7, 1, 7 } }, { 'A', { 2, 5, 7, 5, 5 } }, { 'B', { 6, 5, 6, 5, 6 } },
+    { 'C', { 3, 4, 4, 4, 3 } }, { 'D', { 6, 5, 5, 5, 6 } }, { 'E', { 7, 4, 6, 4, 7 } },
+    { 'F', { 7, 4, 6, 4, 4 } }, { 'G', { 3, 4, 5, 5, 3 } }, { 'H', { 5, 5, 7, 5, 5 } },
+    { 'I', { 7, 2, 2, 2, 7 } }, { 'J', { 1, 1, 1, 5, 2 } }, { 'K', { 5, 5, 6, 5, 5 } },
+    { 'L', { 4, 4, 4, 4, 7 } }, { 'M', { 5, 7, 7, 5, 5 } }, { 'N', { 6, 5, 5, 5, 5 } },
+    { 'O', { 2, 5, 5, 5, 2 } }, { 'P', { 6, 5, 6, 4, 4 } }, { 'Q', { 2, 5, 5, 7, 3 } },
+    { 'R', { 6, 5, 6, 5, 5 } }, { 'S', { 3, 4, 2, 1, 6 } }, { 'T', { 7, 2, 2, 2, 2 } },
+    { 'U', { 5, 5, 5, 5, 7 } }, { 'V', { 5, 5, 5, 5, 2 } }, { 'W', { 5, 5, 7, 7, 5 } },
+    { 'X', { 5, 5, 2, 5, 5 } }, { 'Y', { 5, 5, 2, 2, 2 } }, { 'Z', { 7, 1, 2, 4, 7 } },
+    { '.', { 0, 0, 0, 0, 2 } }, { ':', { 0, 2, 0, 2, 0 } }, { '/', { 1, 1, 2, 4, 4 } },
+    { '%', { 5, 1, 2, 4, 5 } }, { '-', { 0, 0, 7, 0, 0 } }, { '(', { 1, 2, 2, 2, 1 } },
+    { ')', { 4, 2, 2, 2, 4 } },
+};
+
+double toMB( VkDeviceSize bytes )
+{
+    return static_cast<double>( bytes ) / ( 1024.0 * 1024.0 );
+}
+} // namespace
+
+void PerfHud::create( const PerfHudCreateInfo &createInfo )
+{
+    m_PhysicalDevice = createInfo.physicalDevice;
+    m_Device = createInfo.device;
+    m_ColorFormat = createInfo.colorFormat;
+    m_ImageLayout = createInfo.imageLayout;
+    m_MemoryBudget = createInfo.memoryBudget;
+    m_BeginRendering = createInfo.beginRendering;
+    m_EndRendering = createInfo.endRendering;
+
+    for ( const Glyph &glyph : kGlyphs )
+    {
+        std::copy( std::begin( glyph.rows ), std::end( glyph.rows ), m_Font[glyph.character].begin() );
+    }
+
+    if ( m_BeginRendering == nullptr )
+    {
+        createRenderPass( createInfo );
+    }
+
+    SpriteBatchCreateInfo batchInfo{};
+    batchInfo.physicalDevice = m_PhysicalDevice;
+    batchInfo.device = m_Device;
+    batchInfo.renderPass = m_RenderPass;
+    batchInfo.colorFormat = m_ColorFormat;
+    batchInfo.framesInFlight = createInfo.framesInFlight;
+    batchInfo.initialCapacity = 4096;
+    batchInfo.assets = createInfo.assets;
+    m_Batch.create( batchInfo );
+
+    queryHeaps();
+}
+
+void PerfHud::cleanup()
+{
+    if ( m_Device == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    cleanupTargets();
+    m_Batch.cleanup();
+    vkDestroyRenderPass( m_Device, m_RenderPass, nullptr );
+    m_RenderPass = VK_NULL_HANDLE;
+    m_Device = VK_NULL_HANDLE;
+}
+
+void PerfHud::createRenderPass( const PerfHudCreateInfo &createInfo )
+{
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = createInfo.colorFormat;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = createInfo.imageLayout;
+    colorAttachment.finalLayout = createInfo.imageLayout;
+
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+
+    // The scene's writes were already made visible to this stage by whoever wrote them
+    // last, so the incoming dependency only has to order the layout transition.
+    std::array<VkSubpassDependency, 2> dependencies{};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = kImageStages;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstStageMask = kImageStages;
+    dependencies[0].dstAccessMask = kImageAccess;
+
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>( dependencies.size() );
+    renderPassInfo.pDependencies = dependencies.data();
+
+    if ( vkCreateRenderPass( m_Device, &renderPassInfo, nullptr, &m_RenderPass ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create HUD render pass!" );
+    }
+}
+
+void PerfHud::createTargets( const std::vector<VkImage> &images,
+                             const std::vector<VkImageView> &imageViews,
+                             VkExtent2D extent )
+{
+    m_Images = images;
+    m_ImageViews = imageViews;
+    m_Extent = extent;
+
+    if ( m_RenderPass == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    m_Framebuffers.resize( imageViews.size(), VK_NULL_HANDLE );
+    for ( size_t i = 0; i < imageViews.size(); ++i )
+    {
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = m_RenderPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = &imageViews[i];
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
+        framebufferInfo.layers = 1;
+
+        if ( vkCreateFramebuffer( m_Device, &framebufferInfo, nullptr, &m_Framebuffers[i] ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create HUD framebuffer!" );
+        }
+    }
+}
+
+void PerfHud::cleanupTargets()
+{
+    for ( VkFramebuffer framebuffer : m_Framebuffers )
+    {
+        vkDestroyFramebuffer( m_Device, framebuffer, nullptr );
+    }
+    m_Framebuffers.clear();
+    m_Images.clear();
+    m_ImageViews.clear();
+}
+
+void PerfHud::update( const HudCounters &counters )
+{
+    m_Counters = counters;
+
+    m_CpuHistory[m_CpuNext] = static_cast<float>( counters.cpuMs );
+    m_CpuNext = ( m_CpuNext + 1 ) % kHistory;
+
+    if ( counters.gpuMs >= 0.0 )
+    {
+        m_LastGpuMs = counters.gpuMs;
+        m_GpuHistory[m_GpuNext] = static_cast<float>( counters.gpuMs );
+        m_GpuNext = ( m_GpuNext + 1 ) % kHistory;
+    }
+    if ( counters.hudGpuMs >= 0.0 )
+    {
+        m_LastHudGpuMs = counters.hudGpuMs;
+    }
+
+    if ( ++m_FramesSinceHeapQuery >= kHeapQueryInterval )
+    {
+        queryHeaps();
+    }
+}
+
+void PerfHud::queryHeaps()
+{
+    m_FramesSinceHeapQuery = 0;
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    if ( m_MemoryBudget )
+    {
+        properties.pNext = &budget;
+        vkGetPhysicalDeviceMemoryProperties2( m_PhysicalDevice, &properties );
+    }
+    else
+    {
+        vkGetPhysicalDeviceMemoryProperties( m_PhysicalDevice, &properties.memoryProperties );
+    }
+
+    const VkPhysicalDeviceMemoryProperties &memory = properties.memoryProperties;
+    m_Heaps.resize( memory.memoryHeapCount );
+    for ( uint32_t i = 0; i < memory.memoryHeapCount; ++i )
+    {
+        m_Heaps[i].size = memory.memoryHeaps[i].size;
+        m_Heaps[i].deviceLocal = ( memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT ) != 0;
+        m_Heaps[i].usage = budget.heapUsage[i];
+        m_Heaps[i].budget = budget.heapBudget[i];
+    }
+}
+
+void PerfHud::record( VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t imageIndex )
+{
+    double startUs = CpuTimeline::nowUs();
+
+    m_Batch.begin( frameIndex );
+    buildOverlay();
+
+    VkRect2D renderArea{ { 0, 0 }, m_Extent };
+
+    if ( m_BeginRendering != nullptr )
+    {
+        recordImageBarrier( commandBuffer,
+                            m_Images[imageIndex],
+                            m_ImageLayout,
+                            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                            kImageStages,
+                            0,
+                            kImageStages,
+                            kImageAccess );
+
+        VkRenderingAttachmentInfo colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        colorAttachment.imageView = m_ImageViews[imageIndex];
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+        VkRenderingInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        renderingInfo.renderArea = renderArea;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+        m_BeginRendering( commandBuffer, &renderingInfo );
+    }
+    else
+    {
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = m_RenderPass;
+        renderPassInfo.framebuffer = m_Framebuffers[imageIndex];
+        renderPassInfo.renderArea = renderArea;
+        vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+    }
+
+    VkViewport viewport{ 0.0f, 0.0f, (float)m_Extent.width, (float)m_Extent.height, 0.0f, 1.0f };
+    vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
+    vkCmdSetScissor( commandBuffer, 0, 1, &renderArea );
+
+    m_Batch.flush( commandBuffer, m_Extent );
+
+    if ( m_BeginRendering != nullptr )
+    {
+        m_EndRendering( commandBuffer );
+        recordImageBarrier( commandBuffer,
+                            m_Images[imageIndex],
+                            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                            m_ImageLayout,
+                            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                            VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            VK_ACCESS_TRANSFER_READ_BIT );
+    }
+    else
+    {
+        vkCmdEndRenderPass( commandBuffer );
+    }
+
+    m_LastHudCpuMs = ( CpuTimeline::nowUs() - startUs ) / 1000.0;
+}
+
+void PerfHud::buildOverlay()
+{
+    const float x = kMargin;
+    float y = kMargin;
+    const float panelHeight = 6.0f * kLineHeight + 2.0f * ( kGraphHeight + 4.0f ) +
+                              static_cast<float>( m_Heaps.size() ) * kLineHeight + 2.0f * kMargin;
+    m_Batch.submitQuad( { 0.0f, 0.0f }, { kPanelWidth, panelHeight }, kPanelColor );
+
+    // Both graphs share a scale so they can be compared; a 60 Hz frame at the least.
+    float scaleMs = 1000.0f / 60.0f;
+    for ( float ms : m_CpuHistory )
+    {
+        scaleMs = std::max( scaleMs, ms );
+    }
+    for ( float ms : m_GpuHistory )
+    {
+        scaleMs = std::max( scaleMs, ms );
+    }
+
+    char line[64];
+    std::snprintf( line, sizeof( line ), "CPU %.2f MS", m_Counters.cpuMs );
+    drawText( x, y, line, kCpuColor );
+    std::snprintf( line, sizeof( line ), "GPU %.2f MS", m_LastGpuMs );
+    drawText( x + kPanelWidth / 2.0f, y, line, kGpuColor );
+    y += kLineHeight;
+
+    drawGraph( x, y, m_CpuHistory, m_CpuNext, scaleMs, kCpuColor );
+    y += kGraphHeight + 4.0f;
+    drawGraph( x, y, m_GpuHistory, m_GpuNext, scaleMs, kGpuColor );
+    y += kGraphHeight + 4.0f;
+
+    std::snprintf( line, sizeof( line ), "SCALE %.1f MS  FRAME %.2f MS", scaleMs, m_Counters.frameMs );
+    drawText( x, y, line, kTextColor );
+    y += kLineHeight;
+
+    std::snprintf( line, sizeof( line ), "FRAMES IN FLIGHT %u", m_Counters.framesInFlight );
+    drawText( x, y, line, kTextColor );
+    y += kLineHeight;
+
+    std::snprintf( line, sizeof( line ), "DRAWS %u  DISPATCHES %u", m_Counters.draws, m_Counters.dispatches );
+    drawText( x, y, line, kTextColor );
+    y += kLineHeight;
+
+    std::snprintf( line, sizeof( line ), "UPLOAD %.1f KB", static_cast<double>( m_Counters.uploadBytes ) / 1024.0 );
+    drawText( x, y, line, kTextColor );
+    y += kLineHeight;
+
+    for ( size_t i = 0; i < m_Heaps.size(); ++i )
+    {
+        const Heap &heap = m_Heaps[i];
+        const char *kind = heap.deviceLocal ? "VRAM" : "HOST";
+        if ( m_MemoryBudget )
+        {
+            std::snprintf( line, sizeof( line ), "HEAP %zu %s %.0f/%.0f MB", i, kind, toMB( heap.usage ),
+                           toMB( heap.budget ) );
+            drawText( x, y, line, heap.usage > heap.budget * 9 / 10 ? kGpuColor : kTextColor );
+        }
+        else
+        {
+            std::snprintf( line, sizeof( line ), "HEAP %zu %s %.0f MB", i, kind, toMB( heap.size ) );
+            drawText( x, y, line, kTextColor );
+        }
+        y += kLineHeight;
+    }
+
+    std::snprintf( line, sizeof( line ), "HUD CPU %.3f MS", m_LastHudCpuMs );
+    drawText( x, y, line, kGuideColor * 2.0f );
+    std::snprintf( line, sizeof( line ), "GPU %.3f MS", m_LastHudGpuMs );
+    drawText( x + kPanelWidth / 2.0f, y, line, kGuideColor * 2.0f );
+}
+
+void PerfHud::drawText( float x, float y, const char *text, glm::vec3 color )
+{
+    for ( ; *text != '\0'; ++text, x += 4.0f * kTextScale )
+    {
+        const std::array<uint8_t, 5> &rows = m_Font[static_cast<unsigned char>( *text ) & 127];
+        for ( uint32_t row = 0; row < rows.size(); ++row )
+        {
+            // One quad per horizontal run of lit pixels.
+            uint8_t bits = rows[row];
+            for ( uint32_t column = 0; column < 3; )
+            {
+                if ( !( bits & ( 4u >> column ) ) )
+                {
+                    ++column;
+                    continue;
+                }
+                uint32_t end = column + 1;
+                while ( end < 3 && ( bits & ( 4u >> end ) ) )
+                {
+                    ++end;
+                }
+                m_Batch.submitQuad( { x + column * kTextScale, y + row * kTextScale },
+                                    { ( end - column ) * kTextScale, kTextScale },
+                                    color );
+                column = end;
+            }
+        }
+    }
+}
+
+void PerfHud::drawGraph( float x,
+                         float y,
+                         const std::array<float, kHistory> &history,
+                         uint32_t next,
+                         float scaleMs,
+                         glm::vec3 color )
+{
+    const float barWidth = ( kPanelWidth - 2.0f * kMargin ) / kHistory;
+
+    // The 60 Hz budget, where it fits.
+    float budget = kGraphHeight * ( 1000.0f / 60.0f ) / scaleMs;
+    m_Batch.submitQuad( { x, y + kGraphHeight - budget }, { kPanelWidth - 2.0f * kMargin, 1.0f }, kGuideColor );
+
+    // Oldest sample on the left.
+    for ( uint32_t i = 0; i < kHistory; ++i )
+    {
+        float ms = history[( next + i ) % kHistory];
+        float height = std::min( kGraphHeight, kGraphHeight * ms / scaleMs );
+        if ( height > 0.0f )
+        {
+            m_Batch.submitQuad( { x + i * barWidth, y + kGraphHeight - height }, { barWidth, height }, color );
+        }
+    }
+}
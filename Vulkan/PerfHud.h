@@ -0,0 +1,125 @@
+#pragma once
+// On-screen performance overlay.
+//
+// Drawn as a pass of its own on the finished swap chain image, after the scene and any
+// upscale, so it is never scaled and needs nothing from the passes before it. Text is
+// a built-in 3x5 pixel font and graphs are bars, all of it flat quads submitted to a
+// SpriteBatch, which keeps the whole overlay at a single draw.
+//
+// The counters come from the frame before the one being drawn; GPU times arrive
+// whenever the profiler resolves a frame, MAX_FRAMES_IN_FLIGHT frames late.
+
+#include "SpriteBatch.h"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+struct HudCounters
+{
+    // CPU time the render thread spent on the frame, waits excluded.
+    double       cpuMs = 0.0;
+    // Time between two presents.
+    double       frameMs = 0.0;
+    // Negative when no new GPU frame was resolved since the last update.
+    double       gpuMs = -1.0;
+    double       hudGpuMs = -1.0;
+    // Earlier frames the GPU was still working on when the frame started.
+    uint32_t     framesInFlight = 0;
+    uint32_t     draws = 0;
+    uint32_t     dispatches = 0;
+    VkDeviceSize uploadBytes = 0;
+};
+
+struct PerfHudCreateInfo
+{
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice         device = VK_NULL_HANDLE;
+    VkFormat         colorFormat = VK_FORMAT_UNDEFINED;
+    // Layout the images are in before the HUD is drawn, and are left in.
+    VkImageLayout    imageLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // Set with dynamic rendering, which then replaces the render pass and framebuffers.
+    PFN_vkCmdBeginRenderingKHR beginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR   endRendering = nullptr;
+    uint32_t         framesInFlight = 0;
+    // VK_EXT_memory_budget is enabled on the device; otherwise only heap sizes are shown.
+    bool             memoryBudget = false;
+    const AssetArchive *assets = nullptr;
+};
+
+class PerfHud
+{
+public:
+    void create( const PerfHudCreateInfo &createInfo );
+    void cleanup();
+
+    bool isEnabled() const { return m_Device != VK_NULL_HANDLE; }
+
+    // The images drawn to, indexed like the swap chain's. Call again after it was recreated.
+    void createTargets( const std::vector<VkImage> &images, const std::vector<VkImageView> &imageViews, VkExtent2D extent );
+    void cleanupTargets();
+
+    void update( const HudCounters &counters );
+
+    // Recorded outside of any render pass. The scene's writes to the image must be made
+    // visible to the color attachment stage beforehand; the HUD's own are made visible
+    // to transfers, for readback.
+    void record( VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t imageIndex );
+
+    static constexpr VkPipelineStageFlags kImageStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    static constexpr VkAccessFlags        kImageAccess =
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+private:
+    static constexpr uint32_t kHistory = 128;
+
+    void createRenderPass( const PerfHudCreateInfo &createInfo );
+    void queryHeaps();
+    void buildOverlay();
+
+    void drawText( float x, float y, const char *text, glm::vec3 color );
+    void drawGraph( float x, float y, const std::array<float, kHistory> &history, uint32_t next, float scaleMs, glm::vec3 color );
+
+private:
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice         m_Device = VK_NULL_HANDLE;
+    VkFormat         m_ColorFormat = VK_FORMAT_UNDEFINED;
+    VkImageLayout    m_ImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    bool             m_MemoryBudget = false;
+
+    PFN_vkCmdBeginRenderingKHR m_BeginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR   m_EndRendering = nullptr;
+    VkRenderPass               m_RenderPass = VK_NULL_HANDLE;
+
+    std::vector<VkImage>       m_Images;
+    std::vector<VkImageView>   m_ImageViews;
+    std::vector<VkFramebuffer> m_Framebuffers;
+    VkExtent2D                 m_Extent{};
+
+    SpriteBatch m_Batch;
+    // Rows of each glyph, top first, bit 2 the leftmost pixel.
+    std::array<std::array<uint8_t, 5>, 128> m_Font{};
+
+    std::array<float, kHistory> m_CpuHistory{};
+    std::array<float, kHistory> m_GpuHistory{};
+    uint32_t                    m_CpuNext = 0;
+    uint32_t                    m_GpuNext = 0;
+
+    HudCounters m_Counters;
+    double      m_LastGpuMs = 0.0;
+    double      m_LastHudGpuMs = 0.0;
+    // CPU time building the previous overlay.
+    double      m_LastHudCpuMs = 0.0;
+
+    struct Heap
+    {
+        VkDeviceSize size = 0;
+        VkDeviceSize usage = 0;
+        VkDeviceSize budget = 0;
+        bool         deviceLocal = false;
+    };
+    std::vector<Heap> m_Heaps;
+    uint32_t          m_FramesSinceHeapQuery = 0;
+};
@@ -0,0 +1,887 @@
+#include "PointCloud.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+const char     kMagic[8] = { 'V', 'K', 'P', 'O', 'I', 'N', 'T', 'S' };
+const uint32_t kVersion = 1;
+
+struct PointFileHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t nodeCount;
+    uint64_t pointCount;
+    uint64_t recordCount;
+    uint32_t maxChunkPoints;
+    uint32_t reserved;
+    // A cube.
+    float    boundsMin[3];
+    float    boundsMax[3];
+    uint64_t nodesOffset;
+    uint64_t pointsOffset;
+};
+static_assert( sizeof( PointFileHeader ) == 80 );
+
+struct PushConstants
+{
+    // xyz: the center of the cloud, w: the scale into the unit cube.
+    float centerScale[4];
+    float pointSize;
+};
+
+// Spreads the low 8 bits of v out to every third bit.
+uint32_t spreadBits( uint32_t v )
+{
+    v &= 0xff;
+    v = ( v | ( v << 8 ) ) & 0x00f00f;
+    v = ( v | ( v << 4 ) ) & 0x0c30c3;
+    v = ( v | ( v << 2 ) ) & 0x249249;
+    return v;
+}
+
+uint64_t alignUp( uint64_t value, uint64_t alignment )
+{
+    return ( value + alignment - 1 ) / alignment * alignment;
+}
+} // namespace
+
+struct PointCloud::Node
+{
+    float    boundsMin[3];
+    float    boundsMax[3];
+    // The node's chunk, in records.
+    uint64_t firstPoint;
+    uint32_t pointCount;
+    // Leaves have no children.
+    uint32_t firstChild;
+    uint32_t childCount;
+    uint32_t reserved;
+};
+static_assert( sizeof( PointRecord ) == 16 );
+
+VkVertexInputBindingDescription PointRecord::getBindingDescription()
+{
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof( PointRecord );
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    return bindingDescription;
+}
+
+std::array<VkVertexInputAttributeDescription, 2> PointRecord::getAttributeDescription()
+{
+    std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[0].offset = offsetof( PointRecord, position );
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+    attributeDescriptions[1].offset = offsetof( PointRecord, color );
+
+    return attributeDescriptions;
+}
+
+void PointCloud::build( const std::string &inputPath,
+                        const std::string &outputPath,
+                        const PointCloudBuildSettings &settings )
+{
+    if ( settings.maxChunkPoints == 0 )
+    {
+        throw std::runtime_error( "point cloud chunks need at least one point" );
+    }
+    const uint64_t maxChunk = settings.maxChunkPoints;
+
+    MappedFile input;
+    input.open( inputPath );
+    std::span<const char> data = input.getData();
+    if ( data.empty() || data.size() % sizeof( PointRecord ) != 0 )
+    {
+        throw std::runtime_error( inputPath + " is not a file of point records" );
+    }
+    const PointRecord *points = reinterpret_cast<const PointRecord *>( data.data() );
+    const uint64_t pointCount = data.size() / sizeof( PointRecord );
+
+    glm::vec3 low( FLT_MAX );
+    glm::vec3 high( -FLT_MAX );
+    for ( uint64_t i = 0; i < pointCount; ++i )
+    {
+        glm::vec3 position( points[i].position[0], points[i].position[1], points[i].position[2] );
+        low = glm::min( low, position );
+        high = glm::max( high, position );
+    }
+    // Cubic cells keep the octree's children cubes too.
+    glm::vec3 center = ( low + high ) * 0.5f;
+    glm::vec3 extent = high - low;
+    float halfSize = std::max( std::max( extent.x, extent.y ), extent.z ) * 0.5f;
+    halfSize = halfSize > 0.0f ? halfSize : 1.0f;
+    low = center - glm::vec3( halfSize );
+    high = center + glm::vec3( halfSize );
+
+    const uint32_t depth = std::clamp( settings.gridDepth, 1u, 8u );
+    const uint32_t resolution = 1u << depth;
+    const uint32_t cellCount = 1u << ( 3 * depth );
+    const float    cellsPerUnit = resolution / ( 2.0f * halfSize );
+    auto cellOf = [&]( const PointRecord &point ) {
+        uint32_t code = 0;
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            float cell = ( point.position[axis] - low[axis] ) * cellsPerUnit;
+            uint32_t index = cell > 0.0f ? std::min( static_cast<uint32_t>( cell ), resolution - 1 ) : 0;
+            code |= spreadBits( index ) << axis;
+        }
+        return code;
+    };
+
+    // Where every cell's points start once sorted.
+    std::vector<uint64_t> cellStart( cellCount + 1, 0 );
+    for ( uint64_t i = 0; i < pointCount; ++i )
+    {
+        ++cellStart[cellOf( points[i] ) + 1];
+    }
+    for ( uint32_t cell = 0; cell < cellCount; ++cell )
+    {
+        cellStart[cell + 1] += cellStart[cell];
+    }
+
+    // Breadth first, so that the children of a node are appended next to each other.
+    struct BuildNode
+    {
+        uint32_t level;
+        uint32_t firstCell;
+        // The run of sorted points below the node.
+        uint64_t first;
+        uint64_t count;
+    };
+    std::vector<Node>      nodes;
+    std::vector<BuildNode> buildNodes;
+    std::vector<uint32_t>  interiorNodes;
+    uint64_t               recordCount = pointCount;
+
+    Node root{};
+    for ( int axis = 0; axis < 3; ++axis )
+    {
+        root.boundsMin[axis] = low[axis];
+        root.boundsMax[axis] = high[axis];
+    }
+    nodes.push_back( root );
+    buildNodes.push_back( BuildNode{ 0, 0, 0, pointCount } );
+    for ( size_t i = 0; i < nodes.size(); ++i )
+    {
+        const BuildNode current = buildNodes[i];
+        if ( current.count <= maxChunk )
+        {
+            nodes[i].firstPoint = current.first;
+            nodes[i].pointCount = static_cast<uint32_t>( current.count );
+            continue;
+        }
+
+        nodes[i].firstPoint = recordCount;
+        nodes[i].pointCount = settings.maxChunkPoints;
+        nodes[i].firstChild = static_cast<uint32_t>( nodes.size() );
+        recordCount += maxChunk;
+        interiorNodes.push_back( static_cast<uint32_t>( i ) );
+
+        const Node parent = nodes[i];
+        if ( current.level < depth )
+        {
+            const uint32_t childCells = 1u << ( 3 * ( depth - current.level - 1 ) );
+            const float    childSize = ( parent.boundsMax[0] - parent.boundsMin[0] ) * 0.5f;
+            for ( uint32_t octant = 0; octant < 8; ++octant )
+            {
+                uint32_t firstCell = current.firstCell + octant * childCells;
+                uint64_t first = cellStart[firstCell];
+                uint64_t count = cellStart[firstCell + childCells] - first;
+                if ( count == 0 )
+                {
+                    continue;
+                }
+
+                Node child{};
+                for ( int axis = 0; axis < 3; ++axis )
+                {
+                    child.boundsMin[axis] = parent.boundsMin[axis] + ( ( octant >> axis ) & 1 ) * childSize;
+                    child.boundsMax[axis] = child.boundsMin[axis] + childSize;
+                }
+                nodes.push_back( child );
+                buildNodes.push_back( BuildNode{ current.level + 1, firstCell, first, count } );
+            }
+        }
+        else
+        {
+            // A single cell denser than a chunk: split it by count into leaves that
+            // all share its bounds.
+            uint64_t pieces = ( current.count + maxChunk - 1 ) / maxChunk;
+            for ( uint64_t piece = 0; piece < pieces; ++piece )
+            {
+                uint64_t first = current.first + piece * current.count / pieces;
+                uint64_t end = current.first + ( piece + 1 ) * current.count / pieces;
+
+                Node child{};
+                std::copy( parent.boundsMin, parent.boundsMin + 3, child.boundsMin );
+                std::copy( parent.boundsMax, parent.boundsMax + 3, child.boundsMax );
+                nodes.push_back( child );
+                buildNodes.push_back( BuildNode{ current.level, current.firstCell, first, end - first } );
+            }
+        }
+        nodes[i].childCount = static_cast<uint32_t>( nodes.size() ) - nodes[i].firstChild;
+    }
+
+    PointFileHeader header{};
+    memcpy( header.magic, kMagic, sizeof( kMagic ) );
+    header.version = kVersion;
+    header.nodeCount = static_cast<uint32_t>( nodes.size() );
+    header.pointCount = pointCount;
+    header.recordCount = recordCount;
+    header.maxChunkPoints = settings.maxChunkPoints;
+    std::copy( nodes[0].boundsMin, nodes[0].boundsMin + 3, header.boundsMin );
+    std::copy( nodes[0].boundsMax, nodes[0].boundsMax + 3, header.boundsMax );
+    header.nodesOffset = sizeof( header );
+    header.pointsOffset = alignUp( header.nodesOffset + nodes.size() * sizeof( Node ), sizeof( PointRecord ) );
+
+    std::ofstream out( outputPath, std::ios::binary | std::ios::trunc );
+    if ( !out )
+    {
+        throw std::runtime_error( "failed to create " + outputPath );
+    }
+    out.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+    out.write( reinterpret_cast<const char *>( nodes.data() ), nodes.size() * sizeof( Node ) );
+
+    // Sorts a run of whole cells at a time, each in one more pass over the input, so
+    // the memory needed doesn't grow with the scan. A single cell larger than the batch
+    // is still sorted in one go.
+    const uint64_t batchPoints = std::max<uint64_t>( settings.batchBytes / sizeof( PointRecord ), 1 );
+    std::vector<PointRecord> batch;
+    std::vector<PointRecord> samples;
+    std::vector<uint64_t>    cursors;
+    for ( uint32_t firstCell = 0; firstCell < cellCount; )
+    {
+        uint32_t endCell = firstCell + 1;
+        while ( endCell < cellCount && cellStart[endCell + 1] - cellStart[firstCell] <= batchPoints )
+        {
+            ++endCell;
+        }
+        const uint64_t first = cellStart[firstCell];
+        const uint64_t count = cellStart[endCell] - first;
+        if ( count == 0 )
+        {
+            firstCell = endCell;
+            continue;
+        }
+
+        batch.resize( count );
+        cursors.assign( cellStart.begin() + firstCell, cellStart.begin() + endCell );
+        for ( uint64_t i = 0; i < pointCount; ++i )
+        {
+            uint32_t cell = cellOf( points[i] );
+            if ( cell >= firstCell && cell < endCell )
+            {
+                batch[cursors[cell - firstCell]++ - first] = points[i];
+            }
+        }
+        out.seekp( header.pointsOffset + first * sizeof( PointRecord ) );
+        out.write( reinterpret_cast<const char *>( batch.data() ), count * sizeof( PointRecord ) );
+
+        // Sample s of an interior node is point first + s * count / maxChunk of its run.
+        for ( uint32_t index : interiorNodes )
+        {
+            const BuildNode &node = buildNodes[index];
+            auto firstSampleAt = [&]( uint64_t point ) {
+                if ( point <= node.first )
+                {
+                    return uint64_t( 0 );
+                }
+                return std::min( ( ( point - node.first ) * maxChunk + node.count - 1 ) / node.count, maxChunk );
+            };
+            uint64_t sampleBegin = firstSampleAt( first );
+            uint64_t sampleEnd = firstSampleAt( first + count );
+            if ( sampleBegin >= sampleEnd )
+            {
+                continue;
+            }
+
+            samples.clear();
+            for ( uint64_t s = sampleBegin; s < sampleEnd; ++s )
+            {
+                samples.push_back( batch[node.first + s * node.count / maxChunk - first] );
+            }
+            out.seekp( header.pointsOffset + ( nodes[index].firstPoint + sampleBegin ) * sizeof( PointRecord ) );
+            out.write( reinterpret_cast<const char *>( samples.data() ), samples.size() * sizeof( PointRecord ) );
+        }
+        firstCell = endCell;
+    }
+
+    if ( !out )
+    {
+        throw std::runtime_error( "failed to write " + outputPath );
+    }
+}
+
+void PointCloud::create( const PointCloudCreateInfo &createInfo )
+{
+    m_File.open( createInfo.path );
+
+    std::span<const char> data = m_File.getData();
+    PointFileHeader header;
+    if ( data.size() < sizeof( header ) )
+    {
+        m_File.close();
+        throw std::runtime_error( createInfo.path + " is not a point cloud" );
+    }
+    memcpy( &header, data.data(), sizeof( header ) );
+    if ( memcmp( header.magic, kMagic, sizeof( kMagic ) ) != 0 || header.version != kVersion ||
+         header.nodeCount == 0 || header.maxChunkPoints == 0 )
+    {
+        m_File.close();
+        throw std::runtime_error( createInfo.path + " is not a point cloud" );
+    }
+    // Written so that no sum of the file's fields can wrap around.
+    if ( header.nodesOffset % alignof( Node ) != 0 || header.pointsOffset % alignof( PointRecord ) != 0 ||
+         header.nodesOffset > data.size() || header.nodeCount > ( data.size() - header.nodesOffset ) / sizeof( Node ) ||
+         header.pointsOffset > data.size() ||
+         header.recordCount > ( data.size() - header.pointsOffset ) / sizeof( PointRecord ) )
+    {
+        m_File.close();
+        throw std::runtime_error( createInfo.path + " is truncated" );
+    }
+
+    m_Nodes = reinterpret_cast<const Node *>( data.data() + header.nodesOffset );
+    m_NodeCount = header.nodeCount;
+    m_Records = reinterpret_cast<const PointRecord *>( data.data() + header.pointsOffset );
+    m_PointCount = header.pointCount;
+    m_ChunkPoints = header.maxChunkPoints;
+    for ( uint32_t i = 0; i < m_NodeCount; ++i )
+    {
+        const Node &node = m_Nodes[i];
+        if ( node.pointCount > m_ChunkPoints || node.firstPoint > header.recordCount ||
+             node.pointCount > header.recordCount - node.firstPoint ||
+             ( node.childCount > 0 && ( node.firstChild <= i || node.firstChild > m_NodeCount ||
+                                        node.childCount > m_NodeCount - node.firstChild ) ) )
+        {
+            m_File.close();
+            throw std::runtime_error( createInfo.path + " has an invalid octree" );
+        }
+    }
+
+    glm::vec3 low( header.boundsMin[0], header.boundsMin[1], header.boundsMin[2] );
+    glm::vec3 high( header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] );
+    m_Center = ( low + high ) * 0.5f;
+    m_Scale = high.x > low.x ? 1.0f / ( high.x - low.x ) : 1.0f;
+
+    m_PhysicalDevice = createInfo.physicalDevice;
+    m_Device = createInfo.device;
+    m_FramesInFlight = createInfo.framesInFlight;
+    m_UploadsPerFrame = std::max( createInfo.uploadsPerFrame, 1u );
+    m_PointSpacing = createInfo.pointSpacing;
+    m_PointSize = createInfo.largePoints ? createInfo.pointSize : 1.0f;
+    m_NodeStates.assign( m_NodeCount, NodeState{} );
+    m_FrameNumber = 0;
+    m_ResidentCount = 0;
+    m_Uploads = 0;
+    m_Evictions = 0;
+
+    const VkDeviceSize slotBytes = VkDeviceSize( m_ChunkPoints ) * sizeof( PointRecord );
+    uint32_t slotCount = static_cast<uint32_t>(
+        std::clamp<VkDeviceSize>( createInfo.budgetBytes / slotBytes, 1, m_NodeCount ) );
+    createBuffer( m_PhysicalDevice,
+                  m_Device,
+                  slotCount * slotBytes,
+                  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                  m_PoolBuffer,
+                  m_PoolMemory );
+    m_SlotNodes.assign( slotCount, kNone );
+    m_FreeSlots.clear();
+    for ( uint32_t slot = slotCount; slot > 0; --slot )
+    {
+        m_FreeSlots.push_back( slot - 1 );
+    }
+
+    // Enough for the uploads of every frame in flight plus the one being loaded.
+    m_Staging.assign( m_UploadsPerFrame * ( m_FramesInFlight + 1 ), Staging{} );
+    createBuffer( m_PhysicalDevice,
+                  m_Device,
+                  m_Staging.size() * slotBytes,
+                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  m_StagingBuffer,
+                  m_StagingMemory );
+    void *mapped;
+    vkMapMemory( m_Device, m_StagingMemory, 0, VK_WHOLE_SIZE, 0, &mapped );
+    m_StagingMapped = static_cast<char *>( mapped );
+
+    createPipeline( createInfo );
+
+    m_Stop = false;
+    for ( uint32_t i = 0; i < std::max( createInfo.workerCount, 1u ); ++i )
+    {
+        m_Workers.emplace_back( &PointCloud::workerLoop, this );
+    }
+}
+
+void PointCloud::cleanup()
+{
+    if ( m_Device == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        m_Stop = true;
+    }
+    m_WorkAvailable.notify_all();
+    for ( std::thread &worker : m_Workers )
+    {
+        worker.join();
+    }
+    m_Workers.clear();
+    m_Jobs.clear();
+    m_Loaded.clear();
+
+    vkDestroyPipeline( m_Device, m_Pipeline, nullptr );
+    vkDestroyPipelineLayout( m_Device, m_PipelineLayout, nullptr );
+    vkUnmapMemory( m_Device, m_StagingMemory );
+    vkDestroyBuffer( m_Device, m_StagingBuffer, nullptr );
+    vkFreeMemory( m_Device, m_StagingMemory, nullptr );
+    vkDestroyBuffer( m_Device, m_PoolBuffer, nullptr );
+    vkFreeMemory( m_Device, m_PoolMemory, nullptr );
+    m_Pipeline = VK_NULL_HANDLE;
+    m_PipelineLayout = VK_NULL_HANDLE;
+    m_StagingBuffer = VK_NULL_HANDLE;
+    m_StagingMemory = VK_NULL_HANDLE;
+    m_StagingMapped = nullptr;
+    m_PoolBuffer = VK_NULL_HANDLE;
+    m_PoolMemory = VK_NULL_HANDLE;
+
+    m_Staging.clear();
+    m_SlotNodes.clear();
+    m_FreeSlots.clear();
+    m_NodeStates.clear();
+    m_Requests.clear();
+    m_Draws.clear();
+    m_File.close();
+    m_Nodes = nullptr;
+    m_Records = nullptr;
+    m_NodeCount = 0;
+    m_Device = VK_NULL_HANDLE;
+}
+
+void PointCloud::update( const glm::mat4 &modelViewProj, float projectionScale, VkExtent2D extent, uint64_t frameNumber )
+{
+    m_FrameNumber = frameNumber;
+
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        // The frame that copied out of a staging slot has retired.
+        for ( Staging &staging : m_Staging )
+        {
+            if ( staging.state == StagingState::InFlight && staging.frameNumber + m_FramesInFlight <= frameNumber )
+            {
+                staging.state = StagingState::Free;
+            }
+        }
+        // Requests not picked up yet are made again below if they still matter.
+        for ( const Job &job : m_Jobs )
+        {
+            m_NodeStates[job.node].loading = false;
+            m_Staging[job.staging].state = StagingState::Free;
+        }
+        m_Jobs.clear();
+    }
+
+    m_Requests.clear();
+    m_Draws.clear();
+    m_DrawnPoints = 0;
+    visit( 0, kNone, modelViewProj, projectionScale * extent.height * 0.5f );
+
+    std::sort( m_Requests.begin(), m_Requests.end(), []( const Request &a, const Request &b ) {
+        return a.priority > b.priority;
+    } );
+
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        uint32_t staging = 0;
+        for ( size_t i = 0; i < m_Requests.size() && m_Jobs.size() < m_UploadsPerFrame; ++i )
+        {
+            while ( staging < m_Staging.size() && m_Staging[staging].state != StagingState::Free )
+            {
+                ++staging;
+            }
+            if ( staging == m_Staging.size() )
+            {
+                break;
+            }
+            m_Staging[staging].state = StagingState::Queued;
+            m_NodeStates[m_Requests[i].node].loading = true;
+            m_Jobs.push_back( Job{ m_Requests[i].node, staging } );
+        }
+    }
+    m_WorkAvailable.notify_all();
+}
+
+void PointCloud::visit( uint32_t index, uint32_t fallback, const glm::mat4 &modelViewProj, float pixelScale )
+{
+    const Node &node = m_Nodes[index];
+    NodeState &state = m_NodeStates[index];
+
+    glm::vec3 low = ( glm::vec3( node.boundsMin[0], node.boundsMin[1], node.boundsMin[2] ) - m_Center ) * m_Scale;
+    glm::vec3 high = ( glm::vec3( node.boundsMax[0], node.boundsMax[1], node.boundsMax[2] ) - m_Center ) * m_Scale;
+
+    // Culled when all corners are outside the same clip plane.
+    bool outside[6] = { true, true, true, true, true, true };
+    for ( uint32_t corner = 0; corner < 8; ++corner )
+    {
+        glm::vec4 clip = modelViewProj * glm::vec4( corner & 1 ? high.x : low.x,
+                                                    corner & 2 ? high.y : low.y,
+                                                    corner & 4 ? high.z : low.z,
+                                                    1.0f );
+        outside[0] = outside[0] && clip.x < -clip.w;
+        outside[1] = outside[1] && clip.x > clip.w;
+        outside[2] = outside[2] && clip.y < -clip.w;
+        outside[3] = outside[3] && clip.y > clip.w;
+        outside[4] = outside[4] && clip.z < 0.0f;
+        outside[5] = outside[5] && clip.z > clip.w;
+    }
+    if ( std::find( std::begin( outside ), std::end( outside ), true ) != std::end( outside ) )
+    {
+        return;
+    }
+
+    // The bounding sphere's diameter in pixels; unbounded once the camera is inside it.
+    float diameter = glm::length( high - low );
+    float distance = ( modelViewProj * glm::vec4( ( low + high ) * 0.5f, 1.0f ) ).w;
+    float screenSize = distance > diameter * 0.5f ? diameter * pixelScale / distance : FLT_MAX;
+
+    if ( state.slot != kNone )
+    {
+        state.lastUsedFrame = m_FrameNumber;
+        fallback = index;
+    }
+    else if ( !state.loading )
+    {
+        m_Requests.push_back( Request{ screenSize, index } );
+    }
+
+    bool refine = node.childCount > 0 && screenSize > std::sqrt( static_cast<float>( node.pointCount ) ) * m_PointSpacing;
+    if ( refine )
+    {
+        for ( uint32_t child = 0; child < node.childCount; ++child )
+        {
+            visit( node.firstChild + child, fallback, modelViewProj, pixelScale );
+        }
+    }
+    else if ( fallback != kNone )
+    {
+        draw( fallback );
+    }
+}
+
+void PointCloud::draw( uint32_t index )
+{
+    NodeState &state = m_NodeStates[index];
+    if ( state.drawnFrame == m_FrameNumber )
+    {
+        return;
+    }
+    state.drawnFrame = m_FrameNumber;
+    m_Draws.push_back( Draw{ state.slot * m_ChunkPoints, m_Nodes[index].pointCount } );
+    m_DrawnPoints += m_Nodes[index].pointCount;
+}
+
+uint32_t PointCloud::allocateSlot()
+{
+    if ( !m_FreeSlots.empty() )
+    {
+        uint32_t slot = m_FreeSlots.back();
+        m_FreeSlots.pop_back();
+        return slot;
+    }
+
+    // Least recently used, but never a chunk drawn by this frame.
+    uint32_t victim = kNone;
+    uint64_t oldest = m_FrameNumber;
+    for ( uint32_t slot = 0; slot < m_SlotNodes.size(); ++slot )
+    {
+        uint64_t lastUsed = m_NodeStates[m_SlotNodes[slot]].lastUsedFrame;
+        if ( lastUsed < oldest )
+        {
+            oldest = lastUsed;
+            victim = slot;
+        }
+    }
+    if ( victim != kNone )
+    {
+        m_NodeStates[m_SlotNodes[victim]].slot = kNone;
+        m_SlotNodes[victim] = kNone;
+        --m_ResidentCount;
+        ++m_Evictions;
+    }
+    return victim;
+}
+
+void PointCloud::recordUploads( VkCommandBuffer commandBuffer )
+{
+    m_LastUploadBytes = 0;
+
+    const VkDeviceSize slotBytes = VkDeviceSize( m_ChunkPoints ) * sizeof( PointRecord );
+    std::vector<VkBufferCopy> regions;
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        for ( const Job &job : m_Loaded )
+        {
+            NodeState &state = m_NodeStates[job.node];
+            state.loading = false;
+            uint32_t slot = allocateSlot();
+            if ( slot == kNone )
+            {
+                // The budget is taken by what this frame draws; asked for again later.
+                m_Staging[job.staging].state = StagingState::Free;
+                continue;
+            }
+
+            VkDeviceSize size = VkDeviceSize( m_Nodes[job.node].pointCount ) * sizeof( PointRecord );
+            regions.push_back( VkBufferCopy{ job.staging * slotBytes, slot * slotBytes, size } );
+            m_Staging[job.staging] = Staging{ StagingState::InFlight, m_FrameNumber };
+            m_SlotNodes[slot] = job.node;
+            state.slot = slot;
+            state.lastUsedFrame = m_FrameNumber;
+            ++m_ResidentCount;
+            m_LastUploadBytes += size;
+        }
+        m_Loaded.clear();
+    }
+    if ( regions.empty() )
+    {
+        return;
+    }
+    m_Uploads += regions.size();
+
+    // Slots being replaced may still be read by earlier frames.
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = m_PoolBuffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          0, 0, nullptr, 1, &barrier, 0, nullptr );
+
+    vkCmdCopyBuffer( commandBuffer, m_StagingBuffer, m_PoolBuffer, static_cast<uint32_t>( regions.size() ), regions.data() );
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                          0, 0, nullptr, 1, &barrier, 0, nullptr );
+}
+
+void PointCloud::recordDraw( VkCommandBuffer commandBuffer, VkDescriptorSet sceneSet )
+{
+    if ( m_Draws.empty() )
+    {
+        return;
+    }
+
+    vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline );
+    vkCmdBindDescriptorSets( commandBuffer,
+                             VK_PIPELINE_BIND_POINT_GRAPHICS,
+                             m_PipelineLayout,
+                             0,
+                             1,
+                             &sceneSet,
+                             0,
+                             nullptr );
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers( commandBuffer, 0, 1, &m_PoolBuffer, &offset );
+
+    PushConstants pushConstants{ { m_Center.x, m_Center.y, m_Center.z, m_Scale }, m_PointSize };
+    vkCmdPushConstants( commandBuffer,
+                        m_PipelineLayout,
+                        VK_SHADER_STAGE_VERTEX_BIT,
+                        0,
+                        sizeof( pushConstants ),
+                        &pushConstants );
+
+    for ( const Draw &draw : m_Draws )
+    {
+        vkCmdDraw( commandBuffer, draw.vertexCount, 1, draw.firstVertex, 0 );
+    }
+}
+
+void PointCloud::workerLoop()
+{
+    const VkDeviceSize slotBytes = VkDeviceSize( m_ChunkPoints ) * sizeof( PointRecord );
+    for ( ;; )
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock( m_Mutex );
+            m_WorkAvailable.wait( lock, [this] { return m_Stop || !m_Jobs.empty(); } );
+            if ( m_Stop )
+            {
+                return;
+            }
+            job = m_Jobs.front();
+            m_Jobs.pop_front();
+            m_Staging[job.staging].state = StagingState::Loading;
+        }
+
+        // Faults the chunk's pages in from disk.
+        const Node &node = m_Nodes[job.node];
+        memcpy( m_StagingMapped + job.staging * slotBytes,
+                m_Records + node.firstPoint,
+                node.pointCount * sizeof( PointRecord ) );
+
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        m_Loaded.push_back( job );
+    }
+}
+
+VkShaderModule PointCloud::loadShaderModule( const PointCloudCreateInfo &createInfo, const std::string &name ) const
+{
+    if ( createInfo.assets )
+    {
+        return createShaderModule( m_Device, createInfo.assets->load( name ).getData() );
+    }
+    return createShaderModule( m_Device, readFile( name ) );
+}
+
+void PointCloud::createPipeline( const PointCloudCreateInfo &createInfo )
+{
+    VkShaderModule vertShaderModule = loadShaderModule( createInfo, "point_vert.spv" );
+    VkShaderModule fragShaderModule = loadShaderModule( createInfo, "frag.spv" );
+
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module = fragShaderModule;
+    fragShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+
+    auto bindingDescription = PointRecord::getBindingDescription();
+    auto attributeDescriptions = PointRecord::getAttributeDescription();
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>( attributeDescriptions.size() );
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>( dynamicStates.size() );
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof( PushConstants );
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &createInfo.sceneSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if ( vkCreatePipelineLayout( m_Device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create point cloud pipeline layout!" );
+    }
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_PipelineLayout;
+    pipelineInfo.renderPass = createInfo.renderPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &createInfo.colorFormat;
+    if ( createInfo.renderPass == VK_NULL_HANDLE )
+    {
+        pipelineInfo.pNext = &renderingInfo;
+    }
+
+    if ( vkCreateGraphicsPipelines( m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create point cloud pipeline!" );
+    }
+
+    vkDestroyShaderModule( m_Device, fragShaderModule, nullptr );
+    vkDestroyShaderModule( m_Device, vertShaderModule, nullptr );
+}
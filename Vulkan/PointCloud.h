@@ -0,0 +1,228 @@
+#pragma once
+// Out-of-core point clouds.
+//
+// A scan is converted once into an octree file (--build-point-cloud). Its points are
+// sorted into the cells of a uniform grid in Morton order, so every octree node covers
+// one contiguous run of them. A node of at most maxChunkPoints points is a leaf and
+// its chunk is that run. Larger nodes are split, and their chunk is an evenly strided
+// sample of their run, stored behind the leaves. A node's chunk is a coarse version
+// of everything below it.
+//
+// Layout, all little endian:
+//   Header
+//   Node[nodeCount], breadth first; a node's children are contiguous
+//   PointRecord[recordCount]: every input point once, in leaf order, then the samples
+//
+// At run time the file is mapped, never read as a whole. update() walks the octree
+// every frame, culls nodes against the view and refines those that cover too many
+// pixels for their point count. Missing chunks are requested biggest on screen first.
+// Worker threads copy them out of the mapping into staging buffers, so the page faults
+// happen there. recordUploads copies them into fixed-size slots of one device local
+// vertex buffer sized by the memory budget, evicting the least recently drawn chunks
+// when it is full. Until a chunk is resident its nearest resident ancestor is drawn.
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include "AssetArchive.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The layout of the input files, the octree file and the vertex buffer alike.
+struct PointRecord
+{
+    float    position[3];
+    // RGBA8, red in the lowest byte.
+    uint32_t color;
+
+    static VkVertexInputBindingDescription getBindingDescription();
+    static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescription();
+};
+
+struct PointCloudBuildSettings
+{
+    uint32_t maxChunkPoints = 64 * 1024;
+    // The sorting grid has 2^gridDepth cells per axis, at most 2^8; every level costs
+    // eight times the counters. Cells denser than a chunk are split by count.
+    uint32_t gridDepth = 7;
+    // Sorted points held in memory at once. Every batch is one pass over the input.
+    uint64_t batchBytes = 1ull << 30;
+};
+
+struct PointCloudCreateInfo
+{
+    VkPhysicalDevice      physicalDevice = VK_NULL_HANDLE;
+    VkDevice              device = VK_NULL_HANDLE;
+    // VK_NULL_HANDLE with dynamic rendering; the pipeline is then built for colorFormat.
+    VkRenderPass          renderPass = VK_NULL_HANDLE;
+    VkFormat              colorFormat = VK_FORMAT_UNDEFINED;
+    // Layout of the set holding the scene's UniformBufferObject at binding 0.
+    VkDescriptorSetLayout sceneSetLayout = VK_NULL_HANDLE;
+    uint32_t              framesInFlight = 0;
+    // Shaders are loaded from here when set, otherwise from the working directory.
+    const AssetArchive   *assets = nullptr;
+
+    // An octree file written by build().
+    std::string  path;
+    // Size of the chunk pool on the device.
+    VkDeviceSize budgetBytes = 512ull << 20;
+    uint32_t     workerCount = 2;
+    uint32_t     uploadsPerFrame = 8;
+    // A node is refined when its chunk would leave points further apart than this on screen.
+    float        pointSpacing = 2.0f;
+    // Points larger than one pixel need the largePoints feature.
+    bool         largePoints = false;
+    float        pointSize = 1.0f;
+};
+
+class PointCloud
+{
+public:
+    // Converts a file of PointRecords into the octree format. Throws
+    // std::runtime_error on I/O errors or when the input isn't a whole number of records.
+    static void build( const std::string &inputPath,
+                       const std::string &outputPath,
+                       const PointCloudBuildSettings &settings = {} );
+
+    void create( const PointCloudCreateInfo &createInfo );
+    void cleanup();
+
+    bool isEnabled() const { return m_Device != VK_NULL_HANDLE; }
+
+    // Call once per frame after the frame's fence was waited on. modelViewProj is the
+    // scene's transform and projectionScale the projection's focal length in y, both
+    // for the cloud scaled into a unit cube around the origin. frameNumber must
+    // increase by one every frame.
+    void update( const glm::mat4 &modelViewProj, float projectionScale, VkExtent2D extent, uint64_t frameNumber );
+
+    // Copies the chunks the workers finished. Must be outside of a render pass.
+    void recordUploads( VkCommandBuffer commandBuffer );
+    // Recorded inside the render pass; expects the scene's set for the frame.
+    void recordDraw( VkCommandBuffer commandBuffer, VkDescriptorSet sceneSet );
+
+    uint64_t     getPointCount() const { return m_PointCount; }
+    uint32_t     getNodeCount() const { return m_NodeCount; }
+    // For the last update / recordUploads.
+    uint32_t     getDrawCount() const { return static_cast<uint32_t>( m_Draws.size() ); }
+    uint64_t     getDrawnPoints() const { return m_DrawnPoints; }
+    VkDeviceSize getLastUploadBytes() const { return m_LastUploadBytes; }
+    // Since create.
+    uint32_t     getResidentCount() const { return m_ResidentCount; }
+    uint32_t     getSlotCount() const { return static_cast<uint32_t>( m_SlotNodes.size() ); }
+    uint64_t     getUploadCount() const { return m_Uploads; }
+    uint64_t     getEvictionCount() const { return m_Evictions; }
+
+private:
+    struct Node;
+
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct NodeState
+    {
+        uint32_t slot = kNone;
+        uint64_t lastUsedFrame = 0;
+        // Several culled children may fall back to the same ancestor.
+        uint64_t drawnFrame = UINT64_MAX;
+        // Queued for or being copied by a worker.
+        bool     loading = false;
+    };
+
+    enum class StagingState
+    {
+        Free,
+        Queued,
+        // Copied to by a worker, or waiting for recordUploads.
+        Loading,
+        // Read by the copy of frame frameNumber.
+        InFlight,
+    };
+
+    struct Staging
+    {
+        StagingState state = StagingState::Free;
+        uint64_t     frameNumber = 0;
+    };
+
+    struct Job
+    {
+        uint32_t node;
+        uint32_t staging;
+    };
+
+    struct Request
+    {
+        float    priority;
+        uint32_t node;
+    };
+
+    struct Draw
+    {
+        uint32_t firstVertex;
+        uint32_t vertexCount;
+    };
+
+    void workerLoop();
+    void visit( uint32_t node, uint32_t fallback, const glm::mat4 &modelViewProj, float pixelScale );
+    void draw( uint32_t node );
+    uint32_t allocateSlot();
+    void createPipeline( const PointCloudCreateInfo &createInfo );
+    VkShaderModule loadShaderModule( const PointCloudCreateInfo &createInfo, const std::string &name ) const;
+
+private:
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice         m_Device = VK_NULL_HANDLE;
+    uint32_t         m_FramesInFlight = 0;
+    uint32_t         m_UploadsPerFrame = 0;
+    float            m_PointSpacing = 0.0f;
+    float            m_PointSize = 1.0f;
+
+    MappedFile         m_File;
+    const Node        *m_Nodes = nullptr;
+    uint32_t           m_NodeCount = 0;
+    const PointRecord *m_Records = nullptr;
+    uint64_t           m_PointCount = 0;
+    uint32_t           m_ChunkPoints = 0;
+    // Maps the file's coordinates into a unit cube around the origin.
+    glm::vec3          m_Center;
+    float              m_Scale = 1.0f;
+
+    std::vector<NodeState> m_NodeStates;
+    uint64_t               m_FrameNumber = 0;
+    std::vector<Request>   m_Requests;
+    std::vector<Draw>      m_Draws;
+    uint64_t               m_DrawnPoints = 0;
+
+    // The chunk pool: one vertex buffer of fixed-size slots.
+    VkBuffer              m_PoolBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory        m_PoolMemory = VK_NULL_HANDLE;
+    std::vector<uint32_t> m_SlotNodes;
+    std::vector<uint32_t> m_FreeSlots;
+    uint32_t              m_ResidentCount = 0;
+
+    VkBuffer             m_StagingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory       m_StagingMemory = VK_NULL_HANDLE;
+    char                *m_StagingMapped = nullptr;
+    std::vector<Staging> m_Staging;
+
+    VkDeviceSize m_LastUploadBytes = 0;
+    uint64_t     m_Uploads = 0;
+    uint64_t     m_Evictions = 0;
+
+    VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+    VkPipeline       m_Pipeline = VK_NULL_HANDLE;
+
+    std::vector<std::thread> m_Workers;
+    std::mutex               m_Mutex;
+    std::condition_variable  m_WorkAvailable;
+    std::deque<Job>          m_Jobs;
+    std::vector<Job>         m_Loaded;
+    bool                     m_Stop = false;
+};
@@ -0,0 +1,25 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+layout(push_constant) uniform PushConstants {
+    // xyz: center of the cloud, w: scale into the unit cube.
+    vec4 centerScale;
+    float pointSize;
+} push;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec4 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    vec3 position = (inPosition - push.centerScale.xyz) * push.centerScale.w;
+    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(position, 1.0);
+    gl_PointSize = push.pointSize;
+    fragColor = inColor.rgb;
+}
\ No newline at end of file
@@ -0,0 +1,576 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+// Per-thread ring capacity; must be a power of two.
+constexpr uint64_t kThreadEventCapacity = 1 << 16;
+// Resolved GPU scopes kept for export.
+constexpr size_t kMaxGpuHistory = 1 << 20;
+constexpr size_t kMaxPassHistory = 1 << 18;
+
+// Results come back in bit order, one value per enabled statistic.
+constexpr VkQueryPipelineStatisticFlags kPipelineStatistics =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT | VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+constexpr uint32_t kPipelineStatisticCount = 6;
+
+struct ThreadEvents
+{
+    uint32_t                threadId = 0;
+    std::string             name;
+    std::vector<TraceEvent> ring;
+    std::atomic<uint64_t>   head{ 0 };
+};
+
+const std::chrono::steady_clock::time_point g_Epoch = std::chrono::steady_clock::now();
+
+std::mutex                                 g_RegistryMutex;
+std::vector<std::shared_ptr<ThreadEvents>> g_Threads;
+
+std::shared_ptr<ThreadEvents> registerThread()
+{
+    auto events = std::make_shared<ThreadEvents>();
+    events->ring.resize( kThreadEventCapacity );
+
+    std::lock_guard<std::mutex> lock( g_RegistryMutex );
+    events->threadId = static_cast<uint32_t>( g_Threads.size() + 1 );
+    events->name = "thread " + std::to_string( events->threadId );
+    g_Threads.push_back( events );
+    return events;
+}
+
+ThreadEvents &localEvents()
+{
+    // The registry keeps the ring alive after the thread exits so its events still export.
+    thread_local std::shared_ptr<ThreadEvents> events = registerThread();
+    return *events;
+}
+
+void writeJsonString( std::ofstream &out, const std::string &text )
+{
+    out << '"';
+    for ( char c : text )
+    {
+        if ( c == '"' || c == '\\' )
+        {
+            out << '\\' << c;
+        }
+        else if ( static_cast<unsigned char>( c ) < 0x20 )
+        {
+            out << ' ';
+        }
+        else
+        {
+            out << c;
+        }
+    }
+    out << '"';
+}
+} // namespace
+
+void printPassStatistics( std::ostream &out, const std::vector<PassStatistics> &passes )
+{
+    for ( const auto &stats : passes )
+    {
+        out << "Pass " << ( stats.name ? stats.name : "?" ) << ":";
+        if ( stats.hasPipelineStatistics )
+        {
+            out << " vertices " << stats.inputVertices << ", primitives " << stats.inputPrimitives
+                << ", VS invocations " << stats.vertexInvocations << ", clipped " << stats.clippingInvocations
+                << " -> " << stats.clippingPrimitives << ", FS invocations " << stats.fragmentInvocations;
+        }
+        if ( stats.hasOcclusion )
+        {
+            out << ( stats.hasPipelineStatistics ? "," : "" ) << " samples passed " << stats.samplesPassed;
+        }
+        if ( !stats.hasPipelineStatistics && !stats.hasOcclusion )
+        {
+            out << " no results yet";
+        }
+        out << "\n";
+    }
+}
+
+double CpuTimeline::nowUs()
+{
+    return std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - g_Epoch ).count();
+}
+
+void CpuTimeline::record( const char *name, double startUs, double endUs )
+{
+    ThreadEvents &events = localEvents();
+    uint64_t head = events.head.load( std::memory_order_relaxed );
+
+    TraceEvent &event = events.ring[head & ( kThreadEventCapacity - 1 )];
+    event.name = name;
+    event.startUs = startUs;
+    event.durationUs = endUs - startUs;
+    event.threadId = events.threadId;
+
+    events.head.store( head + 1, std::memory_order_release );
+}
+
+void CpuTimeline::setThreadName( const char *name )
+{
+    ThreadEvents &events = localEvents();
+    std::lock_guard<std::mutex> lock( g_RegistryMutex );
+    events.name = name;
+}
+
+std::vector<TraceEvent> CpuTimeline::snapshot()
+{
+    std::vector<TraceEvent> result;
+
+    std::lock_guard<std::mutex> lock( g_RegistryMutex );
+    for ( const auto &events : g_Threads )
+    {
+        uint64_t head = events->head.load( std::memory_order_acquire );
+        uint64_t first = head > kThreadEventCapacity ? head - kThreadEventCapacity : 0;
+
+        size_t copied = result.size();
+        for ( uint64_t i = first; i < head; ++i )
+        {
+            result.push_back( events->ring[i & ( kThreadEventCapacity - 1 )] );
+        }
+
+        // The owning thread keeps recording while we copy. Whatever it wrapped around to
+        // in the meantime, the slot it may be writing right now included, can be torn, so
+        // drop it, like a seqlock reader would.
+        std::atomic_thread_fence( std::memory_order_acquire );
+        uint64_t newHead = events->head.load( std::memory_order_relaxed );
+        if ( newHead + 1 > first + kThreadEventCapacity )
+        {
+            uint64_t overwritten = std::min( newHead + 1 - kThreadEventCapacity - first, head - first );
+            result.erase( result.begin() + copied, result.begin() + copied + overwritten );
+        }
+    }
+    return result;
+}
+
+std::vector<std::pair<uint32_t, std::string>> CpuTimeline::threadNames()
+{
+    std::vector<std::pair<uint32_t, std::string>> names;
+
+    std::lock_guard<std::mutex> lock( g_RegistryMutex );
+    for ( const auto &events : g_Threads )
+    {
+        names.emplace_back( events->threadId, events->name );
+    }
+    return names;
+}
+
+void GpuProfiler::create( VkPhysicalDevice physicalDevice,
+                          VkDevice device,
+                          uint32_t queueFamilyIndex,
+                          uint32_t framesInFlight,
+                          uint32_t maxScopesPerFrame )
+{
+    m_Device = device;
+    m_MaxScopes = maxScopesPerFrame;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties( physicalDevice, &queueFamilyCount, nullptr );
+    std::vector<VkQueueFamilyProperties> queueFamilies( queueFamilyCount );
+    vkGetPhysicalDeviceQueueFamilyProperties( physicalDevice, &queueFamilyCount, queueFamilies.data() );
+
+    m_Frames.resize( framesInFlight );
+
+    uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+    m_Supported = validBits != 0;
+    if ( !m_Supported )
+    {
+        return;
+    }
+    m_TimestampMask = validBits >= 64 ? ~0ull : ( ( 1ull << validBits ) - 1 );
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties( physicalDevice, &properties );
+    m_TimestampPeriodNs = properties.limits.timestampPeriod;
+
+    for ( auto &frame : m_Frames )
+    {
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = m_MaxScopes * 2;
+
+        if ( vkCreateQueryPool( m_Device, &poolInfo, nullptr, &frame.pool ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create timestamp query pool!" );
+        }
+    }
+}
+
+void GpuProfiler::enablePassStatistics( const VkPhysicalDeviceFeatures &enabledFeatures, uint32_t maxPassesPerFrame )
+{
+    m_MaxPasses = maxPassesPerFrame;
+    m_OcclusionFlags = enabledFeatures.occlusionQueryPrecise ? VkQueryControlFlags( VK_QUERY_CONTROL_PRECISE_BIT ) : 0;
+
+    for ( auto &frame : m_Frames )
+    {
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryCount = m_MaxPasses;
+
+        if ( enabledFeatures.pipelineStatisticsQuery )
+        {
+            poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            poolInfo.pipelineStatistics = kPipelineStatistics;
+            if ( vkCreateQueryPool( m_Device, &poolInfo, nullptr, &frame.statisticsPool ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to create pipeline statistics query pool!" );
+            }
+        }
+
+        poolInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
+        poolInfo.pipelineStatistics = 0;
+        if ( vkCreateQueryPool( m_Device, &poolInfo, nullptr, &frame.occlusionPool ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create occlusion query pool!" );
+        }
+    }
+}
+
+void GpuProfiler::cleanup()
+{
+    for ( auto &frame : m_Frames )
+    {
+        vkDestroyQueryPool( m_Device, frame.pool, nullptr );
+        vkDestroyQueryPool( m_Device, frame.statisticsPool, nullptr );
+        vkDestroyQueryPool( m_Device, frame.occlusionPool, nullptr );
+    }
+    m_Frames.clear();
+}
+
+void GpuProfiler::collect( uint32_t frameIndex )
+{
+    FrameQueries &frame = m_Frames[frameIndex];
+    collectPassStatistics( frame );
+
+    if ( !m_Supported || frame.names.empty() )
+    {
+        return;
+    }
+
+    // Each query returns its value followed by an availability word.
+    std::vector<uint64_t> results( frame.queryCount * 2 );
+    vkGetQueryPoolResults( m_Device,
+                           frame.pool,
+                           0,
+                           frame.queryCount,
+                           results.size() * sizeof( uint64_t ),
+                           results.data(),
+                           sizeof( uint64_t ) * 2,
+                           VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT );
+
+    uint64_t firstTimestamp = ~0ull;
+    for ( uint32_t i = 0; i < frame.queryCount; ++i )
+    {
+        if ( results[i * 2 + 1] != 0 )
+        {
+            firstTimestamp = std::min( firstTimestamp, results[i * 2] & m_TimestampMask );
+        }
+    }
+
+    m_LastFrameScopes.clear();
+    m_LastFrameGpuMs = 0.0;
+    for ( uint32_t scope = 0; scope < frame.names.size(); ++scope )
+    {
+        const uint64_t *begin = &results[scope * 4];
+        const uint64_t *end = &results[scope * 4 + 2];
+        if ( begin[1] == 0 || end[1] == 0 )
+        {
+            continue;
+        }
+
+        uint64_t beginTicks = ( begin[0] & m_TimestampMask ) - firstTimestamp;
+        uint64_t endTicks = ( end[0] & m_TimestampMask ) - firstTimestamp;
+
+        // Without calibrated timestamps the GPU clock can't be related to the CPU one,
+        // so the frame is anchored at the moment it was submitted.
+        TraceEvent event;
+        event.name = frame.names[scope];
+        event.startUs = frame.submitUs + beginTicks * m_TimestampPeriodNs / 1000.0;
+        event.durationUs = ( endTicks - beginTicks ) * m_TimestampPeriodNs / 1000.0;
+        event.threadId = frame.depth[scope];
+        m_LastFrameScopes.push_back( event );
+
+        if ( frame.depth[scope] == 0 )
+        {
+            m_LastFrameGpuMs += event.durationUs / 1000.0;
+        }
+    }
+
+    if ( m_History.size() + m_LastFrameScopes.size() > kMaxGpuHistory )
+    {
+        m_History.erase( m_History.begin(), m_History.begin() + m_History.size() / 4 );
+    }
+    m_History.insert( m_History.end(), m_LastFrameScopes.begin(), m_LastFrameScopes.end() );
+
+    frame.names.clear();
+    frame.depth.clear();
+    frame.queryCount = 0;
+    m_HasNewResults = true;
+    ++m_ResolvedFrames;
+}
+
+void GpuProfiler::collectPassStatistics( FrameQueries &frame )
+{
+    if ( frame.passNames.empty() )
+    {
+        return;
+    }
+
+    uint32_t passCount = static_cast<uint32_t>( frame.passNames.size() );
+    m_LastFramePassStatistics.assign( passCount, PassStatistics{} );
+    for ( uint32_t pass = 0; pass < passCount; ++pass )
+    {
+        m_LastFramePassStatistics[pass].name = frame.passNames[pass];
+        m_LastFramePassStatistics[pass].timeUs = frame.submitUs;
+    }
+
+    if ( frame.statisticsPool != VK_NULL_HANDLE )
+    {
+        const uint32_t stride = kPipelineStatisticCount + 1;
+        std::vector<uint64_t> results( passCount * stride );
+        vkGetQueryPoolResults( m_Device,
+                               frame.statisticsPool,
+                               0,
+                               passCount,
+                               results.size() * sizeof( uint64_t ),
+                               results.data(),
+                               stride * sizeof( uint64_t ),
+                               VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT );
+
+        for ( uint32_t pass = 0; pass < passCount; ++pass )
+        {
+            const uint64_t *values = &results[pass * stride];
+            PassStatistics &stats = m_LastFramePassStatistics[pass];
+            stats.hasPipelineStatistics = values[kPipelineStatisticCount] != 0;
+            if ( stats.hasPipelineStatistics )
+            {
+                stats.inputVertices = values[0];
+                stats.inputPrimitives = values[1];
+                stats.vertexInvocations = values[2];
+                stats.clippingInvocations = values[3];
+                stats.clippingPrimitives = values[4];
+                stats.fragmentInvocations = values[5];
+            }
+        }
+    }
+
+    std::vector<uint64_t> samples( passCount * 2 );
+    vkGetQueryPoolResults( m_Device,
+                           frame.occlusionPool,
+                           0,
+                           passCount,
+                           samples.size() * sizeof( uint64_t ),
+                           samples.data(),
+                           sizeof( uint64_t ) * 2,
+                           VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT );
+    for ( uint32_t pass = 0; pass < passCount; ++pass )
+    {
+        PassStatistics &stats = m_LastFramePassStatistics[pass];
+        stats.hasOcclusion = samples[pass * 2 + 1] != 0;
+        stats.samplesPassed = stats.hasOcclusion ? samples[pass * 2] : 0;
+    }
+
+    if ( m_PassHistory.size() + passCount > kMaxPassHistory )
+    {
+        m_PassHistory.erase( m_PassHistory.begin(), m_PassHistory.begin() + m_PassHistory.size() / 4 );
+    }
+    m_PassHistory.insert( m_PassHistory.end(), m_LastFramePassStatistics.begin(), m_LastFramePassStatistics.end() );
+
+    frame.passNames.clear();
+}
+
+void GpuProfiler::beginFrame( VkCommandBuffer commandBuffer, uint32_t frameIndex )
+{
+    m_RecordingFrame = frameIndex;
+
+    FrameQueries &frame = m_Frames[frameIndex];
+    frame.passNames.clear();
+    if ( m_MaxPasses != 0 )
+    {
+        if ( frame.statisticsPool != VK_NULL_HANDLE )
+        {
+            vkCmdResetQueryPool( commandBuffer, frame.statisticsPool, 0, m_MaxPasses );
+        }
+        vkCmdResetQueryPool( commandBuffer, frame.occlusionPool, 0, m_MaxPasses );
+    }
+
+    if ( !m_Supported )
+    {
+        return;
+    }
+
+    frame.names.clear();
+    frame.depth.clear();
+    frame.queryCount = 0;
+    frame.openScopes = 0;
+    vkCmdResetQueryPool( commandBuffer, frame.pool, 0, m_MaxScopes * 2 );
+}
+
+void GpuProfiler::markSubmitted( uint32_t frameIndex )
+{
+    m_Frames[frameIndex].submitUs = CpuTimeline::nowUs();
+}
+
+uint32_t GpuProfiler::beginScope( VkCommandBuffer commandBuffer, const char *name )
+{
+    if ( !m_Supported )
+    {
+        return UINT32_MAX;
+    }
+
+    FrameQueries &frame = m_Frames[m_RecordingFrame];
+    if ( frame.names.size() >= m_MaxScopes )
+    {
+        return UINT32_MAX;
+    }
+
+    uint32_t scope = static_cast<uint32_t>( frame.names.size() );
+    frame.names.push_back( name );
+    frame.depth.push_back( frame.openScopes++ );
+    frame.queryCount += 2;
+
+    vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, scope * 2 );
+    return scope;
+}
+
+void GpuProfiler::endScope( VkCommandBuffer commandBuffer, uint32_t scope )
+{
+    if ( scope == UINT32_MAX )
+    {
+        return;
+    }
+
+    FrameQueries &frame = m_Frames[m_RecordingFrame];
+    --frame.openScopes;
+    vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.pool, scope * 2 + 1 );
+}
+
+uint32_t GpuProfiler::beginPassStatistics( VkCommandBuffer commandBuffer, const char *name )
+{
+    FrameQueries &frame = m_Frames[m_RecordingFrame];
+    if ( frame.passNames.size() >= m_MaxPasses )
+    {
+        return UINT32_MAX;
+    }
+
+    uint32_t pass = static_cast<uint32_t>( frame.passNames.size() );
+    frame.passNames.push_back( name );
+
+    if ( frame.statisticsPool != VK_NULL_HANDLE )
+    {
+        vkCmdBeginQuery( commandBuffer, frame.statisticsPool, pass, 0 );
+    }
+    vkCmdBeginQuery( commandBuffer, frame.occlusionPool, pass, m_OcclusionFlags );
+    return pass;
+}
+
+void GpuProfiler::endPassStatistics( VkCommandBuffer commandBuffer, uint32_t pass )
+{
+    if ( pass == UINT32_MAX )
+    {
+        return;
+    }
+
+    FrameQueries &frame = m_Frames[m_RecordingFrame];
+    vkCmdEndQuery( commandBuffer, frame.occlusionPool, pass );
+    if ( frame.statisticsPool != VK_NULL_HANDLE )
+    {
+        vkCmdEndQuery( commandBuffer, frame.statisticsPool, pass );
+    }
+}
+
+bool GpuProfiler::consumeNewResults()
+{
+    bool hasNewResults = m_HasNewResults;
+    m_HasNewResults = false;
+    return hasNewResults;
+}
+
+bool GpuProfiler::exportChromeTrace( const std::string &path ) const
+{
+    std::ofstream out( path, std::ios::trunc );
+    if ( !out.is_open() )
+    {
+        return false;
+    }
+
+    const uint32_t cpuProcess = 1;
+    const uint32_t gpuProcess = 2;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << cpuProcess << ",\"args\":{\"name\":\"CPU\"}}";
+    out << ",\n{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << gpuProcess << ",\"args\":{\"name\":\"GPU\"}}";
+
+    for ( const auto &thread : CpuTimeline::threadNames() )
+    {
+        out << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << cpuProcess << ",\"tid\":" << thread.first
+            << ",\"args\":{\"name\":";
+        writeJsonString( out, thread.second );
+        out << "}}";
+    }
+
+    auto writeEvents = [&out]( const std::vector<TraceEvent> &events, uint32_t pid ) {
+        for ( const auto &event : events )
+        {
+            out << ",\n{\"ph\":\"X\",\"name\":";
+            writeJsonString( out, event.name ? event.name : "?" );
+            out << ",\"pid\":" << pid << ",\"tid\":" << event.threadId << ",\"ts\":" << event.startUs
+                << ",\"dur\":" << event.durationUs << "}";
+        }
+    };
+
+    out.precision( 3 );
+    out << std::fixed;
+    writeEvents( CpuTimeline::snapshot(), cpuProcess );
+    // GPU scopes use their nesting depth as the track so overlapping scopes stack.
+    writeEvents( m_History, gpuProcess );
+
+    // Separate counter tracks per pass, since vertex and fragment counts differ by orders of magnitude.
+    auto writeCounter = [&out]( const PassStatistics &stats, const char *suffix, uint32_t pid ) {
+        out << ",\n{\"ph\":\"C\",\"name\":";
+        writeJsonString( out, std::string( stats.name ? stats.name : "?" ) + suffix );
+        out << ",\"pid\":" << pid << ",\"ts\":" << stats.timeUs << ",\"args\":{";
+    };
+    for ( const auto &stats : m_PassHistory )
+    {
+        if ( stats.hasPipelineStatistics )
+        {
+            writeCounter( stats, " vertices", gpuProcess );
+            out << "\"inputVertices\":" << stats.inputVertices << ",\"vsInvocations\":" << stats.vertexInvocations
+                << "}}";
+            writeCounter( stats, " primitives", gpuProcess );
+            out << "\"inputPrimitives\":" << stats.inputPrimitives
+                << ",\"clippingInvocations\":" << stats.clippingInvocations
+                << ",\"clippingPrimitives\":" << stats.clippingPrimitives << "}}";
+        }
+        if ( stats.hasPipelineStatistics || stats.hasOcclusion )
+        {
+            writeCounter( stats, " fragments", gpuProcess );
+            if ( stats.hasPipelineStatistics )
+            {
+                out << "\"fsInvocations\":" << stats.fragmentInvocations << ( stats.hasOcclusion ? "," : "" );
+            }
+            if ( stats.hasOcclusion )
+            {
+                out << "\"samplesPassed\":" << stats.samplesPassed;
+            }
+            out << "}}";
+        }
+    }
+
+    out << "\n]}\n";
+    return true;
+}
@@ -0,0 +1,213 @@
+#pragma once
+// Frame timing instrumentation.
+//
+// GPU scopes write vkCmdWriteTimestamp pairs into one query pool per frame in flight.
+// A pool is only read back after the frame's fence has been waited on, so resolving
+// never blocks - results simply arrive MAX_FRAMES_IN_FLIGHT frames late.
+//
+// Passes can additionally be wrapped in pipeline statistics and occlusion queries,
+// which are resolved the same way and show up as counter tracks in the trace.
+//
+// CPU scopes go into a per-thread ring that only its owning thread writes to, so
+// recording an event never takes a lock. Both timelines can be written out as a
+// Chrome trace (chrome://tracing, ui.perfetto.dev).
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct TraceEvent
+{
+    const char *name = nullptr;
+    double      startUs = 0.0;
+    double      durationUs = 0.0;
+    uint32_t    threadId = 0;
+};
+
+// Counters of one pass. Vertex-side counts growing with frame time point at a
+// geometry-bound pass, fragment invocations and samples at a fill-bound one.
+struct PassStatistics
+{
+    const char *name = nullptr;
+    // CPU time the frame was submitted, like the GPU scopes.
+    double      timeUs = 0.0;
+
+    bool     hasPipelineStatistics = false;
+    uint64_t inputVertices = 0;
+    uint64_t inputPrimitives = 0;
+    uint64_t vertexInvocations = 0;
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentInvocations = 0;
+
+    bool     hasOcclusion = false;
+    // Exact only if occlusionQueryPrecise was enabled, otherwise just zero / non-zero.
+    uint64_t samplesPassed = 0;
+};
+
+void printPassStatistics( std::ostream &out, const std::vector<PassStatistics> &passes );
+
+// Process-wide CPU timeline. Names must be string literals (or otherwise outlive the profiler).
+class CpuTimeline
+{
+public:
+    static double nowUs();
+    static void   record( const char *name, double startUs, double endUs );
+    static void   setThreadName( const char *name );
+
+    // Copies out the events currently held by every thread's ring.
+    static std::vector<TraceEvent> snapshot();
+    static std::vector<std::pair<uint32_t, std::string>> threadNames();
+};
+
+class CpuScope
+{
+public:
+    explicit CpuScope( const char *name )
+        : m_Name( name ), m_StartUs( CpuTimeline::nowUs() )
+    {
+    }
+    ~CpuScope() { CpuTimeline::record( m_Name, m_StartUs, CpuTimeline::nowUs() ); }
+
+    CpuScope( const CpuScope & ) = delete;
+    CpuScope &operator=( const CpuScope & ) = delete;
+
+private:
+    const char *m_Name;
+    double      m_StartUs;
+};
+
+#define PROFILE_CONCAT_INNER( a, b ) a##b
+#define PROFILE_CONCAT( a, b ) PROFILE_CONCAT_INNER( a, b )
+#define PROFILE_CPU_SCOPE( name ) CpuScope PROFILE_CONCAT( cpuScope_, __LINE__ )( name )
+#define PROFILE_GPU_SCOPE( profiler, commandBuffer, name ) \
+    GpuScope PROFILE_CONCAT( gpuScope_, __LINE__ )( profiler, commandBuffer, name )
+#define PROFILE_GPU_PASS_STATISTICS( profiler, commandBuffer, name ) \
+    GpuPassStatisticsScope PROFILE_CONCAT( gpuPassStatistics_, __LINE__ )( profiler, commandBuffer, name )
+
+class GpuProfiler
+{
+public:
+    void create( VkPhysicalDevice physicalDevice,
+                 VkDevice device,
+                 uint32_t queueFamilyIndex,
+                 uint32_t framesInFlight,
+                 uint32_t maxScopesPerFrame = 64 );
+    void cleanup();
+
+    bool isSupported() const { return m_Supported; }
+
+    // Turns on the per-pass queries. enabledFeatures are the features the device was
+    // created with: pipeline statistics need pipelineStatisticsQuery, occlusion
+    // queries are always available.
+    void enablePassStatistics( const VkPhysicalDeviceFeatures &enabledFeatures, uint32_t maxPassesPerFrame = 16 );
+    bool hasPassStatistics() const { return m_MaxPasses != 0; }
+
+    // Call right after the frame's fence has been waited on: reads back what that
+    // frame slot measured last time around without waiting.
+    void collect( uint32_t frameIndex );
+
+    // Resets the slot's queries; must be recorded outside of a render pass.
+    void beginFrame( VkCommandBuffer commandBuffer, uint32_t frameIndex );
+    // Remembers the CPU time the frame was handed to the queue, used to place its
+    // GPU scopes on the CPU timeline.
+    void markSubmitted( uint32_t frameIndex );
+
+    uint32_t beginScope( VkCommandBuffer commandBuffer, const char *name );
+    void     endScope( VkCommandBuffer commandBuffer, uint32_t scope );
+
+    // Both calls must be recorded inside the same subpass.
+    uint32_t beginPassStatistics( VkCommandBuffer commandBuffer, const char *name );
+    void     endPassStatistics( VkCommandBuffer commandBuffer, uint32_t pass );
+
+    // GPU time of the last resolved frame (sum of its top level scopes), in milliseconds.
+    double getLastFrameGpuMs() const { return m_LastFrameGpuMs; }
+    const std::vector<TraceEvent> &getLastFrameScopes() const { return m_LastFrameScopes; }
+    // Set whenever collect() resolved a new frame; cleared by the caller.
+    bool consumeNewResults();
+    // Number of frames collect() resolved so far, for readers other than the one above.
+    uint64_t getResolvedFrameCount() const { return m_ResolvedFrames; }
+    const std::vector<PassStatistics> &getLastFramePassStatistics() const { return m_LastFramePassStatistics; }
+
+    bool exportChromeTrace( const std::string &path ) const;
+
+private:
+    struct FrameQueries
+    {
+        VkQueryPool              pool = VK_NULL_HANDLE;
+        VkQueryPool              statisticsPool = VK_NULL_HANDLE;
+        VkQueryPool              occlusionPool = VK_NULL_HANDLE;
+        std::vector<const char *> names;
+        std::vector<const char *> passNames;
+        std::vector<uint32_t>     depth;
+        uint32_t                 queryCount = 0;
+        uint32_t                 openScopes = 0;
+        double                   submitUs = 0.0;
+    };
+
+    void collectPassStatistics( FrameQueries &frame );
+
+private:
+    VkDevice m_Device = VK_NULL_HANDLE;
+    bool     m_Supported = false;
+    double   m_TimestampPeriodNs = 1.0;
+    uint64_t m_TimestampMask = ~0ull;
+    uint32_t m_MaxScopes = 0;
+    uint32_t m_MaxPasses = 0;
+    VkQueryControlFlags m_OcclusionFlags = 0;
+
+    std::vector<FrameQueries> m_Frames;
+    uint32_t                  m_RecordingFrame = 0;
+
+    std::vector<TraceEvent> m_History;
+    std::vector<TraceEvent> m_LastFrameScopes;
+    double                  m_LastFrameGpuMs = 0.0;
+    bool                    m_HasNewResults = false;
+    uint64_t                m_ResolvedFrames = 0;
+
+    std::vector<PassStatistics> m_PassHistory;
+    std::vector<PassStatistics> m_LastFramePassStatistics;
+};
+
+class GpuScope
+{
+public:
+    GpuScope( GpuProfiler &profiler, VkCommandBuffer commandBuffer, const char *name )
+        : m_Profiler( profiler ), m_CommandBuffer( commandBuffer ),
+          m_Scope( profiler.beginScope( commandBuffer, name ) )
+    {
+    }
+    ~GpuScope() { m_Profiler.endScope( m_CommandBuffer, m_Scope ); }
+
+    GpuScope( const GpuScope & ) = delete;
+    GpuScope &operator=( const GpuScope & ) = delete;
+
+private:
+    GpuProfiler    &m_Profiler;
+    VkCommandBuffer m_CommandBuffer;
+    uint32_t        m_Scope;
+};
+
+class GpuPassStatisticsScope
+{
+public:
+    GpuPassStatisticsScope( GpuProfiler &profiler, VkCommandBuffer commandBuffer, const char *name )
+        : m_Profiler( profiler ), m_CommandBuffer( commandBuffer ),
+          m_Pass( profiler.beginPassStatistics( commandBuffer, name ) )
+    {
+    }
+    ~GpuPassStatisticsScope() { m_Profiler.endPassStatistics( m_CommandBuffer, m_Pass ); }
+
+    GpuPassStatisticsScope( const GpuPassStatisticsScope & ) = delete;
+    GpuPassStatisticsScope &operator=( const GpuPassStatisticsScope & ) = delete;
+
+private:
+    GpuProfiler    &m_Profiler;
+    VkCommandBuffer m_CommandBuffer;
+    uint32_t        m_Pass;
+};
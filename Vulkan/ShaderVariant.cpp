@@ -0,0 +1,97 @@
+#include "ShaderVariant.h"
+
+#include <cstring>
+#include <stdexcept>
+
+ShaderVariant &ShaderVariant::set( uint32_t constantId, bool value )
+{
+    return set( constantId, static_cast<uint32_t>( value ? VK_TRUE : VK_FALSE ) );
+}
+
+ShaderVariant &ShaderVariant::set( uint32_t constantId, int32_t value )
+{
+    return set( constantId, static_cast<uint32_t>( value ) );
+}
+
+ShaderVariant &ShaderVariant::set( uint32_t constantId, uint32_t value )
+{
+    m_Values[constantId] = value;
+    rebuild();
+    return *this;
+}
+
+ShaderVariant &ShaderVariant::set( uint32_t constantId, float value )
+{
+    uint32_t bits;
+    memcpy( &bits, &value, sizeof( bits ) );
+    return set( constantId, bits );
+}
+
+VkSpecializationInfo ShaderVariant::getSpecializationInfo() const
+{
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = static_cast<uint32_t>( m_Entries.size() );
+    specializationInfo.pMapEntries = m_Entries.data();
+    specializationInfo.dataSize = m_Data.size() * sizeof( uint32_t );
+    specializationInfo.pData = m_Data.data();
+    return specializationInfo;
+}
+
+void ShaderVariant::rebuild()
+{
+    m_Entries.clear();
+    m_Data.clear();
+    for ( const auto &[constantId, value] : m_Values )
+    {
+        VkSpecializationMapEntry entry{};
+        entry.constantID = constantId;
+        entry.offset = static_cast<uint32_t>( m_Data.size() * sizeof( uint32_t ) );
+        entry.size = sizeof( uint32_t );
+        m_Entries.push_back( entry );
+        m_Data.push_back( value );
+    }
+}
+
+void PipelineVariants::create( VkDevice device, CreateFunction createPipeline )
+{
+    m_Device = device;
+    m_CreatePipeline = std::move( createPipeline );
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    if ( vkCreatePipelineCache( m_Device, &cacheInfo, nullptr, &m_Cache ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create pipeline cache!" );
+    }
+}
+
+void PipelineVariants::cleanup()
+{
+    if ( m_Device == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    for ( const auto &[variant, pipeline] : m_Pipelines )
+    {
+        vkDestroyPipeline( m_Device, pipeline, nullptr );
+    }
+    m_Pipelines.clear();
+
+    vkDestroyPipelineCache( m_Device, m_Cache, nullptr );
+    m_Device = VK_NULL_HANDLE;
+}
+
+VkPipeline PipelineVariants::get( const ShaderVariant &variant )
+{
+    auto found = m_Pipelines.find( variant );
+    if ( found != m_Pipelines.end() )
+    {
+        return found->second;
+    }
+
+    VkSpecializationInfo specializationInfo = variant.getSpecializationInfo();
+    VkPipeline pipeline = m_CreatePipeline( &specializationInfo, m_Cache );
+    m_Pipelines.emplace( variant, pipeline );
+    return pipeline;
+}
@@ -0,0 +1,58 @@
+#pragma once
+// Shader variants built from specialization constants.
+//
+// A ShaderVariant is the set of constant_id values a pipeline is created with. The
+// driver folds them into the shader when the pipeline is compiled, so toggles and loop
+// bounds cost nothing per vertex or fragment. PipelineVariants creates one pipeline
+// per distinct variant on first use and keeps it for the lifetime of the device.
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <vector>
+
+class ShaderVariant
+{
+public:
+    // Every constant is 32 bits wide, matching bool, int, uint and float in GLSL.
+    ShaderVariant &set( uint32_t constantId, bool value );
+    ShaderVariant &set( uint32_t constantId, int32_t value );
+    ShaderVariant &set( uint32_t constantId, uint32_t value );
+    ShaderVariant &set( uint32_t constantId, float value );
+
+    // Points into the variant; valid until it is changed or destroyed.
+    VkSpecializationInfo getSpecializationInfo() const;
+
+    bool operator<( const ShaderVariant &other ) const { return m_Values < other.m_Values; }
+
+private:
+    void rebuild();
+
+private:
+    std::map<uint32_t, uint32_t>          m_Values;
+    std::vector<VkSpecializationMapEntry> m_Entries;
+    std::vector<uint32_t>                 m_Data;
+};
+
+class PipelineVariants
+{
+public:
+    // Creates the pipeline for one variant; the same specialization applies to every stage.
+    using CreateFunction = std::function<VkPipeline( const VkSpecializationInfo *specialization, VkPipelineCache cache )>;
+
+    void create( VkDevice device, CreateFunction createPipeline );
+    void cleanup();
+
+    VkPipeline get( const ShaderVariant &variant );
+    size_t     getVariantCount() const { return m_Pipelines.size(); }
+
+private:
+    VkDevice        m_Device = VK_NULL_HANDLE;
+    CreateFunction  m_CreatePipeline;
+    // Shared by all variants so the driver can reuse what they have in common.
+    VkPipelineCache m_Cache = VK_NULL_HANDLE;
+
+    std::map<ShaderVariant, VkPipeline> m_Pipelines;
+};
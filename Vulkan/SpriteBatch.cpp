@@ -0,0 +1,332 @@
+#include "SpriteBatch.h"
+#include "AssetArchive.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+
+namespace
+{
+// 224 MB per frame in flight.
+constexpr uint32_t kMaxCapacity = 1u << 23;
+
+struct PushConstants
+{
+    float scale[2];
+};
+} // namespace
+
+VkVertexInputBindingDescription SpriteInstance::getBindingDescription()
+{
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof( SpriteInstance );
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    return bindingDescription;
+}
+
+std::array<VkVertexInputAttributeDescription, 3> SpriteInstance::getAttributeDescription()
+{
+    std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+    attributeDescriptions[0].offset = offsetof( SpriteInstance, position );
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[1].offset = offsetof( SpriteInstance, color );
+
+    attributeDescriptions[2].binding = 0;
+    attributeDescriptions[2].location = 2;
+    attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
+    attributeDescriptions[2].offset = offsetof( SpriteInstance, size );
+
+    return attributeDescriptions;
+}
+
+void SpriteBatch::create( const SpriteBatchCreateInfo &createInfo )
+{
+    m_PhysicalDevice = createInfo.physicalDevice;
+    m_Device = createInfo.device;
+
+    m_Peak = std::clamp( createInfo.initialCapacity, 1u, kMaxCapacity );
+    m_Rings.resize( createInfo.framesInFlight );
+    for ( Ring &ring : m_Rings )
+    {
+        createRing( ring, m_Peak );
+    }
+
+    createPipeline( createInfo );
+}
+
+void SpriteBatch::cleanup()
+{
+    if ( m_Device == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    for ( Ring &ring : m_Rings )
+    {
+        destroyRing( ring );
+    }
+    m_Rings.clear();
+
+    vkDestroyPipeline( m_Device, m_Pipeline, nullptr );
+    vkDestroyPipelineLayout( m_Device, m_PipelineLayout, nullptr );
+    m_Pipeline = VK_NULL_HANDLE;
+    m_PipelineLayout = VK_NULL_HANDLE;
+
+    m_Mapped = nullptr;
+    m_Capacity = 0;
+    m_Count = 0;
+    m_Device = VK_NULL_HANDLE;
+}
+
+void SpriteBatch::begin( uint32_t frameIndex )
+{
+    m_Peak = std::max( m_Peak, std::min( m_Count + m_Dropped, kMaxCapacity ) );
+
+    Ring &ring = m_Rings[frameIndex];
+    if ( ring.capacity < m_Peak )
+    {
+        destroyRing( ring );
+        createRing( ring, std::min( std::bit_ceil( m_Peak ), kMaxCapacity ) );
+    }
+
+    m_Frame = frameIndex;
+    m_Mapped = ring.mapped;
+    m_Capacity = ring.capacity;
+    m_Count = 0;
+    m_Flushed = 0;
+    m_Dropped = 0;
+    m_Draws = 0;
+}
+
+void SpriteBatch::flush( VkCommandBuffer commandBuffer, VkExtent2D extent )
+{
+    if ( m_Count == m_Flushed )
+    {
+        return;
+    }
+
+    vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline );
+
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers( commandBuffer, 0, 1, &m_Rings[m_Frame].buffer, &offset );
+
+    PushConstants push{ { 2.0f / extent.width, 2.0f / extent.height } };
+    vkCmdPushConstants( commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( push ), &push );
+
+    // firstInstance picks up where the previous flush stopped.
+    vkCmdDraw( commandBuffer, 4, m_Count - m_Flushed, 0, m_Flushed );
+    m_Flushed = m_Count;
+    ++m_Draws;
+}
+
+void SpriteBatch::createRing( Ring &ring, uint32_t capacity )
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = sizeof( SpriteInstance ) * static_cast<VkDeviceSize>( capacity );
+    bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if ( vkCreateBuffer( m_Device, &bufferInfo, nullptr, &ring.buffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create sprite buffer!" );
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements( m_Device, ring.buffer, &memRequirements );
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+
+    // The GPU reads every quad once, so device local memory the CPU can write to
+    // directly saves it fetching them over the bus. That heap is often small, so
+    // plain host memory is the fallback.
+    std::optional<uint32_t> memoryType =
+        findMemoryTypeIndex( m_PhysicalDevice,
+                             memRequirements.memoryTypeBits,
+                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+    VkResult result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    if ( memoryType.has_value() )
+    {
+        allocInfo.memoryTypeIndex = memoryType.value();
+        result = vkAllocateMemory( m_Device, &allocInfo, nullptr, &ring.memory );
+    }
+    if ( result != VK_SUCCESS )
+    {
+        allocInfo.memoryTypeIndex =
+            findMemoryType( m_PhysicalDevice,
+                            memRequirements.memoryTypeBits,
+                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+        if ( vkAllocateMemory( m_Device, &allocInfo, nullptr, &ring.memory ) != VK_SUCCESS )
+        {
+            vkDestroyBuffer( m_Device, ring.buffer, nullptr );
+            ring.buffer = VK_NULL_HANDLE;
+            throw std::runtime_error( "Failed to allocate sprite buffer memory!" );
+        }
+    }
+
+    vkBindBufferMemory( m_Device, ring.buffer, ring.memory, 0 );
+
+    void *mapped;
+    vkMapMemory( m_Device, ring.memory, 0, VK_WHOLE_SIZE, 0, &mapped );
+    ring.mapped = static_cast<SpriteInstance *>( mapped );
+    ring.capacity = capacity;
+}
+
+void SpriteBatch::destroyRing( Ring &ring )
+{
+    if ( ring.memory != VK_NULL_HANDLE )
+    {
+        vkUnmapMemory( m_Device, ring.memory );
+        vkFreeMemory( m_Device, ring.memory, nullptr );
+    }
+    if ( ring.buffer != VK_NULL_HANDLE )
+    {
+        vkDestroyBuffer( m_Device, ring.buffer, nullptr );
+    }
+    ring = {};
+}
+
+VkShaderModule SpriteBatch::loadShaderModule( const SpriteBatchCreateInfo &createInfo, const std::string &name ) const
+{
+    if ( createInfo.assets )
+    {
+        return createShaderModule( m_Device, createInfo.assets->load( name ).getData() );
+    }
+    return createShaderModule( m_Device, readFile( createInfo.shaderDir + name ) );
+}
+
+void SpriteBatch::createPipeline( const SpriteBatchCreateInfo &createInfo )
+{
+    VkShaderModule vertShaderModule = loadShaderModule( createInfo, "sprite_vert.spv" );
+    VkShaderModule fragShaderModule = loadShaderModule( createInfo, "sprite_frag.spv" );
+
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module = fragShaderModule;
+    fragShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+
+    // Only per-instance input; the corners come from gl_VertexIndex.
+    auto bindingDescription = SpriteInstance::getBindingDescription();
+    auto attributeDescriptions = SpriteInstance::getAttributeDescription();
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>( attributeDescriptions.size() );
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    // Negative sizes flip the winding.
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    // Opaque; later quads simply cover earlier ones.
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>( dynamicStates.size() );
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof( PushConstants );
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if ( vkCreatePipelineLayout( m_Device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create sprite pipeline layout!" );
+    }
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_PipelineLayout;
+    pipelineInfo.renderPass = createInfo.renderPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &createInfo.colorFormat;
+    if ( createInfo.renderPass == VK_NULL_HANDLE )
+    {
+        pipelineInfo.pNext = &renderingInfo;
+    }
+
+    if ( vkCreateGraphicsPipelines( m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create sprite pipeline!" );
+    }
+
+    vkDestroyShaderModule( m_Device, fragShaderModule, nullptr );
+    vkDestroyShaderModule( m_Device, vertShaderModule, nullptr );
+}
@@ -0,0 +1,113 @@
+#pragma once
+// Immediate-mode batch of flat colored quads, for UI and overlays.
+//
+// Every frame in flight owns a persistently mapped instance buffer. submitQuad writes
+// one instance straight into it - no staging, no per-quad commands - and flush draws
+// everything submitted since the last flush as a single instanced draw of a 4-vertex
+// strip, so a frame of quads usually costs one draw call. Quads that don't fit are
+// dropped and counted; the frame's buffer is then grown the next time it comes round,
+// once its fence guarantees the GPU is done reading it.
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class AssetArchive;
+
+// The leading position and color have the same types and formats as Vertex.
+struct SpriteInstance
+{
+    glm::vec2 position;
+    glm::vec3 color;
+    glm::vec2 size;
+
+    static VkVertexInputBindingDescription getBindingDescription();
+    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescription();
+};
+
+struct SpriteBatchCreateInfo
+{
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice         device = VK_NULL_HANDLE;
+    // VK_NULL_HANDLE with dynamic rendering; the pipeline is then built for colorFormat.
+    VkRenderPass     renderPass = VK_NULL_HANDLE;
+    VkFormat         colorFormat = VK_FORMAT_UNDEFINED;
+    uint32_t         framesInFlight = 0;
+    // Quads per frame before the first growth.
+    uint32_t         initialCapacity = 16 * 1024;
+    // Shaders are loaded from here when set, otherwise from shaderDir.
+    const AssetArchive *assets = nullptr;
+    std::string         shaderDir;
+};
+
+class SpriteBatch
+{
+public:
+    void create( const SpriteBatchCreateInfo &createInfo );
+    void cleanup();
+
+    bool isEnabled() const { return m_Device != VK_NULL_HANDLE; }
+
+    // Call after the frame's fence was waited on, before the first submitQuad.
+    void begin( uint32_t frameIndex );
+
+    // position is the top left corner in pixels of the extent passed to flush, y down.
+    void submitQuad( glm::vec2 position, glm::vec2 size, glm::vec3 color )
+    {
+        if ( m_Count == m_Capacity )
+        {
+            ++m_Dropped;
+            return;
+        }
+        m_Mapped[m_Count++] = { position, color, size };
+    }
+
+    // Recorded inside a render pass with the viewport already set; extent is the size
+    // in pixels the quad positions refer to. Binds its own pipeline and buffer.
+    void flush( VkCommandBuffer commandBuffer, VkExtent2D extent );
+
+    // For the frame since begin.
+    uint32_t getQuadCount() const { return m_Count; }
+    uint32_t getDroppedCount() const { return m_Dropped; }
+    uint32_t getDrawCount() const { return m_Draws; }
+    uint32_t getCapacity() const { return m_Capacity; }
+
+private:
+    struct Ring
+    {
+        VkBuffer        buffer = VK_NULL_HANDLE;
+        VkDeviceMemory  memory = VK_NULL_HANDLE;
+        SpriteInstance *mapped = nullptr;
+        uint32_t        capacity = 0;
+    };
+
+    void createRing( Ring &ring, uint32_t capacity );
+    void destroyRing( Ring &ring );
+    void createPipeline( const SpriteBatchCreateInfo &createInfo );
+    VkShaderModule loadShaderModule( const SpriteBatchCreateInfo &createInfo, const std::string &name ) const;
+
+private:
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice         m_Device = VK_NULL_HANDLE;
+
+    std::vector<Ring> m_Rings;
+    // Most quads any frame asked for, dropped ones included.
+    uint32_t          m_Peak = 0;
+
+    VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+    VkPipeline       m_Pipeline = VK_NULL_HANDLE;
+
+    // The current frame's ring, cached for submitQuad.
+    uint32_t        m_Frame = 0;
+    SpriteInstance *m_Mapped = nullptr;
+    uint32_t        m_Capacity = 0;
+    uint32_t        m_Count = 0;
+    uint32_t        m_Flushed = 0;
+    uint32_t        m_Dropped = 0;
+    uint32_t        m_Draws = 0;
+};
@@ -0,0 +1,21 @@
+#version 450
+
+layout(push_constant) uniform PushConstants {
+    // 2 / the extent in pixels.
+    vec2 scale;
+} push;
+
+// Per instance: one quad, laid out as in SpriteBatch.h.
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inSize;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    // Triangle strip over the corners (0,0) (1,0) (0,1) (1,1).
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+    vec2 pixel = inPosition + corner * inSize;
+    gl_Position = vec4(pixel * push.scale - 1.0, 0.0, 1.0);
+    fragColor = inColor;
+}
@@ -0,0 +1,742 @@
+#include "TextureStreamer.h"
+#include "Ktx2.h"
+#include "VulkanUtils.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+constexpr VkFormat kTextureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+
+uint32_t mipLevelCount( uint32_t width, uint32_t height )
+{
+    return static_cast<uint32_t>( std::floor( std::log2( std::max( width, height ) ) ) ) + 1;
+}
+
+bool generatesMips( const std::vector<VkDeviceSize> &levelOffsets, VkFormat format )
+{
+    return levelOffsets.size() == 1 && format == kTextureFormat;
+}
+
+// Halves an RGBA8 image with a box filter; odd edges repeat their last texel.
+std::vector<unsigned char> halve( const std::vector<unsigned char> &pixels,
+                                  uint32_t &width,
+                                  uint32_t &height )
+{
+    uint32_t halfWidth = std::max( width / 2, 1u );
+    uint32_t halfHeight = std::max( height / 2, 1u );
+    std::vector<unsigned char> result( static_cast<size_t>( halfWidth ) * halfHeight * 4 );
+
+    for ( uint32_t y = 0; y < halfHeight; ++y )
+    {
+        uint32_t y0 = std::min( y * 2, height - 1 );
+        uint32_t y1 = std::min( y * 2 + 1, height - 1 );
+        for ( uint32_t x = 0; x < halfWidth; ++x )
+        {
+            uint32_t x0 = std::min( x * 2, width - 1 );
+            uint32_t x1 = std::min( x * 2 + 1, width - 1 );
+            for ( uint32_t c = 0; c < 4; ++c )
+            {
+                uint32_t sum = pixels[( static_cast<size_t>( y0 ) * width + x0 ) * 4 + c] +
+                               pixels[( static_cast<size_t>( y0 ) * width + x1 ) * 4 + c] +
+                               pixels[( static_cast<size_t>( y1 ) * width + x0 ) * 4 + c] +
+                               pixels[( static_cast<size_t>( y1 ) * width + x1 ) * 4 + c];
+                result[( static_cast<size_t>( y ) * halfWidth + x ) * 4 + c] = static_cast<unsigned char>( sum / 4 );
+            }
+        }
+    }
+
+    width = halfWidth;
+    height = halfHeight;
+    return result;
+}
+} // namespace
+
+void TextureStreamer::create( const TextureStreamerCreateInfo &createInfo )
+{
+    m_PhysicalDevice = createInfo.physicalDevice;
+    m_Device = createInfo.device;
+    m_DeletionQueue = createInfo.deletionQueue;
+    m_BudgetBytes = createInfo.budgetBytes;
+    m_UploadBytesPerFrame = createInfo.uploadBytesPerFrame;
+    m_CoarseSize = std::max( createInfo.coarseSize, 1u );
+    if ( m_DeletionQueue == nullptr )
+    {
+        throw std::runtime_error( "texture streamer needs a deletion queue!" );
+    }
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties( m_PhysicalDevice, kTextureFormat, &formatProperties );
+    if ( !( formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT ) )
+    {
+        throw std::runtime_error( "texture image format does not support linear blitting!" );
+    }
+
+    // Best quality per bit first. Everything falls back to plain RGBA.
+    const std::pair<VkBool32, VkFormat> transcodeCandidates[] = {
+        { createInfo.enabledFeatures.textureCompressionBC, VK_FORMAT_BC7_SRGB_BLOCK },
+        { createInfo.enabledFeatures.textureCompressionASTC_LDR, VK_FORMAT_ASTC_4x4_SRGB_BLOCK },
+        { createInfo.enabledFeatures.textureCompressionETC2, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK },
+    };
+    m_TranscodeFormat = kTextureFormat;
+    for ( const auto &[enabled, format] : transcodeCandidates )
+    {
+        if ( enabled && isSampleable( format ) )
+        {
+            m_TranscodeFormat = format;
+            break;
+        }
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if ( vkCreateSampler( m_Device, &samplerInfo, nullptr, &m_Sampler ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to create texture sampler!" );
+    }
+
+    // The fallback has to be bindable before the first frame, so its image exists up
+    // front; the pixels follow with the first batch of uploads.
+    Texture fallback;
+    fallback.path = "<fallback>";
+    fallback.full = createImage( 1, 1, 1, kTextureFormat );
+    fallback.residency = Residency::Full;
+    fallback.coarseOnly = true;
+    m_Textures.push_back( std::move( fallback ) );
+    m_FallbackUpload = { kFallbackTexture, true, kTextureFormat, 1, 1, { 255, 255, 255, 255 }, { 0 } };
+    m_FallbackUploaded = false;
+
+    m_Stop = false;
+    uint32_t workerCount = std::max( createInfo.workerCount, 1u );
+    for ( uint32_t i = 0; i < workerCount; ++i )
+    {
+        m_Workers.emplace_back( &TextureStreamer::workerLoop, this );
+    }
+}
+
+void TextureStreamer::cleanup()
+{
+    if ( m_Device == VK_NULL_HANDLE )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        m_Stop = true;
+    }
+    m_WorkAvailable.notify_all();
+    for ( auto &worker : m_Workers )
+    {
+        worker.join();
+    }
+    m_Workers.clear();
+    m_Jobs.clear();
+    m_Decoded.clear();
+
+    // Goes to the deletion queue like everything else; the caller flushes it.
+    m_Textures.clear();
+    m_CoarseUploads.clear();
+    m_FullUploads.clear();
+    m_ResidentBytes = 0;
+
+    vkDestroySampler( m_Device, m_Sampler, nullptr );
+    m_Device = VK_NULL_HANDLE;
+}
+
+TextureStreamer::TextureId TextureStreamer::load( const std::string &path )
+{
+    TextureId id = static_cast<TextureId>( m_Textures.size() );
+
+    Texture texture;
+    texture.path = path;
+    texture.coarsePending = true;
+    texture.fullPending = true;
+    texture.lastUsedFrame = m_FrameNumber;
+    m_Textures.push_back( std::move( texture ) );
+
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        m_Jobs.push_back( { id, path, true, true } );
+    }
+    m_WorkAvailable.notify_one();
+
+    return id;
+}
+
+void TextureStreamer::beginFrame( uint64_t frameNumber )
+{
+    m_FrameNumber = frameNumber;
+
+    std::deque<Decoded> decoded;
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        decoded.swap( m_Decoded );
+    }
+
+    for ( auto &result : decoded )
+    {
+        Texture &texture = m_Textures[result.id];
+        if ( !result.error.empty() )
+        {
+            std::cerr << "Failed to load texture " << texture.path << ": " << result.error << std::endl;
+            texture.coarsePending = false;
+            texture.fullPending = false;
+            texture.coarseOnly = true;
+            continue;
+        }
+
+        bool hasCoarse = false;
+        for ( auto &upload : result.uploads )
+        {
+            hasCoarse |= !upload.full;
+            ( upload.full ? m_FullUploads : m_CoarseUploads ).push_back( std::move( upload ) );
+        }
+        // Small images skip the coarse copy and go straight to full resolution.
+        if ( !hasCoarse )
+        {
+            texture.coarsePending = false;
+        }
+    }
+}
+
+void TextureStreamer::recordUploads( VkCommandBuffer commandBuffer )
+{
+    m_LastUploadBytes = recordQueuedUploads( commandBuffer, true );
+}
+
+void TextureStreamer::flush( VkCommandPool commandPool, VkQueue queue )
+{
+    {
+        std::unique_lock<std::mutex> lock( m_Mutex );
+        m_WorkDone.wait( lock, [this]() { return m_Jobs.empty() && m_ActiveJobs == 0; } );
+    }
+    // Hands the decoded textures to the upload queues.
+    beginFrame( m_FrameNumber );
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if ( vkAllocateCommandBuffers( m_Device, &allocInfo, &commandBuffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to allocate the texture flush command buffer!" );
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer( commandBuffer, &beginInfo );
+    recordQueuedUploads( commandBuffer, false );
+    vkEndCommandBuffer( commandBuffer );
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    VkResult result = vkQueueSubmit( queue, 1, &submitInfo, VK_NULL_HANDLE );
+    vkQueueWaitIdle( queue );
+    vkFreeCommandBuffers( m_Device, commandPool, 1, &commandBuffer );
+    if ( result != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to submit the texture flush!" );
+    }
+}
+
+VkDeviceSize TextureStreamer::recordQueuedUploads( VkCommandBuffer commandBuffer, bool limited )
+{
+    if ( !m_FallbackUploaded )
+    {
+        recordImageData( commandBuffer, m_FallbackUpload, m_Textures[kFallbackTexture].full.image.get(), 1 );
+        m_FallbackUploaded = true;
+    }
+
+    VkDeviceSize uploadedBytes = 0;
+    // Let at least one upload through per frame, however large.
+    auto withinBudget = [&]( const Upload &upload ) {
+        return !limited || uploadedBytes == 0 || uploadedBytes + upload.pixels.size() <= m_UploadBytesPerFrame;
+    };
+
+    while ( !m_CoarseUploads.empty() && withinBudget( m_CoarseUploads.front() ) )
+    {
+        uploadedBytes += m_CoarseUploads.front().pixels.size();
+        recordUpload( commandBuffer, m_CoarseUploads.front() );
+        m_CoarseUploads.pop_front();
+    }
+
+    while ( !m_FullUploads.empty() && withinBudget( m_FullUploads.front() ) )
+    {
+        const Upload &upload = m_FullUploads.front();
+        Texture &texture = m_Textures[upload.id];
+
+        // Give the coarse copy at least one frame on screen before replacing it.
+        bool ready = texture.residency == Residency::None ? !texture.coarsePending
+                                                          : texture.coarseFrame < m_FrameNumber;
+        if ( limited && !ready )
+        {
+            break;
+        }
+
+        VkDeviceSize estimatedSize = upload.pixels.size();
+        if ( generatesMips( upload.levelOffsets, upload.format ) )
+        {
+            estimatedSize = estimatedSize * 4 / 3;
+        }
+        if ( estimatedSize > m_BudgetBytes )
+        {
+            texture.fullPending = false;
+            texture.coarseOnly = true;
+            m_FullUploads.pop_front();
+            continue;
+        }
+        // Everything resident is still in use; try again next frame.
+        if ( !makeRoom( estimatedSize, upload.id ) )
+        {
+            break;
+        }
+
+        uploadedBytes += upload.pixels.size();
+        recordUpload( commandBuffer, upload );
+        m_FullUploads.pop_front();
+    }
+    return uploadedBytes;
+}
+
+void TextureStreamer::markUsed( TextureId id )
+{
+    Texture &texture = m_Textures[id];
+    texture.lastUsedFrame = m_FrameNumber;
+
+    if ( texture.residency != Residency::Full && !texture.fullPending && !texture.coarseOnly )
+    {
+        requestFull( id );
+    }
+}
+
+VkDescriptorImageInfo TextureStreamer::getDescriptorInfo( TextureId id ) const
+{
+    const Texture &texture = m_Textures[id];
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.sampler = m_Sampler;
+    switch ( texture.residency )
+    {
+    case Residency::Full:
+        imageInfo.imageView = texture.full.view.get();
+        break;
+    case Residency::Coarse:
+        imageInfo.imageView = texture.coarse.view.get();
+        break;
+    case Residency::None:
+        imageInfo.imageView = m_Textures[kFallbackTexture].full.view.get();
+        break;
+    }
+    return imageInfo;
+}
+
+uint64_t TextureStreamer::getVersion( TextureId id ) const
+{
+    return m_Textures[id].version;
+}
+
+void TextureStreamer::workerLoop()
+{
+    for ( ;; )
+    {
+        DecodeJob job;
+        {
+            std::unique_lock<std::mutex> lock( m_Mutex );
+            m_WorkAvailable.wait( lock, [this]() { return m_Stop || !m_Jobs.empty(); } );
+            if ( m_Stop )
+            {
+                return;
+            }
+            job = std::move( m_Jobs.front() );
+            m_Jobs.pop_front();
+            ++m_ActiveJobs;
+        }
+
+        Decoded decoded = decode( job );
+
+        {
+            std::lock_guard<std::mutex> lock( m_Mutex );
+            m_Decoded.push_back( std::move( decoded ) );
+            --m_ActiveJobs;
+        }
+        m_WorkDone.notify_all();
+    }
+}
+
+TextureStreamer::Decoded TextureStreamer::decode( const DecodeJob &job ) const
+{
+    Decoded decoded;
+    decoded.id = job.id;
+
+    if ( isKtx2File( job.path ) )
+    {
+        decodeKtx2( job, decoded );
+        return decoded;
+    }
+
+    int width, height, channels;
+    stbi_uc *data = stbi_load( job.path.c_str(), &width, &height, &channels, STBI_rgb_alpha );
+    if ( !data )
+    {
+        decoded.error = stbi_failure_reason();
+        return decoded;
+    }
+
+    std::vector<unsigned char> pixels( data, data + static_cast<size_t>( width ) * height * 4 );
+    stbi_image_free( data );
+
+    uint32_t fullWidth = static_cast<uint32_t>( width );
+    uint32_t fullHeight = static_cast<uint32_t>( height );
+
+    if ( job.wantCoarse && std::max( fullWidth, fullHeight ) > m_CoarseSize )
+    {
+        uint32_t coarseWidth = fullWidth;
+        uint32_t coarseHeight = fullHeight;
+        std::vector<unsigned char> coarse = halve( pixels, coarseWidth, coarseHeight );
+        while ( std::max( coarseWidth, coarseHeight ) > m_CoarseSize )
+        {
+            coarse = halve( coarse, coarseWidth, coarseHeight );
+        }
+        decoded.uploads.push_back(
+            { job.id, false, kTextureFormat, coarseWidth, coarseHeight, std::move( coarse ), { 0 } } );
+    }
+
+    if ( job.wantFull )
+    {
+        decoded.uploads.push_back( { job.id, true, kTextureFormat, fullWidth, fullHeight, std::move( pixels ), { 0 } } );
+    }
+
+    return decoded;
+}
+
+void TextureStreamer::decodeKtx2( const DecodeJob &job, Decoded &decoded ) const
+{
+    Ktx2Image image;
+    try
+    {
+        image = loadKtx2( job.path, m_TranscodeFormat );
+    }
+    catch ( const std::exception &e )
+    {
+        decoded.error = e.what();
+        return;
+    }
+
+    if ( !isSampleable( image.format ) )
+    {
+        decoded.error = "format " + std::to_string( image.format ) + " can't be sampled on this device";
+        return;
+    }
+
+    auto makeUpload = [&]( bool full, uint32_t firstLevel ) {
+        Upload upload{};
+        upload.id = job.id;
+        upload.full = full;
+        upload.format = image.format;
+        upload.width = std::max( image.width >> firstLevel, 1u );
+        upload.height = std::max( image.height >> firstLevel, 1u );
+        for ( uint32_t level = firstLevel; level < image.levels.size(); ++level )
+        {
+            upload.levelOffsets.push_back( upload.pixels.size() );
+            upload.pixels.insert( upload.pixels.end(), image.levels[level].begin(), image.levels[level].end() );
+        }
+        return upload;
+    };
+
+    uint32_t coarseLevel = 0;
+    while ( coarseLevel + 1 < image.levels.size() &&
+            std::max( image.width >> coarseLevel, image.height >> coarseLevel ) > m_CoarseSize )
+    {
+        ++coarseLevel;
+    }
+
+    if ( job.wantCoarse && coarseLevel > 0 )
+    {
+        decoded.uploads.push_back( makeUpload( false, coarseLevel ) );
+    }
+    if ( job.wantFull )
+    {
+        decoded.uploads.push_back( makeUpload( true, 0 ) );
+    }
+}
+
+bool TextureStreamer::isSampleable( VkFormat format ) const
+{
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties( m_PhysicalDevice, format, &formatProperties );
+    return ( formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT ) != 0;
+}
+
+void TextureStreamer::recordUpload( VkCommandBuffer commandBuffer, const Upload &upload )
+{
+    uint32_t mipLevels = generatesMips( upload.levelOffsets, upload.format )
+                             ? mipLevelCount( upload.width, upload.height )
+                             : static_cast<uint32_t>( upload.levelOffsets.size() );
+    Image image = createImage( upload.width, upload.height, mipLevels, upload.format );
+    recordImageData( commandBuffer, upload, image.image.get(), mipLevels );
+
+    Texture &texture = m_Textures[upload.id];
+    if ( upload.full )
+    {
+        m_ResidentBytes += image.size;
+        texture.full = std::move( image );
+        texture.residency = Residency::Full;
+        texture.fullPending = false;
+    }
+    else
+    {
+        texture.coarse = std::move( image );
+        texture.coarseFrame = m_FrameNumber;
+        texture.coarsePending = false;
+        if ( texture.residency == Residency::None )
+        {
+            texture.residency = Residency::Coarse;
+        }
+    }
+    ++texture.version;
+}
+
+void TextureStreamer::recordImageData( VkCommandBuffer commandBuffer,
+                                       const Upload &upload,
+                                       VkImage image,
+                                       uint32_t mipLevels )
+{
+    VkDeviceSize imageSize = upload.pixels.size();
+
+    // Released when this returns, destroyed once the frame has retired.
+    VkBuffer       stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer( m_PhysicalDevice,
+                  m_Device,
+                  imageSize,
+                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  stagingBuffer,
+                  stagingBufferMemory );
+    UniqueDeviceMemory stagingMemory( m_Device, stagingBufferMemory, m_DeletionQueue );
+    UniqueBuffer       staging( m_Device, stagingBuffer, m_DeletionQueue );
+
+    void *data;
+    vkMapMemory( m_Device, stagingMemory.get(), 0, imageSize, 0, &data );
+    memcpy( data, upload.pixels.data(), static_cast<size_t>( imageSize ) );
+    vkUnmapMemory( m_Device, stagingMemory.get() );
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          0, 0, nullptr, 0, nullptr, 1, &barrier );
+
+    uint32_t storedLevels = static_cast<uint32_t>( upload.levelOffsets.size() );
+    std::vector<VkBufferImageCopy> regions( storedLevels );
+    for ( uint32_t level = 0; level < storedLevels; ++level )
+    {
+        VkBufferImageCopy &region = regions[level];
+        region.bufferOffset = upload.levelOffsets[level];
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = { 0, 0, 0 };
+        region.imageExtent = { std::max( upload.width >> level, 1u ), std::max( upload.height >> level, 1u ), 1 };
+    }
+    vkCmdCopyBufferToImage( commandBuffer,
+                            staging.get(),
+                            image,
+                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            storedLevels, regions.data() );
+
+    // Each missing level is blitted from the one above it, which is then done and can
+    // move to its sampling layout.
+    barrier.subresourceRange.levelCount = 1;
+    int32_t mipWidth = static_cast<int32_t>( upload.width );
+    int32_t mipHeight = static_cast<int32_t>( upload.height );
+    for ( uint32_t i = storedLevels; i < mipLevels; ++i )
+    {
+        barrier.subresourceRange.baseMipLevel = i - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier( commandBuffer,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              0, 0, nullptr, 0, nullptr, 1, &barrier );
+
+        VkImageBlit blit{};
+        blit.srcOffsets[0] = { 0, 0, 0 };
+        blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = i - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        blit.dstOffsets[0] = { 0, 0, 0 };
+        blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = i;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+        vkCmdBlitImage( commandBuffer,
+                        image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        1, &blit,
+                        VK_FILTER_LINEAR );
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier( commandBuffer,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                              0, 0, nullptr, 0, nullptr, 1, &barrier );
+
+        mipWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+        mipHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+    }
+
+    bool generated = storedLevels < mipLevels;
+    barrier.subresourceRange.baseMipLevel = generated ? mipLevels - 1 : 0;
+    barrier.subresourceRange.levelCount = generated ? 1 : mipLevels;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                          0, 0, nullptr, 0, nullptr, 1, &barrier );
+}
+
+TextureStreamer::Image TextureStreamer::createImage( uint32_t width,
+                                                    uint32_t height,
+                                                    uint32_t mipLevels,
+                                                    VkFormat format )
+{
+    VkImage        rawImage;
+    VkDeviceMemory rawMemory;
+    ::createImage( m_PhysicalDevice,
+                   m_Device,
+                   width,
+                   height,
+                   mipLevels,
+                   format,
+                   VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                   rawImage,
+                   rawMemory );
+
+    Image image;
+    image.memory = UniqueDeviceMemory( m_Device, rawMemory, m_DeletionQueue );
+    image.image = UniqueImage( m_Device, rawImage, m_DeletionQueue );
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements( m_Device, rawImage, &memRequirements );
+    image.size = memRequirements.size;
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = rawImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = mipLevels;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+    VkImageView view;
+    if ( vkCreateImageView( m_Device, &viewInfo, nullptr, &view ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to create texture image view!" );
+    }
+    image.view = UniqueImageView( m_Device, view, m_DeletionQueue );
+
+    return image;
+}
+
+bool TextureStreamer::makeRoom( VkDeviceSize size, TextureId keep )
+{
+    while ( m_ResidentBytes + size > m_BudgetBytes )
+    {
+        // Least recently used full image, skipping anything drawn this frame.
+        TextureId victim = kFallbackTexture;
+        for ( TextureId id = kFallbackTexture + 1; id < m_Textures.size(); ++id )
+        {
+            const Texture &texture = m_Textures[id];
+            if ( id == keep || texture.residency != Residency::Full || texture.lastUsedFrame >= m_FrameNumber )
+            {
+                continue;
+            }
+            if ( victim == kFallbackTexture || texture.lastUsedFrame < m_Textures[victim].lastUsedFrame )
+            {
+                victim = id;
+            }
+        }
+        if ( victim == kFallbackTexture )
+        {
+            return false;
+        }
+
+        Texture &texture = m_Textures[victim];
+        m_ResidentBytes -= texture.full.size;
+        texture.full = {};
+        texture.residency = texture.coarse.image ? Residency::Coarse : Residency::None;
+        ++texture.version;
+    }
+    return true;
+}
+
+void TextureStreamer::requestFull( TextureId id )
+{
+    Texture &texture = m_Textures[id];
+    texture.fullPending = true;
+
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        m_Jobs.push_back( { id, texture.path, false, true } );
+    }
+    m_WorkAvailable.notify_one();
+}
@@ -0,0 +1,193 @@
+#pragma once
+// Texture loading that never blocks the render loop.
+//
+// Files are decoded on worker threads. Every texture becomes resident in two steps:
+// first a coarse copy no larger than coarseSize, uploaded the frame its decode
+// finishes so something is on screen right away, then the full resolution image a
+// frame later. Both go through a staging buffer and get their mip chain built on the
+// GPU with vkCmdBlitImage. Uploads are recorded into the frame's own command buffer,
+// ahead of the render pass, and capped at uploadBytesPerFrame.
+//
+// .ktx2 files keep their stored mip chain and block-compressed format (BC, ASTC,
+// ETC2), which has to be sampleable on the device. Basis Universal files are
+// transcoded on the workers to the best compressed format the device supports; see
+// Ktx2.h. Their coarse copy is simply the tail of the mip chain.
+//
+// Full resolution images count against budgetBytes. When a new one doesn't fit, the
+// least recently used ones fall back to their coarse copy; they are streamed in again
+// when markUsed() is called for them. Evicted images and spent staging buffers go to
+// the deletion queue, which destroys them once the frames using them have retired.
+
+#include "DeletionQueue.h"
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TextureStreamerCreateInfo
+{
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice         device = VK_NULL_HANDLE;
+    // Collected by the caller after every frame's fence wait. Required.
+    DeletionQueue   *deletionQueue = nullptr;
+    uint32_t         workerCount = 2;
+    VkDeviceSize     budgetBytes = 256ull << 20;
+    VkDeviceSize     uploadBytesPerFrame = 32ull << 20;
+    uint32_t         coarseSize = 64;
+    // Compressed formats are only used when their feature is enabled here.
+    VkPhysicalDeviceFeatures enabledFeatures{};
+};
+
+class TextureStreamer
+{
+public:
+    using TextureId = uint32_t;
+    // Always valid: a 1x1 white texture.
+    static constexpr TextureId kFallbackTexture = 0;
+
+    void create( const TextureStreamerCreateInfo &createInfo );
+    void cleanup();
+
+    // Queues the file for decoding and returns at once. Until the coarse copy is
+    // resident the texture samples as the fallback.
+    TextureId load( const std::string &path );
+
+    // Call once per frame after the frame's fence was waited on, before anything is
+    // recorded. frameNumber must increase by one every frame.
+    void beginFrame( uint64_t frameNumber );
+    // Records this frame's uploads. Must be outside of a render pass.
+    void recordUploads( VkCommandBuffer commandBuffer );
+    // Blocks until every texture loaded so far is decoded and uploaded, at full
+    // resolution where it fits the budget, ignoring the per-frame cap. Submits to queue
+    // and waits for it. For replays, whose frames must not depend on decode times.
+    void flush( VkCommandPool commandPool, VkQueue queue );
+
+    // Keeps the texture's full resolution image resident, streaming it in if needed.
+    void markUsed( TextureId id );
+
+    VkDescriptorImageInfo getDescriptorInfo( TextureId id ) const;
+    // Changes whenever getDescriptorInfo() would return something new for the texture.
+    uint64_t getVersion( TextureId id ) const;
+
+    VkDeviceSize getResidentBytes() const { return m_ResidentBytes; }
+    // Pixel data the last recordUploads copied.
+    VkDeviceSize getLastUploadBytes() const { return m_LastUploadBytes; }
+    // What Basis Universal files are transcoded to.
+    VkFormat     getTranscodeFormat() const { return m_TranscodeFormat; }
+
+private:
+    enum class Residency
+    {
+        None,
+        Coarse,
+        Full,
+    };
+
+    // Members are released in reverse order: view, image, then memory.
+    struct Image
+    {
+        UniqueDeviceMemory memory;
+        UniqueImage        image;
+        UniqueImageView    view;
+        VkDeviceSize       size = 0;
+    };
+
+    struct Texture
+    {
+        std::string path;
+        Residency   residency = Residency::None;
+        Image       coarse;
+        Image       full;
+        uint64_t    coarseFrame = 0;
+        uint64_t    lastUsedFrame = 0;
+        uint64_t    version = 0;
+        bool        coarsePending = false;
+        // A decode for the full image is queued or its pixels wait for upload.
+        bool        fullPending = false;
+        // The full image never fits the budget or failed to load; don't stream it again.
+        bool        coarseOnly = false;
+    };
+
+    struct DecodeJob
+    {
+        TextureId   id;
+        std::string path;
+        bool        wantCoarse;
+        bool        wantFull;
+    };
+
+    struct Upload
+    {
+        TextureId                  id;
+        bool                       full;
+        VkFormat                   format;
+        uint32_t                   width;
+        uint32_t                   height;
+        // Every mip level back to back.
+        std::vector<unsigned char> pixels;
+        // Offset of each level in pixels. With a single uncompressed level the rest of
+        // the chain is generated on the GPU.
+        std::vector<VkDeviceSize>  levelOffsets;
+    };
+
+    struct Decoded
+    {
+        TextureId           id;
+        std::vector<Upload> uploads;
+        std::string         error;
+    };
+
+    void workerLoop();
+    Decoded decode( const DecodeJob &job ) const;
+    void    decodeKtx2( const DecodeJob &job, Decoded &decoded ) const;
+    bool    isSampleable( VkFormat format ) const;
+
+    // Unlimited skips the per-frame cap, and the frame each coarse copy gets on screen.
+    VkDeviceSize recordQueuedUploads( VkCommandBuffer commandBuffer, bool limited );
+    void recordUpload( VkCommandBuffer commandBuffer, const Upload &upload );
+    void recordImageData( VkCommandBuffer commandBuffer,
+                          const Upload &upload,
+                          VkImage image,
+                          uint32_t mipLevels );
+    Image createImage( uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format );
+    bool makeRoom( VkDeviceSize size, TextureId keep );
+    void requestFull( TextureId id );
+
+private:
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkDevice         m_Device = VK_NULL_HANDLE;
+    DeletionQueue   *m_DeletionQueue = nullptr;
+    VkDeviceSize     m_BudgetBytes = 0;
+    VkDeviceSize     m_UploadBytesPerFrame = 0;
+    uint32_t         m_CoarseSize = 0;
+    VkFormat         m_TranscodeFormat = VK_FORMAT_UNDEFINED;
+    VkSampler        m_Sampler = VK_NULL_HANDLE;
+
+    std::vector<Texture> m_Textures;
+    uint64_t             m_FrameNumber = 0;
+    VkDeviceSize         m_ResidentBytes = 0;
+    VkDeviceSize         m_LastUploadBytes = 0;
+
+    std::deque<Upload>   m_CoarseUploads;
+    std::deque<Upload>   m_FullUploads;
+    // The fallback's pixels go out with the first recordUploads().
+    Upload               m_FallbackUpload{};
+    bool                 m_FallbackUploaded = false;
+
+    std::vector<std::thread> m_Workers;
+    std::mutex               m_Mutex;
+    std::condition_variable  m_WorkAvailable;
+    // Signalled whenever a worker finishes a decode.
+    std::condition_variable  m_WorkDone;
+    std::deque<DecodeJob>    m_Jobs;
+    // Taken off m_Jobs but not in m_Decoded yet.
+    uint32_t                 m_ActiveJobs = 0;
+    std::deque<Decoded>      m_Decoded;
+    bool                     m_Stop = false;
+};
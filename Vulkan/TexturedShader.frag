@@ -0,0 +1,34 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Set per pipeline variant, see ShaderConstant in App.h.
+layout(constant_id = 0) const bool USE_TEXTURE = true;
+layout(constant_id = 1) const bool USE_VERTEX_COLOR = true;
+// Box filter radius in texels; 0 takes a single sample.
+layout(constant_id = 2) const int BLUR_RADIUS = 0;
+
+layout(binding = 1) uniform sampler2D texSampler;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 0) out vec4 outColor;
+
+void main() 
+{
+    outColor = USE_VERTEX_COLOR ? vec4(fragColor, 1.0) : vec4(1.0);
+
+    if (USE_TEXTURE)
+    {
+        vec2 texelSize = 1.0 / vec2(textureSize(texSampler, 0));
+        vec4 sum = vec4(0.0);
+        for (int y = -BLUR_RADIUS; y <= BLUR_RADIUS; ++y)
+        {
+            for (int x = -BLUR_RADIUS; x <= BLUR_RADIUS; ++x)
+            {
+                sum += texture(texSampler, fragTexCoord + vec2(x, y) * texelSize);
+            }
+        }
+        float taps = float((2 * BLUR_RADIUS + 1) * (2 * BLUR_RADIUS + 1));
+        outColor *= sum / taps;
+    }
+}
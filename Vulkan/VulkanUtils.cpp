@@ -0,0 +1,315 @@
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+std::vector<char> readFile( const std::string &filename )
+{
+    std::ifstream file( filename, std::ios::ate | std::ios::binary );
+    if ( !file.is_open() )
+    {
+        throw std::runtime_error( "failed to open file " + filename );
+    }
+
+    size_t fileSize = (size_t)file.tellg();
+    std::vector<char> buffer( fileSize );
+
+    file.seekg( 0 );
+    file.read( buffer.data(), fileSize );
+
+    return buffer;
+}
+
+std::optional<uint32_t> findMemoryTypeIndex( VkPhysicalDevice physicalDevice,
+                                             uint32_t typeFilter,
+                                             VkMemoryPropertyFlags properties )
+{
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties( physicalDevice, &memProperties );
+    for ( uint32_t i = 0; i < memProperties.memoryTypeCount; ++i )
+    {
+        /*
+        VkMemoryRequirements::memoryTypeBits is a bitfield that sets a bit for every memoryType 
+        that is supported for the resource. Therefore we need to check if the bit at index i is
+        set while also testing the required memory property flags while iterating over the memory 
+        types. Leaving this here just in case I'm not the only one that got confused.
+        */
+        if ( typeFilter & ( 1 << i ) && 
+             ( memProperties.memoryTypes[i].propertyFlags & properties ) == properties )
+        {
+            return i;
+        }
+    }
+
+    return std::nullopt;
+}
+
+uint32_t findMemoryType( VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties )
+{
+    std::optional<uint32_t> index = findMemoryTypeIndex( physicalDevice, typeFilter, properties );
+    if ( !index.has_value() )
+    {
+        throw std::runtime_error( "Failed to find suitable memory type!" );
+    }
+
+    return index.value();
+}
+
+static void allocateBuffer( VkPhysicalDevice physicalDevice,
+                            VkDevice device,
+                            const VkBufferCreateInfo &bufferInfo,
+                            VkMemoryPropertyFlags properties,
+                            VkBuffer &buffer,
+                            VkDeviceMemory &bufferMemory )
+{
+    if ( vkCreateBuffer( device, &bufferInfo, nullptr, &buffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to create buffer!" );
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements( device, buffer, &memRequirements );
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType( physicalDevice, memRequirements.memoryTypeBits, properties );
+
+    if ( vkAllocateMemory( device, &allocInfo, nullptr, &bufferMemory ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to allocate buffer memory!" );
+    }
+
+    vkBindBufferMemory( device, buffer, bufferMemory, 0 );
+}
+
+void createBuffer( VkPhysicalDevice physicalDevice,
+                   VkDevice device,
+                   VkDeviceSize size,
+                   VkBufferUsageFlags usage,
+                   VkMemoryPropertyFlags properties,
+                   VkBuffer &buffer,
+                   VkDeviceMemory &bufferMemory )
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    allocateBuffer( physicalDevice, device, bufferInfo, properties, buffer, bufferMemory );
+}
+
+void createSharedBuffer( VkPhysicalDevice physicalDevice,
+                         VkDevice device,
+                         VkDeviceSize size,
+                         VkBufferUsageFlags usage,
+                         VkMemoryPropertyFlags properties,
+                         const std::vector<uint32_t> &queueFamilies,
+                         VkBuffer &buffer,
+                         VkDeviceMemory &bufferMemory )
+{
+    std::vector<uint32_t> uniqueFamilies;
+    for ( uint32_t family : queueFamilies )
+    {
+        if ( std::find( uniqueFamilies.begin(), uniqueFamilies.end(), family ) == uniqueFamilies.end() )
+        {
+            uniqueFamilies.push_back( family );
+        }
+    }
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    if ( uniqueFamilies.size() > 1 )
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>( uniqueFamilies.size() );
+        bufferInfo.pQueueFamilyIndices = uniqueFamilies.data();
+    }
+    else
+    {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    allocateBuffer( physicalDevice, device, bufferInfo, properties, buffer, bufferMemory );
+}
+
+void createImage( VkPhysicalDevice physicalDevice,
+                  VkDevice device,
+                  uint32_t width,
+                  uint32_t height,
+                  uint32_t mipLevels,
+                  VkFormat format,
+                  VkImageUsageFlags usage,
+                  VkMemoryPropertyFlags properties,
+                  VkImage &image,
+                  VkDeviceMemory &imageMemory )
+{
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = width;
+    imageInfo.extent.height = height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = usage;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if ( vkCreateImage( device, &imageInfo, nullptr, &image ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to create image!" );
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements( device, image, &memRequirements );
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType( physicalDevice, memRequirements.memoryTypeBits, properties );
+
+    if ( vkAllocateMemory( device, &allocInfo, nullptr, &imageMemory ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to allocate image memory!" );
+    }
+
+    vkBindImageMemory( device, image, imageMemory, 0 );
+}
+
+void copyBuffer( VkDevice device,
+                 VkCommandPool commandPool,
+                 VkQueue queue,
+                 VkBuffer srcBuffer,
+                 VkBuffer dstBuffer,
+                 VkDeviceSize size )
+{
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    vkAllocateCommandBuffers( device, &allocInfo, &commandBuffer );
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer( commandBuffer, &beginInfo );
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = 0; // Optional
+    copyRegion.dstOffset = 0; // Optional
+    copyRegion.size = size; // can't use the VK_WOLE_SIZE
+    vkCmdCopyBuffer( commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion );
+
+    vkEndCommandBuffer( commandBuffer );
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    vkQueueSubmit( queue, 1, &submitInfo, VK_NULL_HANDLE );
+    vkQueueWaitIdle( queue );
+
+    vkFreeCommandBuffers( device, commandPool, 1, &commandBuffer );
+}
+
+bool hasDeviceExtension( VkPhysicalDevice physicalDevice, const char *extension )
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties( physicalDevice, nullptr, &extensionCount, nullptr );
+    std::vector<VkExtensionProperties> extensions( extensionCount );
+    vkEnumerateDeviceExtensionProperties( physicalDevice, nullptr, &extensionCount, extensions.data() );
+
+    for ( const auto &properties : extensions )
+    {
+        if ( strcmp( properties.extensionName, extension ) == 0 )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void recordImageBarrier( VkCommandBuffer commandBuffer,
+                         VkImage image,
+                         VkImageLayout oldLayout,
+                         VkImageLayout newLayout,
+                         VkPipelineStageFlags srcStage,
+                         VkAccessFlags srcAccess,
+                         VkPipelineStageFlags dstStage,
+                         VkAccessFlags dstAccess,
+                         uint32_t baseMipLevel,
+                         uint32_t mipLevelCount )
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = baseMipLevel;
+    barrier.subresourceRange.levelCount = mipLevelCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier( commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier );
+}
+
+VkShaderModule createShaderModule( VkDevice device, std::span<const char> code )
+{
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t *>( code.data() );
+    VkShaderModule shaderModule;
+    if ( vkCreateShaderModule( device, &createInfo, nullptr, &shaderModule ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "failed to create shader module!" );
+    }
+
+    return shaderModule;
+}
+
+VkPipeline createComputePipeline( VkDevice device,
+                                  VkShaderModule shaderModule,
+                                  VkPipelineLayout layout,
+                                  const VkSpecializationInfo *specialization,
+                                  VkPipelineCache cache )
+{
+    VkPipelineShaderStageCreateInfo stageInfo{};
+    stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    stageInfo.module = shaderModule;
+    stageInfo.pName = "main";
+    stageInfo.pSpecializationInfo = specialization;
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = stageInfo;
+    pipelineInfo.layout = layout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    VkPipeline pipeline;
+    if ( vkCreateComputePipelines( device, cache, 1, &pipelineInfo, nullptr, &pipeline ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create compute pipeline!" );
+    }
+
+    return pipeline;
+}
@@ -0,0 +1,82 @@
+#pragma once
+// Free-standing helpers shared by App and the subsystems that live outside of it.
+// They only need the raw device handles, so they can also be used by tools
+// that don't create a window.
+
+#include <vulkan/vulkan.h>
+
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+std::vector<char> readFile( const std::string &filename );
+
+// Returns the first memory type allowed by typeFilter that has all of the requested
+// properties, or std::nullopt when the device doesn't expose such a type.
+std::optional<uint32_t> findMemoryTypeIndex( VkPhysicalDevice physicalDevice,
+                                             uint32_t typeFilter,
+                                             VkMemoryPropertyFlags properties );
+
+uint32_t findMemoryType( VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties );
+
+void createBuffer( VkPhysicalDevice physicalDevice,
+                   VkDevice device,
+                   VkDeviceSize size,
+                   VkBufferUsageFlags usage,
+                   VkMemoryPropertyFlags properties,
+                   VkBuffer &buffer,
+                   VkDeviceMemory &bufferMemory );
+
+// Like createBuffer, but the buffer may be used from every listed queue family without
+// ownership transfers (concurrent sharing when they differ).
+void createSharedBuffer( VkPhysicalDevice physicalDevice,
+                         VkDevice device,
+                         VkDeviceSize size,
+                         VkBufferUsageFlags usage,
+                         VkMemoryPropertyFlags properties,
+                         const std::vector<uint32_t> &queueFamilies,
+                         VkBuffer &buffer,
+                         VkDeviceMemory &bufferMemory );
+
+void createImage( VkPhysicalDevice physicalDevice,
+                  VkDevice device,
+                  uint32_t width,
+                  uint32_t height,
+                  uint32_t mipLevels,
+                  VkFormat format,
+                  VkImageUsageFlags usage,
+                  VkMemoryPropertyFlags properties,
+                  VkImage &image,
+                  VkDeviceMemory &imageMemory );
+
+// Records a one-off copy on the given pool, submits it and waits for the queue to go idle.
+void copyBuffer( VkDevice device,
+                 VkCommandPool commandPool,
+                 VkQueue queue,
+                 VkBuffer srcBuffer,
+                 VkBuffer dstBuffer,
+                 VkDeviceSize size );
+
+bool hasDeviceExtension( VkPhysicalDevice physicalDevice, const char *extension );
+
+// Records a layout transition / memory barrier for mip levels of a single-layer color image.
+void recordImageBarrier( VkCommandBuffer commandBuffer,
+                         VkImage image,
+                         VkImageLayout oldLayout,
+                         VkImageLayout newLayout,
+                         VkPipelineStageFlags srcStage,
+                         VkAccessFlags srcAccess,
+                         VkPipelineStageFlags dstStage,
+                         VkAccessFlags dstAccess,
+                         uint32_t baseMipLevel = 0,
+                         uint32_t mipLevelCount = 1 );
+
+// The code has to stay 4-byte aligned; both readFile and archive payloads are.
+VkShaderModule createShaderModule( VkDevice device, std::span<const char> code );
+
+VkPipeline createComputePipeline( VkDevice device,
+                                  VkShaderModule shaderModule,
+                                  VkPipelineLayout layout,
+                                  const VkSpecializationInfo *specialization = nullptr,
+                                  VkPipelineCache cache = VK_NULL_HANDLE );
@@ -1,12 +1,26 @@
 #include "App.h"
+#include "Options.h"
 #include <iostream>
 
-int main()
+int main( int argc, char **argv )
 {
-    App app;
-
     try
     {
+        AppOptions options = parseCommandLine( argc, argv );
+        if ( !options.packArchive.empty() )
+        {
+            AssetArchive::write( options.packArchive, options.packFiles, options.packCompression );
+            std::cout << "Packed " << options.packFiles.size() << " files into " << options.packArchive << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if ( !options.pointCloudInput.empty() )
+        {
+            PointCloud::build( options.pointCloudInput, options.pointCloudOutput );
+            std::cout << "Wrote point cloud octree " << options.pointCloudOutput << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        App app( options );
         app.run();
     }
     catch ( const std::exception &e )